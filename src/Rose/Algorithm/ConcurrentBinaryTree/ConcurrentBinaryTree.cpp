@@ -23,11 +23,12 @@ ref<ConcurrentBinaryTree> ConcurrentBinaryTree::Create(CommandContext& context,
 
 	ShaderDefines defs { { "CBT_HEAP_BUFFER_COUNT", std::to_string(arraySize) } };
 
-	auto cbtSrc    = FindShaderPath("cbt/cbt.cs.slang");
+	auto cbtSrc    = FindShaderPath("cbt.cs.slang");
 	cbt->cbtReducePrepassPipeline = Pipeline::CreateCompute(context.GetDevice(), ShaderModule::Create(context.GetDevice(), cbtSrc, "SumReducePrepass", "sm_6_7", defs));
 	cbt->cbtReducePipeline        = Pipeline::CreateCompute(context.GetDevice(), ShaderModule::Create(context.GetDevice(), cbtSrc, "SumReduce", "sm_6_7", defs));
 	cbt->dispatchArgsPipeline     = Pipeline::CreateCompute(context.GetDevice(), ShaderModule::Create(context.GetDevice(), cbtSrc, "WriteIndirectDispatchArgs", "sm_6_7", defs));
 	cbt->drawArgsPipeline         = Pipeline::CreateCompute(context.GetDevice(), ShaderModule::Create(context.GetDevice(), cbtSrc, "WriteIndirectDrawArgs", "sm_6_7", defs));
+	cbt->indirectArgsPipeline     = Pipeline::CreateCompute(context.GetDevice(), ShaderModule::Create(context.GetDevice(), cbtSrc, "WriteIndirectArgs", "sm_6_7", defs));
 	return cbt;
 }
 ConcurrentBinaryTree::~ConcurrentBinaryTree() {
@@ -54,13 +55,9 @@ void ConcurrentBinaryTree::Build(CommandContext& context) {
 
 		context->bindPipeline(vk::PipelineBindPoint::eCompute, ***cbtReducePrepassPipeline);
 		context.BindDescriptors(*cbtReducePrepassPipeline->Layout(), *descriptorSets);
-		context.ExecuteBarriers();
 		params["u_PassID"] = it;
-		for (uint32_t i = 0; i < trees.size(); i++) {
-			params["u_CbtID"] = i;
-			context.PushConstants(*cbtReducePrepassPipeline->Layout(), params);
-			context->dispatch((((1 << it) >> 5) + 255) / 256, 1u, 1u);
-		}
+		context.PushConstants(*cbtReducePrepassPipeline->Layout(), params);
+		context->dispatch((((1 << it) >> 5) + 255) / 256, numTrees, 1u);
 		it -= 5;
 	}
 	context->bindPipeline(vk::PipelineBindPoint::eCompute, ***cbtReducePipeline);
@@ -74,11 +71,8 @@ void ConcurrentBinaryTree::Build(CommandContext& context) {
 		context.ExecuteBarriers();
 
 		params["u_PassID"] = it;
-		for (uint32_t i = 0; i < trees.size(); i++) {
-			params["u_CbtID"] = i;
-			context.PushConstants(*cbtReducePipeline->Layout(), params);
-			context->dispatch(((1u << it) + 255) / 256, 1u, 1u);
-		}
+		context.PushConstants(*cbtReducePipeline->Layout(), params);
+		context->dispatch(((1u << it) + 255) / 256, numTrees, 1u);
 	}
 }
 
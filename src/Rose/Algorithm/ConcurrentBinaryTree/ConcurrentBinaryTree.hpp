@@ -16,6 +16,7 @@ private:
 	ref<Pipeline> cbtReducePipeline = {};
 	ref<Pipeline> dispatchArgsPipeline = {};
 	ref<Pipeline> drawArgsPipeline = {};
+	ref<Pipeline> indirectArgsPipeline = {};
 
 	uint32_t numTrees = 1;
 	uint32_t maxDepth = 6;
@@ -31,8 +32,12 @@ public:
 	inline uint32_t MaxDepth() const { return maxDepth; }
 	inline bool     Square() const { return squareMode; }
 
+	// Sum-reduces all trees at once. Each pass is a single dispatch, with one row of workgroups per tree.
 	void Build(CommandContext& context);
 
+	// Number of dispatches recorded by Build(), independent of ArraySize()
+	inline uint32_t BuildDispatchCount() const { return 1 + (uint32_t)std::max<int>(0, (int)maxDepth - 5); }
+
 	inline ShaderParameter GetShaderParameter() const {
 		ShaderParameter params = {};
 		for (uint32_t i = 0; i < buffers.size(); i++)
@@ -51,6 +56,14 @@ public:
 		params["output"] = buf;
 		context.Dispatch(*drawArgsPipeline, numTrees, params);
 	}
+	// Writes per-tree dispatch and draw arguments in a single dispatch. Element i of each buffer belongs to tree i.
+	inline void WriteIndirectArgs(CommandContext& context, const BufferView& dispatchArgs, const BufferView& drawArgs, const uint32_t workgroupDim) const {
+		ShaderParameter params = GetShaderParameter();
+		params["dispatchArgs"] = dispatchArgs;
+		params["drawArgs"] = drawArgs;
+		params["blockDim"] = workgroupDim;
+		context.Dispatch(*indirectArgsPipeline, numTrees, params);
+	}
 };
 
 }
\ No newline at end of file
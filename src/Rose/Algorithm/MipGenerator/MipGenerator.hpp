@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Rose/Core/PipelineCache.hpp>
+#include <Rose/Core/TransientResourceCache.hpp>
+
+namespace RoseEngine {
+
+// How the 2x2 texels under a texel of the next level are combined. Texels past the edge of an odd sized level are skipped.
+enum class MipReduction {
+	eAverage,
+	eMax,
+	eMin,
+	eSum, // for importance maps sampled hierarchically
+};
+
+// Generates the mip chain of an image in a single dispatch, in the style of AMD's single pass downsampler.
+// Each workgroup reduces a 64x64 tile of level 0 to levels 1 to 6, and the last workgroup to finish
+// (found with a global atomic counter) reduces level 6 to levels 7 to 12.
+// sRGB images are written through UNORM views and filtered in linear space.
+class MipGenerator {
+private:
+	static const uint32_t kMaxLevels = 12; // levels written per dispatch, the size of dstLevels in MipGenerator.cs.slang
+
+	PipelineCache mPipeline = PipelineCache(FindShaderPath("MipGenerator.cs.slang"), "main", PipelineLayoutInfo{
+		.descriptorBindingFlags = { { "dstLevels", vk::DescriptorBindingFlagBits::ePartiallyBound } } });
+
+	// The format the generator reads and writes images of format through
+	inline static vk::Format GetStorageFormat(const vk::Format format) {
+		switch (format) {
+		case vk::Format::eR8Srgb:       return vk::Format::eR8Unorm;
+		case vk::Format::eR8G8Srgb:     return vk::Format::eR8G8Unorm;
+		case vk::Format::eR8G8B8A8Srgb: return vk::Format::eR8G8B8A8Unorm;
+		default: return format;
+		}
+	}
+	// The image format qualifier for storage views of format, or nullptr if the shader can't write it
+	inline static const char* GetShaderImageFormat(const vk::Format format) {
+		switch (format) {
+		case vk::Format::eR8Unorm:                 return "r8";
+		case vk::Format::eR8G8Unorm:               return "rg8";
+		case vk::Format::eR8G8B8A8Unorm:           return "rgba8";
+		case vk::Format::eR16Unorm:                return "r16";
+		case vk::Format::eR16G16Unorm:             return "rg16";
+		case vk::Format::eR16G16B16A16Unorm:       return "rgba16";
+		case vk::Format::eA2B10G10R10UnormPack32:  return "rgb10_a2";
+		case vk::Format::eB10G11R11UfloatPack32:   return "r11f_g11f_b10f";
+		case vk::Format::eR16Sfloat:               return "r16f";
+		case vk::Format::eR16G16Sfloat:            return "rg16f";
+		case vk::Format::eR16G16B16A16Sfloat:      return "rgba16f";
+		case vk::Format::eR32Sfloat:               return "r32f";
+		case vk::Format::eR32G32Sfloat:            return "rg32f";
+		case vk::Format::eR32G32B32A32Sfloat:      return "rgba32f";
+		default: return nullptr;
+		}
+	}
+
+	inline static bool SupportsQuadOperations(const Device& device) {
+		const auto subgroup = device.PhysicalDevice().getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>().get<vk::PhysicalDeviceSubgroupProperties>();
+		return (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) && (subgroup.supportedOperations & vk::SubgroupFeatureFlagBits::eQuad);
+	}
+
+public:
+	// Adds the usage and create flags the generator needs to info.
+	// Returns false, leaving info unchanged, if the device can't write info's format from a compute shader.
+	inline static bool Configure(const Device& device, ImageInfo& info) {
+		const vk::Format storageFormat = GetStorageFormat(info.format);
+		if (!GetShaderImageFormat(storageFormat) || info.type != vk::ImageType::e2D)
+			return false;
+		const vk::FormatFeatureFlags features = device.PhysicalDevice().getFormatProperties(storageFormat).optimalTilingFeatures;
+		if (!(features & vk::FormatFeatureFlagBits::eStorageImage) || !(features & vk::FormatFeatureFlagBits::eSampledImage))
+			return false;
+		info.usage |= vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+		if (storageFormat != info.format)
+			info.createFlags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+		return true;
+	}
+
+	// Generates levels 1 and up of every array layer of image from level 0.
+	// The image must have been created with the flags from Configure.
+	inline void operator()(CommandContext& context, const ref<Image>& image, const MipReduction reduction = MipReduction::eAverage) {
+		const ImageInfo& info = image->Info();
+		if (info.mipLevels < 2) return;
+
+		const vk::Format storageFormat = GetStorageFormat(info.format);
+		const char* imageFormat = GetShaderImageFormat(storageFormat);
+		if (!imageFormat || !(info.usage & vk::ImageUsageFlagBits::eStorage) || (storageFormat != info.format && !(info.createFlags & vk::ImageCreateFlagBits::eMutableFormat)))
+			throw std::runtime_error("MipGenerator can't write " + vk::to_string(info.format) + " image. Create it with MipGenerator::Configure");
+
+		const ShaderDefines defines {
+			{ "REDUCTION", std::to_string((uint32_t)reduction) },
+			{ "SRGB", storageFormat != info.format ? "1" : "0" },
+			{ "IMAGE_FORMAT", "\"" + std::string(imageFormat) + "\"" },
+			{ "USE_QUAD_OPERATIONS", SupportsQuadOperations(context.GetDevice()) ? "1" : "0" } };
+		const ref<Pipeline> pipeline = mPipeline.get(context.GetDevice(), defines);
+
+		context.PushDebugLabel("MipGenerator");
+
+		auto counter = context.GetTransientBuffer<uint32_t>(1, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferDst);
+
+		for (uint32_t layer = 0; layer < info.arrayLayers; layer++) {
+			for (uint32_t base = 0; base + 1 < info.mipLevels;) {
+				const uint2 srcExtent = uint2(GetLevelExtent(info.extent, base));
+				// the last workgroup reduces a single 64x64 tile of level base+6, so larger images take more than one dispatch
+				const uint32_t levelCount = std::min(info.mipLevels - 1 - base, std::max(srcExtent.x, srcExtent.y) > 4096 ? 6 : kMaxLevels);
+				const uint2 tileCount = (srcExtent + 63u) / 64u;
+
+				ShaderParameter params = {};
+				params["srcLevel"] = ImageParameter{
+					.image = ImageView::Create(image, vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, base, 1, layer, 1 }, vk::ImageViewType::e2D, {}, storageFormat),
+					.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+				for (uint32_t i = 0; i < levelCount; i++)
+					params["dstLevels"][i] = ImageParameter{
+						.image = ImageView::Create(image, vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, base + 1 + i, 1, layer, 1 }, vk::ImageViewType::e2D, {}, storageFormat),
+						.imageLayout = vk::ImageLayout::eGeneral };
+				params["counter"]    = (BufferParameter)counter;
+				params["srcExtent"]  = srcExtent;
+				params["levelCount"] = levelCount;
+				params["tileCount"]  = tileCount.x * tileCount.y;
+
+				context.Fill(counter, 0u);
+				context.Dispatch(*pipeline, uint3(tileCount.x * 256, tileCount.y, 1), params);
+
+				base += levelCount;
+			}
+		}
+
+		context.PopDebugLabel();
+	}
+};
+
+}
\ No newline at end of file
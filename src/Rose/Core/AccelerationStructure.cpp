@@ -6,62 +6,258 @@
 namespace RoseEngine {
 
 
+ref<AccelerationStructure> AccelerationStructure::Allocate(const Device& device, const vk::AccelerationStructureTypeKHR type, const vk::DeviceSize size) {
+	AccelerationStructure* as = new AccelerationStructure();
+	as->type = type;
+	as->buffer = Buffer::Create(
+		device,
+		size,
+		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+		0.5f,
+		MemoryPool::eScene);
+
+	as->accelerationStructure = device->createAccelerationStructureKHR(vk::AccelerationStructureCreateInfoKHR{
+		.buffer = **as->buffer.mBuffer,
+		.offset = as->buffer.mOffset,
+		.size = as->buffer.size_bytes(),
+		.type = type });
+
+	if (type == vk::AccelerationStructureTypeKHR::eBottomLevel)
+		gBottomLevelMemory += as->buffer.size_bytes();
+
+	return ref<AccelerationStructure>(as);
+}
+
 ref<AccelerationStructure> AccelerationStructure::Create(
 	CommandContext& context,
 	const vk::AccelerationStructureTypeKHR type,
 	const vk::ArrayProxy<const vk::AccelerationStructureGeometryKHR>& geometries,
 	const vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR>& buildRanges,
-	const vk::BuildAccelerationStructureFlagBitsKHR buildFlags
+	const vk::BuildAccelerationStructureFlagsKHR buildFlags
 ) {
-	vk::AccelerationStructureBuildGeometryInfoKHR buildGeometry {
-		.type  = type,
-		.flags = buildFlags,
-		.mode  = vk::BuildAccelerationStructureModeKHR::eBuild };
-	buildGeometry.setGeometries(geometries);
+	const BuildGeometries build {
+		.geometries  = { geometries.begin(), geometries.end() },
+		.buildRanges = { buildRanges.begin(), buildRanges.end() } };
+	return Create(context, type, std::span{ &build, 1 }, buildFlags).front();
+}
+
+std::vector<ref<AccelerationStructure>> AccelerationStructure::Create(
+	CommandContext& context,
+	const vk::AccelerationStructureTypeKHR type,
+	const std::span<const BuildGeometries> builds,
+	const vk::BuildAccelerationStructureFlagsKHR buildFlags,
+	const bool allowCompaction,
+	const vk::DeviceSize maxScratchSize
+) {
+	const Device& device = context.GetDevice();
+
+	const vk::DeviceSize scratchAlignment = std::max<vk::DeviceSize>(device.AccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment, 1);
+	auto alignScratch = [=](const vk::DeviceSize x) { return (x + scratchAlignment - 1) / scratchAlignment * scratchAlignment; };
+
+	std::vector<ref<AccelerationStructure>> result(builds.size());
+	std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildGeometries(builds.size());
+	std::vector<vk::DeviceSize> scratchSizes(builds.size());
 
-	vk::AccelerationStructureBuildSizesInfoKHR buildSizes;
-	if (buildRanges.size() > 0 && buildRanges.front().primitiveCount > 0) {
-		std::vector<uint32_t> counts((uint32_t)geometries.size());
-		for (uint32_t i = 0; i < geometries.size(); i++)
-			counts[i] = (buildRanges.data() + i)->primitiveCount;
-		buildSizes = context.GetDevice()->getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, buildGeometry, counts);
-	} else
-		buildSizes.accelerationStructureSize = buildSizes.buildScratchSize = 4;
+	vk::DeviceSize maxBuildScratchSize = 0;
+	vk::DeviceSize totalScratchSize = 0;
+	for (size_t i = 0; i < builds.size(); i++) {
+		vk::AccelerationStructureBuildGeometryInfoKHR& buildGeometry = buildGeometries[i];
+		buildGeometry = vk::AccelerationStructureBuildGeometryInfoKHR{
+			.type  = type,
+			.flags = allowCompaction ? buildFlags | vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction : buildFlags,
+			.mode  = vk::BuildAccelerationStructureModeKHR::eBuild };
+		buildGeometry.setGeometries(builds[i].geometries);
 
+		vk::AccelerationStructureBuildSizesInfoKHR buildSizes;
+		if (builds[i].buildRanges.size() > 0 && builds[i].buildRanges.front().primitiveCount > 0) {
+			std::vector<uint32_t> counts((uint32_t)builds[i].geometries.size());
+			for (uint32_t j = 0; j < counts.size(); j++)
+				counts[j] = builds[i].buildRanges[j].primitiveCount;
+			buildSizes = device->getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice, buildGeometry, counts);
+		} else
+			buildSizes.accelerationStructureSize = buildSizes.buildScratchSize = 4;
+
+		scratchSizes[i] = alignScratch(buildSizes.buildScratchSize);
+		maxBuildScratchSize = std::max(maxBuildScratchSize, scratchSizes[i]);
+		totalScratchSize += scratchSizes[i];
+
+		result[i] = Allocate(device, type, buildSizes.accelerationStructureSize);
+		result[i]->uncompactedSize = result[i]->Size();
+		result[i]->buildFlags = buildGeometry.flags;
+		result[i]->updateScratchSize = buildSizes.updateScratchSize;
+		if (type == vk::AccelerationStructureTypeKHR::eBottomLevel)
+			gBottomLevelMemoryUncompacted += result[i]->uncompactedSize;
+
+		buildGeometry.dstAccelerationStructure = **result[i];
+	}
+
+	// one scratch arena for the whole batch. when it fills up, the builds recorded so far are flushed and the arena is reused.
+	const vk::DeviceSize arenaSize = std::max(maxBuildScratchSize, std::min(totalScratchSize, maxScratchSize));
 	auto scratchData = context.GetTransientBuffer(
-		buildSizes.buildScratchSize,
-		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eStorageBuffer);
+		arenaSize + scratchAlignment,
+		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eStorageBuffer,
+		MemoryPool::eScratch);
+	const vk::DeviceAddress scratchAddress = alignScratch(device->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **scratchData.mBuffer }) + scratchData.mOffset);
 
-	AccelerationStructure* as = new AccelerationStructure();
-	as->buffer = Buffer::Create(
-		context.GetDevice(),
-		buildSizes.accelerationStructureSize,
-		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress);
+	size_t batchStart = 0;
+	vk::DeviceSize scratchOffset = 0;
+	auto flush = [&](const size_t batchEnd) {
+		if (batchEnd == batchStart) return;
 
-	as->accelerationStructure = context.GetDevice()->createAccelerationStructureKHR(vk::AccelerationStructureCreateInfoKHR{
-		.buffer = **as->buffer.mBuffer,
-		.offset = as->buffer.mOffset,
-		.size = as->buffer.size_bytes(),
-		.type = type });
+		context.AddBarrier(scratchData, Buffer::ResourceState{
+			.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+			.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+			.queueFamily = context.QueueFamily() });
+		context.ExecuteBarriers();
 
-	buildGeometry.dstAccelerationStructure = **as;
-	buildGeometry.scratchData = context.GetDevice()->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **scratchData.mBuffer }) + scratchData.mOffset;
+		std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> buildRanges(batchEnd - batchStart);
+		for (size_t i = batchStart; i < batchEnd; i++)
+			buildRanges[i - batchStart] = builds[i].buildRanges.data();
+		context->buildAccelerationStructuresKHR(std::span{ buildGeometries }.subspan(batchStart, batchEnd - batchStart), buildRanges);
 
-	context->buildAccelerationStructuresKHR(buildGeometry, buildRanges.data());
+		batchStart = batchEnd;
+		scratchOffset = 0;
+	};
+	for (size_t i = 0; i < builds.size(); i++) {
+		if (scratchOffset + scratchSizes[i] > arenaSize)
+			flush(i);
+		buildGeometries[i].scratchData = scratchAddress + scratchOffset;
+		scratchOffset += scratchSizes[i];
+	}
+	flush(builds.size());
+
+	for (const auto& as : result) {
+		as->buffer.SetState(Buffer::ResourceState{
+			.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+			.access = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+			.queueFamily = context.QueueFamily() });
+		// make the results visible to subsequent builds, copies and queries
+		context.AddBarrier(as->buffer, Buffer::ResourceState{
+			.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+			.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+			.queueFamily = context.QueueFamily() });
+	}
+
+	if (allowCompaction && !result.empty()) {
+		context.ExecuteBarriers();
+
+		auto queryPool = make_ref<vk::raii::QueryPool>(*device, vk::QueryPoolCreateInfo{
+			.queryType = vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+			.queryCount = (uint32_t)result.size() });
+		context->resetQueryPool(**queryPool, 0, (uint32_t)result.size());
+
+		std::vector<vk::AccelerationStructureKHR> accelerationStructures(result.size());
+		for (size_t i = 0; i < result.size(); i++) {
+			accelerationStructures[i] = **result[i];
+			result[i]->compactedSizeQueryPool = queryPool;
+			result[i]->compactedSizeQuery = (uint32_t)i;
+			result[i]->compactedSizeSignal = device.NextTimelineSignal();
+		}
+		context->writeAccelerationStructuresPropertiesKHR(accelerationStructures, vk::QueryType::eAccelerationStructureCompactedSizeKHR, **queryPool, 0);
+	}
+
+	return result;
+}
+
+ref<AccelerationStructure> AccelerationStructure::Compact(CommandContext& context) {
+	if (!CanCompact(context.GetDevice()))
+		return nullptr;
+
+	const auto [queryResult, compactedSize] = compactedSizeQueryPool->getResult<vk::DeviceSize>(compactedSizeQuery, 1, sizeof(vk::DeviceSize), vk::QueryResultFlagBits::e64);
+	if (queryResult != vk::Result::eSuccess)
+		return nullptr;
+
+	// only compact once
+	compactedSizeQueryPool = {};
+
+	if (compactedSize == 0 || compactedSize >= buffer.size_bytes())
+		return nullptr;
+
+	auto as = Allocate(context.GetDevice(), type, compactedSize);
+	as->uncompactedSize = uncompactedSize;
+	as->buildFlags = buildFlags;
+	as->updateScratchSize = updateScratchSize;
+	as->updateCount = updateCount;
+	if (type == vk::AccelerationStructureTypeKHR::eBottomLevel)
+		gBottomLevelMemoryUncompacted += uncompactedSize;
 
-	as->buffer.SetState(Buffer::ResourceState{
+	context.AddBarrier(buffer, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+		.queueFamily = context.QueueFamily() });
+	context.AddBarrier(as->buffer, Buffer::ResourceState{
 		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
 		.access = vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
 		.queueFamily = context.QueueFamily() });
+	context.ExecuteBarriers();
 
-	return ref<AccelerationStructure>(as);
+	context->copyAccelerationStructureKHR(vk::CopyAccelerationStructureInfoKHR{
+		.src  = *accelerationStructure,
+		.dst  = **as,
+		.mode = vk::CopyAccelerationStructureModeKHR::eCompact });
+
+	context.AddBarrier(as->buffer, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+		.queueFamily = context.QueueFamily() });
+
+	return as;
 }
 
-ref<AccelerationStructure> AccelerationStructure::Create(
+void AccelerationStructure::Update(
 	CommandContext& context,
-	vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>&& instances,
-	const vk::BuildAccelerationStructureFlagBitsKHR buildFlags
+	const vk::ArrayProxy<const vk::AccelerationStructureGeometryKHR>& geometries,
+	const vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR>& buildRanges
 ) {
+	if (!AllowsUpdate())
+		throw std::runtime_error("Acceleration structure was not built with eAllowUpdate");
+
+	const Device& device = context.GetDevice();
+
+	const vk::DeviceSize scratchAlignment = std::max<vk::DeviceSize>(device.AccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment, 1);
+	auto scratchData = context.GetTransientBuffer(
+		std::max<vk::DeviceSize>(updateScratchSize, 4) + scratchAlignment,
+		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eStorageBuffer,
+		MemoryPool::eScratch);
+	const vk::DeviceAddress scratchAddress = device->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **scratchData.mBuffer }) + scratchData.mOffset;
+
+	vk::AccelerationStructureBuildGeometryInfoKHR buildGeometry {
+		.type  = type,
+		.flags = buildFlags,
+		.mode  = vk::BuildAccelerationStructureModeKHR::eUpdate,
+		.srcAccelerationStructure = *accelerationStructure,
+		.dstAccelerationStructure = *accelerationStructure,
+		.scratchData = (scratchAddress + scratchAlignment - 1) / scratchAlignment * scratchAlignment };
+	buildGeometry.setGeometries(geometries);
+
+	// the update is done in place, so previously submitted work (e.g. ray queries) must be done reading it
+	buffer.SetState(Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAllCommands,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+		.queueFamily = context.QueueFamily() });
+	context.AddBarrier(buffer, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+		.queueFamily = context.QueueFamily() });
+	context.AddBarrier(scratchData, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR | vk::AccessFlagBits2::eAccelerationStructureWriteKHR,
+		.queueFamily = context.QueueFamily() });
+	context.ExecuteBarriers();
+
+	context->buildAccelerationStructuresKHR(buildGeometry, buildRanges.data());
+
+	context.AddBarrier(buffer, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eAccelerationStructureReadKHR,
+		.queueFamily = context.QueueFamily() });
+
+	updateCount++;
+}
+
+vk::AccelerationStructureGeometryKHR AccelerationStructure::UploadInstances(CommandContext& context, const vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>& instances) {
 	BufferRange<vk::AccelerationStructureInstanceKHR> instanceBuf;
 
 	if (instances.empty())
@@ -69,17 +265,35 @@ ref<AccelerationStructure> AccelerationStructure::Create(
 	else
 		instanceBuf = context.UploadData(instances, vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eShaderDeviceAddress);
 
+	context.AddBarrier(instanceBuf, Buffer::ResourceState{
+		.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+		.access = vk::AccessFlagBits2::eShaderRead,
+		.queueFamily = context.QueueFamily() });
+
 	vk::AccelerationStructureGeometryInstancesDataKHR instanceGeometries{
-		.data = context.GetDevice()->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **instanceBuf.mBuffer }) };
+		.data = context.GetDevice()->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **instanceBuf.mBuffer }) + instanceBuf.mOffset };
 
-	vk::AccelerationStructureGeometryKHR geometry{
+	return vk::AccelerationStructureGeometryKHR{
 		.geometryType = vk::GeometryTypeKHR::eInstances,
 		.geometry = instanceGeometries };
+}
 
+ref<AccelerationStructure> AccelerationStructure::Create(
+	CommandContext& context,
+	vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>&& instances,
+	const vk::BuildAccelerationStructureFlagsKHR buildFlags
+) {
+	const vk::AccelerationStructureGeometryKHR geometry = UploadInstances(context, instances);
 	vk::AccelerationStructureBuildRangeInfoKHR range{ .primitiveCount = (uint32_t)std::ranges::size(instances) };
 	return Create(context, vk::AccelerationStructureTypeKHR::eTopLevel, geometry, range, buildFlags);
 }
 
+void AccelerationStructure::Update(CommandContext& context, vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>&& instances) {
+	const vk::AccelerationStructureGeometryKHR geometry = UploadInstances(context, instances);
+	vk::AccelerationStructureBuildRangeInfoKHR range{ .primitiveCount = (uint32_t)std::ranges::size(instances) };
+	Update(context, geometry, range);
+}
+
 ref<AccelerationStructure> AccelerationStructure::Create(CommandContext& context, const float3 aabbMin, const float3 aabbMax, const bool opaque) {
 	vk::AabbPositionsKHR aabb{
 		.minX = aabbMin.x, .minY = aabbMin.y, .minZ = aabbMin.z,
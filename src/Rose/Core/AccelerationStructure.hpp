@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ranges>
+#include <atomic>
 
 #include "Buffer.hpp"
 #include "MathTypes.hpp"
@@ -10,28 +11,68 @@ namespace RoseEngine {
 class CommandContext;
 
 class AccelerationStructure {
+public:
+	// Inputs for one acceleration structure in a batched build
+	struct BuildGeometries {
+		std::vector<vk::AccelerationStructureGeometryKHR>       geometries = {};
+		std::vector<vk::AccelerationStructureBuildRangeInfoKHR> buildRanges = {};
+	};
+
 private:
 	vk::raii::AccelerationStructureKHR accelerationStructure = nullptr;
 	BufferView buffer = {};
+	vk::AccelerationStructureTypeKHR type = {};
+	vk::DeviceSize uncompactedSize = 0;
+	vk::BuildAccelerationStructureFlagsKHR buildFlags = {};
+	vk::DeviceSize updateScratchSize = 0;
+	uint32_t       updateCount = 0; // updates since the last full build
+
+	// Written by builds with allowCompaction, available once the device reaches compactedSizeSignal
+	ref<vk::raii::QueryPool> compactedSizeQueryPool = {};
+	uint32_t compactedSizeQuery = 0;
+	uint64_t compactedSizeSignal = 0;
+
+	// totals over all live bottom-level acceleration structures
+	inline static std::atomic<vk::DeviceSize> gBottomLevelMemory = 0;
+	inline static std::atomic<vk::DeviceSize> gBottomLevelMemoryUncompacted = 0;
 
 	inline AccelerationStructure() {}
 
+	static ref<AccelerationStructure> Allocate(const Device& device, const vk::AccelerationStructureTypeKHR type, const vk::DeviceSize size);
+	static vk::AccelerationStructureGeometryKHR UploadInstances(CommandContext& context, const vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>& instances);
+
 public:
 	static ref<AccelerationStructure> Create(
 		CommandContext& context,
 		const vk::AccelerationStructureTypeKHR type,
 		const vk::ArrayProxy<const vk::AccelerationStructureGeometryKHR>& geometries,
 		const vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR>& buildRanges,
-		const vk::BuildAccelerationStructureFlagBitsKHR buildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
+		const vk::BuildAccelerationStructureFlagsKHR buildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
 	);
 	static ref<AccelerationStructure> Create(
 		CommandContext& context,
 		vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>&& instances,
-		const vk::BuildAccelerationStructureFlagBitsKHR buildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
+		const vk::BuildAccelerationStructureFlagsKHR buildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace
 	);
 	static ref<AccelerationStructure> Create(CommandContext& context, const float3 aabbMin, const float3 aabbMax, const bool opaque = true);
 
+	// Builds many acceleration structures with as few build commands as possible.
+	// Scratch memory is sub-allocated from a single arena of at most maxScratchSize bytes, which is reused once full.
+	// If allowCompaction is set, the compacted sizes are queried so that Compact() can be called after the build completes.
+	static std::vector<ref<AccelerationStructure>> Create(
+		CommandContext& context,
+		const vk::AccelerationStructureTypeKHR type,
+		const std::span<const BuildGeometries> builds,
+		const vk::BuildAccelerationStructureFlagsKHR buildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
+		const bool allowCompaction = false,
+		const vk::DeviceSize maxScratchSize = 256 << 20
+	);
+
 	inline ~AccelerationStructure() {
+		if (type == vk::AccelerationStructureTypeKHR::eBottomLevel) {
+			gBottomLevelMemory -= buffer.size_bytes();
+			gBottomLevelMemoryUncompacted -= uncompactedSize;
+		}
 		accelerationStructure = nullptr;
 		buffer = {};
 	}
@@ -44,6 +85,33 @@ public:
 	inline vk::DeviceAddress GetDeviceAddress(const Device& device) const {
 		return device->getAccelerationStructureAddressKHR(vk::AccelerationStructureDeviceAddressInfoKHR{ .accelerationStructure = *accelerationStructure });
 	}
+
+	inline vk::AccelerationStructureTypeKHR Type() const { return type; }
+	inline vk::BuildAccelerationStructureFlagsKHR BuildFlags() const { return buildFlags; }
+	inline bool     AllowsUpdate() const { return (bool)(buildFlags & vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate); }
+	inline uint32_t UpdateCount() const { return updateCount; }
+	inline vk::DeviceSize Size() const { return buffer.size_bytes(); }
+
+	inline bool CanCompact(const Device& device) const {
+		return compactedSizeQueryPool && device.CurrentTimelineValue() >= compactedSizeSignal;
+	}
+
+	// Updates (refits) in place from new geometry data. Requires AllowsUpdate(), and the same geometry
+	// types, flags and primitive counts as the original build. Trace quality degrades with each update,
+	// so callers should rebuild once UpdateCount() gets large.
+	void Update(
+		CommandContext& context,
+		const vk::ArrayProxy<const vk::AccelerationStructureGeometryKHR>& geometries,
+		const vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR>& buildRanges);
+	void Update(CommandContext& context, vk::ArrayProxy<vk::AccelerationStructureInstanceKHR>&& instances);
+
+	// Copies this acceleration structure into a new one of the queried compacted size.
+	// Requires CanCompact(). The result has a different device address, so instances referencing it must be rebuilt.
+	ref<AccelerationStructure> Compact(CommandContext& context);
+
+	inline static vk::DeviceSize BottomLevelMemory() { return gBottomLevelMemory; }
+	// Bottom-level memory as it would be without compaction
+	inline static vk::DeviceSize BottomLevelMemoryUncompacted() { return gBottomLevelMemoryUncompacted; }
 };
 
 }
\ No newline at end of file
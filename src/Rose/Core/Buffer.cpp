@@ -1,5 +1,6 @@
 #include <iostream>
 #include "Buffer.hpp"
+#include "ResidencyManager.hpp"
 
 namespace RoseEngine {
 
@@ -7,8 +8,10 @@ ref<Buffer> Buffer::Create(const Device& device, const vk::BufferCreateInfo& cre
 	VmaAllocation alloc;
 	VmaAllocationInfo allocInfo;
 	VkBuffer vkbuffer;
-	vk::Result result = (vk::Result)vmaCreateBuffer(device.MemoryAllocator(), &(const VkBufferCreateInfo&)createInfo, &allocationInfo, &vkbuffer, &alloc, &allocInfo);
+	const vk::Result result = (vk::Result)vmaCreateBuffer(device.MemoryAllocator(), &(const VkBufferCreateInfo&)createInfo, &allocationInfo, &vkbuffer, &alloc, &allocInfo);
 	if (result != vk::Result::eSuccess) {
+		if (result == vk::Result::eErrorOutOfDeviceMemory)
+			device.Residency().AllocationFailed(createInfo.size);
 		std::cerr << "Failed to create buffer: " << vk::to_string(result) << std::endl;
 		return nullptr;
 	}
@@ -20,13 +23,34 @@ ref<Buffer> Buffer::Create(const Device& device, const vk::BufferCreateInfo& cre
 	buffer->mAllocationInfo = allocInfo;
 	buffer->mSize  = createInfo.size;
 	buffer->mUsage = createInfo.usage;
-	buffer->mMemoryFlags = (vk::MemoryPropertyFlags)allocInfo.memoryType;
+	VkMemoryPropertyFlags memoryFlags = 0;
+	vmaGetAllocationMemoryProperties(device.MemoryAllocator(), alloc, &memoryFlags);
+	buffer->mMemoryFlags = (vk::MemoryPropertyFlags)memoryFlags;
 	buffer->mSharingMode = createInfo.sharingMode;
 	return buffer;
 }
 
+ref<Buffer> Buffer::CreatePlaced(const Device& device, const vk::BufferCreateInfo& createInfo, const ref<VmaAllocation_T>& memory, const vk::DeviceSize offset) {
+	VkBuffer vkbuffer;
+	const vk::Result result = (vk::Result)vmaCreateAliasingBuffer2(device.MemoryAllocator(), memory.get(), offset, &(const VkBufferCreateInfo&)createInfo, &vkbuffer);
+	if (result != vk::Result::eSuccess) {
+		std::cerr << "Failed to create placed buffer: " << vk::to_string(result) << std::endl;
+		return nullptr;
+	}
+
+	auto buffer = make_ref<Buffer>();
+	buffer->mBuffer = vkbuffer;
+	buffer->mMemoryAllocator = device.MemoryAllocator();
+	buffer->mSize  = createInfo.size;
+	buffer->mUsage = createInfo.usage;
+	buffer->mSharingMode = createInfo.sharingMode;
+	buffer->mPlacedMemory = memory;
+	return buffer;
+}
+
 Buffer::~Buffer() {
-	if (mMemoryAllocator && mBuffer && mAllocation) {
+	// placed buffers have no allocation of their own
+	if (mMemoryAllocator && mBuffer) {
 		vmaDestroyBuffer(mMemoryAllocator, mBuffer, mAllocation);
 		mMemoryAllocator = nullptr;
 		mBuffer     = nullptr;
@@ -38,18 +62,19 @@ BufferView Buffer::Create(
 	const Device& device,
 	const vk::BufferCreateInfo&    createInfo,
 	const vk::MemoryPropertyFlags  memoryFlags,
-	const VmaAllocationCreateFlags allocationFlags) {
-	auto buf = Create(
-		device,
-		createInfo,
-		VmaAllocationCreateInfo{
-			.flags = allocationFlags,
-			.usage = VMA_MEMORY_USAGE_AUTO,
-			.requiredFlags = (VkMemoryPropertyFlags)memoryFlags,
-			.memoryTypeBits = 0,
-			.pool = VK_NULL_HANDLE,
-			.pUserData = VK_NULL_HANDLE,
-			.priority = 0 });
+	const VmaAllocationCreateFlags allocationFlags,
+	const float                    priority,
+	const MemoryPool               pool) {
+	VmaAllocationCreateInfo allocationInfo{
+		.flags = allocationFlags,
+		.usage = VMA_MEMORY_USAGE_AUTO,
+		.requiredFlags = (VkMemoryPropertyFlags)memoryFlags,
+		.memoryTypeBits = 0,
+		.pool = VK_NULL_HANDLE,
+		.pUserData = VK_NULL_HANDLE,
+		.priority = priority };
+	device.SelectMemoryPool(pool, createInfo, allocationInfo);
+	auto buf = Create(device, createInfo, allocationInfo);
 	return { buf, 0, createInfo.size };
 }
 
@@ -58,21 +83,18 @@ BufferView Buffer::Create(
 	const vk::DeviceSize size,
 	const vk::BufferUsageFlags     usage,
 	const vk::MemoryPropertyFlags  memoryFlags,
-	const VmaAllocationCreateFlags allocationFlags) {
-	auto buf = Create(
+	const VmaAllocationCreateFlags allocationFlags,
+	const float                    priority,
+	const MemoryPool               pool) {
+	return Create(
 		device,
 		vk::BufferCreateInfo{
 			.size = size,
 			.usage = usage },
-		VmaAllocationCreateInfo{
-			.flags = allocationFlags,
-			.usage = VMA_MEMORY_USAGE_AUTO,
-			.requiredFlags = (VkMemoryPropertyFlags)memoryFlags,
-			.memoryTypeBits = 0,
-			.pool = VK_NULL_HANDLE,
-			.pUserData = VK_NULL_HANDLE,
-			.priority = 0 });
-	return { buf, 0, size };
+		memoryFlags,
+		allocationFlags,
+		priority,
+		pool);
 }
 
 TexelBufferView TexelBufferView::Create(const Device& device, const BufferView& buffer, vk::Format format) {
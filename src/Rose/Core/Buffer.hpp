@@ -27,25 +27,41 @@ private:
 	vk::BufferUsageFlags    mUsage = {};
 	vk::MemoryPropertyFlags mMemoryFlags = {};
 	vk::SharingMode         mSharingMode = {};
+	ref<VmaAllocation_T>    mPlacedMemory = {}; // memory shared with other resources, for buffers created with CreatePlaced
 
 	PairMap<ResourceState, vk::DeviceSize, vk::DeviceSize> mState;
+	ResourceState mInitialState = {
+		.stage       = vk::PipelineStageFlagBits2::eTopOfPipe,
+		.access      = vk::AccessFlagBits2::eNone,
+		.queueFamily = VK_QUEUE_FAMILY_IGNORED };
 
 public:
 	static ref<Buffer> Create(
 		const Device&                  device,
 		const vk::BufferCreateInfo&    createInfo,
 		const VmaAllocationCreateInfo& allocationInfo);
+	// priority is the VK_EXT_memory_priority of the allocation, in [0,1]. Buffers in a pool other than MemoryPool::eDefault take the pool's priority
 	static BufferView Create(
 		const Device&                  device,
 		const vk::BufferCreateInfo&    createInfo,
 		const vk::MemoryPropertyFlags  memoryFlags     = vk::MemoryPropertyFlagBits::eDeviceLocal,
-		const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT);
+		const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+		const float                    priority        = 0.5f,
+		const MemoryPool               pool            = MemoryPool::eDefault);
 	static BufferView Create(
 		const Device&                  device,
 		const vk::DeviceSize           size,
 		const vk::BufferUsageFlags     usage           = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
 		const vk::MemoryPropertyFlags  memoryFlags     = vk::MemoryPropertyFlagBits::eDeviceLocal,
-		const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT);
+		const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+		const float                    priority        = 0.5f,
+		const MemoryPool               pool            = MemoryPool::eDefault);
+	// Creates a buffer bound to memory at offset, which other resources may alias (see TransientHeap)
+	static ref<Buffer> CreatePlaced(
+		const Device&               device,
+		const vk::BufferCreateInfo& createInfo,
+		const ref<VmaAllocation_T>& memory,
+		const vk::DeviceSize        offset);
 	template<std::ranges::contiguous_range R>
 	static BufferRange<std::ranges::range_value_t<R>> Create(
 		const Device& device,
@@ -68,15 +84,32 @@ public:
 
 	inline void* data() const { return mAllocationInfo.pMappedData; }
 
+	// Makes device writes to a range of mapped memory visible to the host. Only needed for memory which isn't host coherent
+	inline void Invalidate(const vk::DeviceSize offset = 0, const vk::DeviceSize size = VK_WHOLE_SIZE) const {
+		if (mAllocation && !(mMemoryFlags & vk::MemoryPropertyFlagBits::eHostCoherent))
+			vmaInvalidateAllocation(mMemoryAllocator, mAllocation, offset, size);
+	}
+
 	inline const ResourceState& GetState(vk::DeviceSize offset, vk::DeviceSize size) {
 		auto it = mState.find(std::make_pair(offset, size));
 		if (it == mState.end())
-			it = mState.emplace(std::make_pair(offset, size), ResourceState{
-				.stage       = vk::PipelineStageFlagBits2::eTopOfPipe,
-				.access      = vk::AccessFlagBits2::eNone,
-				.queueFamily = VK_QUEUE_FAMILY_IGNORED }).first;
+			it = mState.emplace(std::make_pair(offset, size), mInitialState).first;
 		return it->second;
 	}
+	// Forgets the state of every range. Ranges start out in state until their next barrier.
+	inline void ResetState(const ResourceState& state) {
+		mState.clear();
+		mInitialState = state;
+	}
+	// The stages and accesses of every range combined, to order resources aliasing the buffer's memory after it
+	inline ResourceState CombinedState() const {
+		ResourceState combined = { .stage = mInitialState.stage, .access = mInitialState.access };
+		for (const auto&[range, state] : mState) {
+			combined.stage  |= state.stage;
+			combined.access |= state.access;
+		}
+		return combined;
+	}
 	inline vk::BufferMemoryBarrier2 SetState(const ResourceState& newState, vk::DeviceSize offset, vk::DeviceSize size) {
 		auto oldState = GetState(offset, size);
 		mState[std::make_pair(offset, size)] = newState;
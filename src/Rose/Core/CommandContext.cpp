@@ -21,6 +21,12 @@ void CommandContext::Begin() {
 	if (mLastSubmit > 0)
 		mDevice->Wait(mLastSubmit);
 
+	mTransientHeap.NextFrame();
+
+	// readbacks recorded since the last submit are never written
+	if (mReadback->HasPending())
+		mReadback->Discarded();
+
 	mCommandBuffer.reset();
 	mCommandBuffer.begin(vk::CommandBufferBeginInfo{});
 
@@ -39,16 +45,6 @@ void CommandContext::Begin() {
 			std::ranges::sort(bufs, {}, &CachedData::CachedBuffers::size);
 	}
 
-	if (!mCache.mNewImages.empty()) {
-		for (auto&[info, images] : mCache.mNewImages) {
-			for (auto& image : images) {
-				if (image && image.use_count() == 1)
-					mCache.mImages[info].emplace_back(std::move(image));
-			}
-			images.clear();
-		}
-	}
-
 	if (!mCache.mNewDescriptorSets.empty()) {
 		for (auto&[layout, sets] : mCache.mNewDescriptorSets)
 			for (auto& s : sets) {
@@ -78,6 +74,16 @@ uint64_t CommandContext::Submit(
 	const vk::ArrayProxy<const vk::PipelineStageFlags>& waitStages,
 	const vk::ArrayProxy<const uint64_t>&               waitValues) {
 
+	// makes the readbacks' transfer writes visible to the host
+	if (mReadback->HasPending()) {
+		const vk::MemoryBarrier2 barrier{
+			.srcStageMask  = vk::PipelineStageFlagBits2::eTransfer,
+			.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+			.dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+			.dstAccessMask = vk::AccessFlagBits2::eHostRead };
+		mCommandBuffer.pipelineBarrier2(vk::DependencyInfo{}.setMemoryBarriers(barrier));
+	}
+
 	mCommandBuffer.end();
 
 	vk::StructureChain<vk::SubmitInfo, vk::TimelineSemaphoreSubmitInfo> submitInfoChain = {};
@@ -105,10 +111,31 @@ uint64_t CommandContext::Submit(
 	(*mDevice)->getQueue(mQueueFamily, queueIndex).submit( submitInfo );
 
 	mLastSubmit = signalValue;
+	mResidency.Touch(signalValue);
+	if (mReadback->HasPending())
+		mReadback->Submitted(signalValue);
 
 	return signalValue;
 }
 
+// Cached resources are not in use: Begin waits for the last submit before moving resources into the cache.
+// Transient heap blocks count only once nothing is placed in them, since only those are released.
+vk::DeviceSize CommandContext::CachedResourceBytes() const {
+	vk::DeviceSize bytes = mTransientHeap.UnusedSize();
+	for (const auto&[usage, bufs] : mCache.mBuffers)
+		for (const auto& b : bufs)
+			if (b.buffer) bytes += b.buffer.mBuffer->Size(); // host buffers aren't device local
+	return bytes;
+}
+vk::DeviceSize CommandContext::ReleaseCachedResources() {
+	vk::DeviceSize bytes = mTransientHeap.ReleaseUnused();
+	for (const auto&[usage, bufs] : mCache.mBuffers)
+		for (const auto& b : bufs)
+			if (b.buffer) bytes += b.buffer.mBuffer->Size();
+	mCache.mBuffers.clear();
+	return bytes;
+}
+
 void CommandContext::AllocateDescriptorPool() {
 	std::vector<vk::DescriptorPoolSize> poolSizes {
 		vk::DescriptorPoolSize{ vk::DescriptorType::eSampler,              std::min(16384u, mDevice->Limits().maxDescriptorSetSamplers) },
@@ -172,20 +199,6 @@ ref<DescriptorSets> CommandContext::GetDescriptorSets(const PipelineLayout& pipe
 	return descriptorSets;
 }
 
-ref<Image> CommandContext::GetTransientImage(const ImageInfo& info) {
-	ref<Image> image = {};
-	if (auto it_ = mCache.mImages.find(info); it_ != mCache.mImages.end()) {
-		auto& q = it_->second;
-		if (!q.empty()) {
-			image = std::move(q.back());
-			q.pop_back();
-		}
-	}
-
-	if (!image) image = Image::Create(GetDevice(), info);
-
-	return mCache.mNewImages[info].emplace_back(image);
-}
 
 
 uint32_t align16(uint32_t s) {
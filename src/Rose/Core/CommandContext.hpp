@@ -5,6 +5,9 @@
 #include "AccelerationStructure.hpp"
 #include "Pipeline.hpp"
 #include "ParameterMap.hpp"
+#include "ResidencyManager.hpp"
+#include "TransientHeap.hpp"
+#include "ReadbackRing.hpp"
 
 namespace RoseEngine {
 
@@ -89,6 +92,7 @@ private:
 	ref<Device> mDevice = {};
 	uint32_t mQueueFamily = {};
 
+	std::vector<vk::MemoryBarrier2>       mMemoryBarrierQueue = {};
 	std::vector<vk::BufferMemoryBarrier2> mBufferBarrierQueue = {};
 	std::vector<vk::ImageMemoryBarrier2>  mImageBarrierQueue = {};
 
@@ -106,12 +110,15 @@ private:
 		};
 		std::unordered_map<vk::BufferUsageFlags, std::vector<CachedBuffers>> mBuffers = {};
 		std::unordered_map<vk::BufferUsageFlags, std::vector<CachedBuffers>> mNewBuffers = {};
-
-
-		std::unordered_map<ImageInfo, std::vector<ref<Image>>> mImages = {};
-		std::unordered_map<ImageInfo, std::vector<ref<Image>>> mNewImages = {};
 	};
 	CachedData mCache = {};
+	TransientHeap mTransientHeap = {};
+	ref<ReadbackRing> mReadback = {};
+
+	// lets the residency manager release cached buffers and images when over budget
+	ResidencyManager::Handle mResidency = {};
+	vk::DeviceSize CachedResourceBytes() const;
+	vk::DeviceSize ReleaseCachedResources();
 
 	void AllocateDescriptorPool();
 	DescriptorSets AllocateDescriptorSets(const vk::ArrayProxy<const vk::DescriptorSetLayout>& layouts, const vk::ArrayProxy<const uint32_t>& variableSetCounts = {});
@@ -126,6 +133,12 @@ public:
 		ref<CommandContext> context = make_ref<CommandContext>();
 		context->mDevice = device;
 		context->mQueueFamily = queueFamily;
+		context->mReadback = ReadbackRing::Create(*device);
+		context->mResidency = device->Residency().Register({
+			.name = "Cached transient resources",
+			.priority = 0.25f,
+			.size  = [ctx = context.get()]() { return ctx->CachedResourceBytes(); },
+			.evict = [ctx = context.get()](CommandContext&, const vk::DeviceSize) { return ctx->ReleaseCachedResources(); } });
 		return context;
 	}
 	inline static ref<CommandContext> Create(const ref<Device>& device, const vk::QueueFlags flags = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer) {
@@ -135,6 +148,8 @@ public:
 	inline Device& GetDevice() const { return *mDevice; }
 	inline const ref<Device>& GetDeviceRef() const { return mDevice; }
 	inline uint32_t QueueFamily() const { return mQueueFamily; }
+	inline TransientHeap& GetTransientHeap() { return mTransientHeap; }
+	inline const ReadbackRing& GetReadbackRing() const { return *mReadback; }
 
 	void Begin();
 
@@ -170,16 +185,20 @@ public:
 	inline void ExecuteBarriers() {
 		mCommandBuffer.pipelineBarrier2(vk::DependencyInfo {
 			.dependencyFlags = vk::DependencyFlagBits::eByRegion,
+			.memoryBarrierCount       = (uint32_t)mMemoryBarrierQueue.size(),
+			.pMemoryBarriers          = mMemoryBarrierQueue.data(),
 			.bufferMemoryBarrierCount = (uint32_t)mBufferBarrierQueue.size(),
 			.pBufferMemoryBarriers    = mBufferBarrierQueue.data(),
 			.imageMemoryBarrierCount  = (uint32_t)mImageBarrierQueue.size(),
 			.pImageMemoryBarriers     = mImageBarrierQueue.data(),
 		});
 
+		mMemoryBarrierQueue.clear();
 		mBufferBarrierQueue.clear();
 		mImageBarrierQueue.clear();
 	}
 
+	inline void AddBarrier(const vk::MemoryBarrier2& barrier)       { mMemoryBarrierQueue.emplace_back(barrier); }
 	inline void AddBarrier(const vk::BufferMemoryBarrier2& barrier) { mBufferBarrierQueue.emplace_back(barrier); }
 	inline void AddBarrier(const vk::ImageMemoryBarrier2& barrier)  { mImageBarrierQueue.emplace_back(barrier); }
 
@@ -247,6 +266,39 @@ public:
 				.dstOffset = dst.mOffset,
 				.size = src.size_bytes() });
 	}
+	// Copies src[i] to dst[dstIndices[i]] with a single copy command. Runs of consecutive indices are copied as one region.
+	template<typename T>
+	inline void Copy(const BufferRange<T>& src, const BufferRange<T>& dst, const std::span<const uint32_t> dstIndices) {
+		if (dstIndices.empty()) return;
+		if (src.size() < dstIndices.size())
+			throw std::runtime_error("src smaller than index count: " + std::to_string(src.size()) + " < " + std::to_string(dstIndices.size()));
+
+		std::vector<vk::BufferCopy> regions;
+		for (uint32_t i = 0; i < dstIndices.size(); i++) {
+			if (dstIndices[i] >= dst.size())
+				throw std::runtime_error("dst index out of range: " + std::to_string(dstIndices[i]) + " >= " + std::to_string(dst.size()));
+			if (i > 0 && dstIndices[i] == dstIndices[i-1] + 1)
+				regions.back().size += sizeof(T);
+			else
+				regions.emplace_back(vk::BufferCopy{
+					.srcOffset = src.mOffset + i * sizeof(T),
+					.dstOffset = dst.mOffset + dstIndices[i] * sizeof(T),
+					.size = sizeof(T) });
+		}
+
+		AddBarrier(src, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eTransfer,
+			.access = vk::AccessFlagBits2::eTransferRead,
+			.queueFamily = mQueueFamily });
+		AddBarrier(dst, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eTransfer,
+			.access = vk::AccessFlagBits2::eTransferWrite,
+			.queueFamily = mQueueFamily });
+
+		ExecuteBarriers();
+
+		mCommandBuffer.copyBuffer(**src.mBuffer, **dst.mBuffer, regions);
+	}
 	template<typename T>
 	inline void Copy(const BufferRange<T>& src, const ImageView& dst, const uint32_t dstLevel = 0) {
 		AddBarrier(src, Buffer::ResourceState{
@@ -272,7 +324,63 @@ public:
 				.bufferImageHeight = 0,
 				.imageSubresource = dst.GetSubresourceLayer(dstLevel),
 				.imageOffset = { 0, 0, 0 },
-				.imageExtent = vk::Extent3D{dst.Extent().x, dst.Extent().y, dst.Extent().z} });
+				.imageExtent = vk::Extent3D{dst.Extent(dstLevel).x, dst.Extent(dstLevel).y, dst.Extent(dstLevel).z} });
+	}
+	// Copies regions of src to dst in a single command, e.g. every level and layer of a texture file.
+	// Region buffer offsets are relative to src.
+	template<typename T>
+	inline void Copy(const BufferRange<T>& src, const ref<Image>& dst, const std::span<const vk::BufferImageCopy> regions) {
+		AddBarrier(src, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eTransfer,
+			.access = vk::AccessFlagBits2::eTransferRead,
+			.queueFamily = mQueueFamily });
+		AddBarrier(dst,
+			vk::ImageSubresourceRange{
+				.aspectMask     = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel   = 0,
+				.levelCount     = dst->Info().mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount     = dst->Info().arrayLayers },
+			Image::ResourceState{
+				.layout = vk::ImageLayout::eTransferDstOptimal,
+				.stage = vk::PipelineStageFlagBits2::eTransfer,
+				.access = vk::AccessFlagBits2::eTransferWrite,
+				.queueFamily = mQueueFamily });
+
+		ExecuteBarriers();
+
+		std::vector<vk::BufferImageCopy> copies(regions.begin(), regions.end());
+		for (vk::BufferImageCopy& c : copies)
+			c.bufferOffset += src.mOffset;
+		mCommandBuffer.copyBufferToImage(**src.mBuffer, **dst, vk::ImageLayout::eTransferDstOptimal, copies);
+	}
+	// Copies a mip level of src to dst, tightly packed
+	template<typename T>
+	inline void Copy(const ImageView& src, const BufferRange<T>& dst, const uint32_t srcLevel = 0) {
+		AddBarrier(src,
+			Image::ResourceState{
+				.layout = vk::ImageLayout::eTransferSrcOptimal,
+				.stage = vk::PipelineStageFlagBits2::eTransfer,
+				.access = vk::AccessFlagBits2::eTransferRead,
+				.queueFamily = mQueueFamily });
+		AddBarrier(dst, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eTransfer,
+			.access = vk::AccessFlagBits2::eTransferWrite,
+			.queueFamily = mQueueFamily });
+
+		ExecuteBarriers();
+
+		mCommandBuffer.copyImageToBuffer(
+			**src.mImage,
+			vk::ImageLayout::eTransferSrcOptimal,
+			**dst.mBuffer,
+			vk::BufferImageCopy{
+				.bufferOffset = dst.mOffset,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = src.GetSubresourceLayer(srcLevel),
+				.imageOffset = { 0, 0, 0 },
+				.imageExtent = vk::Extent3D{src.Extent(srcLevel).x, src.Extent(srcLevel).y, src.Extent(srcLevel).z} });
 	}
 
 	inline void Copy(const ref<Image>& src, const ref<Image>& dst, const vk::ArrayProxy<const vk::ImageCopy>& regions) {
@@ -322,40 +430,17 @@ public:
 			.extent = vk::Extent3D{dst.Extent().x, dst.Extent().y, dst.Extent().z} });
 	}
 
-	// Get a device buffer
+	// Get a device buffer, placed in pool's blocks of the transient heap.
+	// Its memory is reused by transient resources requested after the last reference to it is dropped.
 	template<typename T = std::byte>
-	inline BufferRange<T> GetTransientBuffer(const size_t count, const vk::BufferUsageFlags usage) {
+	inline BufferRange<T> GetTransientBuffer(const size_t count, const vk::BufferUsageFlags usage, const MemoryPool pool = MemoryPool::eTransient) {
 		const size_t size = sizeof(T) * count;
-
-		BufferView hostBuffer = {};
-		BufferView buffer = {};
-		if (auto it_ = mCache.mBuffers.find(usage); it_ != mCache.mBuffers.end()) {
-			auto& q = it_->second;
-			if (!q.empty() && q.back().size() >= size) {
-				// find smallest cached buffer that can fit size
-				auto it = std::ranges::lower_bound(q, size, {}, &CachedData::CachedBuffers::size);
-				if (it != q.end()) {
-					hostBuffer = it->hostBuffer;
-					buffer     = it->buffer;
-					q.erase(it);
-				}
-			}
-		}
-
-		if (!buffer || buffer.size() < size) {
-			buffer = Buffer::Create(
-				*mDevice,
-				size,
-				usage,
-				vk::MemoryPropertyFlagBits::eDeviceLocal,
-				VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT);
-			mDevice->SetDebugName(**buffer.mBuffer, "Transient buffer");
-			hostBuffer = {};
-		}
-
-		mCache.mNewBuffers[usage].emplace_back(hostBuffer, buffer);
-
-		return buffer.slice(0, size);
+		const BufferView buffer = mTransientHeap.GetBuffer(*mDevice, vk::BufferCreateInfo{
+			.size  = std::max<vk::DeviceSize>(size, 4),
+			.usage = usage }, pool);
+		if (const auto barrier = mTransientHeap.TakeAliasingBarrier())
+			AddBarrier(*barrier);
+		return buffer.slice(0, size).cast<T>();
 	}
 
 	// Copies data to buffer.
@@ -397,7 +482,9 @@ public:
 					size,
 					usage,
 					vk::MemoryPropertyFlagBits::eDeviceLocal,
-					VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT);
+					VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT,
+					0.5f,
+					MemoryPool::eTransient);
 				mDevice->SetDebugName(**buffer.mBuffer, "Transient buffer");
 			}
 
@@ -409,7 +496,13 @@ public:
 		return usage == (vk::BufferUsageFlags)0 ? hostBuffer.slice(0, size) : buffer.slice(0, size);
 	}
 
-	ref<Image> GetTransientImage(const ImageInfo& info);
+	// Get an image, placed in the transient heap like GetTransientBuffer
+	inline ref<Image> GetTransientImage(const ImageInfo& info) {
+		const ref<Image> image = mTransientHeap.GetImage(*mDevice, info);
+		if (const auto barrier = mTransientHeap.TakeAliasingBarrier())
+			AddBarrier(*barrier);
+		return image;
+	}
 	inline ref<Image> GetTransientImage(const uint3 extent, const vk::Format format, const vk::ImageUsageFlags usage, const uint32_t mipLevels = 1, const uint32_t arrayLayers = 1) {
 		return GetTransientImage(ImageInfo {
 			.format = format,
@@ -421,6 +514,51 @@ public:
 		});
 	}
 
+	// Copies src to the context's readback ring.
+	// The future resolves once the commands recorded so far are submitted and done. No memory is allocated unless the ring is full.
+	template<typename T>
+	inline ReadbackFuture<T> Readback(const BufferRange<T>& src) {
+		const auto[id, dst] = mReadback->Allocate(src.size_bytes(), std::max<vk::DeviceSize>(alignof(T), 16));
+		Copy(src, dst);
+		return ReadbackFuture<T>(mReadback, id, dst.cast<T>());
+	}
+	// Copies a region of a level of src's first layer to the context's readback ring, tightly packed.
+	// For block-compressed formats, offset and extent are in texels and must be multiples of the block size or reach the level's edge.
+	template<typename T = std::byte>
+	inline ReadbackFuture<T> Readback(const ImageView& src, const int3 offset, const uint3 extent, const uint32_t srcLevel = 0) {
+		const vk::Format format = src.mImage->Info().format;
+		const auto[id, dst] = mReadback->Allocate(GetImageSize(format, extent), std::lcm<vk::DeviceSize>(alignof(T), GetCopyAlignment(format)));
+
+		AddBarrier(src,
+			Image::ResourceState{
+				.layout = vk::ImageLayout::eTransferSrcOptimal,
+				.stage = vk::PipelineStageFlagBits2::eTransfer,
+				.access = vk::AccessFlagBits2::eTransferRead,
+				.queueFamily = mQueueFamily });
+		AddBarrier(dst, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eTransfer,
+			.access = vk::AccessFlagBits2::eTransferWrite,
+			.queueFamily = mQueueFamily });
+
+		ExecuteBarriers();
+
+		vk::ImageSubresourceLayers layer = src.GetSubresourceLayer(srcLevel);
+		layer.layerCount = 1;
+		mCommandBuffer.copyImageToBuffer(
+			**src.mImage,
+			vk::ImageLayout::eTransferSrcOptimal,
+			**dst.mBuffer,
+			vk::BufferImageCopy{
+				.bufferOffset = dst.mOffset,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = layer,
+				.imageOffset = { offset.x, offset.y, offset.z },
+				.imageExtent = { extent.x, extent.y, extent.z } });
+
+		return ReadbackFuture<T>(mReadback, id, dst.cast<T>());
+	}
+
 	inline void Blit(const ref<Image>& src, const ref<Image>& dst, const vk::ArrayProxy<const vk::ImageBlit>& regions, const vk::Filter filter) {
 		for (const vk::ImageBlit& region : regions) {
 			AddBarrier(src,
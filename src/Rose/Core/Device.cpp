@@ -5,6 +5,7 @@
 #include "Device.hpp"
 
 #include "Instance.hpp"
+#include "ResidencyManager.hpp"
 
 #include <functional>
 
@@ -21,7 +22,10 @@ auto ConfigureFeatures(Device& device, vk::PhysicalDeviceFeatures& features) {
 		vk::PhysicalDeviceRayTracingPipelineFeaturesKHR,
 		vk::PhysicalDeviceRayQueryFeaturesKHR,
 		vk::PhysicalDeviceFragmentShaderBarycentricFeaturesKHR,
-		vk::PhysicalDeviceMeshShaderFeaturesEXT
+		vk::PhysicalDeviceMeshShaderFeaturesEXT,
+		vk::PhysicalDeviceMemoryPriorityFeaturesEXT,
+		vk::PhysicalDevicePresentIdFeaturesKHR,
+		vk::PhysicalDevicePresentWaitFeaturesKHR
 		> createInfo = {};
 
 	features.fillModeNonSolid = true;
@@ -34,6 +38,8 @@ auto ConfigureFeatures(Device& device, vk::PhysicalDeviceFeatures& features) {
 	features.shaderInt16 = true;
 	features.shaderFloat64 = true;
 	features.geometryShader = true;
+	features.textureCompressionBC = device.PhysicalDevice().getFeatures().textureCompressionBC; // optional, for DDS and KTX2 textures
+	features.multiDrawIndirect = device.PhysicalDevice().getFeatures().multiDrawIndirect; // optional, for fixed count indirect draws
 	//features.shaderStorageBufferArrayDynamicIndexing = true;
 	//features.shaderSampledImageArrayDynamicIndexing = true;
 	//features.shaderStorageImageArrayDynamicIndexing = true;
@@ -47,6 +53,7 @@ auto ConfigureFeatures(Device& device, vk::PhysicalDeviceFeatures& features) {
 	vk12features.shaderFloat16 = true;
 	vk12features.bufferDeviceAddress = device.EnabledExtensions().contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) || device.EnabledExtensions().contains(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
 	vk12features.timelineSemaphore = true;
+	vk12features.drawIndirectCount = device.PhysicalDevice().getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount; // optional, see InstanceCulling
 
 	vk::PhysicalDeviceVulkan13Features& vk13features = std::get<vk::PhysicalDeviceVulkan13Features>(createInfo);
 	vk13features.dynamicRendering = true;
@@ -91,17 +98,42 @@ auto ConfigureFeatures(Device& device, vk::PhysicalDeviceFeatures& features) {
 		v.taskShader = true;
 	});
 
+	configureExtension.template operator()<vk::PhysicalDeviceMemoryPriorityFeaturesEXT>(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME, [](vk::PhysicalDeviceMemoryPriorityFeaturesEXT& v) {
+		v.memoryPriority = true;
+	});
+
+	configureExtension.template operator()<vk::PhysicalDevicePresentIdFeaturesKHR>(VK_KHR_PRESENT_ID_EXTENSION_NAME, [](vk::PhysicalDevicePresentIdFeaturesKHR& v) {
+		v.presentId = true;
+	});
+
+	configureExtension.template operator()<vk::PhysicalDevicePresentWaitFeaturesKHR>(VK_KHR_PRESENT_WAIT_EXTENSION_NAME, [](vk::PhysicalDevicePresentWaitFeaturesKHR& v) {
+		v.presentWait = true;
+	});
+
 	return createInfo;
 }
 
-ref<Device> Device::Create(const Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::ArrayProxy<const std::string>& deviceExtensions) {
+ref<Device> Device::Create(const Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::ArrayProxy<const std::string>& deviceExtensions, const vk::ArrayProxy<const std::string>& optionalDeviceExtensions) {
 	ref<Device> device = make_ref<Device>();
 
 	device->mPhysicalDevice = physicalDevice;
 	device->mInstance = **instance;
 
-	for (const auto& e : deviceExtensions)
+	std::unordered_set<std::string> supportedExtensions;
+	for (const auto& e : physicalDevice.enumerateDeviceExtensionProperties())
+		supportedExtensions.emplace(e.extensionName.data());
+	for (const auto& e : deviceExtensions) {
+		if (!supportedExtensions.contains(e))
+			throw std::runtime_error("Device extension " + e + " is not supported");
 		device->mExtensions.emplace(e);
+	}
+	// unsupported optional extensions are skipped, so that the features using them can fall back
+	for (const auto& e : optionalDeviceExtensions) {
+		if (supportedExtensions.contains(e))
+			device->mExtensions.emplace(e);
+		else
+			std::cout << "Optional device extension " << e << " is not supported" << std::endl;
+	}
 
 	auto createStructureChain = ConfigureFeatures(*device, device->mFeatures);
 
@@ -146,9 +178,14 @@ ref<Device> Device::Create(const Instance& instance, const vk::raii::PhysicalDev
 		.vulkanApiVersion = instance.VulkanVersion()
 	};
 	if (device->mExtensions.contains(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))                      allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	if (device->mExtensions.contains(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME))                    allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
 	if (std::get<vk::PhysicalDeviceVulkan12Features>(createStructureChain).bufferDeviceAddress) allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 	vmaCreateAllocator(&allocatorInfo, &device->mMemoryAllocator);
 
+	device->mDrawIndirectCount = std::get<vk::PhysicalDeviceVulkan12Features>(createStructureChain).drawIndirectCount;
+
+	device->mResidency = ResidencyManager::Create(*device);
+
 	// Create timeline semaphore
 
 	device->mCurrentTimelineValue = 0;
@@ -163,21 +200,113 @@ ref<Device> Device::Create(const Instance& instance, const vk::raii::PhysicalDev
 
 	device->mUseDebugUtils = instance.DebugMessengerEnabled();
 
-	const auto& properties = device->mPhysicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+	const auto& properties = device->mPhysicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR, vk::PhysicalDeviceMeshShaderPropertiesEXT>();
 	device->SetDebugName(*device->mDevice, "[" + std::to_string(properties.get<vk::PhysicalDeviceProperties2>().properties.deviceID) + "]: " + properties.get<vk::PhysicalDeviceProperties2>().properties.deviceName.data());
 
 	device->mLimits = properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
 	device->mAccelerationStructureProperties = properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+	device->mMeshShaderProperties = properties.get<vk::PhysicalDeviceMeshShaderPropertiesEXT>();
 
 	return device;
 }
 Device::~Device() {
+	mResidency.reset();
 	if (mMemoryAllocator != nullptr) {
+		for (const auto&[key, pool] : mMemoryPools)
+			vmaDestroyPool(mMemoryAllocator, pool);
+		mMemoryPools.clear();
 		vmaDestroyAllocator(mMemoryAllocator);
 		mMemoryAllocator = nullptr;
 	}
 }
 
+VmaPool Device::GetMemoryPool(const MemoryPool pool, const uint32_t memoryTypeIndex) const {
+	std::scoped_lock lock(mMemoryPoolMutex);
+	if (const auto it = mMemoryPools.find({ pool, memoryTypeIndex }); it != mMemoryPools.end())
+		return it->second;
+
+	// blockSize is left at 0 so that allocations larger than VMA's preferred block size can still get dedicated memory.
+	// Every pool uses VMA's default algorithm (TLSF), which reuses the holes left by freed allocations. Transient heap
+	// blocks and scratch buffers are freed one at a time as the frames and builds using them finish, never all at once,
+	// so the linear algorithm would only reuse memory once everything after a hole is freed too.
+	VmaPoolCreateInfo createInfo = {
+		.memoryTypeIndex = memoryTypeIndex,
+		.flags = 0,
+		.blockSize = 0,
+		.minBlockCount = 0,
+		.maxBlockCount = 0,
+		.priority = 0.5f };
+	switch (pool) {
+	case MemoryPool::eScene:
+		createInfo.priority = 0.75f;
+		break;
+	case MemoryPool::eTransient:
+	case MemoryPool::eScratch:
+		break;
+	case MemoryPool::eRenderTarget:
+		createInfo.priority = 1.f;
+		break;
+	default:
+		return VK_NULL_HANDLE;
+	}
+
+	VmaPool vmaPool = VK_NULL_HANDLE;
+	if (const vk::Result result = (vk::Result)vmaCreatePool(mMemoryAllocator, &createInfo, &vmaPool); result != vk::Result::eSuccess) {
+		std::cerr << "Failed to create " << to_string(pool) << " memory pool: " << vk::to_string(result) << std::endl;
+		return VK_NULL_HANDLE;
+	}
+	vmaSetPoolName(mMemoryAllocator, vmaPool, (std::string(to_string(pool)) + " (memory type " + std::to_string(memoryTypeIndex) + ")").c_str());
+	mMemoryPools.emplace(std::make_pair(pool, memoryTypeIndex), vmaPool);
+	return vmaPool;
+}
+
+std::vector<std::tuple<MemoryPool, uint32_t, VmaPool>> Device::MemoryPools() const {
+	std::scoped_lock lock(mMemoryPoolMutex);
+	std::vector<std::tuple<MemoryPool, uint32_t, VmaPool>> pools;
+	pools.reserve(mMemoryPools.size());
+	for (const auto&[key, pool] : mMemoryPools)
+		pools.emplace_back(key.first, key.second, pool);
+	return pools;
+}
+
+std::vector<Device::MemoryPoolStats> Device::MemoryPoolStatistics() const {
+	std::vector<MemoryPoolStats> result;
+	for (const auto&[pool, memoryType, vmaPool] : MemoryPools()) {
+		VmaDetailedStatistics stats;
+		vmaCalculatePoolStatistics(mMemoryAllocator, vmaPool, &stats);
+		const vk::DeviceSize unusedBytes = stats.statistics.blockBytes - stats.statistics.allocationBytes;
+		result.emplace_back(MemoryPoolStats{
+			.pool            = pool,
+			.memoryType      = memoryType,
+			.allocationCount = stats.statistics.allocationCount,
+			.allocationBytes = stats.statistics.allocationBytes,
+			.blockCount      = stats.statistics.blockCount,
+			.blockBytes      = stats.statistics.blockBytes,
+			.freeRanges      = stats.unusedRangeCount,
+			.fragmentation   = unusedBytes > 0 ? 1.f - stats.unusedRangeSizeMax / (float)unusedBytes : 0.f });
+	}
+	return result;
+}
+
+void Device::SelectMemoryPool(const MemoryPool pool, const vk::BufferCreateInfo& createInfo, VmaAllocationCreateInfo& allocationInfo) const {
+	if (pool == MemoryPool::eDefault || allocationInfo.pool != VK_NULL_HANDLE)
+		return;
+	if (pool == MemoryPool::eRenderTarget)
+		allocationInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+	uint32_t memoryTypeIndex;
+	if (vmaFindMemoryTypeIndexForBufferInfo(mMemoryAllocator, &(const VkBufferCreateInfo&)createInfo, &allocationInfo, &memoryTypeIndex) == VK_SUCCESS)
+		allocationInfo.pool = GetMemoryPool(pool, memoryTypeIndex);
+}
+void Device::SelectMemoryPool(const MemoryPool pool, const vk::ImageCreateInfo& createInfo, VmaAllocationCreateInfo& allocationInfo) const {
+	if (pool == MemoryPool::eDefault || allocationInfo.pool != VK_NULL_HANDLE)
+		return;
+	if (pool == MemoryPool::eRenderTarget)
+		allocationInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+	uint32_t memoryTypeIndex;
+	if (vmaFindMemoryTypeIndexForImageInfo(mMemoryAllocator, &(const VkImageCreateInfo&)createInfo, &allocationInfo, &memoryTypeIndex) == VK_SUCCESS)
+		allocationInfo.pool = GetMemoryPool(pool, memoryTypeIndex);
+}
+
 void Device::LoadPipelineCache(const std::filesystem::path& path) {
 	std::vector<uint8_t> cacheData;
 	vk::PipelineCacheCreateInfo cacheInfo = {};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <bitset>
+#include <map>
+#include <mutex>
 #include <vk_mem_alloc.h>
 
 #include "RoseEngine.hpp"
@@ -10,21 +12,60 @@ namespace RoseEngine {
 class Instance;
 
 class CommandContext;
+class ResidencyManager;
+
+// Classes of resources with their own VMA pools, so that allocations with different lifetimes don't fragment each other's memory blocks
+enum class MemoryPool {
+	eDefault,      // VMA's default pools
+	eScene,        // long lived scene data: meshes, textures, acceleration structures
+	eTransient,    // buffers and images cached by CommandContext, reused every frame
+	eScratch,      // acceleration structure build scratch
+	eRenderTarget, // attachments, each in a dedicated allocation
+};
+inline const char* to_string(const MemoryPool pool) {
+	switch (pool) {
+		default:
+		case MemoryPool::eDefault:      return "Default";
+		case MemoryPool::eScene:        return "Scene";
+		case MemoryPool::eTransient:    return "Transient";
+		case MemoryPool::eScratch:      return "Scratch";
+		case MemoryPool::eRenderTarget: return "Render target";
+	}
+}
 
 class Device {
+public:
+	struct MemoryPoolStats {
+		MemoryPool     pool = MemoryPool::eDefault;
+		uint32_t       memoryType = 0;
+		uint32_t       allocationCount = 0;
+		vk::DeviceSize allocationBytes = 0;
+		uint32_t       blockCount = 0;
+		vk::DeviceSize blockBytes = 0;
+		uint32_t       freeRanges = 0;
+		float          fragmentation = 0; // share of the free memory outside the largest free range
+	};
+
 private:
 	vk::raii::Device         mDevice = nullptr;
 	vk::raii::PhysicalDevice mPhysicalDevice = nullptr;
 	vk::raii::PipelineCache  mPipelineCache = nullptr;
 	vk::Instance             mInstance = nullptr;
 	VmaAllocator             mMemoryAllocator = nullptr;
+	ref<ResidencyManager>    mResidency = nullptr;
+
+	// created on first use, for each memory type a class of resources is allocated from
+	mutable std::mutex                                          mMemoryPoolMutex;
+	mutable std::map<std::pair<MemoryPool, uint32_t>, VmaPool> mMemoryPools = {};
 
 	vk::raii::Semaphore      mTimelineSemaphore = nullptr;
 	uint64_t                 mCurrentTimelineValue = 0;
 
 	vk::PhysicalDeviceFeatures mFeatures = {};
+	bool mDrawIndirectCount = false;
 	vk::PhysicalDeviceLimits mLimits = {};
 	vk::PhysicalDeviceAccelerationStructurePropertiesKHR mAccelerationStructureProperties = {};
+	vk::PhysicalDeviceMeshShaderPropertiesEXT mMeshShaderProperties = {};
 
 	std::unordered_set<std::string> mExtensions = {};
 
@@ -33,7 +74,9 @@ private:
 public:
 	~Device();
 
-	static ref<Device> Create(const Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::ArrayProxy<const std::string>& deviceExtensions = {});
+	// Throws if one of deviceExtensions is not supported. optionalDeviceExtensions are enabled only if supported,
+	// so features depending on them (ray queries, mesh shaders) must check EnabledExtensions.
+	static ref<Device> Create(const Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::ArrayProxy<const std::string>& deviceExtensions = {}, const vk::ArrayProxy<const std::string>& optionalDeviceExtensions = {});
 
 	inline       vk::raii::Device& operator*()        { return mDevice; }
 	inline const vk::raii::Device& operator*() const  { return mDevice; }
@@ -44,12 +87,31 @@ public:
 	void StorePipelineCache(const std::filesystem::path& path);
 
 	inline VmaAllocator                           MemoryAllocator() const { return mMemoryAllocator; }
+	inline ResidencyManager&                      Residency() const { return *mResidency; }
+	// The VMA pools created so far, with their class and memory type
+	std::vector<std::tuple<MemoryPool, uint32_t, VmaPool>> MemoryPools() const;
+	// Usage of each pool in MemoryPools
+	std::vector<MemoryPoolStats> MemoryPoolStatistics() const;
+	// The VMA pool of a class of resources for a memory type, or VK_NULL_HANDLE for MemoryPool::eDefault
+	VmaPool GetMemoryPool(const MemoryPool pool, const uint32_t memoryTypeIndex) const;
+	// Points allocationInfo at the pool of a class of resources, for the memory type VMA picks for the buffer or image.
+	// Allocations in a pool take the pool's priority. Leaves allocationInfo unchanged for MemoryPool::eDefault.
+	void SelectMemoryPool(const MemoryPool pool, const vk::BufferCreateInfo& createInfo, VmaAllocationCreateInfo& allocationInfo) const;
+	void SelectMemoryPool(const MemoryPool pool, const vk::ImageCreateInfo&  createInfo, VmaAllocationCreateInfo& allocationInfo) const;
 	inline vk::Instance                           GetInstance() const { return mInstance; }
 	inline const vk::raii::PhysicalDevice&        PhysicalDevice() const { return mPhysicalDevice; }
 	inline const vk::raii::PipelineCache&         PipelineCache() const { return mPipelineCache; }
+	inline const vk::PhysicalDeviceFeatures&      Features() const { return mFeatures; }
 	inline const vk::PhysicalDeviceLimits&        Limits() const { return mLimits; }
+	inline const vk::PhysicalDeviceAccelerationStructurePropertiesKHR& AccelerationStructureProperties() const { return mAccelerationStructureProperties; }
+	inline const vk::PhysicalDeviceMeshShaderPropertiesEXT& MeshShaderProperties() const { return mMeshShaderProperties; }
 	inline const std::unordered_set<std::string>& EnabledExtensions() const { return mExtensions; }
 	inline bool                                   DebugUtilsEnabled() const { return mUseDebugUtils; }
+	inline bool                                   SupportsMemoryPriority() const { return mExtensions.contains(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME); }
+	// Without drawIndirectCount, culling writes a command per instance (see InstanceCulling)
+	inline bool                                   SupportsDrawIndirectCount() const { return mDrawIndirectCount; }
+	// Scene shaders fall back to software ray tracing (USE_SOFTWARE_RAYTRACING) without ray queries
+	inline bool                                   SupportsRayQuery() const { return mExtensions.contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME) && mExtensions.contains(VK_KHR_RAY_QUERY_EXTENSION_NAME); }
 
 	inline uint32_t FindQueueFamily(const vk::QueueFlags flags = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer) {
 		uint32_t min_i = -1;
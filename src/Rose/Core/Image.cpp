@@ -1,5 +1,6 @@
 #include "Image.hpp"
 #include "Buffer.hpp"
+#include "ResidencyManager.hpp"
 #include <iostream>
 
 namespace RoseEngine {
@@ -16,16 +17,7 @@ std::vector<std::vector<Image::ResourceState>> CreateSubresourceStates(const Ima
 				.queueFamily = info.queueFamilies.empty() ? VK_QUEUE_FAMILY_IGNORED : info.queueFamilies.front() }));
 }
 
-ref<Image> Image::Create(Device& device, const ImageInfo& info, const vk::MemoryPropertyFlags memoryFlags, const VmaAllocationCreateFlags allocationFlags) {
-	VmaAllocationCreateInfo allocationCreateInfo {
-		.flags = allocationFlags,
-		.usage = VMA_MEMORY_USAGE_AUTO,
-		.requiredFlags = (VkMemoryPropertyFlags)memoryFlags,
-		.memoryTypeBits = 0,
-		.pool = VK_NULL_HANDLE,
-		.pUserData = VK_NULL_HANDLE,
-		.priority = 0 };
-
+vk::ImageCreateInfo Image::GetCreateInfo(const ImageInfo& info) {
 	vk::ImageCreateInfo createInfo{
 		.flags       = info.createFlags,
 		.imageType   = info.type,
@@ -39,11 +31,30 @@ ref<Image> Image::Create(Device& device, const ImageInfo& info, const vk::Memory
 		.sharingMode = info.sharingMode,
 		.initialLayout = vk::ImageLayout::eUndefined };
 	createInfo.setQueueFamilyIndices(info.queueFamilies);
+	return createInfo;
+}
+
+ref<Image> Image::Create(Device& device, const ImageInfo& info, const vk::MemoryPropertyFlags memoryFlags, const VmaAllocationCreateFlags allocationFlags, const float priority, const MemoryPool pool) {
+	VmaAllocationCreateInfo allocationCreateInfo {
+		.flags = allocationFlags,
+		.usage = VMA_MEMORY_USAGE_AUTO,
+		.requiredFlags = (VkMemoryPropertyFlags)memoryFlags,
+		.memoryTypeBits = 0,
+		.pool = VK_NULL_HANDLE,
+		.pUserData = VK_NULL_HANDLE,
+		.priority = priority };
+
+	const vk::ImageCreateInfo createInfo = GetCreateInfo(info);
+
+	device.SelectMemoryPool(pool, createInfo, allocationCreateInfo);
 
 	VkImage vkimg;
 	VmaAllocation alloc;
-	vk::Result result = (vk::Result)vmaCreateImage(device.MemoryAllocator(), &(const VkImageCreateInfo&)createInfo, &allocationCreateInfo, &vkimg, &alloc, nullptr);
+	VmaAllocationInfo allocInfo;
+	const vk::Result result = (vk::Result)vmaCreateImage(device.MemoryAllocator(), &(const VkImageCreateInfo&)createInfo, &allocationCreateInfo, &vkimg, &alloc, &allocInfo);
 	if (result != vk::Result::eSuccess) {
+		if (result == vk::Result::eErrorOutOfDeviceMemory)
+			device.Residency().AllocationFailed(device->getImageMemoryRequirements(vk::DeviceImageMemoryRequirements{ .pCreateInfo = &createInfo }).memoryRequirements.size);
 		std::cerr << "Failed to create image: " << vk::to_string(result) << std::endl;
 		return nullptr;
 	}
@@ -53,6 +64,7 @@ ref<Image> Image::Create(Device& device, const ImageInfo& info, const vk::Memory
 	image->mDevice = **device;
 	image->mMemoryAllocator = device.MemoryAllocator();
 	image->mAllocation = alloc;
+	image->mMemorySize = allocInfo.size;
 	image->mInfo = info;
 	image->mSubresourceStates = CreateSubresourceStates(info);
 	return image;
@@ -67,10 +79,30 @@ ref<Image> Image::Create(const vk::Device device, const vk::Image vkimage, const
 	image->mSubresourceStates = CreateSubresourceStates(info);
 	return image;
 }
+ref<Image> Image::CreatePlaced(const Device& device, const ImageInfo& info, const ref<VmaAllocation_T>& memory, const vk::DeviceSize offset) {
+	const vk::ImageCreateInfo createInfo = GetCreateInfo(info);
+	VkImage vkimg;
+	const vk::Result result = (vk::Result)vmaCreateAliasingImage2(device.MemoryAllocator(), memory.get(), offset, &(const VkImageCreateInfo&)createInfo, &vkimg);
+	if (result != vk::Result::eSuccess) {
+		std::cerr << "Failed to create placed image: " << vk::to_string(result) << std::endl;
+		return nullptr;
+	}
+
+	auto image = make_ref<Image>();
+	image->mImage = vkimg;
+	image->mDevice = **device;
+	image->mMemoryAllocator = device.MemoryAllocator();
+	image->mPlacedMemory = memory;
+	image->mInfo = info;
+	image->mSubresourceStates = CreateSubresourceStates(info);
+	return image;
+}
+
 Image::~Image() {
 	for (auto[key, v] : mCachedViews)
 		mDevice.destroyImageView(v);
-	if (mMemoryAllocator && mImage && mAllocation) {
+	// placed images have no allocation of their own. images without an allocator (e.g. swapchain images) aren't owned
+	if (mMemoryAllocator && mImage) {
 		vmaDestroyImage(mMemoryAllocator, mImage, mAllocation);
 		mMemoryAllocator = nullptr;
 		mImage = nullptr;
@@ -78,18 +110,19 @@ Image::~Image() {
 	}
 }
 
-ImageView ImageView::Create(const ref<Image>& image, const vk::ImageSubresourceRange& subresource, const vk::ImageViewType type, const vk::ComponentMapping& componentMapping) {
+ImageView ImageView::Create(const ref<Image>& image, const vk::ImageSubresourceRange& subresource, const vk::ImageViewType type, const vk::ComponentMapping& componentMapping, const vk::Format format) {
 	if (!image) return {};
 	vk::ImageSubresourceRange s = subresource;
 	if (s.layerCount == VK_REMAINING_ARRAY_LAYERS) s.layerCount = image->Info().arrayLayers;
 	if (s.levelCount == VK_REMAINING_MIP_LEVELS)   s.levelCount = image->Info().mipLevels;
-	auto key = std::tie(s, type, componentMapping);
+	const vk::Format viewFormat = format == vk::Format::eUndefined ? image->Info().format : format;
+	auto key = std::tie(s, type, componentMapping, viewFormat);
 	auto it = image->mCachedViews.find(key);
 	if (it == image->mCachedViews.end()) {
 		vk::ImageView v = image->mDevice.createImageView(vk::ImageViewCreateInfo{
 			.image = **image,
 			.viewType = type,
-			.format = image->Info().format,
+			.format = viewFormat,
 			.components = componentMapping,
 			.subresourceRange = s });
 		it = image->mCachedViews.emplace(key, v).first;
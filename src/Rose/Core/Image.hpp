@@ -1,5 +1,7 @@
 #pragma once
 
+#include <numeric>
+
 #include "MathTypes.hpp"
 #include "Buffer.hpp"
 
@@ -339,14 +341,68 @@ inline constexpr T GetChannelCount(const vk::Format format) {
 }
 
 
+inline constexpr bool IsBlockCompressed(vk::Format format) {
+	return format >= vk::Format::eBc1RgbUnormBlock && format <= vk::Format::eBc7SrgbBlock;
+}
+
+// Size of a 4x4 texel block of a block-compressed format, in bytes
+inline constexpr uint32_t GetBlockSize(vk::Format format) {
+	switch (format) {
+	case vk::Format::eBc1RgbUnormBlock:
+	case vk::Format::eBc1RgbSrgbBlock:
+	case vk::Format::eBc1RgbaUnormBlock:
+	case vk::Format::eBc1RgbaSrgbBlock:
+	case vk::Format::eBc4UnormBlock:
+	case vk::Format::eBc4SnormBlock:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+// Size of a tightly packed region of format, in bytes
+inline size_t GetImageSize(vk::Format format, const uint3& extent) {
+	if (IsBlockCompressed(format))
+		return size_t((extent.x + 3) / 4) * size_t((extent.y + 3) / 4) * extent.z * GetBlockSize(format);
+	return size_t(extent.x) * extent.y * extent.z * GetTexelSize(format);
+}
+
+// Alignment of the buffer offset of copies between buffers and images of format: a multiple of the texel (or block) size and of 4
+inline size_t GetCopyAlignment(vk::Format format) {
+	return std::lcm(size_t(IsBlockCompressed(format) ? GetBlockSize(format) : GetTexelSize(format)), size_t(4));
+}
+
 struct PixelData {
 	BufferView data     = {};
 	vk::Format format   = {};
 	uint3 extent = {};
+	uint32_t          mipLevels   = 1;
+	uint32_t          arrayLayers = 1;
+	vk::ImageViewType viewType    = vk::ImageViewType::e2D;
+	std::vector<vk::BufferImageCopy> regions = {}; // every level and layer in data, with offsets relative to data
 };
 class CommandContext;
 PixelData LoadImageFile(CommandContext& context, const std::filesystem::path& filename, const bool srgb = true, int desiredChannels = 0);
 
+// Pixels of an image file in host memory. Unlike LoadImageFile, decoding may run on any thread.
+struct DecodedImage {
+	std::vector<std::byte> pixels = {};
+	vk::Format             format = {};
+	uint3                  extent = {};
+	// DDS and KTX2 files may contain mip chains, arrays and cube maps. Other formats have a single level and layer.
+	uint32_t               mipLevels   = 1;
+	uint32_t               arrayLayers = 1;
+	vk::ImageViewType      viewType    = vk::ImageViewType::e2D;
+	std::vector<vk::BufferImageCopy> regions = {}; // every level and layer in pixels
+};
+// Basis Universal textures in KTX2 files are transcoded to BC formats if transcodeToBC, and to RGBA8 otherwise.
+DecodedImage DecodeImageFile(const std::filesystem::path& filename, const bool srgb = true, int desiredChannels = 0, const bool transcodeToBC = true);
+
+bool IsKTX2(const std::span<const std::byte> data);
+// Reads a KTX2 container in memory, including every level, layer and face. Uncompressed and zlib supercompressed
+// files are read directly. zstd supercompression and Basis Universal need libktx (ENABLE_KTX).
+DecodedImage DecodeKTX2(const std::span<const std::byte> data, const bool transcodeToBC = true);
+
 struct ImageInfo {
 	vk::ImageCreateFlags    createFlags   = {};
 	vk::ImageType           type          = vk::ImageType::e2D;
@@ -377,16 +433,22 @@ private:
 	vk::Device    mDevice = nullptr;
 	VmaAllocator  mMemoryAllocator = nullptr;
 	VmaAllocation mAllocation = nullptr;
+	vk::DeviceSize mMemorySize = 0;
+	ref<VmaAllocation_T> mPlacedMemory = {}; // memory shared with other resources, for images created with CreatePlaced
 	ImageInfo     mInfo = {};
 
 	friend struct ImageView;
-	TupleMap<vk::ImageView, vk::ImageSubresourceRange, vk::ImageViewType, vk::ComponentMapping> mCachedViews = {};
+	TupleMap<vk::ImageView, vk::ImageSubresourceRange, vk::ImageViewType, vk::ComponentMapping, vk::Format> mCachedViews = {};
 
 	std::vector<std::vector<ResourceState>> mSubresourceStates = {}; // mSubresourceStates[arrayLayer][mipLevel]
 
 public:
-	static ref<Image> Create(Device& device, const ImageInfo& info, const vk::MemoryPropertyFlags memoryFlags = vk::MemoryPropertyFlagBits::eDeviceLocal, const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT);
+	// priority is the VK_EXT_memory_priority of the allocation, in [0,1]. Images in a pool other than MemoryPool::eDefault take the pool's priority
+	static ref<Image> Create(Device& device, const ImageInfo& info, const vk::MemoryPropertyFlags memoryFlags = vk::MemoryPropertyFlagBits::eDeviceLocal, const VmaAllocationCreateFlags allocationFlags = VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, const float priority = 0.5f, const MemoryPool pool = MemoryPool::eDefault);
 	static ref<Image> Create(const vk::Device device, const vk::Image image, const ImageInfo& info);
+	// Creates an image bound to memory at offset, which other resources may alias (see TransientHeap)
+	static ref<Image> CreatePlaced(const Device& device, const ImageInfo& info, const ref<VmaAllocation_T>& memory, const vk::DeviceSize offset);
+	static vk::ImageCreateInfo GetCreateInfo(const ImageInfo& info);
 	~Image();
 
 	inline       vk::Image& operator*()        { return mImage; }
@@ -399,10 +461,27 @@ public:
 	inline operator bool() const { return mImage; }
 
 	inline const ImageInfo& Info() const { return mInfo; }
+	// Bytes of memory allocated for the image, or 0 if it isn't owned (e.g. swapchain images)
+	inline vk::DeviceSize MemorySize() const { return mMemorySize; }
 
 	inline const ResourceState& GetSubresourceState(const uint32_t arrayLayer, const uint32_t level) const {
 		return mSubresourceStates[arrayLayer][level];
 	}
+	// Sets the state of every subresource, without a barrier
+	inline void ResetState(const ResourceState& state) {
+		for (auto& layer : mSubresourceStates)
+			std::ranges::fill(layer, state);
+	}
+	// The stages and accesses of every subresource combined, to order resources aliasing the image's memory after it
+	inline ResourceState CombinedState() const {
+		ResourceState combined = {};
+		for (const auto& layer : mSubresourceStates)
+			for (const ResourceState& state : layer) {
+				combined.stage  |= state.stage;
+				combined.access |= state.access;
+			}
+		return combined;
+	}
 	inline std::vector<vk::ImageMemoryBarrier2> SetSubresourceState(const vk::ImageSubresourceRange& subresource, const ResourceState& newState) {
 		std::vector<vk::ImageMemoryBarrier2> barriers;
 
@@ -473,7 +552,8 @@ struct ImageView {
 	vk::ImageViewType         mType = vk::ImageViewType::e2D;
 	vk::ComponentMapping      mComponentMapping = {};
 
-	static ImageView Create(const ref<Image>& image, const vk::ImageSubresourceRange& subresource = { vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }, const vk::ImageViewType type = vk::ImageViewType::e2D, const vk::ComponentMapping& componentMapping = {});
+	// format defaults to the image's. Other formats need an image created with eMutableFormat.
+	static ImageView Create(const ref<Image>& image, const vk::ImageSubresourceRange& subresource = { vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS }, const vk::ImageViewType type = vk::ImageViewType::e2D, const vk::ComponentMapping& componentMapping = {}, const vk::Format format = vk::Format::eUndefined);
 
 	inline       vk::ImageView& operator*()        { return mView; }
 	inline const vk::ImageView& operator*() const  { return mView; }
@@ -0,0 +1,193 @@
+#include "ImageLoader.hpp"
+#include "Gui.hpp"
+
+#include <chrono>
+
+namespace RoseEngine {
+
+ref<ThreadPool> ImageLoader::SharedPool() {
+	static std::mutex mutex;
+	static std::weak_ptr<ThreadPool> pool;
+	std::scoped_lock lock(mutex);
+	ref<ThreadPool> p = pool.lock();
+	if (!p) {
+		p = make_ref<ThreadPool>();
+		pool = p;
+	}
+	return p;
+}
+
+ImageLoader::ImageLoader(const uint32_t threadCount) {
+	mPool = threadCount == 0 ? SharedPool() : make_ref<ThreadPool>(threadCount);
+}
+ImageLoader::~ImageLoader() {
+	// the tasks write to mStats, so wait for this loader's tasks to finish. Other loaders may still use a shared pool.
+	for (const ref<AsyncImage>& image : mPending)
+		if (image->mDecode.valid())
+			image->mDecode.wait();
+	mPool.reset();
+	mRetiredPools.clear();
+}
+
+void ImageLoader::SetThreadCount(const uint32_t threadCount) {
+	mRetiredPools.emplace_back(std::move(mPool));
+	mPool = threadCount == 0 ? SharedPool() : make_ref<ThreadPool>(threadCount);
+}
+
+ref<AsyncImage> ImageLoader::Load(CommandContext& context, const std::filesystem::path& filename, const bool srgb, const int desiredChannels) {
+	if (!mPlaceholder) {
+		mPlaceholder = ImageView::Create(Image::Create(context.GetDevice(), ImageInfo{
+			.format = vk::Format::eR8G8B8A8Unorm,
+			.extent = uint3(1, 1, 1),
+			.queueFamilies = { context.QueueFamily() } }));
+		context.GetDevice().SetDebugName(**mPlaceholder.mImage, "ImageLoader placeholder");
+		context.Copy(context.UploadData(std::array<uint8_t, 4>{ 0, 0, 0, 255 }), mPlaceholder);
+	}
+
+	const ref<AsyncImage> image = make_ref<AsyncImage>();
+	image->mFilename = filename;
+	image->mView     = mPlaceholder;
+
+	// Basis Universal textures become BC7, BC5 or BC4 where supported
+	const bool transcodeToBC = context.GetDevice().Features().textureCompressionBC;
+
+	std::string extension = filename.extension().string();
+	std::ranges::transform(extension, extension.begin(), [](const char c) { return (char)std::tolower(c); });
+
+	image->mDecode = mPool->Push([=, this]() {
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		DecodedImage result = {};
+		std::exception_ptr error = nullptr;
+		try {
+			result = DecodeImageFile(filename, srgb, desiredChannels, transcodeToBC);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t0).count();
+		{
+			std::scoped_lock lock(mStatsMutex);
+			FormatStats& stats = mStats[extension];
+			if (error) {
+				stats.failures++;
+			} else {
+				stats.count++;
+				stats.decodeSeconds += seconds;
+				stats.maxDecodeSeconds = std::max(stats.maxDecodeSeconds, seconds);
+				stats.decodedBytes += result.pixels.size();
+			}
+		}
+		if (error)
+			std::rethrow_exception(error);
+		return result;
+	});
+
+	mPending.emplace_back(image);
+	return image;
+}
+
+uint32_t ImageLoader::Update(CommandContext& context) {
+	uint32_t doneCount = 0;
+	std::erase_if(mPending, [&](const ref<AsyncImage>& image) {
+		if (image->mDecode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+
+		doneCount++;
+
+		DecodedImage pixels;
+		try {
+			pixels = image->mDecode.get();
+		} catch (const std::exception& e) {
+			image->mError = e.what();
+			std::cerr << "Failed to load " << image->mFilename << ": " << e.what() << std::endl;
+			return true;
+		}
+
+		// BC6H and BC7 are optional
+		if (!(context.GetDevice().PhysicalDevice().getFormatProperties(pixels.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+			image->mError = "Format " + vk::to_string(pixels.format) + " is not supported by the device";
+			std::cerr << "Failed to load " << image->mFilename << ": " << image->mError << std::endl;
+			return true;
+		}
+
+		const bool cube = pixels.viewType == vk::ImageViewType::eCube || pixels.viewType == vk::ImageViewType::eCubeArray;
+		const ImageView view = ImageView::Create(
+			Image::Create(context.GetDevice(), ImageInfo{
+				.createFlags = cube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlags{},
+				.type = pixels.viewType == vk::ImageViewType::e3D ? vk::ImageType::e3D :
+					(pixels.viewType == vk::ImageViewType::e1D || pixels.viewType == vk::ImageViewType::e1DArray) ? vk::ImageType::e1D : vk::ImageType::e2D,
+				.format = pixels.format,
+				.extent = pixels.extent,
+				.mipLevels = pixels.mipLevels,
+				.arrayLayers = pixels.arrayLayers,
+				.queueFamilies = { context.QueueFamily() } }),
+			vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+			pixels.viewType);
+		if (!view) {
+			image->mError = "Failed to create image";
+			return true;
+		}
+		context.GetDevice().SetDebugName(**view.mImage, image->mFilename.filename().string());
+		// every level and layer in one copy
+		context.Copy(context.UploadData(pixels.pixels), view.mImage, pixels.regions);
+
+		image->mView = view;
+		image->mReady = true;
+		return true;
+	});
+
+	if (mPending.empty())
+		mRetiredPools.clear();
+
+	return doneCount;
+}
+
+void ImageLoader::Flush(CommandContext& context) {
+	for (const ref<AsyncImage>& image : mPending)
+		image->mDecode.wait();
+	Update(context);
+}
+
+std::unordered_map<std::string, ImageLoader::FormatStats> ImageLoader::Stats() const {
+	std::scoped_lock lock(mStatsMutex);
+	return mStats;
+}
+void ImageLoader::ResetStats() {
+	std::scoped_lock lock(mStatsMutex);
+	mStats.clear();
+}
+
+void ImageLoader::DrawGui() {
+	uint32_t threadCount = ThreadCount();
+	if (Gui::ScalarField("Decode threads", &threadCount, 1u, std::max(std::thread::hardware_concurrency(), 1u), 0) && threadCount != ThreadCount())
+		SetThreadCount(threadCount);
+
+	ImGui::Text("%zu images pending", mPending.size());
+
+	const auto stats = Stats();
+	if (stats.empty()) return;
+
+	if (ImGui::BeginTable("Decode stats", 5, ImGuiTableFlags_RowBg|ImGuiTableFlags_SizingFixedFit)) {
+		ImGui::TableSetupColumn("Format");
+		ImGui::TableSetupColumn("Images");
+		ImGui::TableSetupColumn("Avg (ms)");
+		ImGui::TableSetupColumn("Max (ms)");
+		ImGui::TableSetupColumn("Decoded");
+		ImGui::TableHeadersRow();
+		for (const auto&[extension, s] : stats) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(extension.c_str());
+			ImGui::TableNextColumn();
+			if (s.failures > 0)
+				ImGui::Text("%u (%u failed)", s.count, s.failures);
+			else
+				ImGui::Text("%u", s.count);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", s.count > 0 ? 1000 * s.decodeSeconds / s.count : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", 1000 * s.maxDecodeSeconds);
+			const auto[bytes, unit] = FormatBytes(s.decodedBytes);
+			ImGui::TableNextColumn(); ImGui::Text("%zu %s", bytes, unit);
+		}
+		ImGui::EndTable();
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+
+#include "CommandContext.hpp"
+#include "ThreadPool.hpp"
+
+namespace RoseEngine {
+
+// Image file which is decoded in the background by an ImageLoader.
+// View() returns the loader's placeholder until the pixels are decoded and uploaded.
+class AsyncImage {
+private:
+	friend class ImageLoader;
+
+	std::filesystem::path     mFilename = {};
+	ImageView                 mView = {};
+	bool                      mReady = false;
+	std::string               mError = {};
+	std::future<DecodedImage> mDecode = {};
+
+public:
+	inline const std::filesystem::path& Filename() const { return mFilename; }
+	inline const ImageView& View() const { return mView; }
+	inline bool IsReady() const { return mReady; }
+	// True once the image is either uploaded or failed to load
+	inline bool IsDone() const { return mReady || !mError.empty(); }
+	inline const std::string& Error() const { return mError; }
+};
+
+// Decodes image files on a thread pool, and uploads them from the thread that records commands.
+class ImageLoader {
+public:
+	struct FormatStats {
+		uint32_t count = 0;
+		uint32_t failures = 0;
+		double   decodeSeconds = 0;
+		double   maxDecodeSeconds = 0;
+		size_t   decodedBytes = 0;
+	};
+
+private:
+	ref<ThreadPool>              mPool;
+	std::vector<ref<ThreadPool>> mRetiredPools; // replaced by SetThreadCount, destroyed once their tasks are done
+	std::vector<ref<AsyncImage>>             mPending;
+	ImageView                                mPlaceholder = {};
+
+	mutable std::mutex                           mStatsMutex;
+	std::unordered_map<std::string, FormatStats> mStats; // by lowercase file extension
+
+public:
+	// The pool used by loaders created with threadCount = 0, with one thread per hardware thread
+	static ref<ThreadPool> SharedPool();
+
+	// threadCount = 0 uses SharedPool, so that loaders (e.g. one per scene) don't each start a thread per hardware thread
+	ImageLoader(const uint32_t threadCount = 0);
+	~ImageLoader();
+
+	inline uint32_t ThreadCount() const { return mPool->ThreadCount(); }
+	// Tasks already queued keep running on the previous threads
+	void SetThreadCount(const uint32_t threadCount);
+
+	inline size_t PendingCount() const { return mPending.size(); }
+
+	// Queues filename for decoding. The returned image holds a 1x1 placeholder until Update uploads it.
+	// See DecodeImageFile for srgb and desiredChannels.
+	ref<AsyncImage> Load(CommandContext& context, const std::filesystem::path& filename, const bool srgb = true, const int desiredChannels = 0);
+
+	// Records uploads of the images which finished decoding. Returns the number of images which became done.
+	uint32_t Update(CommandContext& context);
+
+	// Blocks until every queued image is done, then uploads them
+	void Flush(CommandContext& context);
+
+	std::unordered_map<std::string, FormatStats> Stats() const;
+	void ResetStats();
+
+	void DrawGui();
+};
+
+}
\ No newline at end of file
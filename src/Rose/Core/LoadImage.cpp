@@ -14,6 +14,10 @@
 #define TINYDDSLOADER_IMPLEMENTATION
 #include <tinyddsloader.h>
 
+#ifdef ENABLE_KTX
+#include <ktx.h>
+#endif
+
 namespace RoseEngine {
 
 inline vk::Format dxgiToVulkan(tinyddsloader::DDSFile::DXGIFormat format, const bool alphaFlag) {
@@ -35,6 +39,10 @@ inline vk::Format dxgiToVulkan(tinyddsloader::DDSFile::DXGIFormat format, const
 		case tinyddsloader::DDSFile::DXGIFormat::BC4_SNorm:       return vk::Format::eBc4SnormBlock;
 		case tinyddsloader::DDSFile::DXGIFormat::BC5_UNorm:       return vk::Format::eBc5UnormBlock;
 		case tinyddsloader::DDSFile::DXGIFormat::BC5_SNorm:       return vk::Format::eBc5SnormBlock;
+		case tinyddsloader::DDSFile::DXGIFormat::BC6H_UF16:       return vk::Format::eBc6HUfloatBlock;
+		case tinyddsloader::DDSFile::DXGIFormat::BC6H_SF16:       return vk::Format::eBc6HSfloatBlock;
+		case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm:       return vk::Format::eBc7UnormBlock;
+		case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm_SRGB:  return vk::Format::eBc7SrgbBlock;
 
 		case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm:      return vk::Format::eR8G8B8A8Unorm;
 		case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm_SRGB: return vk::Format::eR8G8B8A8Srgb;
@@ -50,14 +58,217 @@ inline vk::Format dxgiToVulkan(tinyddsloader::DDSFile::DXGIFormat format, const
 		case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_UNorm:  return vk::Format::eR16G16B16A16Unorm;
 		case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_SNorm:  return vk::Format::eR16G16B16A16Snorm;
 
+		case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_Float:  return vk::Format::eR32G32B32A32Sfloat;
+		case tinyddsloader::DDSFile::DXGIFormat::R32G32_Float:        return vk::Format::eR32G32Sfloat;
+		case tinyddsloader::DDSFile::DXGIFormat::R32_Float:           return vk::Format::eR32Sfloat;
+		case tinyddsloader::DDSFile::DXGIFormat::R16G16_Float:        return vk::Format::eR16G16Sfloat;
+		case tinyddsloader::DDSFile::DXGIFormat::R16_Float:           return vk::Format::eR16Sfloat;
+		case tinyddsloader::DDSFile::DXGIFormat::R11G11B10_Float:     return vk::Format::eB10G11R11UfloatPack32;
+		case tinyddsloader::DDSFile::DXGIFormat::R9G9B9E5_SHAREDEXP:  return vk::Format::eE5B9G9R9UfloatPack32;
+		case tinyddsloader::DDSFile::DXGIFormat::R10G10B10A2_UNorm:   return vk::Format::eA2B10G10R10UnormPack32;
+		case tinyddsloader::DDSFile::DXGIFormat::R8G8_UNorm:          return vk::Format::eR8G8Unorm;
+		case tinyddsloader::DDSFile::DXGIFormat::R8_UNorm:            return vk::Format::eR8Unorm;
+
 		default: return vk::Format::eUndefined;
 	}
 }
 
-PixelData LoadImageFile(CommandContext& context, const std::filesystem::path& filename, const bool srgb, int desiredChannels) {
+inline size_t AlignRegion(const size_t size, const size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+// Copy of a whole, tightly packed mip level at offset
+inline vk::BufferImageCopy GetLevelCopy(const size_t offset, const uint3 extent) {
+	return vk::BufferImageCopy{
+		.bufferOffset = offset,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = vk::ImageSubresourceLayers{
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1 },
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = vk::Extent3D{ extent.x, extent.y, extent.z } };
+}
+
+namespace {
+
+struct KTX2Header {
+	uint8_t  identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+struct KTX2Level {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+static_assert(sizeof(KTX2Header) == 80);
+
+const uint8_t kKTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+enum KTX2Supercompression : uint32_t {
+	eNone    = 0,
+	eBasisLZ = 1,
+	eZstd    = 2,
+	eZlib    = 3,
+};
+
+vk::ImageViewType GetViewType(const uint32_t height, const uint32_t depth, const uint32_t layers, const bool cube) {
+	if (depth > 1)  return vk::ImageViewType::e3D;
+	if (cube)       return layers > 6 ? vk::ImageViewType::eCubeArray : vk::ImageViewType::eCube;
+	if (height <= 1) return layers > 1 ? vk::ImageViewType::e1DArray : vk::ImageViewType::e1D;
+	return layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+}
+
+#ifdef ENABLE_KTX
+DecodedImage DecodeKTX2WithLibKtx(const std::span<const std::byte> data, const bool transcodeToBC) {
+	ktxTexture2* texture = nullptr;
+	if (ktxTexture2_CreateFromMemory((const ktx_uint8_t*)data.data(), data.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) != KTX_SUCCESS)
+		throw std::runtime_error("Failed to read KTX2 texture");
+
+	if (ktxTexture2_NeedsTranscoding(texture)) {
+		// BC4 and BC5 keep one and two channel data (e.g. normal maps) at full quality
+		ktx_transcode_fmt_e target = KTX_TTF_RGBA32;
+		if (transcodeToBC) {
+			switch (ktxTexture2_GetNumComponents(texture)) {
+				case 1:  target = KTX_TTF_BC4_R;    break;
+				case 2:  target = KTX_TTF_BC5_RG;   break;
+				default: target = KTX_TTF_BC7_RGBA; break;
+			}
+		}
+		if (const KTX_error_code err = ktxTexture2_TranscodeBasis(texture, target, 0); err != KTX_SUCCESS) {
+			ktxTexture_Destroy(ktxTexture(texture));
+			throw std::runtime_error(std::string("Failed to transcode KTX2 texture: ") + ktxErrorString(err));
+		}
+	}
+
+	const uint32_t layers = texture->numLayers * texture->numFaces;
+
+	DecodedImage result = {};
+	result.format      = (vk::Format)texture->vkFormat;
+	result.extent      = uint3(texture->baseWidth, texture->baseHeight, texture->baseDepth);
+	result.mipLevels   = texture->numLevels;
+	result.arrayLayers = layers;
+	result.viewType    = GetViewType(texture->baseHeight, texture->baseDepth, layers, texture->isCubemap);
+	result.pixels.resize(ktxTexture_GetDataSize(ktxTexture(texture)));
+	std::memcpy(result.pixels.data(), ktxTexture_GetData(ktxTexture(texture)), result.pixels.size());
+
+	for (uint32_t level = 0; level < texture->numLevels; level++)
+		for (uint32_t layer = 0; layer < texture->numLayers; layer++)
+			for (uint32_t face = 0; face < texture->numFaces; face++) {
+				ktx_size_t offset = 0;
+				ktxTexture_GetImageOffset(ktxTexture(texture), level, layer, face, &offset);
+				vk::BufferImageCopy region = GetLevelCopy(offset, GetLevelExtent(result.extent, level));
+				region.imageSubresource.mipLevel = level;
+				region.imageSubresource.baseArrayLayer = layer * texture->numFaces + face;
+				result.regions.emplace_back(region);
+			}
+
+	ktxTexture_Destroy(ktxTexture(texture));
+	return result;
+}
+#endif
+
+}
+
+bool IsKTX2(const std::span<const std::byte> data) {
+	return data.size() >= sizeof(KTX2Header) && std::memcmp(data.data(), kKTX2Identifier, sizeof(kKTX2Identifier)) == 0;
+}
+
+DecodedImage DecodeKTX2(const std::span<const std::byte> data, const bool transcodeToBC) {
+	if (!IsKTX2(data))
+		throw std::runtime_error("Not a KTX2 file");
+
+	KTX2Header header;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	const bool basis = header.vkFormat == 0; // BasisLZ/ETC1S or UASTC
+	if (basis || header.supercompressionScheme == eZstd) {
+#ifdef ENABLE_KTX
+		return DecodeKTX2WithLibKtx(data, transcodeToBC);
+#else
+		throw std::runtime_error(basis ?
+			"Basis Universal KTX2 textures need libktx, which was not found at build time" :
+			"zstd supercompressed KTX2 textures need libktx, which was not found at build time");
+#endif
+	}
+	if (header.supercompressionScheme != eNone && header.supercompressionScheme != eZlib)
+		throw std::runtime_error("Unsupported KTX2 supercompression scheme " + std::to_string(header.supercompressionScheme));
+
+	const uint32_t levelCount = std::max(header.levelCount, 1u);
+	const uint32_t layerCount = std::max(header.layerCount, 1u);
+	const uint32_t faceCount  = std::max(header.faceCount, 1u);
+
+	if (data.size() < sizeof(KTX2Header) + levelCount * sizeof(KTX2Level))
+		throw std::runtime_error("Truncated KTX2 file");
+	std::vector<KTX2Level> levels(levelCount);
+	std::memcpy(levels.data(), data.data() + sizeof(KTX2Header), levelCount * sizeof(KTX2Level));
+
+	DecodedImage result = {};
+	result.format      = (vk::Format)header.vkFormat;
+	result.extent      = uint3(header.pixelWidth, std::max(header.pixelHeight, 1u), std::max(header.pixelDepth, 1u));
+	result.mipLevels   = levelCount;
+	result.arrayLayers = layerCount * faceCount;
+	result.viewType    = GetViewType(header.pixelHeight, header.pixelDepth, result.arrayLayers, faceCount == 6);
+
+	const size_t alignment = GetCopyAlignment(result.format);
+	size_t size = 0;
+	for (const KTX2Level& level : levels) {
+		if (level.byteOffset + level.byteLength > data.size())
+			throw std::runtime_error("Truncated KTX2 file");
+		size += result.arrayLayers * AlignRegion(level.uncompressedByteLength / result.arrayLayers, alignment);
+	}
+	result.pixels.resize(size);
+
+	// each level holds every layer, then every face, then every depth slice
+	std::vector<std::byte> inflated;
+	size_t offset = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		const KTX2Level& l = levels[level];
+		const std::byte* src = data.data() + l.byteOffset;
+		if (header.supercompressionScheme == eZlib) {
+			inflated.resize(l.uncompressedByteLength);
+			mz_ulong length = (mz_ulong)l.uncompressedByteLength;
+			if (mz_uncompress((unsigned char*)inflated.data(), &length, (const unsigned char*)src, (mz_ulong)l.byteLength) != MZ_OK || length != l.uncompressedByteLength)
+				throw std::runtime_error("Failed to inflate KTX2 level " + std::to_string(level));
+			src = inflated.data();
+		}
+
+		const size_t imageSize = l.uncompressedByteLength / result.arrayLayers;
+		for (uint32_t layer = 0; layer < result.arrayLayers; layer++) {
+			std::memcpy(result.pixels.data() + offset, src + layer * imageSize, imageSize);
+			vk::BufferImageCopy region = GetLevelCopy(offset, GetLevelExtent(result.extent, level));
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = layer;
+			result.regions.emplace_back(region);
+			offset += AlignRegion(imageSize, alignment);
+		}
+	}
+
+	return result;
+}
+
+DecodedImage DecodeImageFile(const std::filesystem::path& filename, const bool srgb, int desiredChannels, const bool transcodeToBC) {
 	if (!std::filesystem::exists(filename))
 		throw std::invalid_argument("File does not exist: " + filename.string());
-	if (filename.extension() == ".exr") {
+	if (filename.extension() == ".ktx2") {
+		std::vector<std::byte> data(std::filesystem::file_size(filename));
+		std::ifstream(filename, std::ios::binary).read((char*)data.data(), data.size());
+		return DecodeKTX2(data, transcodeToBC);
+	} else if (filename.extension() == ".exr") {
 		float* pixels = nullptr;
 		int width;
 		int height;
@@ -68,22 +279,58 @@ PixelData LoadImageFile(CommandContext& context, const std::filesystem::path& fi
 			FreeEXRErrorMessage(err);
 			throw std::runtime_error(std::string("Failure when loading image: ") + filename.string());
 		}
-		auto buf = context.UploadData(std::span{ pixels, size_t(width)*size_t(height)*4 }, vk::BufferUsageFlagBits::eTransferSrc);
+		DecodedImage result = { {}, vk::Format::eR32G32B32A32Sfloat, uint3(width, height, 1) };
+		result.pixels.assign((const std::byte*)pixels, (const std::byte*)(pixels + size_t(width)*size_t(height)*4));
+		result.regions = { GetLevelCopy(0, result.extent) };
 		std::free(pixels);
-		return PixelData{buf, vk::Format::eR32G32B32A32Sfloat, uint3(width, height, 1)};
+		return result;
 	} else if (filename.extension() == ".dds") {
 		using namespace tinyddsloader;
 		DDSFile dds;
     	auto ret = dds.Load(filename.string().c_str());
 		if (tinyddsloader::Result::tinydds_Success != ret) throw std::runtime_error("Failed to load " + filename.string());
-		dds.GetBitsPerPixel(dds.GetFormat());
 
+		DecodedImage result = { {}, dxgiToVulkan(dds.GetFormat(), desiredChannels == 4), uint3(dds.GetWidth(), dds.GetHeight(), dds.GetDepth()) };
+		if (result.format == vk::Format::eUndefined)
+			throw std::runtime_error("Unsupported DDS format in " + filename.string());
+
+		// tinyddsloader can't flip BC6H and BC7 blocks, these are loaded as stored
 		dds.Flip();
 
-		const DDSFile::ImageData* img = dds.GetImageData(0, 0);
+		result.mipLevels   = dds.GetMipCount();
+		result.arrayLayers = dds.GetArraySize();
+		if (dds.GetTextureDimension() == DDSFile::TextureDimension::Texture3D)
+			result.viewType = vk::ImageViewType::e3D;
+		else if (dds.IsCubemap())
+			result.viewType = result.arrayLayers > 6 ? vk::ImageViewType::eCubeArray : vk::ImageViewType::eCube;
+		else if (dds.GetTextureDimension() == DDSFile::TextureDimension::Texture1D)
+			result.viewType = result.arrayLayers > 1 ? vk::ImageViewType::e1DArray : vk::ImageViewType::e1D;
+		else
+			result.viewType = result.arrayLayers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
 
-		auto buf = context.UploadData(std::span{ (std::byte*)img->m_mem, img->m_memSlicePitch }, vk::BufferUsageFlagBits::eTransferSrc);
-		return PixelData{buf, dxgiToVulkan(dds.GetFormat(), desiredChannels == 4), uint3(dds.GetWidth(), dds.GetHeight(), dds.GetDepth())};
+		// levels and layers are stored layer by layer, each with its full mip chain
+		const size_t alignment = GetCopyAlignment(result.format);
+		size_t size = 0;
+		for (uint32_t layer = 0; layer < result.arrayLayers; layer++)
+			for (uint32_t level = 0; level < result.mipLevels; level++) {
+				const DDSFile::ImageData* img = dds.GetImageData(level, layer);
+				size += AlignRegion(size_t(img->m_memSlicePitch) * img->m_depth, alignment);
+			}
+		result.pixels.resize(size);
+		result.regions.reserve(result.arrayLayers * result.mipLevels);
+		size_t offset = 0;
+		for (uint32_t layer = 0; layer < result.arrayLayers; layer++)
+			for (uint32_t level = 0; level < result.mipLevels; level++) {
+				const DDSFile::ImageData* img = dds.GetImageData(level, layer);
+				const size_t levelSize = size_t(img->m_memSlicePitch) * img->m_depth;
+				std::memcpy(result.pixels.data() + offset, img->m_mem, levelSize);
+				vk::BufferImageCopy region = GetLevelCopy(offset, uint3(img->m_width, img->m_height, img->m_depth));
+				region.imageSubresource.mipLevel = level;
+				region.imageSubresource.baseArrayLayer = layer;
+				result.regions.emplace_back(region);
+				offset += AlignRegion(levelSize, alignment);
+			}
+		return result;
 	} else {
 		int x,y,channels;
 		stbi_info(filename.string().c_str(), &x, &y, &channels);
@@ -118,13 +365,27 @@ PixelData LoadImageFile(CommandContext& context, const std::filesystem::path& fi
 			}
 		}
 		if (!pixels) throw std::invalid_argument("Could not load " + filename.string());
-		std::cout << "Loaded " << filename << " (" << x << "x" << y << ")" << std::endl;
 		if (desiredChannels) channels = desiredChannels;
 
-		auto buf = context.UploadData(std::span{ pixels, size_t(x)*size_t(y)*GetTexelSize(format) }, vk::BufferUsageFlagBits::eTransferSrc);
+		DecodedImage result = { {}, format, uint3(x,y,1) };
+		result.pixels.assign(pixels, pixels + size_t(x)*size_t(y)*GetTexelSize(format));
+		result.regions = { GetLevelCopy(0, result.extent) };
 		stbi_image_free(pixels);
-		return PixelData{buf, format, uint3(x,y,1)};
+		return result;
 	}
 }
 
+PixelData LoadImageFile(CommandContext& context, const std::filesystem::path& filename, const bool srgb, int desiredChannels) {
+	const DecodedImage img = DecodeImageFile(filename, srgb, desiredChannels);
+	std::cout << "Loaded " << filename << " (" << img.extent.x << "x" << img.extent.y << ")" << std::endl;
+	return PixelData{
+		.data        = context.UploadData(img.pixels, vk::BufferUsageFlagBits::eTransferSrc),
+		.format      = img.format,
+		.extent      = img.extent,
+		.mipLevels   = img.mipLevels,
+		.arrayLayers = img.arrayLayers,
+		.viewType    = img.viewType,
+		.regions     = img.regions };
+}
+
 }
\ No newline at end of file
@@ -26,14 +26,14 @@ inline float3 sphuv2xyz(float2 uv) {
 
 // Octahedral mapping
 SLANG_DIFFERENTIABLE
-float2 xyz2oct(const float3 v) {
+inline float2 xyz2oct(const float3 v) {
 	const float3 n = v / (abs(v.x) + abs(v.y) + abs(v.z));
 	float2 xy = float2(n.x, n.y);
     xy = n.z >= 0.f ? xy : (1.f - abs(float2(n.y, n.x))) * float2(xy.x >= 0.f ? 1.f : -1.f, xy.y >= 0.f ? 1.f : -1.f);
     return xy * 0.5f + float2(0.5f);
 }
 SLANG_DIFFERENTIABLE
-float3 oct2xyz(const float2 p) {
+inline float3 oct2xyz(const float2 p) {
     float2 f = p * 2.f - float2(1.f);
     // https://twitter.com/Stubbesaurus/status/937994790553227264
     const float z = 1.f - abs(f.x) - abs(f.y);
@@ -43,6 +43,38 @@ float3 oct2xyz(const float2 p) {
     return normalize(float3(f, z));
 }
 
+// 16-bit normalized integers, decoded like the Vulkan UNORM and SNORM formats
+inline uint PackUnorm16x2(const float2 v) {
+	const uint2 u = uint2(floor(saturate(v) * 65535.f + 0.5f));
+	return u.x | (u.y << 16);
+}
+inline float2 UnpackUnorm16x2(const uint p) {
+	return float2(p & 0xFFFF, p >> 16) / 65535.f;
+}
+// xy in the first uint, z in the low half of the second
+inline uint2 PackSnorm16x3(const float3 v) {
+	const int3 i = int3(floor(clamp(v, -1.f, 1.f) * 32767.f + 0.5f));
+	return uint2((uint(i.x) & 0xFFFF) | (uint(i.y) << 16), uint(i.z) & 0xFFFF);
+}
+inline float3 UnpackSnorm16x3(const uint2 p) {
+	const int3 i = int3(int(p.x << 16) >> 16, int(p.x) >> 16, int(p.y << 16) >> 16);
+	return max(float3(i) / 32767.f, float3(-1.f));
+}
+
+// Unit vectors as 16-bit octahedral coordinates
+inline uint PackOctahedral(const float3 n) { return PackUnorm16x2(xyz2oct(n)); }
+inline float3 UnpackOctahedral(const uint p) { return oct2xyz(UnpackUnorm16x2(p)); }
+
+// Tangents with the bitangent sign in w. The sign takes the top bit, leaving 15 bits for the second coordinate.
+inline uint PackOctahedralTangent(const float4 t) {
+	const float2 o = floor(saturate(xyz2oct(float3(t.x, t.y, t.z))) * float2(65535.f, 32767.f) + 0.5f);
+	return uint(o.x) | (uint(o.y) << 16) | (t.w < 0 ? 0x80000000u : 0u);
+}
+inline float4 UnpackOctahedralTangent(const uint p) {
+	const float3 t = oct2xyz(float2(p & 0xFFFF, (p >> 16) & 0x7FFF) / float2(65535.f, 32767.f));
+	return float4(t.x, t.y, t.z, (p & 0x80000000u) != 0 ? -1.f : 1.f);
+}
+
 inline float3 srgb2rgb(const float3 srgb) {
 	// https://en.wikipedia.org/wiki/SRGB#From_sRGB_to_CIE_XYZ
 	float3 rgb;
@@ -0,0 +1,134 @@
+#include "ReadbackRing.hpp"
+
+namespace RoseEngine {
+
+ref<ReadbackRing> ReadbackRing::Create(Device& device, const vk::DeviceSize size) {
+	ref<ReadbackRing> ring = make_ref<ReadbackRing>();
+	ring->mDevice = &device;
+	ring->mInitialSize = size;
+	return ring;
+}
+
+const ReadbackRing::Entry* ReadbackRing::Find(const uint64_t id) const {
+	if (id < mFirstId || id >= mFirstId + mEntries.size())
+		return nullptr;
+	return &mEntries[id - mFirstId];
+}
+
+void ReadbackRing::Release(const uint64_t id) {
+	if (Entry* e = Find(id))
+		e->released = true;
+}
+
+void ReadbackRing::CollectReleased() {
+	if (mEntries.empty() || !mEntries.front().released) return;
+	const uint64_t completed = mDevice->CurrentTimelineValue();
+	while (!mEntries.empty() && mEntries.front().released && mEntries.front().signal <= completed) {
+		mEntries.pop_front();
+		mFirstId++;
+	}
+}
+
+std::optional<vk::DeviceSize> ReadbackRing::Tail() const {
+	// entries of retired buffers come first
+	for (const Entry& e : mEntries)
+		if (e.buffer.mBuffer == mBuffer.mBuffer)
+			return e.buffer.mOffset;
+	return std::nullopt;
+}
+
+void ReadbackRing::Grow(const vk::DeviceSize size) {
+	vk::DeviceSize capacity = std::max(mInitialSize, mBuffer ? 2*mBuffer.size() : 0);
+	while (capacity < size)
+		capacity *= 2;
+	// cached memory is much faster to read, but not every device has it. Non-coherent memory is invalidated in Wait
+	const ref<Buffer> buffer = Buffer::Create(
+		*mDevice,
+		vk::BufferCreateInfo{
+			.size  = capacity,
+			.usage = vk::BufferUsageFlagBits::eTransferDst },
+		VmaAllocationCreateInfo{
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT|VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+			.usage = VMA_MEMORY_USAGE_AUTO,
+			.requiredFlags  = (VkMemoryPropertyFlags)vk::MemoryPropertyFlagBits::eHostVisible,
+			.preferredFlags = (VkMemoryPropertyFlags)vk::MemoryPropertyFlagBits::eHostCached });
+	if (!buffer || !buffer->data())
+		throw std::runtime_error("Failed to allocate a " + std::to_string(capacity) + " byte readback ring");
+	mDevice->SetDebugName(**buffer, "Readback ring");
+	// the previous buffer is kept alive by the entries in it
+	mBuffer = BufferView{ buffer, 0, capacity };
+	mHead = 0;
+}
+
+std::pair<uint64_t, BufferView> ReadbackRing::Allocate(vk::DeviceSize size, const vk::DeviceSize alignment) {
+	size = std::max<vk::DeviceSize>(size, 4);
+
+	CollectReleased();
+
+	std::optional<vk::DeviceSize> offset;
+	if (mBuffer) {
+		const vk::DeviceSize capacity = mBuffer.size();
+		const vk::DeviceSize head = (mHead + alignment - 1) / alignment * alignment;
+		if (const auto tail = Tail(); !tail) {
+			if (size <= capacity)
+				offset = 0;
+		} else if (mHead > *tail) {
+			// free space is [mHead, capacity) and [0, tail)
+			if (head + size <= capacity)
+				offset = head;
+			else if (size <= *tail)
+				offset = 0;
+		} else if (mHead < *tail) {
+			// wrapped around, free space is [mHead, tail)
+			if (head + size <= *tail)
+				offset = head;
+		}
+		// mHead == tail: the ring is full
+	}
+
+	if (!offset) {
+		Grow(size);
+		offset = 0;
+	}
+
+	mHead = *offset + size;
+	mEntries.emplace_back(Entry{ .buffer = mBuffer.slice(*offset, size) });
+	mPending++;
+	return { mFirstId + mEntries.size() - 1, mEntries.back().buffer };
+}
+
+void ReadbackRing::Submitted(const uint64_t signalValue) {
+	for (size_t i = mEntries.size() - mPending; i < mEntries.size(); i++)
+		mEntries[i].signal = signalValue;
+	mPending = 0;
+}
+void ReadbackRing::Discarded() {
+	Submitted(0);
+}
+
+bool ReadbackRing::Ready(const uint64_t id) const {
+	const Entry* e = Find(id);
+	if (!e) return true;
+	return e->signal != UINT64_MAX && mDevice->CurrentTimelineValue() >= e->signal;
+}
+void ReadbackRing::Wait(const uint64_t id) const {
+	const Entry* e = Find(id);
+	if (!e) return;
+	if (e->signal == UINT64_MAX)
+		throw std::runtime_error("Waiting on a readback whose commands were not submitted");
+	mDevice->Wait(e->signal);
+	e->buffer.mBuffer->Invalidate(e->buffer.mOffset, e->buffer.size_bytes());
+}
+
+vk::DeviceSize ReadbackRing::Size() const {
+	vk::DeviceSize size = mBuffer ? mBuffer.size() : 0;
+	const Buffer* last = mBuffer.mBuffer.get();
+	for (const Entry& e : mEntries) {
+		if (e.buffer.mBuffer.get() == last || e.buffer.mBuffer == mBuffer.mBuffer) continue;
+		last = e.buffer.mBuffer.get();
+		size += last->Size();
+	}
+	return size;
+}
+
+}
\ No newline at end of file
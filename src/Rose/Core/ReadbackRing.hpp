@@ -0,0 +1,125 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+
+#include "Buffer.hpp"
+
+namespace RoseEngine {
+
+class ReadbackRing;
+
+// The result of a copy to a ReadbackRing. Resolved once the commands it was recorded with are done.
+// Its data stays valid until it is destroyed, after which the ring reuses its space.
+template<typename T>
+class ReadbackFuture {
+private:
+	ref<ReadbackRing> mRing = {};
+	uint64_t          mId = 0;
+	BufferRange<T>    mData = {};
+
+public:
+	ReadbackFuture() = default;
+	ReadbackFuture(const ref<ReadbackRing>& ring, const uint64_t id, const BufferRange<T>& data) : mRing(ring), mId(id), mData(data) {}
+	ReadbackFuture(ReadbackFuture&& r) { *this = std::move(r); }
+	ReadbackFuture& operator=(ReadbackFuture&& r);
+	ReadbackFuture(const ReadbackFuture&) = delete;
+	ReadbackFuture& operator=(const ReadbackFuture&) = delete;
+	~ReadbackFuture();
+
+	inline operator bool() const { return mId != 0; }
+
+	// Whether the copy is done. Never true before the commands it was recorded with are submitted.
+	bool ready() const;
+	// Waits for the copy. The commands it was recorded with must have been submitted.
+	void wait() const;
+
+	// Waits for the copy, then returns the data, which is valid as long as this is
+	inline std::span<const T> get() const {
+		wait();
+		return { mData.data(), mData.size() };
+	}
+	inline const T& operator[](const size_t i) const { return get()[i]; }
+};
+
+// A persistent, mapped host buffer which the commands of a CommandContext copy into (see CommandContext::Readback).
+// Space is handed out in order and reclaimed once the commands writing it are done and its ReadbackFuture is destroyed.
+// When the ring is full, it is replaced by one twice the size, which is kept alive until its readbacks are destroyed.
+class ReadbackRing {
+private:
+	struct Entry {
+		BufferView buffer = {};
+		uint64_t   signal = UINT64_MAX; // timeline value the copy is done at. UINT64_MAX until submitted
+		bool       released = false;
+	};
+
+	Device*           mDevice = nullptr;
+	vk::DeviceSize    mInitialSize = 0;
+	BufferView        mBuffer = {};     // created by the first allocation
+	vk::DeviceSize    mHead = 0;        // offset in mBuffer of the next allocation
+	std::deque<Entry> mEntries = {};    // in the order they were allocated
+	uint64_t          mFirstId = 1;     // id of mEntries.front()
+	size_t            mPending = 0;     // entries at the back of mEntries allocated since the last submit
+
+	void CollectReleased();
+	// Offset of the oldest allocation still in use in mBuffer, or nullopt if there are none
+	std::optional<vk::DeviceSize> Tail() const;
+	void Grow(const vk::DeviceSize size);
+
+	const Entry* Find(const uint64_t id) const;
+	inline Entry* Find(const uint64_t id) { return const_cast<Entry*>(std::as_const(*this).Find(id)); }
+	template<typename T> friend class ReadbackFuture;
+	void Release(const uint64_t id);
+
+public:
+	static ref<ReadbackRing> Create(Device& device, const vk::DeviceSize size = 1 << 20);
+
+	// Allocates space for a copy, returning the id of its ReadbackFuture
+	std::pair<uint64_t, BufferView> Allocate(const vk::DeviceSize size, const vk::DeviceSize alignment = 16);
+
+	// Whether copies were allocated since the last call to Submitted or Discarded
+	inline bool HasPending() const { return mPending > 0; }
+	// Sets the timeline value of the copies allocated since the last call
+	void Submitted(const uint64_t signalValue);
+	// Resolves the copies allocated since the last submit, whose commands were never submitted. Their data is undefined.
+	void Discarded();
+
+	bool Ready(const uint64_t id) const;
+	// Waits for the copy, and makes its data visible to the host
+	void Wait(const uint64_t id) const;
+
+	// Bytes of the ring and of the retired rings still in use
+	vk::DeviceSize Size() const;
+	// Readbacks not yet destroyed or whose copies aren't done
+	inline size_t Count() const { return mEntries.size(); }
+};
+
+template<typename T>
+inline ReadbackFuture<T>& ReadbackFuture<T>::operator=(ReadbackFuture&& r) {
+	if (this == &r) return *this;
+	if (mRing && mId)
+		mRing->Release(mId);
+	mRing = std::move(r.mRing);
+	mId   = r.mId;
+	mData = std::move(r.mData);
+	r.mRing = {};
+	r.mId = 0;
+	r.mData = {};
+	return *this;
+}
+template<typename T>
+inline ReadbackFuture<T>::~ReadbackFuture() {
+	if (mRing && mId)
+		mRing->Release(mId);
+}
+template<typename T>
+inline bool ReadbackFuture<T>::ready() const {
+	return mRing && mRing->Ready(mId);
+}
+template<typename T>
+inline void ReadbackFuture<T>::wait() const {
+	if (mRing)
+		mRing->Wait(mId);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "ResidencyManager.hpp"
+#include "Gui.hpp"
+
+#include <cinttypes>
+
+namespace RoseEngine {
+
+ResidencyManager::Handle& ResidencyManager::Handle::operator=(Handle&& h) {
+	if (this == &h) return *this;
+	if (const auto manager = mManager.lock(); manager && mId)
+		manager->Unregister(mId);
+	mManager = std::move(h.mManager);
+	mId = h.mId;
+	h.mManager = {};
+	h.mId = 0;
+	return *this;
+}
+ResidencyManager::Handle::~Handle() {
+	if (const auto manager = mManager.lock(); manager && mId)
+		manager->Unregister(mId);
+}
+void ResidencyManager::Handle::Touch(const uint64_t timelineValue) const {
+	if (const auto manager = mManager.lock(); manager && mId)
+		manager->Touch(mId, timelineValue);
+}
+
+ref<ResidencyManager> ResidencyManager::Create(const Device& device) {
+	ref<ResidencyManager> manager = make_ref<ResidencyManager>();
+	manager->mDevice = &device;
+	manager->mSelf = manager;
+	return manager;
+}
+
+ResidencyManager::Handle ResidencyManager::Register(ResourceInfo&& info) {
+	std::scoped_lock lock(mMutex);
+	const uint64_t id = mNextId++;
+	mResources.emplace(id, Resource{ .info = std::move(info), .lastUse = 0 });
+	return Handle(mSelf, id);
+}
+void ResidencyManager::Unregister(const uint64_t id) {
+	std::scoped_lock lock(mMutex);
+	mResources.erase(id);
+}
+void ResidencyManager::Touch(const uint64_t id, const uint64_t timelineValue) {
+	std::scoped_lock lock(mMutex);
+	if (const auto it = mResources.find(id); it != mResources.end())
+		it->second.lastUse = std::max(it->second.lastUse, timelineValue);
+}
+
+vk::DeviceSize ResidencyManager::Usage() const {
+	const VkPhysicalDeviceMemoryProperties* properties;
+	vmaGetMemoryProperties(mDevice->MemoryAllocator(), &properties);
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(mDevice->MemoryAllocator(), budgets);
+
+	vk::DeviceSize usage = 0;
+	for (uint32_t i = 0; i < properties->memoryHeapCount; i++)
+		if (properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			usage += budgets[i].usage;
+	return usage;
+}
+vk::DeviceSize ResidencyManager::Budget() const {
+	if (budgetOverride > 0)
+		return budgetOverride;
+
+	const VkPhysicalDeviceMemoryProperties* properties;
+	vmaGetMemoryProperties(mDevice->MemoryAllocator(), &properties);
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(mDevice->MemoryAllocator(), budgets);
+
+	vk::DeviceSize budget = 0;
+	for (uint32_t i = 0; i < properties->memoryHeapCount; i++)
+		if (properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			budget += budgets[i].budget;
+	return vk::DeviceSize(budget * budgetFraction);
+}
+
+vk::DeviceSize ResidencyManager::Evict(CommandContext& context, const vk::DeviceSize bytes) {
+	std::scoped_lock lock(mMutex);
+
+	// by id, since callbacks may register or unregister resources
+	std::vector<std::tuple<float, uint64_t, uint64_t>> candidates; // priority, last use, id
+	for (const auto&[id, r] : mResources)
+		if (r.info.size && r.info.size() > 0)
+			candidates.emplace_back(r.info.priority, r.lastUse, id);
+	std::ranges::sort(candidates);
+
+	vk::DeviceSize freed = 0;
+	for (const auto&[priority, lastUse, id] : candidates) {
+		if (freed >= bytes) break;
+		const auto it = mResources.find(id);
+		if (it == mResources.end()) continue;
+		const EvictFn evict = it->second.info.evict;
+		if (const vk::DeviceSize f = evict(context, bytes - freed); f > 0) {
+			freed += f;
+			mEvictions++;
+		}
+	}
+	mEvictedBytes += freed;
+	return freed;
+}
+
+void ResidencyManager::Enforce(CommandContext& context) {
+	// refreshes VMA's budgets from VK_EXT_memory_budget
+	vmaSetCurrentFrameIndex(mDevice->MemoryAllocator(), mFrameIndex++);
+
+	if (mEvictionSignal > 0) {
+		if (mDevice->CurrentTimelineValue() < mEvictionSignal)
+			return;
+		mEvictionSignal = 0;
+	}
+
+	const vk::DeviceSize usage    = Usage();
+	const vk::DeviceSize budget   = Budget();
+	const vk::DeviceSize deferred = mDeferredBytes.exchange(0);
+	if (usage <= budget && deferred == 0)
+		return;
+
+	if (Evict(context, std::max(usage > budget ? usage - budget : 0, deferred)) > 0)
+		mEvictionSignal = mDevice->NextTimelineSignal();
+}
+
+void ResidencyManager::DrawGui() {
+	std::scoped_lock lock(mMutex);
+
+	{
+		const auto[usage, usageUnit]   = FormatBytes(Usage());
+		const auto[budget, budgetUnit] = FormatBytes(Budget());
+		ImGui::Text("Device local: %zu %s / %zu %s", usage, usageUnit, budget, budgetUnit);
+	}
+	ImGui::SliderFloat("Budget fraction", &budgetFraction, 0.1f, 1.f);
+	uint32_t overrideMiB = uint32_t(budgetOverride >> 20);
+	if (ImGui::InputScalar("Budget override (MiB)", ImGuiDataType_U32, &overrideMiB))
+		budgetOverride = vk::DeviceSize(overrideMiB) << 20;
+	{
+		const Stats stats = GetStats();
+		const auto[evicted, evictedUnit] = FormatBytes(stats.evictedBytes);
+		ImGui::Text("%" PRIu64 " evictions (%zu %s), %" PRIu64 " failed allocations", stats.evictions, evicted, evictedUnit, stats.failedAllocations);
+	}
+
+	if (ImGui::BeginTable("Resources", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+		ImGui::TableSetupColumn("Resource");
+		ImGui::TableSetupColumn("Priority");
+		ImGui::TableSetupColumn("Evictable");
+		ImGui::TableSetupColumn("Last use");
+		ImGui::TableHeadersRow();
+		for (const auto&[id, r] : mResources) {
+			const auto[size, sizeUnit] = FormatBytes(r.info.size ? r.info.size() : 0);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(r.info.name.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.info.priority);
+			ImGui::TableNextColumn(); ImGui::Text("%zu %s", size, sizeUnit);
+			ImGui::TableNextColumn(); ImGui::Text("%" PRIu64, r.lastUse);
+		}
+		ImGui::EndTable();
+	}
+}
+
+}
\ No newline at end of file
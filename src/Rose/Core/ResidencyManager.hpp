@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#include "Device.hpp"
+
+namespace RoseEngine {
+
+class CommandContext;
+
+// Keeps device local memory under the heaps' budgets.
+// Owners of memory that can be given back register it, with a callback that evicts or downgrades it (releasing
+// cached buffers, dropping the top mips of textures, ...). When usage exceeds the budget, registered resources are
+// evicted in order of priority, then least recent use, until usage is back under budget.
+class ResidencyManager {
+public:
+	// Frees up to bytes, returning the bytes freed. Called on the thread recording context.
+	// Memory the device may still be using must be kept alive until it is done (e.g. with TransientResourceCache).
+	using EvictFn = std::function<vk::DeviceSize(CommandContext& context, const vk::DeviceSize bytes)>;
+
+	struct ResourceInfo {
+		std::string                      name;
+		float                            priority = 0.5f; // lower is evicted first
+		std::function<vk::DeviceSize()>  size;            // bytes eviction could free
+		EvictFn                          evict;
+	};
+
+	// Unregisters the resource when destroyed
+	class Handle {
+	private:
+		weak_ref<ResidencyManager> mManager = {};
+		uint64_t                   mId = 0;
+
+	public:
+		Handle() = default;
+		Handle(const weak_ref<ResidencyManager>& manager, const uint64_t id) : mManager(manager), mId(id) {}
+		Handle(Handle&& h) { *this = std::move(h); }
+		Handle& operator=(Handle&& h);
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+		~Handle();
+
+		// Records that the resource is used by commands which signal timelineValue, for least recently used eviction
+		void Touch(const uint64_t timelineValue) const;
+
+		inline operator bool() const { return mId != 0; }
+	};
+
+	struct Stats {
+		uint64_t       evictions = 0;    // calls to EvictFn which freed memory
+		vk::DeviceSize evictedBytes = 0;
+		uint64_t       failedAllocations = 0;
+	};
+
+private:
+	struct Resource {
+		ResourceInfo info;
+		uint64_t     lastUse = 0;
+	};
+
+	const Device* mDevice = nullptr;
+	weak_ref<ResidencyManager> mSelf = {};
+
+	std::recursive_mutex                   mMutex;
+	std::unordered_map<uint64_t, Resource> mResources = {};
+	uint64_t                               mNextId = 1;
+
+	uint32_t mFrameIndex = 0;
+	uint64_t mEvictionSignal = 0; // timeline value after which memory evicted by the last Enforce is released
+	std::atomic<vk::DeviceSize> mDeferredBytes = 0; // requested by failed allocations, but left to the next Enforce
+
+	std::atomic<uint64_t>       mEvictions = 0;
+	std::atomic<vk::DeviceSize> mEvictedBytes = 0;
+	std::atomic<uint64_t>       mFailedAllocations = 0;
+
+	friend class Handle;
+	void Unregister(const uint64_t id);
+	void Touch(const uint64_t id, const uint64_t timelineValue);
+
+public:
+	float          budgetFraction = 0.9f; // of the driver's budget to stay under
+	vk::DeviceSize budgetOverride = 0;    // artificial budget for the device local heaps, for testing. 0 uses the driver's budget
+
+	static ref<ResidencyManager> Create(const Device& device);
+
+	Handle Register(ResourceInfo&& info);
+
+	// Bytes of device local memory in use
+	vk::DeviceSize Usage() const;
+	// Bytes of device local memory to stay under
+	vk::DeviceSize Budget() const;
+
+	// Evicts resources, lowest priority and least recently used first, until bytes are freed. Returns the bytes freed.
+	vk::DeviceSize Evict(CommandContext& context, const vk::DeviceSize bytes);
+
+	// Evicts resources if usage is over budget, or if failed allocations deferred evictions. Called once per frame.
+	// Evictions wait for the memory released by the previous ones, so that they don't overshoot.
+	void Enforce(CommandContext& context);
+
+	// Called by Buffer::Create, Image::Create and TransientHeap when an allocation of bytes fails. Allocations may fail on
+	// threads which can't evict the registered resources (e.g. glTF import threads), so the next Enforce evicts bytes.
+	inline void AllocationFailed(const vk::DeviceSize bytes) {
+		mFailedAllocations++;
+		mDeferredBytes += bytes;
+	}
+
+	inline Stats GetStats() const { return Stats{ .evictions = mEvictions, .evictedBytes = mEvictedBytes, .failedAllocations = mFailedAllocations }; }
+	void DrawGui();
+};
+
+}
\ No newline at end of file
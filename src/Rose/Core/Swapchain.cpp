@@ -82,6 +82,7 @@ bool Swapchain::Recreate(vk::SurfaceKHR surface, const std::vector<uint32_t>& qu
 	}
 
 	mImageIndex = 0;
+	mFirstPresentId = mPresentId + 1;
 	mDirty = false;
 	return true;
 }
@@ -112,10 +113,34 @@ void Swapchain::Present(const vk::Queue queue, const vk::ArrayProxy<const vk::Se
 	info.setSwapchains(*mSwapchain);
 	info.setImageIndices(mImageIndex);
 	info.setWaitSemaphores(waitSemaphores);
+	vk::PresentIdKHR presentId = {};
+	if (mDevice->EnabledExtensions().contains(VK_KHR_PRESENT_ID_EXTENSION_NAME)) {
+		mPresentId++;
+		presentId.setPresentIds(mPresentId);
+		info.pNext = &presentId;
+	}
 	const vk::Result result = queue.presentKHR(&info);
 	if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eErrorSurfaceLostKHR)
 		mDirty = true;
 	mCachedSemaphores.push(std::move(mImageAvailableSemaphore), mDevice->NextTimelineSignal());
 }
 
+bool Swapchain::CanWaitForPresent() const {
+	return mDevice->EnabledExtensions().contains(VK_KHR_PRESENT_ID_EXTENSION_NAME) && mDevice->EnabledExtensions().contains(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+}
+
+bool Swapchain::WaitForPresent(const uint64_t presentId, const std::chrono::nanoseconds& timeout) {
+	// presents to an earlier swapchain never show up on this one
+	if (!CanWaitForPresent() || presentId < mFirstPresentId || !*mSwapchain)
+		return true;
+	try {
+		return mSwapchain.waitForPresent(presentId, timeout.count()) != vk::Result::eTimeout;
+	} catch (const vk::OutOfDateKHRError&) {
+		mDirty = true;
+	} catch (const vk::SurfaceLostKHRError&) {
+		mDirty = true;
+	}
+	return true;
+}
+
 }
\ No newline at end of file
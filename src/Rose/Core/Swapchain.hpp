@@ -39,6 +39,14 @@ public:
 	bool AcquireImage(const std::chrono::nanoseconds& timeout = std::chrono::nanoseconds(0));
 	void Present(const vk::Queue queue, const vk::ArrayProxy<const vk::Semaphore>& waitSemaphores = {});
 
+	// Id of the last present, or 0 without VK_KHR_present_id
+	inline uint64_t PresentId() const { return mPresentId; }
+	// Whether presents can be waited on (VK_KHR_present_id and VK_KHR_present_wait)
+	bool CanWaitForPresent() const;
+	// Waits until the present with presentId, or a later one, is shown. Returns false on timeout.
+	// Returns true right away if presents can't be waited on, or if presentId was presented to an earlier swapchain.
+	bool WaitForPresent(const uint64_t presentId, const std::chrono::nanoseconds& timeout = std::chrono::nanoseconds::max());
+
 private:
 	vk::raii::SwapchainKHR mSwapchain = nullptr;
 	ref<Device> mDevice = nullptr;
@@ -53,6 +61,8 @@ private:
 	bool mDirty = true;
 
 	uint32_t mImageIndex = 0;
+	uint64_t mPresentId = 0;
+	uint64_t mFirstPresentId = 1; // of the current swapchain
 	ref<vk::raii::Semaphore> mImageAvailableSemaphore;
 	TransientResourceCache<ref<vk::raii::Semaphore>> mCachedSemaphores = {};
 };
@@ -0,0 +1,450 @@
+#include "TextureCompression.hpp"
+
+#include <cfloat>
+
+namespace RoseEngine {
+
+namespace {
+
+// The 16 texels of a 4x4 block, with the channels being encoded first
+using BlockTexels = std::array<std::array<float, 4>, 16>;
+
+inline size_t AlignUp(const size_t x, const size_t alignment) { return (x + alignment - 1) / alignment * alignment; }
+
+const std::array<float, 256> kSrgbToLinear = []() {
+	std::array<float, 256> table;
+	for (uint32_t i = 0; i < 256; i++) {
+		const float c = i / 255.f;
+		table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+	return table;
+}();
+inline uint8_t LinearToSrgb(const float c) {
+	const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1/2.4f) - 0.055f;
+	return (uint8_t)std::clamp(std::lround(s * 255), 0l, 255l);
+}
+
+// Endpoints of the first N channels of v, at the extremes of the texels along their principal axis
+template<uint32_t N>
+void FitEndpoints(const BlockTexels& v, std::array<float, N>& e0, std::array<float, N>& e1) {
+	std::array<float, N> mean = {};
+	for (const auto& t : v)
+		for (uint32_t c = 0; c < N; c++)
+			mean[c] += t[c] / 16;
+
+	std::array<std::array<float, N>, N> covariance = {};
+	for (const auto& t : v)
+		for (uint32_t a = 0; a < N; a++)
+			for (uint32_t b = 0; b < N; b++)
+				covariance[a][b] += (t[a] - mean[a]) * (t[b] - mean[b]);
+
+	// power iteration, starting from the row of the channel with the largest variance
+	uint32_t maxChannel = 0;
+	for (uint32_t c = 1; c < N; c++)
+		if (covariance[c][c] > covariance[maxChannel][maxChannel])
+			maxChannel = c;
+	std::array<float, N> axis = covariance[maxChannel];
+	auto normalize = [&]() {
+		float length = 0;
+		for (uint32_t c = 0; c < N; c++) length += axis[c] * axis[c];
+		length = std::sqrt(length);
+		if (length < 1e-8f) return false;
+		for (uint32_t c = 0; c < N; c++) axis[c] /= length;
+		return true;
+	};
+	for (uint32_t i = 0; i < 8 && normalize(); i++) {
+		std::array<float, N> next = {};
+		for (uint32_t a = 0; a < N; a++)
+			for (uint32_t b = 0; b < N; b++)
+				next[a] += covariance[a][b] * axis[b];
+		axis = next;
+	}
+	if (!normalize())
+		axis = {};
+
+	float tMin = FLT_MAX, tMax = -FLT_MAX;
+	for (const auto& t : v) {
+		float d = 0;
+		for (uint32_t c = 0; c < N; c++) d += (t[c] - mean[c]) * axis[c];
+		tMin = std::min(tMin, d);
+		tMax = std::max(tMax, d);
+	}
+	for (uint32_t c = 0; c < N; c++) {
+		e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.f, 255.f);
+		e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.f, 255.f);
+	}
+}
+
+// Least squares endpoints for the first N channels of v, where texel i is interpolated t[i] of the way from e0 to e1.
+// Returns false if every t is the same.
+template<uint32_t N>
+bool RefitEndpoints(const BlockTexels& v, const std::array<float, 16>& t, std::array<float, N>& e0, std::array<float, N>& e1) {
+	float aa = 0, ab = 0, bb = 0;
+	std::array<float, N> ax = {}, bx = {};
+	for (uint32_t i = 0; i < 16; i++) {
+		const float a = 1 - t[i], b = t[i];
+		aa += a*a;
+		ab += a*b;
+		bb += b*b;
+		for (uint32_t c = 0; c < N; c++) {
+			ax[c] += a * v[i][c];
+			bx[c] += b * v[i][c];
+		}
+	}
+	const float det = aa*bb - ab*ab;
+	if (std::abs(det) < 1e-6f)
+		return false;
+	for (uint32_t c = 0; c < N; c++) {
+		e0[c] = std::clamp((ax[c]*bb - bx[c]*ab) / det, 0.f, 255.f);
+		e1[c] = std::clamp((bx[c]*aa - ax[c]*ab) / det, 0.f, 255.f);
+	}
+	return true;
+}
+
+inline uint16_t To565(const std::array<float, 3>& c) {
+	return (uint16_t)((std::lround(c[0] * 31 / 255) << 11) | (std::lround(c[1] * 63 / 255) << 5) | std::lround(c[2] * 31 / 255));
+}
+inline std::array<float, 3> From565(const uint16_t c) {
+	const uint32_t r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+	return { float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)) };
+}
+
+// Encodes the RGB of v in four color mode, which BC3 color blocks always use. Writes the decoded RGB to decoded.
+uint64_t EncodeBC1(const BlockTexels& v, BlockTexels& decoded) {
+	static const float kWeights[4] = { 0, 1, 1/3.f, 2/3.f };
+
+	std::array<float, 3> x0, x1;
+	FitEndpoints<3>(v, x1, x0);
+
+	uint64_t best = 0;
+	float bestError = FLT_MAX;
+	for (uint32_t iteration = 0; iteration < 2; iteration++) {
+		uint16_t c0 = To565(x0), c1 = To565(x1);
+		if (c0 < c1) std::swap(c0, c1);
+
+		std::array<std::array<float, 3>, 4> palette;
+		palette[0] = From565(c0);
+		palette[1] = From565(c1);
+		for (uint32_t c = 0; c < 3; c++) {
+			palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+		}
+		// equal endpoints select three color mode, where the last entry is black
+		const uint32_t paletteSize = c0 == c1 ? 3 : 4;
+
+		std::array<uint32_t, 16> indices;
+		std::array<float, 16> t;
+		float error = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			float minDistance = FLT_MAX;
+			for (uint32_t k = 0; k < paletteSize; k++) {
+				float d = 0;
+				for (uint32_t c = 0; c < 3; c++) d += (palette[k][c] - v[i][c]) * (palette[k][c] - v[i][c]);
+				if (d < minDistance) {
+					minDistance = d;
+					indices[i] = k;
+				}
+			}
+			error += minDistance;
+			t[i] = kWeights[indices[i]];
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			best = c0 | (uint64_t(c1) << 16);
+			for (uint32_t i = 0; i < 16; i++) {
+				best |= uint64_t(indices[i]) << (32 + 2*i);
+				for (uint32_t c = 0; c < 3; c++) decoded[i][c] = palette[indices[i]][c];
+			}
+		}
+
+		if (!RefitEndpoints<3>(v, t, x0, x1))
+			break;
+	}
+	return best;
+}
+
+// Encodes channel c of v in eight value mode. Writes the decoded values to channel c of decoded.
+uint64_t EncodeBC4(const BlockTexels& v, const uint32_t c, BlockTexels& decoded) {
+	float lo = 255, hi = 0;
+	for (const auto& t : v) {
+		lo = std::min(lo, t[c]);
+		hi = std::max(hi, t[c]);
+	}
+	const uint32_t a0 = (uint32_t)std::lround(hi), a1 = (uint32_t)std::lround(lo);
+	uint64_t block = a0 | (a1 << 8);
+	if (a0 == a1) {
+		// six value mode, every index selects a0
+		for (auto& t : decoded) t[c] = (float)a0;
+		return block;
+	}
+
+	std::array<float, 8> palette;
+	palette[0] = (float)a0;
+	palette[1] = (float)a1;
+	for (uint32_t i = 1; i < 7; i++)
+		palette[i + 1] = ((7 - i) * a0 + i * a1) / 7.f;
+
+	for (uint32_t i = 0; i < 16; i++) {
+		uint32_t index = 0;
+		for (uint32_t k = 1; k < 8; k++)
+			if (std::abs(palette[k] - v[i][c]) < std::abs(palette[index] - v[i][c]))
+				index = k;
+		block |= uint64_t(index) << (16 + 3*i);
+		decoded[i][c] = palette[index];
+	}
+	return block;
+}
+
+struct BitWriter {
+	std::array<uint64_t, 2> bits = {};
+	uint32_t position = 0;
+
+	inline void Write(const uint32_t value, const uint32_t count) {
+		for (uint32_t i = 0; i < count; i++, position++)
+			if ((value >> i) & 1)
+				bits[position / 64] |= uint64_t(1) << (position % 64);
+	}
+};
+
+// Encodes v in BC7 mode 6: a single subset with 7 bit RGBA endpoints, a lowest bit per endpoint, and 4 bit indices
+std::array<uint64_t, 2> EncodeBC7(const BlockTexels& v, BlockTexels& decoded) {
+	static const uint32_t kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	std::array<float, 4> x0, x1;
+	FitEndpoints<4>(v, x0, x1);
+
+	std::array<uint64_t, 2> best = {};
+	float bestError = FLT_MAX;
+	for (uint32_t iteration = 0; iteration < 2; iteration++) {
+		// the lowest bit is chosen per endpoint, whichever is closer over the four channels
+		std::array<std::array<uint32_t, 4>, 2> q;
+		std::array<uint32_t, 2> p;
+		std::array<std::array<uint32_t, 4>, 2> e;
+		for (uint32_t j = 0; j < 2; j++) {
+			const std::array<float, 4>& x = j == 0 ? x0 : x1;
+			float pError[2] = { 0, 0 };
+			for (uint32_t pb = 0; pb < 2; pb++)
+				for (uint32_t c = 0; c < 4; c++) {
+					const float value = float((std::clamp(std::lround((x[c] - pb) / 2), 0l, 127l) << 1) | pb);
+					pError[pb] += (value - x[c]) * (value - x[c]);
+				}
+			p[j] = pError[1] < pError[0] ? 1 : 0;
+			for (uint32_t c = 0; c < 4; c++) {
+				q[j][c] = (uint32_t)std::clamp(std::lround((x[c] - p[j]) / 2), 0l, 127l);
+				e[j][c] = (q[j][c] << 1) | p[j];
+			}
+		}
+
+		std::array<std::array<float, 4>, 16> palette;
+		for (uint32_t k = 0; k < 16; k++)
+			for (uint32_t c = 0; c < 4; c++)
+				palette[k][c] = float(((64 - kWeights[k]) * e[0][c] + kWeights[k] * e[1][c] + 32) >> 6);
+
+		std::array<uint32_t, 16> indices;
+		std::array<float, 16> t;
+		float error = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			float minDistance = FLT_MAX;
+			for (uint32_t k = 0; k < 16; k++) {
+				float d = 0;
+				for (uint32_t c = 0; c < 4; c++) d += (palette[k][c] - v[i][c]) * (palette[k][c] - v[i][c]);
+				if (d < minDistance) {
+					minDistance = d;
+					indices[i] = k;
+				}
+			}
+			error += minDistance;
+			t[i] = kWeights[indices[i]] / 64.f;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			for (uint32_t i = 0; i < 16; i++)
+				decoded[i] = palette[indices[i]];
+
+			// the first index is stored without its highest bit, which must be 0. The weights are symmetric,
+			// so swapping the endpoints and mirroring the indices decodes to the same texels.
+			if (indices[0] >= 8) {
+				std::swap(q[0], q[1]);
+				std::swap(p[0], p[1]);
+				for (uint32_t& index : indices) index = 15 - index;
+			}
+
+			BitWriter w;
+			w.Write(1 << 6, 7); // mode 6
+			for (uint32_t c = 0; c < 4; c++) {
+				w.Write(q[0][c], 7);
+				w.Write(q[1][c], 7);
+			}
+			w.Write(p[0], 1);
+			w.Write(p[1], 1);
+			w.Write(indices[0], 3);
+			for (uint32_t i = 1; i < 16; i++)
+				w.Write(indices[i], 4);
+			best = w.bits;
+		}
+
+		if (!RefitEndpoints<4>(v, t, x0, x1))
+			break;
+	}
+	return best;
+}
+
+}
+
+std::vector<uint8_t> DownsampleRGBA8(const std::span<const uint8_t> src, const uint2 srcExtent, const uint2 dstExtent, const bool srgb) {
+	std::vector<uint8_t> dst(size_t(dstExtent.x) * dstExtent.y * 4);
+	for (uint32_t y = 0; y < dstExtent.y; y++) {
+		for (uint32_t x = 0; x < dstExtent.x; x++) {
+			const uint32_t xs[2] = { std::min(2*x, srcExtent.x - 1), std::min(2*x + 1, srcExtent.x - 1) };
+			const uint32_t ys[2] = { std::min(2*y, srcExtent.y - 1), std::min(2*y + 1, srcExtent.y - 1) };
+			for (uint32_t c = 0; c < 4; c++) {
+				const bool linearize = srgb && c < 3;
+				float sum = 0;
+				for (uint32_t j = 0; j < 2; j++)
+					for (uint32_t i = 0; i < 2; i++) {
+						const uint8_t v = src[(size_t(ys[j]) * srcExtent.x + xs[i]) * 4 + c];
+						sum += linearize ? kSrgbToLinear[v] : v;
+					}
+				dst[(size_t(y) * dstExtent.x + x) * 4 + c] = linearize ? LinearToSrgb(sum / 4) : (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+CompressedTexture CompressTexture(const std::span<const uint8_t> rgba, const uint2 extent, const TextureUsage usage, const bool highQuality) {
+	const size_t texelCount = size_t(extent.x) * extent.y;
+	if (texelCount == 0 || rgba.size() < texelCount * 4)
+		throw std::runtime_error("Expected " + std::to_string(extent.x) + "x" + std::to_string(extent.y) + " RGBA8 texels");
+
+	bool hasAlpha = false;
+	if (usage == TextureUsage::eColor)
+		for (size_t i = 0; i < texelCount && !hasAlpha; i++)
+			hasAlpha = rgba[i*4 + 3] != 255;
+
+	CompressedTexture result = {};
+	vk::Format& format = result.image.format;
+	std::array<uint32_t, 4> source = { 0, 1, 2, 3 }; // channel of the texture stored in each channel of a block
+	uint32_t    channelCount = 0; // which usage reads
+	switch (usage) {
+	case TextureUsage::eColor:
+		format = highQuality ? vk::Format::eBc7SrgbBlock : hasAlpha ? vk::Format::eBc3SrgbBlock : vk::Format::eBc1RgbSrgbBlock;
+		channelCount = hasAlpha ? 4 : 3;
+		break;
+	case TextureUsage::eNormal:
+		format = vk::Format::eBc5UnormBlock;
+		channelCount = 2;
+		break;
+	case TextureUsage::eMetallicRoughness:
+		format = vk::Format::eBc5UnormBlock;
+		source = { 1, 2, 0, 3 };
+		channelCount = 2;
+		result.components = { vk::ComponentSwizzle::eZero, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eOne };
+		break;
+	case TextureUsage::eMask:
+		format = vk::Format::eBc4UnormBlock;
+		channelCount = 1;
+		result.components = { vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eOne };
+		break;
+	}
+
+	auto encodeBlock = [&](const BlockTexels& v, BlockTexels& decoded, std::byte* dst) {
+		switch (format) {
+		case vk::Format::eBc1RgbSrgbBlock: {
+			const uint64_t block = EncodeBC1(v, decoded);
+			std::memcpy(dst, &block, sizeof(block));
+			break;
+		}
+		case vk::Format::eBc3SrgbBlock: {
+			const uint64_t block[2] = { EncodeBC4(v, 3, decoded), EncodeBC1(v, decoded) };
+			std::memcpy(dst, block, sizeof(block));
+			break;
+		}
+		case vk::Format::eBc4UnormBlock: {
+			const uint64_t block = EncodeBC4(v, 0, decoded);
+			std::memcpy(dst, &block, sizeof(block));
+			break;
+		}
+		case vk::Format::eBc5UnormBlock: {
+			const uint64_t block[2] = { EncodeBC4(v, 0, decoded), EncodeBC4(v, 1, decoded) };
+			std::memcpy(dst, block, sizeof(block));
+			break;
+		}
+		default: {
+			const std::array<uint64_t, 2> block = EncodeBC7(v, decoded);
+			std::memcpy(dst, block.data(), sizeof(block));
+			break;
+		}
+		}
+	};
+
+	DecodedImage& image = result.image;
+	image.extent    = uint3(extent, 1);
+	image.mipLevels = GetMaxMipLevels(image.extent);
+
+	// levels are aligned like the regions of DDS and KTX2 files
+	size_t size = 0;
+	for (uint32_t level = 0; level < image.mipLevels; level++)
+		size += AlignUp(GetImageSize(format, GetLevelExtent(image.extent, level)), 16);
+	image.pixels.resize(size);
+
+	const uint32_t blockSize = GetBlockSize(format);
+	std::span<const uint8_t> texels = rgba;
+	std::vector<uint8_t>     downsampled;
+	double squaredError = 0;
+	size_t offset = 0;
+	for (uint32_t level = 0; level < image.mipLevels; level++) {
+		const uint3 levelExtent = GetLevelExtent(image.extent, level);
+		if (level > 0) {
+			const uint3 prevExtent = GetLevelExtent(image.extent, level - 1);
+			std::vector<uint8_t> next = DownsampleRGBA8(texels, uint2(prevExtent), uint2(levelExtent), usage == TextureUsage::eColor);
+			downsampled = std::move(next);
+			texels = downsampled;
+		}
+
+		image.regions.emplace_back(vk::BufferImageCopy{
+			.bufferOffset      = offset,
+			.bufferRowLength   = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource  = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level, 0, 1 },
+			.imageOffset       = vk::Offset3D{ 0, 0, 0 },
+			.imageExtent       = vk::Extent3D{ levelExtent.x, levelExtent.y, 1 } });
+
+		const uint32_t blocksX = (levelExtent.x + 3) / 4;
+		const uint32_t blocksY = (levelExtent.y + 3) / 4;
+		for (uint32_t by = 0; by < blocksY; by++) {
+			for (uint32_t bx = 0; bx < blocksX; bx++) {
+				// texels past the edge repeat the last row and column
+				BlockTexels v, decoded = {};
+				for (uint32_t i = 0; i < 16; i++) {
+					const uint32_t x = std::min(bx*4 + i%4, levelExtent.x - 1);
+					const uint32_t y = std::min(by*4 + i/4, levelExtent.y - 1);
+					for (uint32_t c = 0; c < 4; c++)
+						v[i][c] = texels[(size_t(y) * levelExtent.x + x) * 4 + source[c]];
+				}
+
+				encodeBlock(v, decoded, image.pixels.data() + offset + (size_t(by) * blocksX + bx) * blockSize);
+
+				if (level == 0) {
+					for (uint32_t i = 0; i < 16; i++) {
+						if (bx*4 + i%4 >= levelExtent.x || by*4 + i/4 >= levelExtent.y) continue;
+						for (uint32_t c = 0; c < channelCount; c++)
+							squaredError += double(decoded[i][c] - v[i][c]) * double(decoded[i][c] - v[i][c]);
+					}
+				}
+			}
+		}
+
+		offset += AlignUp(GetImageSize(format, levelExtent), 16);
+		result.uncompressedBytes += size_t(levelExtent.x) * levelExtent.y * 4;
+	}
+
+	const double mse = squaredError / (double(texelCount) * channelCount);
+	result.psnr = mse > 0 ? 10 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+
+	return result;
+}
+
+}
\ No newline at end of file
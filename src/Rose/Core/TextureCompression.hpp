@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Image.hpp"
+
+namespace RoseEngine {
+
+enum class TextureCompression {
+	eNone,
+	eFast,        // BC1 or BC3 for color
+	eHighQuality, // BC7 for color
+};
+
+// What a texture stores, which decides the block compressed format it is encoded to
+enum class TextureUsage {
+	eColor,             // sRGB color and alpha: BC1 when opaque, BC3 otherwise, or BC7
+	eNormal,            // tangent space normal in RG: BC5. Z is reconstructed when sampling
+	eMetallicRoughness, // glTF roughness in G and metallic in B: BC5, stored in RG and swizzled back by the view
+	eMask,              // a single channel in R, replicated to RGB by the view: BC4
+};
+
+inline const char* to_string(const TextureUsage usage) {
+	switch (usage) {
+	case TextureUsage::eColor:             return "color";
+	case TextureUsage::eNormal:            return "normal";
+	case TextureUsage::eMetallicRoughness: return "metallic/roughness";
+	case TextureUsage::eMask:              return "mask";
+	}
+	return "";
+}
+
+struct CompressedTexture {
+	DecodedImage         image = {};            // every level of the mip chain
+	vk::ComponentMapping components = {};       // maps the stored channels to the ones usage expects, for views of the image
+	size_t               uncompressedBytes = 0; // of the same mip chain in RGBA8
+	double               psnr = 0;              // of the top level over the channels usage reads, in dB. Infinite if lossless
+};
+
+// Halves an RGBA8 level with a box filter, clamping at the edges of odd extents. RGB is averaged in linear space if srgb.
+std::vector<uint8_t> DownsampleRGBA8(const std::span<const uint8_t> src, const uint2 srcExtent, const uint2 dstExtent, const bool srgb);
+
+// Generates a box filtered mip chain of an RGBA8 image and encodes every level on the calling thread.
+// Color is filtered in linear space. highQuality encodes color to BC7 instead of BC1/BC3.
+CompressedTexture CompressTexture(const std::span<const uint8_t> rgba, const uint2 extent, const TextureUsage usage, const bool highQuality = false);
+
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RoseEngine {
+
+// Fixed set of worker threads which run tasks in the order they are pushed
+class ThreadPool {
+private:
+	std::vector<std::jthread>         mThreads;
+	std::deque<std::function<void()>> mTasks;
+	std::mutex                        mMutex;
+	std::condition_variable           mCondition;
+	bool                              mStop = false;
+
+	inline void Work() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mMutex);
+				mCondition.wait(lock, [&]{ return mStop || !mTasks.empty(); });
+				if (mTasks.empty())
+					return;
+				task = std::move(mTasks.front());
+				mTasks.pop_front();
+			}
+			task();
+		}
+	}
+
+public:
+	// threadCount = 0 creates one thread per hardware thread
+	inline ThreadPool(uint32_t threadCount = 0) {
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		for (uint32_t i = 0; i < threadCount; i++)
+			mThreads.emplace_back([this]() { Work(); });
+	}
+	// Finishes the remaining tasks before joining
+	inline ~ThreadPool() {
+		{
+			std::scoped_lock lock(mMutex);
+			mStop = true;
+		}
+		mCondition.notify_all();
+		mThreads.clear();
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline uint32_t ThreadCount() const { return (uint32_t)mThreads.size(); }
+
+	// Exceptions thrown by fn are rethrown by the future's get()
+	template<typename F>
+	inline std::future<std::invoke_result_t<std::decay_t<F>>> Push(F&& fn) {
+		using R = std::invoke_result_t<std::decay_t<F>>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+		std::future<R> result = task->get_future();
+		{
+			std::scoped_lock lock(mMutex);
+			mTasks.emplace_back([task]() { (*task)(); });
+		}
+		mCondition.notify_one();
+		return result;
+	}
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <iostream>
+#include "TransientHeap.hpp"
+#include "ResidencyManager.hpp"
+
+namespace RoseEngine {
+
+inline vk::DeviceSize AlignUp(const vk::DeviceSize x, const vk::DeviceSize alignment) { return (x + alignment - 1) / alignment * alignment; }
+
+inline long UseCount(const std::variant<ref<Buffer>, ref<Image>>& resource) {
+	return std::visit([](const auto& r) { return r.use_count(); }, resource);
+}
+
+void TransientHeap::CollectDead() {
+	if (!aliasResources) return;
+	for (Block& block : mBlocks) {
+		for (auto it = block.live.begin(); it != block.live.end();) {
+			if (UseCount(it->resource) == 1) {
+				block.dead.emplace_back(std::move(*it));
+				it = block.live.erase(it);
+			} else
+				it++;
+		}
+	}
+}
+
+std::pair<size_t, vk::DeviceSize> TransientHeap::Allocate(const Device& device, const vk::MemoryRequirements& requirements, const MemoryPool pool) {
+	// keeps linear and optimal resources off each other's pages
+	const vk::DeviceSize alignment = std::max(requirements.alignment, device.Limits().bufferImageGranularity);
+
+	// first fit, between the live placements
+	for (size_t i = 0; i < mBlocks.size(); i++) {
+		const Block& block = mBlocks[i];
+		if (block.pool != pool || !(requirements.memoryTypeBits & (1u << block.memoryTypeIndex)))
+			continue;
+		vk::DeviceSize offset = 0;
+		for (const Placement& p : block.live) {
+			if (offset + requirements.size <= p.offset)
+				break;
+			offset = AlignUp(p.offset + p.size, alignment);
+		}
+		if (offset + requirements.size <= block.size)
+			return { i, offset };
+	}
+
+	VmaAllocationCreateInfo allocationInfo{
+		.usage = VMA_MEMORY_USAGE_UNKNOWN,
+		.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	uint32_t memoryTypeIndex;
+	if (vmaFindMemoryTypeIndex(device.MemoryAllocator(), requirements.memoryTypeBits, &allocationInfo, &memoryTypeIndex) != VK_SUCCESS)
+		throw std::runtime_error("No device local memory type for transient resources");
+	allocationInfo.pool = device.GetMemoryPool(pool, memoryTypeIndex);
+	if (!allocationInfo.pool)
+		allocationInfo.memoryTypeBits = 1u << memoryTypeIndex;
+
+	// offsets are aligned relative to the block, so the block itself is aligned to more than any resource needs
+	const VkMemoryRequirements blockRequirements{
+		.size = std::max(blockSize, AlignUp(requirements.size, alignment)),
+		.alignment = std::max<vk::DeviceSize>(alignment, 64 << 10),
+		.memoryTypeBits = 1u << memoryTypeIndex };
+	VmaAllocation allocation;
+	const vk::Result result = (vk::Result)vmaAllocateMemory(device.MemoryAllocator(), &blockRequirements, &allocationInfo, &allocation, nullptr);
+	if (result != vk::Result::eSuccess) {
+		if (result == vk::Result::eErrorOutOfDeviceMemory)
+			device.Residency().AllocationFailed(blockRequirements.size);
+		throw std::runtime_error("Failed to allocate transient memory: " + vk::to_string(result));
+	}
+
+	const VmaAllocator allocator = device.MemoryAllocator();
+	mBlocks.emplace_back(Block{
+		.pool = pool,
+		.memoryTypeIndex = memoryTypeIndex,
+		.size = blockRequirements.size,
+		.memory = ref<VmaAllocation_T>(allocation, [=](VmaAllocation a) { vmaFreeMemory(allocator, a); }) });
+	return { mBlocks.size() - 1, 0 };
+}
+
+std::optional<std::pair<vk::PipelineStageFlags2, vk::AccessFlags2>> TransientHeap::DeadState(const Block& block, const vk::DeviceSize offset, const vk::DeviceSize size) {
+	std::optional<std::pair<vk::PipelineStageFlags2, vk::AccessFlags2>> state;
+	for (const Placement& p : block.dead) {
+		if (p.offset >= offset + size || offset >= p.offset + p.size)
+			continue;
+		const auto[stage, access] = std::visit([](const auto& r) {
+			const auto s = r->CombinedState();
+			return std::make_pair(s.stage, s.access);
+		}, p.resource);
+		if (!state) state = std::make_pair(vk::PipelineStageFlags2{}, vk::AccessFlags2{});
+		state->first  |= stage;
+		state->second |= access;
+	}
+	if (state) {
+		if (!mAliasingBarrier)
+			mAliasingBarrier = vk::MemoryBarrier2{
+				.dstStageMask  = vk::PipelineStageFlagBits2::eAllCommands,
+				.dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite };
+		mAliasingBarrier->srcStageMask  |= state->first;
+		mAliasingBarrier->srcAccessMask |= state->second;
+	}
+	return state;
+}
+
+void TransientHeap::Insert(Block& block, Placement&& placement, const bool aliased) {
+	block.peak = std::max(block.peak, placement.offset + placement.size);
+	mFrameStats.resourceCount++;
+	mFrameStats.requestedBytes += placement.size;
+	if (aliased) mFrameStats.aliasedCount++;
+	const auto it = std::ranges::upper_bound(block.live, placement.offset, {}, &Placement::offset);
+	block.live.insert(it, std::move(placement));
+}
+
+BufferView TransientHeap::GetBuffer(const Device& device, const vk::BufferCreateInfo& createInfo, const MemoryPool pool) {
+	CollectDead();
+
+	const vk::MemoryRequirements requirements = device->getBufferMemoryRequirements(vk::DeviceBufferMemoryRequirements{ .pCreateInfo = &createInfo }).memoryRequirements;
+	const auto[blockIndex, offset] = Allocate(device, requirements, pool);
+	Block& block = mBlocks[blockIndex];
+
+	ref<Buffer> buffer;
+	if (const auto it = std::ranges::find_if(block.reusable, [&](const Placement& p) {
+			const ref<Buffer>* b = std::get_if<ref<Buffer>>(&p.resource);
+			return b && p.offset == offset && (*b)->Size() == createInfo.size && (*b)->Usage() == createInfo.usage;
+		}); it != block.reusable.end()) {
+		buffer = std::get<ref<Buffer>>(it->resource);
+		block.reusable.erase(it);
+	} else {
+		buffer = Buffer::CreatePlaced(device, createInfo, block.memory, offset);
+		if (!buffer) return {};
+		device.SetDebugName(**buffer, "Transient buffer");
+	}
+
+	// the aliasing barrier orders the dead resources' accesses
+	const auto dead = DeadState(block, offset, requirements.size);
+	buffer->ResetState(Buffer::ResourceState{
+		.stage       = vk::PipelineStageFlagBits2::eTopOfPipe,
+		.access      = vk::AccessFlagBits2::eNone,
+		.queueFamily = VK_QUEUE_FAMILY_IGNORED });
+	Insert(block, Placement{ .resource = buffer, .offset = offset, .size = requirements.size }, dead.has_value());
+	return BufferView{ buffer, 0, createInfo.size };
+}
+
+ref<Image> TransientHeap::GetImage(const Device& device, const ImageInfo& info, const MemoryPool pool) {
+	CollectDead();
+
+	const vk::ImageCreateInfo createInfo = Image::GetCreateInfo(info);
+	const vk::MemoryRequirements requirements = device->getImageMemoryRequirements(vk::DeviceImageMemoryRequirements{ .pCreateInfo = &createInfo }).memoryRequirements;
+	const auto[blockIndex, offset] = Allocate(device, requirements, pool);
+	Block& block = mBlocks[blockIndex];
+
+	ref<Image> image;
+	if (const auto it = std::ranges::find_if(block.reusable, [&](const Placement& p) {
+			const ref<Image>* img = std::get_if<ref<Image>>(&p.resource);
+			return img && p.offset == offset && (*img)->Info() == info;
+		}); it != block.reusable.end()) {
+		image = std::get<ref<Image>>(it->resource);
+		block.reusable.erase(it);
+	} else {
+		image = Image::CreatePlaced(device, info, block.memory, offset);
+		if (!image) return nullptr;
+		device.SetDebugName(**image, "Transient image");
+	}
+
+	// the contents of aliased memory are undefined. The layout transition is ordered after the dead resources' accesses
+	// by the image's own barrier, since barriers recorded together aren't ordered with each other
+	const auto dead = DeadState(block, offset, requirements.size);
+	image->ResetState(Image::ResourceState{
+		.layout      = vk::ImageLayout::eUndefined,
+		.stage       = dead ? dead->first  : vk::PipelineStageFlagBits2::eTopOfPipe,
+		.access      = dead ? dead->second : vk::AccessFlagBits2::eNone,
+		.queueFamily = info.queueFamilies.empty() ? VK_QUEUE_FAMILY_IGNORED : info.queueFamilies.front() });
+	Insert(block, Placement{ .resource = image, .offset = offset, .size = requirements.size }, dead.has_value());
+	return image;
+}
+
+void TransientHeap::NextFrame() {
+	mStats = mFrameStats;
+	mStats.peakBytes  = 0;
+	mStats.blockBytes = 0;
+	for (Block& block : mBlocks) {
+		mStats.peakBytes  += block.peak;
+		mStats.blockBytes += block.size;
+
+		// the frame's commands are done, so resources nothing else references can be reused.
+		// the previous frame's resources which weren't reused are destroyed.
+		block.reusable = std::move(block.dead);
+		block.dead.clear();
+		block.peak = 0;
+		for (auto it = block.live.begin(); it != block.live.end();) {
+			if (UseCount(it->resource) == 1) {
+				block.reusable.emplace_back(std::move(*it));
+				it = block.live.erase(it);
+			} else {
+				// kept across frames by its owner
+				block.peak = std::max(block.peak, it->offset + it->size);
+				it++;
+			}
+		}
+	}
+	mFrameStats = {};
+}
+
+vk::DeviceSize TransientHeap::Size() const {
+	vk::DeviceSize size = 0;
+	for (const Block& block : mBlocks)
+		size += block.size;
+	return size;
+}
+
+vk::DeviceSize TransientHeap::UnusedSize() const {
+	vk::DeviceSize size = 0;
+	for (const Block& block : mBlocks)
+		if (block.live.empty() && block.dead.empty())
+			size += block.size;
+	return size;
+}
+
+vk::DeviceSize TransientHeap::ReleaseUnused() {
+	vk::DeviceSize freed = 0;
+	for (auto it = mBlocks.begin(); it != mBlocks.end();) {
+		it->reusable.clear();
+		if (it->live.empty() && it->dead.empty()) {
+			freed += it->size;
+			it = mBlocks.erase(it);
+		} else
+			it++;
+	}
+	return freed;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <variant>
+#include "Image.hpp"
+
+namespace RoseEngine {
+
+// Places the transient buffers and images of a CommandContext in shared memory blocks, aliasing resources whose
+// lifetimes don't overlap within a frame.
+// Lifetimes are found as commands are recorded: once the heap holds the only reference to a resource, no command recorded
+// after that can use it, so its memory goes to the resources placed after it. Placing a resource over the memory of dead
+// ones adds their combined stages and accesses to a global memory barrier (see TakeAliasingBarrier), which orders their
+// writes before any access through the new handle. Images also start out in those stages with an undefined layout,
+// so that their layout transition is ordered after the dead resources too.
+class TransientHeap {
+public:
+	struct Stats {
+		uint32_t       resourceCount  = 0; // placed in the frame
+		uint32_t       aliasedCount   = 0; // placed over the memory of resources which died earlier in the frame
+		vk::DeviceSize requestedBytes = 0; // of every resource placed in the frame, which is the peak without aliasing
+		vk::DeviceSize peakBytes      = 0; // of the blocks' memory in use at once
+		vk::DeviceSize blockBytes     = 0;
+	};
+
+private:
+	using Resource = std::variant<ref<Buffer>, ref<Image>>;
+
+	struct Placement {
+		Resource       resource = {};
+		vk::DeviceSize offset = 0;
+		vk::DeviceSize size = 0;
+	};
+	struct Block {
+		MemoryPool             pool = MemoryPool::eTransient;
+		uint32_t               memoryTypeIndex = 0;
+		vk::DeviceSize         size = 0;
+		ref<VmaAllocation_T>   memory = {};
+		std::vector<Placement> live = {};     // sorted by offset
+		std::vector<Placement> dead = {};     // died this frame. Kept until the frame's commands are done
+		std::vector<Placement> reusable = {}; // of the previous frame, reused when placed at the same offset again
+		vk::DeviceSize         peak = 0;      // highest end of a live placement this frame
+	};
+
+	std::vector<Block> mBlocks = {};
+	Stats mStats = {};      // of the last frame
+	Stats mFrameStats = {};
+	std::optional<vk::MemoryBarrier2> mAliasingBarrier = {};
+
+	void CollectDead();
+	void Insert(Block& block, Placement&& placement, const bool aliased);
+	// Finds room for a resource, returning the block's index and the offset in it
+	std::pair<size_t, vk::DeviceSize> Allocate(const Device& device, const vk::MemoryRequirements& requirements, const MemoryPool pool);
+	// The stages and accesses of the dead resources overlapping a range of a block, or nullopt if there are none.
+	// Adds them to mAliasingBarrier.
+	std::optional<std::pair<vk::PipelineStageFlags2, vk::AccessFlags2>> DeadState(const Block& block, const vk::DeviceSize offset, const vk::DeviceSize size);
+
+public:
+	vk::DeviceSize blockSize = 64 << 20; // larger resources get a block of their own size
+	bool           aliasResources = true;
+
+	BufferView GetBuffer(const Device& device, const vk::BufferCreateInfo& createInfo, const MemoryPool pool = MemoryPool::eTransient);
+	ref<Image> GetImage(const Device& device, const ImageInfo& info, const MemoryPool pool = MemoryPool::eTransient);
+
+	// The memory barrier ordering the dead resources under the resources placed since the last call before any
+	// later command, or nullopt if none were placed over dead memory. Must be recorded before the placed resources are used.
+	inline std::optional<vk::MemoryBarrier2> TakeAliasingBarrier() { return std::exchange(mAliasingBarrier, std::nullopt); }
+
+	// Starts a new frame. Called once the commands of the previous one are done.
+	void NextFrame();
+
+	// Bytes of the blocks
+	vk::DeviceSize Size() const;
+	// Bytes of the blocks no resource is placed in, which ReleaseUnused frees
+	vk::DeviceSize UnusedSize() const;
+	// Frees the blocks no resource is placed in anymore, returning the bytes freed
+	vk::DeviceSize ReleaseUnused();
+
+	inline const Stats& GetStats() const { return mStats; }
+};
+
+}
\ No newline at end of file
@@ -20,7 +20,30 @@ struct WindowedApp {
 	vk::raii::Semaphore commandSignalSemaphore = nullptr;
 
 	uint32_t presentQueueFamily = 0;
-	bool alwaysSync = false;
+
+	// Frames recorded ahead of the GPU, each with its own context. Independent of the swapchain's image count.
+	// 1 waits for each frame before polling input for the next one.
+	uint32_t maxFramesInFlight = 2;
+	// Waits for frames to be presented, rather than just rendered, before starting new ones (VK_KHR_present_wait)
+	bool presentPacing = false;
+
+	struct FrameStats {
+		double cpuWait = 0; // ms waiting for the GPU, or the presentation engine with presentPacing, before starting a frame
+		double gpuBusy = 0; // ms between the first and last command of a frame
+		double latency = 0; // ms from polling input until the frame was rendered (or presented with presentPacing), as seen by the CPU
+	};
+	FrameStats frameStats = {}; // moving averages over the last second
+
+	struct FrameInFlight {
+		std::chrono::high_resolution_clock::time_point start = {}; // when input was polled
+		uint64_t signal = 0;
+		uint64_t presentId = 0;
+		bool     pending = false;
+	};
+	std::vector<FrameInFlight> framesInFlight = {};
+	uint64_t                   frameIndex = 0;
+	vk::raii::QueryPool        timestampQueries = nullptr; // two per frame in flight, if the queue supports timestamps
+	std::chrono::high_resolution_clock::time_point frameStart = {};
 
 	enum WidgetFlagBits {
 		eNone      = 0,
@@ -41,11 +64,12 @@ struct WindowedApp {
 	double fps = 0;
 	std::chrono::high_resolution_clock::time_point lastFrame = {};
 
-	inline CommandContext& CurrentContext() { return *contexts[swapchain->ImageIndex()]; }
+	inline CommandContext& CurrentContext() { return *contexts[frameIndex % contexts.size()]; }
 
 	inline WindowedApp(
 		const std::string& windowTitle,
 		const vk::ArrayProxy<const std::string>& deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME },
+		const vk::ArrayProxy<const std::string>& optionalDeviceExtensions = { VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME },
 		const vk::ArrayProxy<const std::string>& validationLayers = { "VK_LAYER_KHRONOS_validation", /*"VK_LAYER_KHRONOS_synchronization2"*/ }
 	) {
 		std::vector<std::string> instanceExtensions;
@@ -56,7 +80,7 @@ struct WindowedApp {
 
 		vk::raii::PhysicalDevice physicalDevice = nullptr;
 		std::tie(physicalDevice, presentQueueFamily) = Window::FindSupportedDevice(**instance);
-		device = Device::Create(*instance, physicalDevice, deviceExtensions);
+		device = Device::Create(*instance, physicalDevice, deviceExtensions, optionalDeviceExtensions);
 
 		window    = Window::Create(*instance, windowTitle.c_str(), uint2(1920, 1080));
 		swapchain = Swapchain::Create(device, *window->GetSurface());
@@ -108,6 +132,65 @@ struct WindowedApp {
 
 				ImGui::Unindent();
 			}
+
+			if (device->EnabledExtensions().contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME)) {
+				const auto[blasBytes, blasBytesUnit]               = FormatBytes(AccelerationStructure::BottomLevelMemory());
+				const auto[uncompactedBytes, uncompactedBytesUnit] = FormatBytes(AccelerationStructure::BottomLevelMemoryUncompacted());
+				ImGui::Text("BLAS memory: %zu %s (%zu %s before compaction)", blasBytes, blasBytesUnit, uncompactedBytes, uncompactedBytesUnit);
+			}
+
+			if (const auto pools = device->MemoryPoolStatistics(); !pools.empty() && ImGui::CollapsingHeader("Memory pools")) {
+				if (ImGui::BeginTable("Memory pools", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+					ImGui::TableSetupColumn("Pool");
+					ImGui::TableSetupColumn("Memory type");
+					ImGui::TableSetupColumn("Allocations");
+					ImGui::TableSetupColumn("Blocks");
+					ImGui::TableSetupColumn("Free ranges");
+					ImGui::TableSetupColumn("Fragmentation");
+					ImGui::TableHeadersRow();
+					for (const Device::MemoryPoolStats& stats : pools) {
+						const auto[allocationBytes, allocationBytesUnit] = FormatBytes(stats.allocationBytes);
+						const auto[blockBytes, blockBytesUnit]           = FormatBytes(stats.blockBytes);
+						ImGui::TableNextRow();
+						ImGui::TableNextColumn(); ImGui::TextUnformatted(to_string(stats.pool));
+						ImGui::TableNextColumn(); ImGui::Text("%u", stats.memoryType);
+						ImGui::TableNextColumn(); ImGui::Text("%u (%zu %s)", stats.allocationCount, allocationBytes, allocationBytesUnit);
+						ImGui::TableNextColumn(); ImGui::Text("%u (%zu %s)", stats.blockCount, blockBytes, blockBytesUnit);
+						ImGui::TableNextColumn(); ImGui::Text("%u", stats.freeRanges);
+						ImGui::TableNextColumn(); ImGui::Text("%.1f%%", stats.fragmentation * 100);
+					}
+					ImGui::EndTable();
+				}
+			}
+
+			if (ImGui::CollapsingHeader("Transient resources")) {
+				// each context has its own heap. the current one's last frame is shown
+				const TransientHeap::Stats& stats = CurrentContext().GetTransientHeap().GetStats();
+				const auto[peak, peakUnit]           = FormatBytes(stats.peakBytes);
+				const auto[requested, requestedUnit] = FormatBytes(stats.requestedBytes);
+				ImGui::Text("Peak: %zu %s (%zu %s without aliasing)", peak, peakUnit, requested, requestedUnit);
+				ImGui::Text("%u resources, %u aliased", stats.resourceCount, stats.aliasedCount);
+				vk::DeviceSize heapBytes = 0;
+				for (const auto& c : contexts)
+					heapBytes += c->GetTransientHeap().Size();
+				const auto[heap, heapUnit] = FormatBytes(heapBytes);
+				ImGui::Text("%zu %s in the heaps of %zu contexts", heap, heapUnit, contexts.size());
+				vk::DeviceSize readbackBytes = 0;
+				size_t readbackCount = 0;
+				for (const auto& c : contexts) {
+					readbackBytes += c->GetReadbackRing().Size();
+					readbackCount += c->GetReadbackRing().Count();
+				}
+				const auto[readback, readbackUnit] = FormatBytes(readbackBytes);
+				ImGui::Text("%zu %s of readback rings, %zu readbacks in flight", readback, readbackUnit, readbackCount);
+				bool alias = CurrentContext().GetTransientHeap().aliasResources;
+				if (ImGui::Checkbox("Alias resources", &alias))
+					for (const auto& c : contexts)
+						c->GetTransientHeap().aliasResources = alias;
+			}
+
+			if (ImGui::CollapsingHeader("Residency"))
+				device->Residency().DrawGui();
 		}, false);
 
 		AddWidget("Window", [&]() {
@@ -137,6 +220,19 @@ struct WindowedApp {
 				ImGui::EndCombo();
 			}
 
+			if (ImGui::CollapsingHeader("Frame pacing")) {
+				const uint32_t minFrames = 1, maxFrames = 8;
+				ImGui::SetNextItemWidth(40);
+				ImGui::DragScalar("Max frames in flight", ImGuiDataType_U32, &maxFramesInFlight, 1, &minFrames, &maxFrames);
+				ImGui::BeginDisabled(!swapchain->CanWaitForPresent());
+				ImGui::Checkbox("Wait for present", &presentPacing);
+				ImGui::EndDisabled();
+				ImGui::Text("CPU wait: %.2f ms", frameStats.cpuWait);
+				if (*timestampQueries)
+					ImGui::Text("GPU busy: %.2f ms (%.0f%%)", frameStats.gpuBusy, 100 * frameStats.gpuBusy * fps / 1000);
+				ImGui::Text("Latency: %.2f ms", frameStats.latency);
+			}
+
 			if (ImGui::CollapsingHeader("Usage flags")) {
 				uint32_t usage = uint32_t(swapchain->GetImageUsage());
 				for (uint32_t i = 0; i < 8; i++)
@@ -162,7 +258,9 @@ struct WindowedApp {
 		AddMenuItem("Edit", [&]() {
 			ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0,0,0,0));
 			ImGui::PushStyleColor(ImGuiCol_FrameBgActive, ImVec4(0,0,0,0));
-			ImGui::Checkbox("Always wait for gpu", &alwaysSync);
+			bool sync = maxFramesInFlight == 1;
+			if (ImGui::Checkbox("Always wait for gpu", &sync))
+				maxFramesInFlight = sync ? 1 : 2;
 			ImGui::PopStyleColor(2);
 		});
 	}
@@ -185,14 +283,51 @@ struct WindowedApp {
 		if (!swapchain->Recreate(*window->GetSurface(), { presentQueueFamily }))
 			return false; // Window unavailable (minimized?)
 
-		contexts.resize(swapchain->ImageCount());
+		Gui::Initialize(*contexts[0], *window, *swapchain, presentQueueFamily);
+
+		return true;
+	}
+
+	// Creates a context for each frame in flight
+	inline void CreateFrames() {
+		device->Wait();
+
+		contexts.resize(maxFramesInFlight);
 		for (auto& c : contexts)
 			if (!c)
 				c = CommandContext::Create(device, presentQueueFamily);
+		framesInFlight.assign(maxFramesInFlight, {});
+
+		timestampQueries = nullptr;
+		if (device->PhysicalDevice().getQueueFamilyProperties()[presentQueueFamily].timestampValidBits > 0) {
+			timestampQueries = vk::raii::QueryPool(**device, vk::QueryPoolCreateInfo{
+				.queryType  = vk::QueryType::eTimestamp,
+				.queryCount = 2*maxFramesInFlight });
+			device->SetDebugName(*timestampQueries, "WindowedApp Frame Timestamps");
+		}
+	}
 
-		Gui::Initialize(*contexts[0], *window, *swapchain, presentQueueFamily);
-
-		return true;
+	// Waits for the frame which last used the current context, or for its present with presentPacing, and measures it
+	inline void WaitForFrame() {
+		const uint32_t i = uint32_t(frameIndex % framesInFlight.size());
+		FrameInFlight& frame = framesInFlight[i];
+		if (!frame.pending) return;
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		if (presentPacing && frame.presentId > 0)
+			swapchain->WaitForPresent(frame.presentId, std::chrono::milliseconds(100));
+		device->Wait(frame.signal);
+		const auto t1 = std::chrono::high_resolution_clock::now();
+		frame.pending = false;
+
+		const double a = std::min(1.0, dt);
+		frameStats.cpuWait = lerp(frameStats.cpuWait, std::chrono::duration<double, std::milli>(t1 - t0).count(), a);
+		frameStats.latency = lerp(frameStats.latency, std::chrono::duration<double, std::milli>(t1 - frame.start).count(), a);
+		if (*timestampQueries) {
+			const auto[result, timestamps] = timestampQueries.getResults<uint64_t>(2*i, 2, 2*sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+			if (result == vk::Result::eSuccess)
+				frameStats.gpuBusy = lerp(frameStats.gpuBusy, (timestamps[1] - timestamps[0]) * device->Limits().timestampPeriod / 1e6, a);
+		}
 	}
 
 	inline void Update() {
@@ -283,11 +418,18 @@ struct WindowedApp {
 
 		Gui::NewFrame();
 
-		const auto& context = contexts[swapchain->ImageIndex()];
+		const uint32_t frameSlot = uint32_t(frameIndex % framesInFlight.size());
+		const auto& context = contexts[frameSlot];
 
 		context->Begin();
+		if (*timestampQueries) {
+			(*context)->resetQueryPool(*timestampQueries, 2*frameSlot, 2);
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *timestampQueries, 2*frameSlot);
+		}
 		context->ClearColor(swapchain->CurrentImage(), vk::ClearColorValue{std::array<float,4>{ .5f, .7f, 1.f, 1.f }});
 
+		device->Residency().Enforce(*context);
+
 		Update();
 
 		context->PushDebugLabel("Gui::Render");
@@ -300,19 +442,33 @@ struct WindowedApp {
 			.access = vk::AccessFlagBits2::eNone,
 			.queueFamily = presentQueueFamily });
 		context->ExecuteBarriers();
+		if (*timestampQueries)
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *timestampQueries, 2*frameSlot + 1);
 		uint64_t t = context->Submit(0,
 			*commandSignalSemaphore, (size_t)0,
 			swapchain->ImageAvailableSemaphore(),
 			(vk::PipelineStageFlags)vk::PipelineStageFlagBits::eColorAttachmentOutput,
 			(size_t)0);
 
-		if (alwaysSync) device->Wait(t);
-
 		swapchain->Present(*(*device)->getQueue(presentQueueFamily, 0), *commandSignalSemaphore);
+
+		framesInFlight[frameSlot] = FrameInFlight{
+			.start     = frameStart,
+			.signal    = t,
+			.presentId = swapchain->PresentId(),
+			.pending   = true };
+		frameIndex++;
 	}
 
 	inline void Run() {
 		while (true) {
+			if (contexts.size() != maxFramesInFlight)
+				CreateFrames();
+
+			// wait before polling input, so that it is as recent as possible when the frame is shown
+			WaitForFrame();
+			frameStart = std::chrono::high_resolution_clock::now();
+
 			Window::PollEvents();
 			if (!window->IsOpen())
 				break;
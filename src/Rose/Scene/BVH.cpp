@@ -0,0 +1,173 @@
+#include "BVH.hpp"
+
+#include <array>
+#include <algorithm>
+#include <stack>
+
+namespace RoseEngine {
+
+namespace {
+
+struct Bounds {
+	float3 min = float3( std::numeric_limits<float>::infinity());
+	float3 max = float3(-std::numeric_limits<float>::infinity());
+
+	inline void Extend(const float3 p) { min = glm::min(min, p); max = glm::max(max, p); }
+	inline void Extend(const Bounds& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+	inline float SurfaceArea() const {
+		if (any(glm::greaterThan(min, max))) return 0;
+		const float3 e = max - min;
+		return 2 * (e.x*e.y + e.y*e.z + e.z*e.x);
+	}
+};
+
+}
+
+BVH BVH::Build(const std::span<const std::pair<float3, float3>> primitiveBounds, const uint32_t maxLeafSize) {
+	static constexpr uint32_t kBinCount = 16;
+	// relative cost of a node traversal step to a primitive intersection
+	static constexpr float kTraversalCost = 1.f;
+
+	BVH bvh = {};
+	if (primitiveBounds.empty())
+		return bvh;
+
+	const uint32_t primitiveCount = (uint32_t)primitiveBounds.size();
+
+	std::vector<float3> centroids(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; i++)
+		centroids[i] = (primitiveBounds[i].first + primitiveBounds[i].second) * 0.5f;
+
+	bvh.primitiveIndices.resize(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; i++)
+		bvh.primitiveIndices[i] = i;
+
+	bvh.nodes.reserve(2*primitiveCount);
+	bvh.nodes.emplace_back();
+
+	struct BuildTask {
+		uint32_t nodeIndex;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+	std::stack<BuildTask> todo;
+	todo.push(BuildTask{ 0, 0, primitiveCount, 0 });
+	while (!todo.empty()) {
+		const BuildTask task = todo.top();
+		todo.pop();
+
+		Bounds bounds, centroidBounds;
+		for (uint32_t i = task.first; i < task.first + task.count; i++) {
+			const auto& [mn, mx] = primitiveBounds[bvh.primitiveIndices[i]];
+			bounds.Extend(Bounds{ mn, mx });
+			centroidBounds.Extend(centroids[bvh.primitiveIndices[i]]);
+		}
+
+		auto makeLeaf = [&]() {
+			bvh.nodes[task.nodeIndex] = BVHNode{
+				.aabbMin = bounds.min,
+				.leftOrFirst = task.first,
+				.aabbMax = bounds.max,
+				.primitiveCount = task.count };
+		};
+
+		if (task.count <= maxLeafSize || task.depth + 1 >= BVH_MAX_DEPTH) {
+			makeLeaf();
+			continue;
+		}
+
+		// find the cheapest binned split over all axes
+
+		float    bestCost = std::numeric_limits<float>::infinity();
+		uint32_t bestAxis = 0;
+		uint32_t bestSplit = 0;
+		const float3 extent = centroidBounds.max - centroidBounds.min;
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			if (extent[axis] <= 0) continue;
+
+			std::array<Bounds, kBinCount> bins;
+			std::array<uint32_t, kBinCount> binCounts = {};
+			const float scale = kBinCount / extent[axis];
+			for (uint32_t i = task.first; i < task.first + task.count; i++) {
+				const uint32_t p = bvh.primitiveIndices[i];
+				const uint32_t b = std::min(uint32_t((centroids[p][axis] - centroidBounds.min[axis]) * scale), kBinCount - 1);
+				bins[b].Extend(Bounds{ primitiveBounds[p].first, primitiveBounds[p].second });
+				binCounts[b]++;
+			}
+
+			// sweep from the right to get the cost of everything right of each split plane
+			std::array<float, kBinCount> rightCost = {};
+			Bounds right;
+			uint32_t rightCount = 0;
+			for (uint32_t b = kBinCount - 1; b > 0; b--) {
+				right.Extend(bins[b]);
+				rightCount += binCounts[b];
+				rightCost[b] = rightCount * right.SurfaceArea();
+			}
+
+			Bounds left;
+			uint32_t leftCount = 0;
+			for (uint32_t b = 0; b + 1 < kBinCount; b++) {
+				left.Extend(bins[b]);
+				leftCount += binCounts[b];
+				if (leftCount == 0 || leftCount == task.count) continue;
+				const float cost = leftCount * left.SurfaceArea() + rightCost[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		const float leafCost = task.count * bounds.SurfaceArea();
+		bestCost = kTraversalCost * bounds.SurfaceArea() + bestCost;
+		if (bestCost == std::numeric_limits<float>::infinity() || (bestCost >= leafCost && task.count <= 4*maxLeafSize)) {
+			makeLeaf();
+			continue;
+		}
+
+		const float scale = kBinCount / extent[bestAxis];
+		const auto mid = std::partition(bvh.primitiveIndices.begin() + task.first, bvh.primitiveIndices.begin() + task.first + task.count, [&](const uint32_t p) {
+			return std::min(uint32_t((centroids[p][bestAxis] - centroidBounds.min[bestAxis]) * scale), kBinCount - 1) < bestSplit;
+		});
+		const uint32_t leftCount = uint32_t(mid - bvh.primitiveIndices.begin()) - task.first;
+
+		const uint32_t leftChild = (uint32_t)bvh.nodes.size();
+		bvh.nodes.resize(bvh.nodes.size() + 2);
+		bvh.nodes[task.nodeIndex] = BVHNode{
+			.aabbMin = bounds.min,
+			.leftOrFirst = leftChild,
+			.aabbMax = bounds.max,
+			.primitiveCount = 0 };
+
+		todo.push(BuildTask{ leftChild,     task.first,             leftCount,              task.depth + 1 });
+		todo.push(BuildTask{ leftChild + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+	}
+
+	return bvh;
+}
+
+BVH BVH::Build(const std::span<const std::byte> indices, const uint32_t indexSize, const std::byte* positions, const uint32_t positionStride, const uint32_t maxLeafSize) {
+	const size_t triangleCount = indices.size() / (3*indexSize);
+
+	auto loadIndex = [&](const size_t i) -> uint32_t {
+		if (indexSize == sizeof(uint16_t))
+			return reinterpret_cast<const uint16_t*>(indices.data())[i];
+		else
+			return reinterpret_cast<const uint32_t*>(indices.data())[i];
+	};
+
+	std::vector<std::pair<float3, float3>> triangleBounds(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++) {
+		Bounds b;
+		for (size_t j = 0; j < 3; j++)
+			b.Extend(*reinterpret_cast<const float3*>(positions + size_t(loadIndex(3*i + j)) * positionStride));
+		triangleBounds[i] = { b.min, b.max };
+	}
+
+	return Build(triangleBounds, maxLeafSize);
+}
+
+}
\ No newline at end of file
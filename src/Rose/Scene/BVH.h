@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Rose/Core/RoseEngine.h>
+
+// Size of the traversal stack in BVH.slang. BVH::Build stops splitting nodes at BVH_MAX_DEPTH-1.
+#define BVH_MAX_DEPTH 32
+
+namespace RoseEngine {
+
+// Binary BVH node. The children of an interior node are stored next to each other.
+struct BVHNode {
+	float3 aabbMin;
+	uint   leftOrFirst; // index of the left child for interior nodes, first primitive for leaves
+	float3 aabbMax;
+	uint   primitiveCount; // 0 for interior nodes
+
+#ifdef __cplusplus
+	inline bool IsLeaf() const { return primitiveCount > 0; }
+#else
+	property bool isLeaf { get { return primitiveCount > 0; } }
+#endif
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <Rose/Core/MathTypes.hpp>
+#include "BVH.h"
+
+namespace RoseEngine {
+
+// Binary BVH built on the CPU with binned SAH, traversed on the GPU by BVHTraversal in BVH.slang.
+// Used in place of acceleration structures on devices without ray queries.
+struct BVH {
+	std::vector<BVHNode>  nodes = {};
+	std::vector<uint32_t> primitiveIndices = {}; // leaves reference ranges of this array
+
+	inline bool empty() const { return nodes.empty(); }
+
+	// Builds a BVH over the given primitive bounds. The root is nodes[0].
+	static BVH Build(const std::span<const std::pair<float3, float3>> primitiveBounds, const uint32_t maxLeafSize = 4);
+
+	// Builds a BVH over an indexed triangle list. indexSize is 2 or 4.
+	static BVH Build(const std::span<const std::byte> indices, const uint32_t indexSize, const std::byte* positions, const uint32_t positionStride, const uint32_t maxLeafSize = 4);
+};
+
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <optional>
+#include <tuple>
 #include <Rose/Core/MathUtils.h>
+#include <Rose/Core/ThreadPool.hpp>
 
 #define TINYGLTF_USE_CPP14
 #define TINYGLTF_NO_STB_IMAGE_WRITE
@@ -10,17 +13,89 @@
 
 namespace RoseEngine {
 
-ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename) {
+// meshes with fewer triangles are drawn at full resolution only
+static const uint32_t kMinLodTriangleCount = 4096;
+
+// Image loader for tinygltf which keeps the encoded bytes, so that images can be decoded in parallel by DecodeImage
+static bool StoreEncodedImage(tinygltf::Image* image, const int, std::string*, std::string*, int, int, const unsigned char* bytes, int size, void*) {
+	image->image.assign(bytes, bytes + size);
+	image->as_is = true;
+	return true;
+}
+
+// Decodes an image stored by StoreEncodedImage to RGBA, like tinygltf's default loader
+static void DecodeImage(tinygltf::Image& image) {
+	int w = 0, h = 0, comp = 0;
+	void* data = nullptr;
+	image.bits = 8;
+	image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+	if (stbi_is_16_bit_from_memory(image.image.data(), (int)image.image.size())) {
+		data = stbi_load_16_from_memory(image.image.data(), (int)image.image.size(), &w, &h, &comp, 4);
+		if (data) {
+			image.bits = 16;
+			image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+		}
+	}
+	if (!data)
+		data = stbi_load_from_memory(image.image.data(), (int)image.image.size(), &w, &h, &comp, 4);
+	if (!data)
+		throw std::runtime_error("Failed to decode image \"" + image.name + "\": " + stbi_failure_reason());
+
+	image.width = w;
+	image.height = h;
+	image.component = 4;
+	image.as_is = false;
+	image.image.assign((const unsigned char*)data, (const unsigned char*)data + size_t(w) * h * 4 * (image.bits / 8));
+	stbi_image_free(data);
+}
+
+// Block compresses an image decoded by DecodeImage, and frees its texels
+static CompressedTexture CompressImage(tinygltf::Image& image, TextureUsage usage, const bool highQuality) {
+	if (image.bits == 16) {
+		std::vector<unsigned char> texels(image.image.size() / 2);
+		for (size_t i = 0; i < texels.size(); i++) {
+			uint16_t v;
+			std::memcpy(&v, &image.image[2*i], sizeof(v));
+			texels[i] = (unsigned char)((v * 255u + 32767u) / 65535u);
+		}
+		image.image = std::move(texels);
+	}
+
+	// grayscale data needs a single channel
+	if (usage == TextureUsage::eMetallicRoughness) {
+		bool gray = true;
+		for (size_t i = 0; i < image.image.size() && gray; i += 4)
+			gray = image.image[i] == image.image[i + 1] && image.image[i] == image.image[i + 2];
+		if (gray)
+			usage = TextureUsage::eMask;
+	}
+
+	CompressedTexture result = CompressTexture(image.image, uint2(image.width, image.height), usage, highQuality);
+	image.image.clear();
+	return result;
+}
+
+ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename, const bool quantizeVertices, const uint32_t threadCount, const TextureCompression textureCompression, MipGenerator* mipGenerator, VirtualTextureCache* virtualTextures, std::vector<std::filesystem::path>* externalFiles) {
 	std::cout << "Loading " << filename << std::endl;
 
 	tinygltf::Model model;
 	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(&StoreEncodedImage, nullptr);
 	std::string err, warn;
 	if ((filename.extension() == ".glb" && !loader.LoadBinaryFromFile(&model, &err, &warn, filename.string())) ||
 		(filename.extension() == ".gltf" && !loader.LoadASCIIFromFile(&model, &err, &warn, filename.string())) )
 		throw std::runtime_error(filename.string() + ": " + err);
 	if (!warn.empty()) std::cerr << filename.string() << ": " << warn << std::endl;
 
+	if (externalFiles) {
+		for (const tinygltf::Buffer& buffer : model.buffers)
+			if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri))
+				externalFiles->emplace_back(tinygltf::dlib::urldecode(buffer.uri));
+		for (const tinygltf::Image& image : model.images)
+			if (!image.uri.empty() && !tinygltf::IsDataURI(image.uri))
+				externalFiles->emplace_back(tinygltf::dlib::urldecode(image.uri));
+	}
+
 	Device& device = context.GetDevice();
 
 	std::vector<BufferView>               buffersCpu(model.buffers.size());
@@ -50,20 +125,291 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 			model.buffers[i].data.size(),
 			bufferUsage,
 			vk::MemoryPropertyFlagBits::eDeviceLocal,
-			VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT);
+			VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+			0.5f,
+			MemoryPool::eScene);
 		context.GetDevice().SetDebugName(**buffers[i].mBuffer, filename.stem().string() + "/buffer" + std::to_string(i));
 
 		std::memcpy(buffersCpu[i].data(), model.buffers[i].data.data(), model.buffers[i].data.size());
 		context.Copy(buffersCpu[i], buffers[i]);
 	};
 
-	auto GetImage = [&](const uint32_t textureIndex, const bool srgb) -> ImageView {
-		if (textureIndex >= model.textures.size()) return {};
-		const uint32_t index = model.textures[textureIndex].source;
-		if (index >= images.size()) return {};
+	struct PrimitiveResult {
+		Mesh        mesh = {};
+		MeshUploads uploads = {};
+		size_t      optimizedTriangleCount = 0;
+		float       acmrBefore = 0, acmrAfter = 0;
+		size_t      unquantizedBytes = 0, quantizedBytes = 0;
+	};
+	// reads from the host copies of the buffers only, so that primitives can be processed on any thread
+	auto loadPrimitive = [&](const tinygltf::Primitive& prim) {
+		PrimitiveResult result = {};
+		Mesh& mesh = result.mesh;
+		const auto& indicesAccessor = model.accessors[prim.indices];
+		const auto& indexBufferView = model.bufferViews[indicesAccessor.bufferView];
+		const size_t indexStride = tinygltf::GetComponentSizeInBytes(indicesAccessor.componentType);
+
+		mesh.indexBufferCpu = buffersCpu[indexBufferView.buffer].slice(indexBufferView.byteOffset + indicesAccessor.byteOffset, indicesAccessor.count * indexStride);
+		mesh.indexBuffer    = buffers   [indexBufferView.buffer].slice(indexBufferView.byteOffset + indicesAccessor.byteOffset, indicesAccessor.count * indexStride);
+		mesh.indexSize = indexStride;
+		switch (prim.mode) {
+			case TINYGLTF_MODE_POINTS: 			mesh.topology = vk::PrimitiveTopology::ePointList; break;
+			case TINYGLTF_MODE_LINE: 			mesh.topology = vk::PrimitiveTopology::eLineList; break;
+			case TINYGLTF_MODE_LINE_LOOP: 		mesh.topology = vk::PrimitiveTopology::eLineStrip; break;
+			case TINYGLTF_MODE_LINE_STRIP: 		mesh.topology = vk::PrimitiveTopology::eLineStrip; break;
+			case TINYGLTF_MODE_TRIANGLES: 		mesh.topology = vk::PrimitiveTopology::eTriangleList; break;
+			case TINYGLTF_MODE_TRIANGLE_STRIP: 	mesh.topology = vk::PrimitiveTopology::eTriangleStrip; break;
+			case TINYGLTF_MODE_TRIANGLE_FAN: 	mesh.topology = vk::PrimitiveTopology::eTriangleFan; break;
+		}
+
+		for (const auto&[attribName,attribIndex] : prim.attributes) {
+			const tinygltf::Accessor& accessor = model.accessors[attribIndex];
+
+			static const std::unordered_map<int, std::unordered_map<int, vk::Format>> formatMap {
+				{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR8Uint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR8G8Uint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR8G8B8Uint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR8G8B8A8Uint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_BYTE, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR8Sint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR8G8Sint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR8G8B8Sint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR8G8B8A8Sint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR16Uint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR16G16Uint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR16G16B16Uint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR16G16B16A16Uint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_SHORT, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR16Sint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR16G16Sint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR16G16B16Sint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR16G16B16A16Sint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Uint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Uint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Uint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Uint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_INT, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sint },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Sint },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Sint },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Sint },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_FLOAT, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sfloat },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Sfloat },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Sfloat },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Sfloat },
+				} },
+				{ TINYGLTF_COMPONENT_TYPE_DOUBLE, {
+					{ TINYGLTF_TYPE_SCALAR, vk::Format::eR64Sfloat },
+					{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR64G64Sfloat },
+					{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR64G64B64Sfloat },
+					{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR64G64B64A64Sfloat },
+				} }
+			};
+			vk::Format attributeFormat = formatMap.at(accessor.componentType).at(accessor.type);
+
+			MeshVertexAttributeType attributeType;
+			uint32_t typeIndex = 0;
+			// parse typename & typeindex
+			{
+				std::string typeName;
+				typeName.resize(attribName.size());
+				std::ranges::transform(attribName, typeName.begin(), [&](char c) { return tolower(c); });
+				size_t c = typeName.find_first_of("0123456789");
+				if (c != std::string::npos) {
+					typeIndex = stoi(typeName.substr(c));
+					typeName = typeName.substr(0, c);
+				}
+				if (typeName.back() == '_') typeName.pop_back();
+				static const std::unordered_map<std::string, MeshVertexAttributeType> semanticMap {
+					{ "position", 	MeshVertexAttributeType::ePosition },
+					{ "normal", 	MeshVertexAttributeType::eNormal },
+					{ "tangent", 	MeshVertexAttributeType::eTangent },
+					{ "bitangent", 	MeshVertexAttributeType::eBinormal },
+					{ "texcoord", 	MeshVertexAttributeType::eTexcoord },
+					{ "color", 		MeshVertexAttributeType::eColor },
+					{ "psize", 		MeshVertexAttributeType::ePointSize },
+					{ "pointsize", 	MeshVertexAttributeType::ePointSize },
+					{ "joints",     MeshVertexAttributeType::eBlendIndex },
+					{ "weights",    MeshVertexAttributeType::eBlendWeight }
+				};
+				attributeType = semanticMap.at(typeName);
+			}
+
+			if (attributeType == MeshVertexAttributeType::ePosition) {
+				mesh.aabb.minX = (float)accessor.minValues[0];
+				mesh.aabb.minY = (float)accessor.minValues[1];
+				mesh.aabb.minZ = (float)accessor.minValues[2];
+				mesh.aabb.maxX = (float)accessor.maxValues[0];
+				mesh.aabb.maxY = (float)accessor.maxValues[1];
+				mesh.aabb.maxZ = (float)accessor.maxValues[2];
+			}
+
+			for (int i = 0; i < 2; i++) {
+				auto& attribs = i == 0 ? mesh.vertexAttributes[attributeType] : mesh.vertexAttributesCpu[attributeType];
+				if (attribs.size() <= typeIndex) attribs.resize(typeIndex+1);
+				const tinygltf::BufferView& b = model.bufferViews[accessor.bufferView];
+				const uint32_t stride = accessor.ByteStride(b);
+				attribs[typeIndex] = {
+					(i == 0 ? buffers[b.buffer] : buffersCpu[b.buffer]).slice(b.byteOffset + accessor.byteOffset, stride*accessor.count),
+					MeshVertexAttributeLayout{
+						.stride = stride,
+						.format = attributeFormat,
+						.offset = 0,
+						.inputRate = vk::VertexInputRate::eVertex} };
+			}
+		}
+
+		const bool hasCpuTriangles =
+			mesh.topology == vk::PrimitiveTopology::eTriangleList &&
+			mesh.vertexAttributesCpu.contains(MeshVertexAttributeType::ePosition) &&
+			mesh.vertexAttributesCpu.at(MeshVertexAttributeType::ePosition)[0].second.format == vk::Format::eR32G32B32Sfloat;
+
+		// vertex cache, overdraw and vertex fetch order, which exporters rarely optimize
+		if (hasCpuTriangles) {
+			std::tie(result.acmrBefore, result.acmrAfter) = mesh.Optimize(device, result.uploads);
+			result.optimizedTriangleCount = indicesAccessor.count / 3;
+		}
+
+		// simplified levels of detail for dense meshes
+		if (hasCpuTriangles && indicesAccessor.count / 3 >= kMinLodTriangleCount)
+			mesh.GenerateLods(device, result.uploads);
+
+		if (quantizeVertices && hasCpuTriangles) {
+			std::tie(result.unquantizedBytes, result.quantizedBytes) = mesh.Quantize(device, result.uploads);
+		}
+
+		// meshlets for the mesh shading path of the visibility pass
+		if (hasCpuTriangles && device.EnabledExtensions().contains(VK_EXT_MESH_SHADER_EXTENSION_NAME))
+			mesh.UpdateMeshlets(device, result.uploads);
+
+		return result;
+	};
+
+	// KHR_texture_basisu textures name their KTX2 image in the extension
+	auto getImageIndex = [&](const uint32_t textureIndex) -> int {
+		if (textureIndex >= model.textures.size()) return -1;
+		const tinygltf::Texture& texture = model.textures[textureIndex];
+		int source = texture.source;
+		if (const auto it = texture.extensions.find("KHR_texture_basisu"); it != texture.extensions.end() && it->second.Has("source"))
+			source = it->second.Get("source").GetNumberAsInt();
+		return source >= 0 && source < (int)images.size() ? source : -1;
+	};
+
+	// Images are block compressed by what the materials use them for. Images with several uses stay uncompressed.
+	const bool transcodeToBC = device.Features().textureCompressionBC;
+	std::vector<std::optional<TextureUsage>> imageUsages(model.images.size());
+	if (textureCompression != TextureCompression::eNone && transcodeToBC) {
+		std::vector<bool> mixed(model.images.size(), false);
+		auto addUsage = [&](const uint32_t textureIndex, const TextureUsage usage) {
+			if (textureIndex >= model.textures.size()) return;
+			// the texture's own source is the fallback of its KTX2 image
+			for (const int index : { getImageIndex(textureIndex), model.textures[textureIndex].source }) {
+				if (index < 0 || index >= (int)images.size()) continue;
+				if (imageUsages[index] && *imageUsages[index] != usage)
+					mixed[index] = true;
+				imageUsages[index] = usage;
+			}
+		};
+		for (const tinygltf::Material& material : model.materials) {
+			addUsage(material.emissiveTexture.index, TextureUsage::eColor);
+			addUsage(material.pbrMetallicRoughness.baseColorTexture.index, TextureUsage::eColor);
+			addUsage(material.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureUsage::eMetallicRoughness);
+			addUsage(material.normalTexture.index, TextureUsage::eNormal);
+		}
+		for (size_t i = 0; i < imageUsages.size(); i++)
+			if (mixed[i]) imageUsages[i].reset();
+	}
+	const bool highQuality = textureCompression == TextureCompression::eHighQuality;
+
+	// Images are decoded and primitives are processed on the thread pool, while this thread records every upload.
+	// The pool is declared after everything its tasks use, so that it finishes them before those are destroyed.
+	// KTX2 images (KHR_texture_basisu) and block compressed images keep their levels and format
+	std::vector<CompressedTexture> encodedImages(model.images.size());
+
+	ThreadPool pool(threadCount);
+	std::cout << "Decoding images and processing meshes on " << pool.ThreadCount() << " threads" << std::endl;
+
+	std::vector<std::future<void>> imageTasks(model.images.size());
+	for (size_t i = 0; i < model.images.size(); i++) {
+		tinygltf::Image& image = model.images[i];
+		if (image.as_is && !image.image.empty())
+			imageTasks[i] = pool.Push([&image, &encoded = encodedImages[i], usage = imageUsages[i], transcodeToBC, highQuality]() {
+				const auto bytes = std::as_bytes(std::span{ image.image });
+				if (IsKTX2(bytes)) {
+					encoded.image = DecodeKTX2(bytes, transcodeToBC);
+					image.image.clear();
+					return;
+				}
+				DecodeImage(image);
+				if (usage)
+					encoded = CompressImage(image, *usage, highQuality);
+			});
+	}
+
+	std::vector<std::vector<std::future<PrimitiveResult>>> meshTasks(model.meshes.size());
+	for (uint32_t i = 0; i < model.meshes.size(); i++)
+		for (const tinygltf::Primitive& prim : model.meshes[i].primitives)
+			meshTasks[i].emplace_back(pool.Push([&]() { return loadPrimitive(prim); }));
+
+	auto GetImageSource = [&](const uint32_t index, const bool srgb) -> ImageView {
 		if (images[index]) return images[index];
 
+		if (imageTasks[index].valid()) {
+			try {
+				imageTasks[index].get();
+			} catch (...) {
+				// later uses of the image get nothing instead of its encoded bytes
+				model.images[index].image.clear();
+				throw;
+			}
+		}
+
+		// KTX2 files and block compressed images store their format, so srgb is not applied
+		if (const CompressedTexture& encoded = encodedImages[index]; !encoded.image.pixels.empty()) {
+			const DecodedImage& pixels = encoded.image;
+			if (!(device.PhysicalDevice().getFormatProperties(pixels.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+				std::cerr << "Skipping image " << model.images[index].name << ": " << vk::to_string(pixels.format) << " is not supported by the device" << std::endl;
+				return {};
+			}
+			const ImageView img = ImageView::Create(Image::Create(device, ImageInfo{
+					.format = pixels.format,
+					.extent = pixels.extent,
+					.mipLevels = pixels.mipLevels,
+					.arrayLayers = pixels.arrayLayers,
+					.queueFamilies = { context.QueueFamily() } },
+					vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene),
+				vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS },
+				vk::ImageViewType::e2D,
+				encoded.components);
+			device.SetDebugName(**img.mImage, filename.stem().string() + "/" + model.images[index].name);
+			context.Copy(context.UploadData(pixels.pixels), img.mImage, pixels.regions);
+			images[index] = img;
+			return img;
+		}
+
 		const tinygltf::Image& image = model.images[index];
+		if (image.image.empty())
+			return {};
+
+		if (virtualTextures && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && (uint32_t)std::max(image.width, image.height) > kVirtualTileSize) {
+			// the cache holds RGBA8 tiles
+			std::vector<uint8_t> rgba(size_t(image.width) * image.height * 4);
+			for (size_t i = 0; i < size_t(image.width) * image.height; i++)
+				for (uint32_t c = 0; c < 4; c++)
+					rgba[i*4 + c] = c < (uint32_t)image.component ? image.image[i*image.component + c] : c == 3 ? 0xFF : 0;
+			images[index] = virtualTextures->Add(context, std::move(rgba), uint2(image.width, image.height), srgb, filename.stem().string() + "/" + image.name);
+			return images[index];
+		}
 
 		ImageInfo md = {};
 		md.extent = uint3(image.width, image.height, 1);
@@ -85,8 +431,10 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 			md.format = formatMap.at(image.pixel_type).at(image.component - 1);
 		}
 		md.queueFamilies = { context.QueueFamily() };
+		// sRGB textures are filtered in linear space. Formats compute shaders can't write fall back to blits.
+		const bool computeMips = mipGenerator && MipGenerator::Configure(device, md);
 
-		ImageView img = ImageView::Create(Image::Create(device, md), vk::ImageSubresourceRange{
+		ImageView img = ImageView::Create(Image::Create(device, md, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene), vk::ImageSubresourceRange{
 			.aspectMask = vk::ImageAspectFlagBits::eColor,
 			.baseMipLevel = 0,
 			.levelCount = 1,
@@ -95,7 +443,10 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 		device.SetDebugName(**img.mImage, filename.stem().string() + "/" + image.name);
 
 		context.Copy(context.UploadData(image.image), img);
-		context.GenerateMipMaps(img.mImage);
+		if (computeMips)
+			(*mipGenerator)(context, img.mImage);
+		else
+			context.GenerateMipMaps(img.mImage);
 
 		img = ImageView::Create(img.mImage, vk::ImageSubresourceRange{
 			.aspectMask = vk::ImageAspectFlagBits::eColor,
@@ -108,6 +459,23 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 		return img;
 	};
 
+	auto GetImage = [&](const uint32_t textureIndex, const bool srgb) -> ImageView {
+		const int source = getImageIndex(textureIndex);
+		if (source < 0) return {};
+		const int fallback = model.textures[textureIndex].source;
+		if (fallback == source || fallback < 0 || fallback >= (int)images.size())
+			return GetImageSource(source, srgb);
+
+		// KTX2 images which need libktx, or whose format the device can't sample, fall back to the texture's source
+		try {
+			if (const ImageView img = GetImageSource(source, srgb))
+				return img;
+		} catch (const std::exception& e) {
+			std::cerr << "Failed to decode image " << model.images[source].name << ", using " << model.images[fallback].name << " instead: " << e.what() << std::endl;
+		}
+		return GetImageSource(fallback, srgb);
+	};
+
 	std::cout << "Loading materials..." << std::endl;
 	std::ranges::transform(model.materials, materials.begin(), [&](const tinygltf::Material& material) {
 		Material<ImageView> m;
@@ -126,6 +494,19 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 		if      (material.alphaMode == "MASK")  m.SetFlags(MaterialFlags::eAlphaCutoff);
 		else if (material.alphaMode == "BLEND") m.SetFlags(MaterialFlags::eAlphaBlend);
 		if (material.doubleSided) m.SetFlags((MaterialFlags)(m.GetFlags() | (uint)MaterialFlags::eDoubleSided));
+		if (m.bumpMap) {
+			// BC5 (see TextureUsage::eNormal) and two channel normal maps don't store z
+			switch (m.bumpMap.GetImage()->Info().format) {
+			case vk::Format::eBc5UnormBlock:
+			case vk::Format::eBc5SnormBlock:
+			case vk::Format::eR8G8Unorm:
+			case vk::Format::eR16G16Unorm:
+				m.SetFlags((MaterialFlags)(m.GetFlags() | (uint)MaterialFlags::eNormalMapXY));
+				break;
+			default:
+				break;
+			}
+		}
 
 		float3 emission = (float3)double3(material.emissiveFactor[0], material.emissiveFactor[1], material.emissiveFactor[2]);
 
@@ -150,141 +531,57 @@ ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& fi
 		return make_ref<Material<ImageView>>(m);
 	});
 
+	// memory and quality of the block compressed images, by format
+	{
+		struct FormatStats {
+			uint32_t count = 0;
+			size_t   uncompressedBytes = 0, compressedBytes = 0;
+			double   minPsnr = std::numeric_limits<double>::infinity(), psnrSum = 0;
+			uint32_t lossyCount = 0;
+		};
+		std::map<vk::Format, FormatStats> stats;
+		for (const CompressedTexture& encoded : encodedImages) {
+			if (encoded.uncompressedBytes == 0) continue;
+			FormatStats& s = stats[encoded.image.format];
+			s.count++;
+			s.uncompressedBytes += encoded.uncompressedBytes;
+			s.compressedBytes   += encoded.image.pixels.size();
+			s.minPsnr = std::min(s.minPsnr, encoded.psnr);
+			if (std::isfinite(encoded.psnr)) {
+				s.psnrSum += encoded.psnr;
+				s.lossyCount++;
+			}
+		}
+		for (const auto&[format, s] : stats)
+			std::cout << "Block compressed " << s.count << " images to " << vk::to_string(format) << ": "
+				<< (s.uncompressedBytes >> 10) << "KiB -> " << (s.compressedBytes >> 10) << "KiB, PSNR "
+				<< (s.lossyCount > 0 ? s.psnrSum / s.lossyCount : s.minPsnr) << "dB average, " << s.minPsnr << "dB min" << std::endl;
+	}
+
 	std::cout << "Loading meshes...";
+	size_t unquantizedVertexBytes = 0;
+	size_t quantizedVertexBytes = 0;
+	double acmrBefore = 0, acmrAfter = 0; // weighted by triangle count
+	size_t optimizedTriangleCount = 0;
 	for (uint32_t i = 0; i < model.meshes.size(); i++) {
 		std::cout << "\rLoading meshes " << (i+1) << "/" << model.meshes.size() << "     ";
-		meshes[i].resize(model.meshes[i].primitives.size());
-		for (uint32_t j = 0; j < model.meshes[i].primitives.size(); j++) {
-			const tinygltf::Primitive& prim = model.meshes[i].primitives[j];
-			const auto& indicesAccessor = model.accessors[prim.indices];
-			const auto& indexBufferView = model.bufferViews[indicesAccessor.bufferView];
-			const size_t indexStride = tinygltf::GetComponentSizeInBytes(indicesAccessor.componentType);
-
-			Mesh mesh = {};
-			mesh.indexBufferCpu = buffersCpu[indexBufferView.buffer].slice(indexBufferView.byteOffset + indicesAccessor.byteOffset, indicesAccessor.count * indexStride);
-			mesh.indexBuffer    = buffers   [indexBufferView.buffer].slice(indexBufferView.byteOffset + indicesAccessor.byteOffset, indicesAccessor.count * indexStride);
-			mesh.indexSize = indexStride;
-			switch (prim.mode) {
-				case TINYGLTF_MODE_POINTS: 			mesh.topology = vk::PrimitiveTopology::ePointList; break;
-				case TINYGLTF_MODE_LINE: 			mesh.topology = vk::PrimitiveTopology::eLineList; break;
-				case TINYGLTF_MODE_LINE_LOOP: 		mesh.topology = vk::PrimitiveTopology::eLineStrip; break;
-				case TINYGLTF_MODE_LINE_STRIP: 		mesh.topology = vk::PrimitiveTopology::eLineStrip; break;
-				case TINYGLTF_MODE_TRIANGLES: 		mesh.topology = vk::PrimitiveTopology::eTriangleList; break;
-				case TINYGLTF_MODE_TRIANGLE_STRIP: 	mesh.topology = vk::PrimitiveTopology::eTriangleStrip; break;
-				case TINYGLTF_MODE_TRIANGLE_FAN: 	mesh.topology = vk::PrimitiveTopology::eTriangleFan; break;
-			}
-
-			for (const auto&[attribName,attribIndex] : prim.attributes) {
-				const tinygltf::Accessor& accessor = model.accessors[attribIndex];
-
-				static const std::unordered_map<int, std::unordered_map<int, vk::Format>> formatMap {
-					{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR8Uint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR8G8Uint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR8G8B8Uint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR8G8B8A8Uint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_BYTE, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR8Sint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR8G8Sint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR8G8B8Sint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR8G8B8A8Sint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR16Uint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR16G16Uint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR16G16B16Uint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR16G16B16A16Uint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_SHORT, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR16Sint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR16G16Sint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR16G16B16Sint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR16G16B16A16Sint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Uint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Uint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Uint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Uint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_INT, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sint },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Sint },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Sint },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Sint },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_FLOAT, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sfloat },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR32G32Sfloat },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR32G32B32Sfloat },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR32G32B32A32Sfloat },
-					} },
-					{ TINYGLTF_COMPONENT_TYPE_DOUBLE, {
-						{ TINYGLTF_TYPE_SCALAR, vk::Format::eR64Sfloat },
-						{ TINYGLTF_TYPE_VEC2, 	vk::Format::eR64G64Sfloat },
-						{ TINYGLTF_TYPE_VEC3, 	vk::Format::eR64G64B64Sfloat },
-						{ TINYGLTF_TYPE_VEC4, 	vk::Format::eR64G64B64A64Sfloat },
-					} }
-				};
-				vk::Format attributeFormat = formatMap.at(accessor.componentType).at(accessor.type);
-
-				MeshVertexAttributeType attributeType;
-				uint32_t typeIndex = 0;
-				// parse typename & typeindex
-				{
-					std::string typeName;
-					typeName.resize(attribName.size());
-					std::ranges::transform(attribName, typeName.begin(), [&](char c) { return tolower(c); });
-					size_t c = typeName.find_first_of("0123456789");
-					if (c != std::string::npos) {
-						typeIndex = stoi(typeName.substr(c));
-						typeName = typeName.substr(0, c);
-					}
-					if (typeName.back() == '_') typeName.pop_back();
-					static const std::unordered_map<std::string, MeshVertexAttributeType> semanticMap {
-						{ "position", 	MeshVertexAttributeType::ePosition },
-						{ "normal", 	MeshVertexAttributeType::eNormal },
-						{ "tangent", 	MeshVertexAttributeType::eTangent },
-						{ "bitangent", 	MeshVertexAttributeType::eBinormal },
-						{ "texcoord", 	MeshVertexAttributeType::eTexcoord },
-						{ "color", 		MeshVertexAttributeType::eColor },
-						{ "psize", 		MeshVertexAttributeType::ePointSize },
-						{ "pointsize", 	MeshVertexAttributeType::ePointSize },
-						{ "joints",     MeshVertexAttributeType::eBlendIndex },
-						{ "weights",    MeshVertexAttributeType::eBlendWeight }
-					};
-					attributeType = semanticMap.at(typeName);
-				}
-
-				if (attributeType == MeshVertexAttributeType::ePosition) {
-					mesh.aabb.minX = (float)accessor.minValues[0];
-					mesh.aabb.minY = (float)accessor.minValues[1];
-					mesh.aabb.minZ = (float)accessor.minValues[2];
-					mesh.aabb.maxX = (float)accessor.maxValues[0];
-					mesh.aabb.maxY = (float)accessor.maxValues[1];
-					mesh.aabb.maxZ = (float)accessor.maxValues[2];
-				}
-
-				for (int i = 0; i < 2; i++) {
-					auto& attribs = i == 0 ? mesh.vertexAttributes[attributeType] : mesh.vertexAttributesCpu[attributeType];
-					if (attribs.size() <= typeIndex) attribs.resize(typeIndex+1);
-					const tinygltf::BufferView& b = model.bufferViews[accessor.bufferView];
-					const uint32_t stride = accessor.ByteStride(b);
-					attribs[typeIndex] = {
-						(i == 0 ? buffers[b.buffer] : buffersCpu[b.buffer]).slice(b.byteOffset + accessor.byteOffset, stride*accessor.count),
-						MeshVertexAttributeLayout{
-							.stride = stride,
-							.format = attributeFormat,
-							.offset = 0,
-							.inputRate = vk::VertexInputRate::eVertex} };
-				}
-			}
-
-			meshes[i][j] = make_ref<Mesh>(std::move(mesh));
+		meshes[i].resize(meshTasks[i].size());
+		for (uint32_t j = 0; j < meshTasks[i].size(); j++) {
+			PrimitiveResult result = meshTasks[i][j].get();
+			result.uploads.Record(context);
+			acmrBefore             += result.acmrBefore * double(result.optimizedTriangleCount);
+			acmrAfter              += result.acmrAfter  * double(result.optimizedTriangleCount);
+			optimizedTriangleCount += result.optimizedTriangleCount;
+			unquantizedVertexBytes += result.unquantizedBytes;
+			quantizedVertexBytes   += result.quantizedBytes;
+			meshes[i][j] = make_ref<Mesh>(std::move(result.mesh));
 		}
 	}
 	std::cout << std::endl;
+	if (optimizedTriangleCount > 0)
+		std::cout << "Vertex cache ACMR: " << acmrBefore / optimizedTriangleCount << " -> " << acmrAfter / optimizedTriangleCount << std::endl;
+	if (quantizedVertexBytes > 0)
+		std::cout << "Quantized indices and vertex streams: " << (unquantizedVertexBytes >> 10) << "KiB -> " << (quantizedVertexBytes >> 10) << "KiB" << std::endl;
 
 	ref<Mesh> sphereMesh = {};
 
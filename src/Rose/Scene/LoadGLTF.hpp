@@ -1,10 +1,21 @@
 #pragma once
 
+#include <Rose/Algorithm/MipGenerator/MipGenerator.hpp>
 #include <Rose/Core/CommandContext.hpp>
+#include <Rose/Core/TextureCompression.hpp>
 #include "SceneNode.hpp"
+#include "VirtualTexture.hpp"
 
 namespace RoseEngine {
 
-ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename);
+// quantizeVertices stores positions, normals and texcoords in 16-bit formats. See Mesh::Quantize.
+// Images are decoded and meshes are processed on threadCount threads (0 uses one per hardware thread),
+// while every upload is recorded into context on the calling thread.
+// textureCompression encodes PNG and JPEG textures to BC formats chosen by their use in the materials. See CompressTexture.
+// Mips of uncompressed textures are generated with mipGenerator, which must outlive the commands recorded into context,
+// or with blits if it is null or can't write the texture's format.
+// Uncompressed 8-bit textures larger than a tile are added to virtualTextures if it isn't null, and materials use their tails.
+// The paths of the external buffer and image files, relative to the directory of filename, are added to externalFiles if it isn't null.
+ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename, const bool quantizeVertices = true, const uint32_t threadCount = 0, const TextureCompression textureCompression = TextureCompression::eNone, MipGenerator* mipGenerator = nullptr, VirtualTextureCache* virtualTextures = nullptr, std::vector<std::filesystem::path>* externalFiles = nullptr);
 
 }
\ No newline at end of file
@@ -2,9 +2,292 @@
 
 #include <Rose/Core/ShaderModule.hpp>
 #include <Rose/Core/CommandContext.hpp>
+#include <Rose/Core/MathUtils.h>
 
 namespace RoseEngine {
 
+void Mesh::UpdateBVH(const Device& device) {
+	if (!NeedsBVHUpdate())
+		return;
+
+	const auto it = vertexAttributesCpu.find(MeshVertexAttributeType::ePosition);
+	if (it == vertexAttributesCpu.end() || it->second.empty() || !indexBufferCpu)
+		throw std::runtime_error("Mesh BVH requires CPU copies of the positions and indices");
+
+	const auto& [positions, layout] = it->second[0];
+	if (layout.format != vk::Format::eR32G32B32Sfloat)
+		throw std::runtime_error("Mesh BVH requires R32G32B32Sfloat positions");
+
+	bvh = make_ref<BVH>(BVH::Build(std::span{ indexBufferCpu.data(), size_t(RayTracingTriangleCount()) * 3 * indexSize }, indexSize, positions.data() + layout.offset, layout.stride));
+	bvhUpdateTime = device.NextTimelineSignal();
+}
+
+void Mesh::UpdateMeshlets(const Device& device, MeshUploads& uploads) {
+	if (topology != vk::PrimitiveTopology::eTriangleList)
+		throw std::runtime_error("Meshlets require a triangle list");
+
+	const auto it = vertexAttributesCpu.find(MeshVertexAttributeType::ePosition);
+	if (it == vertexAttributesCpu.end() || it->second.empty() || !indexBufferCpu)
+		throw std::runtime_error("Meshlets require CPU copies of the positions and indices");
+
+	const auto& [positions, layout] = it->second[0];
+	if (layout.format != vk::Format::eR32G32B32Sfloat)
+		throw std::runtime_error("Meshlets require R32G32B32Sfloat positions");
+
+	const MeshletSet meshlets = MeshletSet::Build(std::span{ indexBufferCpu.data(), size_t(RayTracingTriangleCount()) * 3 * indexSize }, indexSize, positions.data() + layout.offset, layout.stride);
+
+	meshletCount       = (uint32_t)meshlets.meshlets.size();
+	meshletVertexCount = (uint32_t)meshlets.vertices.size();
+	if (meshlets.empty()) {
+		meshletBuffer = {};
+		return;
+	}
+
+	std::vector<std::byte> data(meshlets.meshlets.size() * sizeof(Meshlet) + meshlets.vertices.size() * sizeof(uint32_t) + meshlets.triangles.size() * sizeof(uint2));
+	std::byte* dst = data.data();
+	dst = std::ranges::copy(std::as_bytes(std::span{ meshlets.meshlets }),  dst).out;
+	dst = std::ranges::copy(std::as_bytes(std::span{ meshlets.vertices }),  dst).out;
+	dst = std::ranges::copy(std::as_bytes(std::span{ meshlets.triangles }), dst).out;
+
+	meshletBuffer = Buffer::Create(device, data.size(), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+	uploads.uploads.emplace_back(std::move(data), meshletBuffer);
+}
+
+void Mesh::GenerateLods(const Device& device, MeshUploads& uploads, const uint32_t maxLodCount, const uint32_t rayTracingLod_) {
+	if (topology != vk::PrimitiveTopology::eTriangleList)
+		throw std::runtime_error("LODs require a triangle list");
+
+	const auto it = vertexAttributesCpu.find(MeshVertexAttributeType::ePosition);
+	if (it == vertexAttributesCpu.end() || it->second.empty() || !indexBufferCpu)
+		throw std::runtime_error("LODs require CPU copies of the positions and indices");
+
+	const auto& [positions, layout] = it->second[0];
+	if (layout.format != vk::Format::eR32G32B32Sfloat)
+		throw std::runtime_error("LODs require R32G32B32Sfloat positions");
+
+	MeshLodChain chain = MeshLodChain::Build(std::span{ indexBufferCpu.data(), indexBufferCpu.size_bytes() }, indexSize, positions.data() + layout.offset, layout.stride, maxLodCount);
+	if (chain.lods.size() < 2)
+		return;
+
+	// simplification scrambles the triangle order
+	for (uint32_t i = 1; i < chain.lods.size(); i++)
+		OptimizeTriangleOrder(std::span{ chain.indices }.subspan(3*chain.lods[i].firstTriangle, 3*chain.lods[i].triangleCount), positions.data() + layout.offset, layout.stride);
+
+	// move the ray traced level to the start
+	lods.clear();
+	rayTracingLod = std::min(rayTracingLod_, (uint32_t)chain.lods.size() - 1);
+	std::vector<uint32_t> order = { rayTracingLod };
+	for (uint32_t i = 0; i < chain.lods.size(); i++)
+		if (i != rayTracingLod) order.emplace_back(i);
+
+	std::vector<std::byte> data(chain.indices.size() * indexSize);
+	lods.resize(chain.lods.size());
+	uint32_t triangleOffset = 0;
+	for (const uint32_t i : order) {
+		const MeshLod& src = chain.lods[i];
+		for (uint32_t j = 0; j < 3*src.triangleCount; j++) {
+			const uint32_t index = chain.indices[3*src.firstTriangle + j];
+			if (indexSize == sizeof(uint16_t))
+				reinterpret_cast<uint16_t*>(data.data())[3*triangleOffset + j] = (uint16_t)index;
+			else
+				reinterpret_cast<uint32_t*>(data.data())[3*triangleOffset + j] = index;
+		}
+		lods[i] = MeshLod{ .firstTriangle = triangleOffset, .triangleCount = src.triangleCount, .error = src.error };
+		triangleOffset += src.triangleCount;
+	}
+
+	indexBufferCpu = Buffer::Create(device, data, vk::BufferUsageFlagBits::eTransferSrc);
+	indexBuffer    = Buffer::Create(device, data.size(), indexBuffer.mBuffer->Usage() | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+	uploads.copies.emplace_back(indexBufferCpu, indexBuffer);
+	lastUpdateTime = device.NextTimelineSignal();
+}
+
+std::pair<float, float> Mesh::Optimize(const Device& device, MeshUploads& uploads) {
+	if (topology != vk::PrimitiveTopology::eTriangleList)
+		throw std::runtime_error("Optimization requires a triangle list");
+
+	const auto it = vertexAttributesCpu.find(MeshVertexAttributeType::ePosition);
+	if (it == vertexAttributesCpu.end() || it->second.empty() || !indexBufferCpu)
+		throw std::runtime_error("Optimization requires CPU copies of the positions and indices");
+	for (const auto&[type, attribs] : vertexAttributes)
+		if (!vertexAttributesCpu.contains(type) || vertexAttributesCpu.at(type).size() != attribs.size())
+			throw std::runtime_error("Optimization requires CPU copies of every vertex stream");
+
+	const auto& [positions, layout] = it->second[0];
+	if (layout.format != vk::Format::eR32G32B32Sfloat)
+		throw std::runtime_error("Optimization requires R32G32B32Sfloat positions");
+
+	std::vector<uint32_t> indices(indexBufferCpu.size_bytes() / indexSize);
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (indexSize == sizeof(uint16_t))
+			indices[i] = reinterpret_cast<const uint16_t*>(indexBufferCpu.data())[i];
+		else
+			indices[i] = reinterpret_cast<const uint32_t*>(indexBufferCpu.data())[i];
+	}
+	indices.resize(indices.size() - indices.size() % 3);
+	if (indices.empty())
+		return { 0.f, 0.f };
+
+	const float acmrBefore = ComputeACMR(indices);
+	OptimizeTriangleOrder(indices, positions.data() + layout.offset, layout.stride);
+	const std::vector<uint32_t> oldIndices = OptimizeVertexFetch(indices);
+	const float acmrAfter = ComputeACMR(indices);
+
+	// | indices | streams... |, with each region 16-byte aligned and each element padded to 4 bytes
+	auto align = [](const size_t x) { return (x + 15) & ~size_t(15); };
+	size_t size = align(indices.size() * indexSize);
+	for (const auto&[type, attribs] : vertexAttributesCpu)
+		for (const auto&[buffer, attribLayout] : attribs)
+			size += align(oldIndices.size() * ((GetTexelSize(attribLayout.format) + 3) & ~3u));
+
+	std::vector<std::byte> data(size);
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (indexSize == sizeof(uint16_t))
+			reinterpret_cast<uint16_t*>(data.data())[i] = (uint16_t)indices[i];
+		else
+			reinterpret_cast<uint32_t*>(data.data())[i] = indices[i];
+	}
+	const size_t indexBytes = indices.size() * indexSize;
+
+	// (type, index, offset, layout) of each stream in data
+	std::vector<std::tuple<MeshVertexAttributeType, uint32_t, size_t, MeshVertexAttributeLayout>> streams;
+	size_t dataOffset = align(indexBytes);
+	for (const auto&[type, attribs] : vertexAttributesCpu) {
+		for (uint32_t i = 0; i < attribs.size(); i++) {
+			const auto&[buffer, attribLayout] = attribs[i];
+			const uint32_t elementSize = GetTexelSize(attribLayout.format);
+			const uint32_t stride = (elementSize + 3) & ~3u;
+			for (uint32_t v = 0; v < oldIndices.size(); v++)
+				std::memcpy(data.data() + dataOffset + size_t(v) * stride, buffer.data() + attribLayout.offset + size_t(oldIndices[v]) * attribLayout.stride, elementSize);
+			streams.emplace_back(type, i, dataOffset, MeshVertexAttributeLayout{
+				.stride = stride,
+				.format = attribLayout.format,
+				.offset = 0,
+				.inputRate = vk::VertexInputRate::eVertex });
+			dataOffset += align(oldIndices.size() * stride);
+		}
+	}
+
+	const BufferView cpuBuffer = Buffer::Create(device, data, vk::BufferUsageFlagBits::eTransferSrc);
+	const BufferView buffer    = Buffer::Create(device, data.size(), indexBuffer.mBuffer->Usage() | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+	uploads.copies.emplace_back(cpuBuffer, buffer);
+
+	indexBufferCpu = cpuBuffer.slice(0, indexBytes);
+	indexBuffer    = buffer.slice(0, indexBytes);
+	for (const auto&[type, i, offset, streamLayout] : streams) {
+		const size_t streamBytes = oldIndices.size() * streamLayout.stride;
+		vertexAttributesCpu.at(type)[i] = { cpuBuffer.slice(offset, streamBytes), streamLayout };
+		if (vertexAttributes.contains(type) && i < vertexAttributes.at(type).size())
+			vertexAttributes.at(type)[i] = { buffer.slice(offset, streamBytes), streamLayout };
+	}
+
+	lastUpdateTime = device.NextTimelineSignal();
+
+	return { acmrBefore, acmrAfter };
+}
+
+std::pair<size_t, size_t> Mesh::Quantize(const Device& device, MeshUploads& uploads) {
+	if (!indexBufferCpu || !vertexAttributesCpu.contains(MeshVertexAttributeType::ePosition))
+		throw std::runtime_error("Quantization requires CPU copies of the positions and indices");
+	if (deformable)
+		throw std::runtime_error("Deformable meshes can't be quantized, since SetPositions and BLAS refits expect float positions");
+
+	auto cpuStream = [&](const MeshVertexAttributeType type, const vk::Format format) -> const MeshVertexAttribute* {
+		const auto it = vertexAttributesCpu.find(type);
+		if (it == vertexAttributesCpu.end() || it->second.empty() || it->second[0].second.format != format || !vertexAttributes.contains(type))
+			return nullptr;
+		return &it->second[0];
+	};
+
+	const MeshVertexAttribute* positionsCpu = cpuStream(MeshVertexAttributeType::ePosition, vk::Format::eR32G32B32Sfloat);
+	if (!positionsCpu)
+		throw std::runtime_error("Quantization requires R32G32B32Sfloat positions");
+	const MeshVertexAttribute* normalsCpu   = cpuStream(MeshVertexAttributeType::eNormal,   vk::Format::eR32G32B32Sfloat);
+	const MeshVertexAttribute* texcoordsCpu = cpuStream(MeshVertexAttributeType::eTexcoord, vk::Format::eR32G32Sfloat);
+
+	const auto& [positions, positionsLayout] = *positionsCpu;
+	const uint32_t vertexCount = (uint32_t)((positions.size_bytes() - positionsLayout.offset) / positionsLayout.stride);
+
+	float3 offset, scale;
+	const std::vector<uint2> quantizedPositions = QuantizePositions(positions.data() + positionsLayout.offset, positionsLayout.stride, vertexCount, offset, scale);
+
+	// (type, data, stride, format) of each quantized stream
+	std::vector<std::tuple<MeshVertexAttributeType, std::span<const std::byte>, uint32_t, vk::Format>> streams;
+	streams.emplace_back(MeshVertexAttributeType::ePosition, std::as_bytes(std::span{ quantizedPositions }), (uint32_t)sizeof(uint2), vk::Format::eR16G16B16A16Snorm);
+
+	std::vector<uint32_t> quantizedNormals, quantizedTexcoords;
+	if (normalsCpu) {
+		quantizedNormals = QuantizeNormals(normalsCpu->first.data() + normalsCpu->second.offset, normalsCpu->second.stride, vertexCount);
+		streams.emplace_back(MeshVertexAttributeType::eNormal, std::as_bytes(std::span{ quantizedNormals }), (uint32_t)sizeof(uint32_t), vk::Format::eR16G16Unorm);
+	}
+	if (texcoordsCpu) {
+		quantizedTexcoords = QuantizeTexcoords(texcoordsCpu->first.data() + texcoordsCpu->second.offset, texcoordsCpu->second.stride, vertexCount);
+		if (!quantizedTexcoords.empty())
+			streams.emplace_back(MeshVertexAttributeType::eTexcoord, std::as_bytes(std::span{ quantizedTexcoords }), (uint32_t)sizeof(uint32_t), vk::Format::eR16G16Unorm);
+	}
+
+	// | blas transform | indices | streams... |, with each region 16-byte aligned
+	auto align = [](const size_t x) { return (x + 15) & ~size_t(15); };
+	size_t oldSize = indexBufferCpu.size_bytes();
+	size_t size = align(sizeof(vk::TransformMatrixKHR)) + align(indexBufferCpu.size_bytes());
+	for (const auto&[type, data, stride, format] : streams) {
+		oldSize += size_t(vertexCount) * vertexAttributes.at(type)[0].second.stride;
+		size += align(data.size_bytes());
+	}
+
+	std::vector<std::byte> data(size);
+	const vk::TransformMatrixKHR transform = { std::array<std::array<float, 4>, 3>{
+		std::array<float, 4>{ scale.x, 0, 0, offset.x },
+		std::array<float, 4>{ 0, scale.y, 0, offset.y },
+		std::array<float, 4>{ 0, 0, scale.z, offset.z } } };
+	std::memcpy(data.data(), &transform, sizeof(transform));
+	size_t dataOffset = align(sizeof(vk::TransformMatrixKHR));
+	std::memcpy(data.data() + dataOffset, indexBufferCpu.data(), indexBufferCpu.size_bytes());
+	const size_t indexOffset = dataOffset;
+	dataOffset += align(indexBufferCpu.size_bytes());
+	std::vector<size_t> streamOffsets;
+	for (const auto&[type, streamData, stride, format] : streams) {
+		std::memcpy(data.data() + dataOffset, streamData.data(), streamData.size_bytes());
+		streamOffsets.emplace_back(dataOffset);
+		dataOffset += align(streamData.size_bytes());
+	}
+
+	const vk::BufferUsageFlags usage = indexBuffer.mBuffer->Usage() | vk::BufferUsageFlagBits::eTransferDst;
+	const BufferView buffer = Buffer::Create(device, size, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+	uploads.uploads.emplace_back(std::move(data), buffer);
+
+	indexBuffer = buffer.slice(indexOffset, indexBufferCpu.size_bytes());
+	for (uint32_t i = 0; i < streams.size(); i++) {
+		const auto&[type, streamData, stride, format] = streams[i];
+		vertexAttributes.at(type)[0] = {
+			buffer.slice(streamOffsets[i], streamData.size_bytes()),
+			MeshVertexAttributeLayout{
+				.stride = stride,
+				.format = format,
+				.offset = 0,
+				.inputRate = vk::VertexInputRate::eVertex } };
+	}
+	blasTransform = usage & vk::BufferUsageFlagBits::eShaderDeviceAddress ? buffer.slice(0, sizeof(vk::TransformMatrixKHR)) : BufferView{};
+	positionOffset = offset;
+	positionScale  = scale;
+
+	// decoded positions for the CPU
+	std::vector<float3> decoded(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		decoded[i] = offset + scale * UnpackSnorm16x3(quantizedPositions[i]);
+	vertexAttributesCpu.at(MeshVertexAttributeType::ePosition)[0] = {
+		Buffer::Create(device, decoded, vk::BufferUsageFlagBits::eTransferSrc),
+		MeshVertexAttributeLayout{
+			.stride = sizeof(float3),
+			.format = vk::Format::eR32G32B32Sfloat,
+			.offset = 0,
+			.inputRate = vk::VertexInputRate::eVertex } };
+
+	lastUpdateTime = device.NextTimelineSignal();
+
+	return { oldSize, size };
+}
+
 void Mesh::Bind(CommandContext& context, const MeshLayout& layout) const {
 	for (const auto&[type, bindings] : layout.vertexAttributeBindings) {
 		const auto& attributes = vertexAttributes.at(type);
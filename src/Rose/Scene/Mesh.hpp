@@ -2,6 +2,11 @@
 
 #include <Rose/Core/CommandContext.hpp>
 #include <Rose/Core/Hash.hpp>
+#include "BVH.hpp"
+#include "Meshlets.hpp"
+#include "MeshOptimize.hpp"
+#include "MeshSimplify.hpp"
+#include "VertexQuantization.hpp"
 
 namespace RoseEngine {
 
@@ -63,6 +68,22 @@ struct MeshLayout {
 	}
 };
 
+// Copies to the device buffers created by Mesh's processing functions. The functions that take a MeshUploads only
+// create buffers, so that meshes can be processed on worker threads while one thread records every copy.
+struct MeshUploads {
+	std::vector<std::pair<BufferView/*host*/, BufferView/*device*/>>           copies;  // from host buffers the mesh keeps
+	std::vector<std::pair<std::vector<std::byte>, BufferView/*device*/>> uploads; // from data only the device keeps
+
+	inline void Record(CommandContext& context) {
+		for (const auto&[src, dst] : copies)
+			context.Copy(src, dst);
+		for (const auto&[data, dst] : uploads)
+			context.Copy(context.UploadData(data), dst);
+		copies.clear();
+		uploads.clear();
+	}
+};
+
 struct Mesh {
 	MeshVertexAttributes  vertexAttributes = {};
 	BufferView            indexBuffer = {};
@@ -73,38 +94,161 @@ struct Mesh {
 	vk::AabbPositionsKHR  aabb = {};
 	ref<AccelerationStructure> blas = {};
 	uint64_t              blasUpdateTime = 0;
+	ref<BVH>              bvh = {}; // used instead of blas on devices without ray queries
+	uint64_t              bvhUpdateTime = 0;
+	// Meshlets for mesh shading, followed by the meshlet vertices and triangles. See UpdateMeshlets.
+	BufferView            meshletBuffer = {};
+	uint32_t              meshletCount = 0;
+	uint32_t              meshletVertexCount = 0;
+	// Levels of detail in indexBuffer, from full resolution to coarsest. Empty if the mesh has a single level.
+	// The level at triangle 0 (lods[rayTracingLod]) is the one that is ray traced, sampled for emission and split into meshlets.
+	std::vector<MeshLod>  lods = {};
+	uint32_t              rayTracingLod = 0;
+	// Quantized positions decode to positionOffset + positionScale * value. See Quantize.
+	float3                positionOffset = float3(0);
+	float3                positionScale = float3(1);
+	BufferView            blasTransform = {}; // the position decode as a vk::TransformMatrixKHR, so that the BLAS is in object space
 	uint64_t              lastUpdateTime = 0;
 
+	// Deformable meshes build their BLAS with eAllowUpdate, and refit it when their positions change.
+	// The BLAS is rebuilt after maxBLASUpdates refits to bound the loss in trace quality.
+	// Their positions must stay 32-bit floats, so they can't be quantized.
+	bool                  deformable = false;
+	uint32_t              maxBLASUpdates = 16;
+
 	inline vk::IndexType IndexType() const { return indexSize == sizeof(uint32_t) ? vk::IndexType::eUint32 : vk::IndexType::eUint16; }
 
+	inline uint32_t LodCount() const { return lods.empty() ? 1 : (uint32_t)lods.size(); }
+	// Whether positions are stored quantized, decoded with positionOffset, positionScale and blasTransform
+	inline bool IsQuantized() const { return vertexAttributes.at(MeshVertexAttributeType::ePosition)[0].second.format == vk::Format::eR16G16B16A16Snorm; }
+	inline MeshLod  GetLod(const uint32_t i) const {
+		return lods.empty() ? MeshLod{ .firstTriangle = 0, .triangleCount = (uint32_t)(indexBuffer.size_bytes() / (indexSize * 3)), .error = 0 } : lods[i];
+	}
+	// Triangles at the start of indexBuffer used for ray tracing
+	inline uint32_t RayTracingTriangleCount() const { return GetLod(rayTracingLod).triangleCount; }
+
+	// Coarsest level whose error is at most maxError once scaled by errorScale, e.g. the number of pixels an
+	// object space unit covers at the mesh's distance
+	inline uint32_t SelectLod(const float errorScale, const float maxError) const {
+		uint32_t lod = 0;
+		while (lod + 1 < lods.size() && lods[lod + 1].error * errorScale <= maxError)
+			lod++;
+		return lod;
+	}
+
 	MeshLayout GetLayout(const ShaderModule& vertexShader) const;
 	void Bind(CommandContext& context, const MeshLayout& layout) const;
 
-	inline void UpdateBLAS(CommandContext& context, const bool opaque) {
-		if (blas && lastUpdateTime <= blasUpdateTime)
-			return;
+	inline bool NeedsBLASUpdate() const { return !blas || lastUpdateTime > blasUpdateTime; }
+	inline bool NeedsBVHUpdate()  const { return !bvh  || lastUpdateTime > bvhUpdateTime; }
+
+	// Builds the BVH for software ray tracing from vertexAttributesCpu and indexBufferCpu,
+	// which must hold 32-bit float positions and must be kept up to date for deformable meshes.
+	void UpdateBVH(const Device& device);
 
+	// Builds meshlets from vertexAttributesCpu and indexBufferCpu like UpdateBVH, and uploads them to meshletBuffer.
+	// Only triangle lists are supported.
+	void UpdateMeshlets(const Device& device, MeshUploads& uploads);
+	inline void UpdateMeshlets(CommandContext& context) {
+		MeshUploads uploads;
+		UpdateMeshlets(context.GetDevice(), uploads);
+		uploads.Record(context);
+	}
+
+	// Reorders triangles for the vertex cache and overdraw, and vertices in order of first use (see MeshOptimize.hpp),
+	// rewriting indexBuffer and every vertex stream, on the CPU and the device, into one tightly packed buffer each.
+	// Requires a CPU copy of every stream in vertexAttributes, and must be called before GenerateLods and Quantize.
+	// Returns the ACMR before and after.
+	std::pair<float, float> Optimize(const Device& device, MeshUploads& uploads);
+	inline std::pair<float, float> Optimize(CommandContext& context) {
+		MeshUploads uploads;
+		const auto acmr = Optimize(context.GetDevice(), uploads);
+		uploads.Record(context);
+		return acmr;
+	}
+
+	// Simplifies the mesh into a chain of up to maxLodCount levels (see MeshLodChain), and replaces indexBuffer and
+	// indexBufferCpu with new buffers holding every level. rayTracingLod is placed first, so that the BLAS and BVH
+	// are built from it. Requires the same CPU data as UpdateBVH, and must be called before the BLAS, BVH and meshlets are built.
+	void GenerateLods(const Device& device, MeshUploads& uploads, const uint32_t maxLodCount = 8, const uint32_t rayTracingLod = 0);
+	inline void GenerateLods(CommandContext& context, const uint32_t maxLodCount = 8, const uint32_t rayTracingLod = 0) {
+		MeshUploads uploads;
+		GenerateLods(context.GetDevice(), uploads, maxLodCount, rayTracingLod);
+		uploads.Record(context);
+	}
+
+	// Replaces indexBuffer and the first position, normal and texcoord streams with one buffer holding
+	// quantized streams (see VertexAttributeFormat). Texcoords outside of [0,1] are kept as floats. Tangents are kept
+	// as they are, since the scene shaders derive them from texcoords rather than decoding a vertex stream.
+	// The CPU positions are replaced with the decoded positions, so that the BVH, meshlets and BLAS match what is rasterized.
+	// Requires the same CPU data as UpdateBVH, and must be called before the BLAS, BVH and meshlets are built.
+	// Throws for deformable meshes.
+	// Returns the bytes of the replaced streams and of the new buffer.
+	std::pair<size_t, size_t> Quantize(const Device& device, MeshUploads& uploads);
+	inline std::pair<size_t, size_t> Quantize(CommandContext& context) {
+		MeshUploads uploads;
+		const auto sizes = Quantize(context.GetDevice(), uploads);
+		uploads.Record(context);
+		return sizes;
+	}
+
+	inline AccelerationStructure::BuildGeometries GetBLASGeometry(const Device& device, const bool opaque) const {
 		auto [positions, vertexLayout] = vertexAttributes.at(MeshVertexAttributeType::ePosition)[0];
 		const uint32_t vertexCount = (uint32_t)((positions.size_bytes() - vertexLayout.offset) / vertexLayout.stride);
-		const uint32_t primitiveCount = indexBuffer.size_bytes() / (indexSize * 3);
+		const uint32_t primitiveCount = RayTracingTriangleCount();
 
 		vk::AccelerationStructureGeometryTrianglesDataKHR triangles {
 			.vertexFormat = vertexLayout.format,
-			.vertexData = context.GetDevice()->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **positions.mBuffer }) + positions.mOffset,
+			.vertexData = device->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **positions.mBuffer }) + positions.mOffset,
 			.vertexStride = vertexLayout.stride,
 			.maxVertex = vertexCount,
 			.indexType = IndexType(),
-			.indexData = context.GetDevice()->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **indexBuffer.mBuffer }) + indexBuffer.mOffset };
+			.indexData = device->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **indexBuffer.mBuffer }) + indexBuffer.mOffset };
+		if (blasTransform)
+			triangles.transformData = device->getBufferAddress(vk::BufferDeviceAddressInfo{ .buffer = **blasTransform.mBuffer }) + blasTransform.mOffset;
 
 		vk::AccelerationStructureGeometryKHR geometry {
 			.geometryType = vk::GeometryTypeKHR::eTriangles,
 			.geometry = triangles,
 			.flags = opaque ? vk::GeometryFlagBitsKHR::eOpaque : vk::GeometryFlagBitsKHR{}};
 
-		vk::AccelerationStructureBuildRangeInfoKHR range{ .primitiveCount = primitiveCount };
-		blas = AccelerationStructure::Create(context, vk::AccelerationStructureTypeKHR::eBottomLevel, geometry, range);
+		return AccelerationStructure::BuildGeometries{
+			.geometries  = { geometry },
+			.buildRanges = { vk::AccelerationStructureBuildRangeInfoKHR{ .primitiveCount = primitiveCount } } };
+	}
+
+	// Builds this mesh's BLAS on its own, or refits it if the mesh is deformable.
+	// Scene::PrepareRenderData batches BLAS builds of rigid meshes instead.
+	inline void UpdateBLAS(CommandContext& context, const bool opaque) {
+		if (!NeedsBLASUpdate())
+			return;
+
+		const auto build = GetBLASGeometry(context.GetDevice(), opaque);
+
+		// positions may have been written by a copy or compute pass
+		context.AddBarrier(vertexAttributes.at(MeshVertexAttributeType::ePosition)[0].first, Buffer::ResourceState{
+			.stage = vk::PipelineStageFlagBits2::eAccelerationStructureBuildKHR,
+			.access = vk::AccessFlagBits2::eShaderRead,
+			.queueFamily = context.QueueFamily() });
+
+		if (deformable && blas && blas->AllowsUpdate() && blas->UpdateCount() < maxBLASUpdates)
+			blas->Update(context, build.geometries, build.buildRanges);
+		else
+			blas = AccelerationStructure::Create(context, vk::AccelerationStructureTypeKHR::eBottomLevel, build.geometries, build.buildRanges,
+				deformable ? vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate : vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
 		blasUpdateTime = context.GetDevice().NextTimelineSignal();
 	}
+
+	// Replaces the vertex positions (e.g. with the output of a skinning compute pass) and refits the BLAS.
+	// The new positions must have the same vertex count and layout, and the mesh must not be quantized.
+	// Meshes that are written in place only need lastUpdateTime bumped before the next UpdateBLAS.
+	inline void SetPositions(CommandContext& context, const BufferView& positions, const bool opaque) {
+		if (IsQuantized())
+			throw std::runtime_error("SetPositions requires 32-bit float positions, but the mesh is quantized");
+		vertexAttributes.at(MeshVertexAttributeType::ePosition)[0].first = positions;
+		lastUpdateTime = context.GetDevice().NextTimelineSignal();
+		if (blas) UpdateBLAS(context, opaque);
+	}
 };
 
 }
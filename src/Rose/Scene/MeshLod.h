@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Rose/Core/RoseEngine.h>
+
+namespace RoseEngine {
+
+// A level of detail of a mesh: a range of triangles in the mesh's index buffer
+struct MeshLod {
+	uint  firstTriangle;
+	uint  triangleCount;
+	float error; // approximate distance from the full resolution surface, in object space units
+};
+
+}
\ No newline at end of file
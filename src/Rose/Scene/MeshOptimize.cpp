@@ -0,0 +1,236 @@
+#include "MeshOptimize.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace RoseEngine {
+
+float ComputeACMR(const std::span<const uint32_t> indices, const uint32_t cacheSize) {
+	const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0 || cacheSize == 0)
+		return 0;
+
+	const uint32_t vertexCount = *std::ranges::max_element(indices) + 1;
+
+	// a vertex is cached if it was inserted within the last cacheSize insertions
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	for (const uint32_t v : indices.first(3*triangleCount)) {
+		if (time - insertedAt[v] > cacheSize) {
+			insertedAt[v] = time++;
+			misses++;
+		}
+	}
+	return float(misses) / triangleCount;
+}
+
+void OptimizeTriangleOrder(const std::span<uint32_t> indices, const std::byte* positions, const uint32_t positionStride, const uint32_t cacheSize, const float overdrawThreshold) {
+	const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	const uint32_t vertexCount = *std::ranges::max_element(indices.first(3*triangleCount)) + 1;
+
+	// triangles adjacent to each vertex
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<uint32_t> adjacency(3*triangleCount);
+	for (uint32_t i = 0; i < 3*triangleCount; i++)
+		adjacencyOffsets[indices[i] + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t i = 0; i < 3*triangleCount; i++)
+			adjacency[cursor[indices[i]]++] = i / 3;
+	}
+
+	// Tipsify: fan around a vertex, emitting all of its triangles, then move to the cached neighbor
+	// which will stay in the cache the longest, or to a dead-end vertex with triangles left
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	std::vector<bool>     emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> order;         // triangles in output order
+	std::vector<uint32_t> clusterStarts; // positions in order where the fan restarted far away, resetting the cache
+	order.reserve(triangleCount);
+
+	uint32_t time = cacheSize + 1;
+	uint32_t scan = 0; // next vertex to check once the dead-end stack runs out
+	uint32_t fan = 0;
+	clusterStarts.emplace_back(0);
+	while (true) {
+		candidates.clear();
+		for (uint32_t i = adjacencyOffsets[fan]; i < adjacencyOffsets[fan + 1]; i++) {
+			const uint32_t t = adjacency[i];
+			if (emitted[t]) continue;
+			emitted[t] = true;
+			order.emplace_back(t);
+			for (uint32_t j = 0; j < 3; j++) {
+				const uint32_t v = indices[3*t + j];
+				deadEnds.emplace_back(v);
+				candidates.emplace_back(v);
+				liveTriangles[v]--;
+				if (time - cachedAt[v] > cacheSize)
+					cachedAt[v] = time++;
+			}
+		}
+
+		// the candidate that stays cached the longest, if its remaining triangles fit in the cache
+		uint32_t next = ~0u;
+		int32_t bestPriority = -1;
+		for (const uint32_t v : candidates) {
+			if (liveTriangles[v] == 0) continue;
+			int32_t priority = 0;
+			if (time - cachedAt[v] + 2*liveTriangles[v] <= cacheSize)
+				priority = (int32_t)(time - cachedAt[v]);
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		if (next == ~0u) {
+			while (!deadEnds.empty()) {
+				const uint32_t v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0) {
+					next = v;
+					break;
+				}
+			}
+		}
+		if (next == ~0u) {
+			while (scan < vertexCount && liveTriangles[scan] == 0)
+				scan++;
+			if (scan == vertexCount)
+				break;
+			next = scan;
+			// the first fans may emit nothing (e.g. vertex 0 has no triangles), which would start an empty cluster
+			if (order.size() < triangleCount && clusterStarts.back() != order.size())
+				clusterStarts.emplace_back((uint32_t)order.size());
+		}
+		fan = next;
+	}
+
+	// split clusters further where the misses so far are close to the cluster's ACMR,
+	// so that reordering them costs little in cache efficiency
+	if (overdrawThreshold > 0) {
+		std::vector<uint32_t> splitStarts;
+		std::vector<uint32_t> insertedAt(vertexCount, 0);
+		uint32_t cacheTime = cacheSize + 1;
+		auto miss = [&](const uint32_t v) {
+			if (cacheTime - insertedAt[v] > cacheSize) {
+				insertedAt[v] = cacheTime++;
+				return 1u;
+			}
+			return 0u;
+		};
+		auto resetCache = [&]() { cacheTime += cacheSize + 1; };
+
+		clusterStarts.emplace_back(triangleCount);
+		for (uint32_t c = 0; c + 1 < clusterStarts.size(); c++) {
+			const uint32_t start = clusterStarts[c];
+			const uint32_t end   = clusterStarts[c + 1];
+
+			resetCache();
+			uint32_t clusterMisses = 0;
+			for (uint32_t i = start; i < end; i++)
+				for (uint32_t j = 0; j < 3; j++)
+					clusterMisses += miss(indices[3*order[i] + j]);
+			const float clusterACMR = float(clusterMisses) / (end - start);
+
+			resetCache();
+			splitStarts.emplace_back(start);
+			uint32_t splitStart = start;
+			uint32_t misses = 0;
+			for (uint32_t i = start; i < end; i++) {
+				for (uint32_t j = 0; j < 3; j++)
+					misses += miss(indices[3*order[i] + j]);
+				if (i + 1 < end && float(misses) / (i + 1 - splitStart) <= clusterACMR * overdrawThreshold) {
+					splitStart = i + 1;
+					splitStarts.emplace_back(splitStart);
+					misses = 0;
+					resetCache();
+				}
+			}
+		}
+		splitStarts.emplace_back(triangleCount);
+
+		auto position = [&](const uint32_t v) -> float3 {
+			return *reinterpret_cast<const float3*>(positions + size_t(v) * positionStride);
+		};
+
+		// area weighted centroids and normals
+		const uint32_t clusterCount = (uint32_t)splitStarts.size() - 1;
+		std::vector<float3> centroids(clusterCount, float3(0));
+		std::vector<float3> normals(clusterCount, float3(0));
+		float3 meshCentroid = float3(0);
+		float  meshArea = 0;
+		for (uint32_t c = 0; c < clusterCount; c++) {
+			float area = 0;
+			for (uint32_t i = splitStarts[c]; i < splitStarts[c + 1]; i++) {
+				const uint32_t* tri = &indices[3*order[i]];
+				const float3 p0 = position(tri[0]);
+				const float3 p1 = position(tri[1]);
+				const float3 p2 = position(tri[2]);
+				const float3 n = cross(p1 - p0, p2 - p0);
+				const float a = length(n);
+				centroids[c] += (p0 + p1 + p2) * (a / 3);
+				normals[c] += n;
+				area += a;
+			}
+			meshCentroid += centroids[c];
+			meshArea += area;
+			centroids[c] = area > 0 ? centroids[c] / area : position(indices[3*order[splitStarts[c]]]);
+			const float l = length(normals[c]);
+			normals[c] = l > 0 ? normals[c] / l : float3(0);
+		}
+		if (meshArea > 0) meshCentroid /= meshArea;
+
+		// clusters facing away from the center are likely in front of the others
+		std::vector<float> sortKeys(clusterCount);
+		for (uint32_t c = 0; c < clusterCount; c++)
+			sortKeys[c] = dot(centroids[c] - meshCentroid, normals[c]);
+		std::vector<uint32_t> clusterOrder(clusterCount);
+		std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+		std::ranges::stable_sort(clusterOrder, [&](const uint32_t a, const uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(triangleCount);
+		for (const uint32_t c : clusterOrder)
+			sorted.insert(sorted.end(), order.begin() + splitStarts[c], order.begin() + splitStarts[c + 1]);
+		order = std::move(sorted);
+	}
+
+	std::vector<uint32_t> result(3*triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+		for (uint32_t j = 0; j < 3; j++)
+			result[3*i + j] = indices[3*order[i] + j];
+	std::ranges::copy(result, indices.begin());
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(const std::span<uint32_t> indices) {
+	if (indices.empty())
+		return {};
+
+	const uint32_t vertexCount = *std::ranges::max_element(indices) + 1;
+	std::vector<uint32_t> newIndices(vertexCount, ~0u);
+	std::vector<uint32_t> oldIndices;
+	for (uint32_t& index : indices) {
+		uint32_t& n = newIndices[index];
+		if (n == ~0u) {
+			n = (uint32_t)oldIndices.size();
+			oldIndices.emplace_back(index);
+		}
+		index = n;
+	}
+	return oldIndices;
+}
+
+}
\ No newline at end of file
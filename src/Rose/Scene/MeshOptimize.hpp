@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <Rose/Core/MathTypes.hpp>
+
+namespace RoseEngine {
+
+// Average post-transform vertex cache misses per triangle (ACMR), simulating a FIFO cache of cacheSize vertices
+float ComputeACMR(const std::span<const uint32_t> indices, const uint32_t cacheSize = 16);
+
+// Reorders the triangles of an indexed triangle list for the post-transform vertex cache with Tipsify
+// (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"), then splits the order
+// into clusters wherever the cache misses stay within overdrawThreshold of the cluster's ACMR, and sorts the
+// clusters to draw outward facing ones first. Triangle winding is preserved. overdrawThreshold = 0 skips the overdraw step.
+void OptimizeTriangleOrder(
+	const std::span<uint32_t> indices,
+	const std::byte* positions,
+	const uint32_t positionStride,
+	const uint32_t cacheSize = 16,
+	const float overdrawThreshold = 1.05f);
+
+// Renumbers vertices in order of first use, so that vertex fetches walk the vertex buffers linearly.
+// Rewrites indices, and returns the old index of each new vertex. Unused vertices are dropped.
+std::vector<uint32_t> OptimizeVertexFetch(const std::span<uint32_t> indices);
+
+}
\ No newline at end of file
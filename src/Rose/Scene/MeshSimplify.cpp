@@ -0,0 +1,279 @@
+#include "MeshSimplify.hpp"
+
+#include <algorithm>
+#include <queue>
+
+namespace RoseEngine {
+
+namespace {
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+	double a2 = 0, ab = 0, ac = 0, ad = 0;
+	double b2 = 0, bc = 0, bd = 0;
+	double c2 = 0, cd = 0;
+	double d2 = 0;
+
+	inline static Quadric FromPlane(const double a, const double b, const double c, const double d) {
+		return Quadric{ a*a, a*b, a*c, a*d, b*b, b*c, b*d, c*c, c*d, d*d };
+	}
+
+	inline Quadric& operator+=(const Quadric& q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		return *this;
+	}
+	inline Quadric operator+(const Quadric& q) const { Quadric r = *this; return r += q; }
+
+	inline double Evaluate(const float3 p) const {
+		const double x = p.x, y = p.y, z = p.z;
+		return a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+		     + b2*y*y + 2*bc*y*z + 2*bd*y
+		     + c2*z*z + 2*cd*z
+		     + d2;
+	}
+};
+
+struct Collapse {
+	float    cost;
+	uint32_t from;
+	uint32_t to;
+	uint32_t fromVersion;
+	uint32_t toVersion;
+	inline bool operator>(const Collapse& rhs) const { return cost > rhs.cost; }
+};
+
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::span<const uint32_t> indices, const std::byte* positions, const uint32_t positionStride, const uint32_t targetTriangleCount, float& error) {
+	error = 0;
+
+	std::vector<uint32_t> triangles(indices.begin(), indices.end());
+	const uint32_t triangleCount = (uint32_t)(triangles.size() / 3);
+	if (triangleCount <= targetTriangleCount)
+		return triangles;
+
+	const uint32_t vertexCount = *std::ranges::max_element(triangles) + 1;
+
+	auto position = [&](const uint32_t v) -> float3 {
+		return *reinterpret_cast<const float3*>(positions + size_t(v) * positionStride);
+	};
+
+	// lock vertices on edges which don't have exactly two triangles
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(triangles.size());
+		for (uint32_t t = 0; t < triangleCount; t++)
+			for (uint32_t j = 0; j < 3; j++) {
+				const uint32_t a = triangles[3*t + j];
+				const uint32_t b = triangles[3*t + (j + 1) % 3];
+				edges.emplace_back((uint64_t(std::min(a, b)) << 32) | std::max(a, b));
+			}
+		std::ranges::sort(edges);
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j] == edges[i]) j++;
+			if (j - i != 2) {
+				locked[uint32_t(edges[i] >> 32)] = true;
+				locked[uint32_t(edges[i])] = true;
+			}
+			i = j;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+	std::vector<bool> alive(triangleCount, true);
+	uint32_t aliveCount = triangleCount;
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const uint32_t* tri = &triangles[3*t];
+		for (uint32_t j = 0; j < 3; j++)
+			vertexTriangles[tri[j]].emplace_back(t);
+
+		const float3 p0 = position(tri[0]);
+		const float3 n = cross(position(tri[1]) - p0, position(tri[2]) - p0);
+		const float l = length(n);
+		if (!(l > 0))
+			continue;
+		const float3 normal = n / l;
+		const Quadric q = Quadric::FromPlane(normal.x, normal.y, normal.z, -dot(normal, p0));
+		for (uint32_t j = 0; j < 3; j++)
+			quadrics[tri[j]] += q;
+	}
+
+	std::vector<bool>     collapsed(vertexCount, false);
+	std::vector<uint32_t> versions(vertexCount, 0);
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	// queues the cheaper direction of an edge
+	auto pushEdge = [&](const uint32_t a, const uint32_t b) {
+		if (locked[a] && locked[b])
+			return;
+		const Quadric q = quadrics[a] + quadrics[b];
+		const double costAB = locked[a] ? INFINITY : q.Evaluate(position(b));
+		const double costBA = locked[b] ? INFINITY : q.Evaluate(position(a));
+		if (costAB <= costBA)
+			queue.push(Collapse{ (float)std::max(costAB, 0.0), a, b, versions[a], versions[b] });
+		else
+			queue.push(Collapse{ (float)std::max(costBA, 0.0), b, a, versions[b], versions[a] });
+	};
+
+	for (uint32_t t = 0; t < triangleCount; t++)
+		for (uint32_t j = 0; j < 3; j++)
+			pushEdge(triangles[3*t + j], triangles[3*t + (j + 1) % 3]);
+
+	auto neighbors = [&](const uint32_t v, std::vector<uint32_t>& result) {
+		result.clear();
+		for (const uint32_t t : vertexTriangles[v]) {
+			if (!alive[t]) continue;
+			for (uint32_t j = 0; j < 3; j++)
+				if (triangles[3*t + j] != v)
+					result.emplace_back(triangles[3*t + j]);
+		}
+		std::ranges::sort(result);
+		result.erase(std::ranges::unique(result).begin(), result.end());
+	};
+
+	std::vector<uint32_t> neighborsA, neighborsB;
+	double maxCost = 0;
+
+	while (aliveCount > targetTriangleCount && !queue.empty()) {
+		const Collapse c = queue.top();
+		queue.pop();
+
+		const uint32_t a = c.from;
+		const uint32_t b = c.to;
+		if (collapsed[a] || collapsed[b] || versions[a] != c.fromVersion || versions[b] != c.toVersion)
+			continue;
+
+		// the edge may have been removed by an earlier collapse
+		uint32_t sharedTriangles = 0;
+		for (const uint32_t t : vertexTriangles[a]) {
+			if (!alive[t]) continue;
+			const uint32_t* tri = &triangles[3*t];
+			if (tri[0] == b || tri[1] == b || tri[2] == b)
+				sharedTriangles++;
+		}
+		if (sharedTriangles == 0)
+			continue;
+
+		// link condition: a and b may only share the vertices opposite of their shared triangles
+		neighbors(a, neighborsA);
+		neighbors(b, neighborsB);
+		uint32_t sharedNeighbors = 0;
+		for (size_t i = 0, j = 0; i < neighborsA.size() && j < neighborsB.size();) {
+			if (neighborsA[i] < neighborsB[j]) i++;
+			else if (neighborsA[i] > neighborsB[j]) j++;
+			else { sharedNeighbors++; i++; j++; }
+		}
+		if (sharedNeighbors != sharedTriangles)
+			continue;
+
+		// reject collapses which flip or degenerate the triangles that move
+		const float3 pb = position(b);
+		bool valid = true;
+		for (const uint32_t t : vertexTriangles[a]) {
+			if (!alive[t]) continue;
+			const uint32_t* tri = &triangles[3*t];
+			if (tri[0] == b || tri[1] == b || tri[2] == b)
+				continue;
+			float3 p[3];
+			for (uint32_t j = 0; j < 3; j++)
+				p[j] = position(tri[j]);
+			const float3 before = cross(p[1] - p[0], p[2] - p[0]);
+			for (uint32_t j = 0; j < 3; j++)
+				if (tri[j] == a) p[j] = pb;
+			const float3 after = cross(p[1] - p[0], p[2] - p[0]);
+			if (dot(before, after) <= 0.2f * length(before) * length(after)) {
+				valid = false;
+				break;
+			}
+		}
+		if (!valid)
+			continue;
+
+		// collapse a onto b
+		std::vector<uint32_t>& trianglesB = vertexTriangles[b];
+		for (const uint32_t t : vertexTriangles[a]) {
+			if (!alive[t]) continue;
+			uint32_t* tri = &triangles[3*t];
+			if (tri[0] == b || tri[1] == b || tri[2] == b) {
+				alive[t] = false;
+				aliveCount--;
+				continue;
+			}
+			for (uint32_t j = 0; j < 3; j++)
+				if (tri[j] == a) tri[j] = b;
+			trianglesB.emplace_back(t);
+		}
+		std::erase_if(trianglesB, [&](const uint32_t t) { return !alive[t]; });
+		vertexTriangles[a].clear();
+		vertexTriangles[a].shrink_to_fit();
+
+		collapsed[a] = true;
+		quadrics[b] += quadrics[a];
+		versions[b]++;
+		maxCost = std::max(maxCost, (double)c.cost);
+
+		neighbors(b, neighborsB);
+		for (const uint32_t n : neighborsB)
+			pushEdge(b, n);
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(aliveCount * 3);
+	for (uint32_t t = 0; t < triangleCount; t++)
+		if (alive[t])
+			result.insert(result.end(), &triangles[3*t], &triangles[3*t] + 3);
+
+	error = (float)std::sqrt(maxCost);
+	return result;
+}
+
+MeshLodChain MeshLodChain::Build(const std::span<const std::byte> indices, const uint32_t indexSize, const std::byte* positions, const uint32_t positionStride, const uint32_t maxLodCount, const uint32_t minTriangleCount) {
+	MeshLodChain chain = {};
+
+	chain.indices.resize(indices.size() / indexSize);
+	for (size_t i = 0; i < chain.indices.size(); i++) {
+		if (indexSize == sizeof(uint16_t))
+			chain.indices[i] = reinterpret_cast<const uint16_t*>(indices.data())[i];
+		else
+			chain.indices[i] = reinterpret_cast<const uint32_t*>(indices.data())[i];
+	}
+	chain.indices.resize(chain.indices.size() - chain.indices.size() % 3);
+
+	chain.lods.emplace_back(MeshLod{ .firstTriangle = 0, .triangleCount = (uint32_t)chain.indices.size()/3, .error = 0 });
+
+	while (chain.lods.size() < maxLodCount) {
+		const MeshLod& prev = chain.lods.back();
+		if (prev.triangleCount / 2 < minTriangleCount)
+			break;
+
+		float error;
+		const std::vector<uint32_t> simplified = SimplifyMesh(
+			std::span{ chain.indices }.subspan(3*prev.firstTriangle, 3*prev.triangleCount),
+			positions, positionStride,
+			prev.triangleCount / 2,
+			error);
+
+		const uint32_t triangleCount = (uint32_t)simplified.size()/3;
+		if (triangleCount > prev.triangleCount - prev.triangleCount / 10)
+			break;
+
+		// errors of successive simplifications add up
+		const MeshLod lod = MeshLod{
+			.firstTriangle = (uint32_t)chain.indices.size()/3,
+			.triangleCount = triangleCount,
+			.error         = prev.error + error };
+		chain.indices.insert(chain.indices.end(), simplified.begin(), simplified.end());
+		chain.lods.emplace_back(lod);
+	}
+
+	return chain;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <Rose/Core/MathTypes.hpp>
+#include "MeshLod.h"
+
+namespace RoseEngine {
+
+// Reduces an indexed triangle list to at most targetTriangleCount triangles (if possible) by collapsing edges
+// in order of quadric error (Garland and Heckbert). Vertices are collapsed onto other vertices, so the result
+// indexes the same vertex buffer. Vertices on open or non-manifold edges, including attribute seams where
+// vertices are split, are never moved. Collapses which flip triangles or pinch the surface are skipped.
+// error is set to the square root of the largest quadric error of any collapse.
+std::vector<uint32_t> SimplifyMesh(
+	const std::span<const uint32_t> indices,
+	const std::byte* positions,
+	const uint32_t positionStride,
+	const uint32_t targetTriangleCount,
+	float& error);
+
+// Levels of detail of an indexed triangle list, each simplified from the previous one to half of its triangles
+struct MeshLodChain {
+	std::vector<uint32_t> indices = {}; // every level, concatenated
+	std::vector<MeshLod>  lods = {};    // from full resolution (lods[0], the input triangles) to coarsest
+
+	// Levels stop once they fail to shrink by at least 10%, or reach minTriangleCount. indexSize is 2 or 4.
+	static MeshLodChain Build(
+		const std::span<const std::byte> indices,
+		const uint32_t indexSize,
+		const std::byte* positions,
+		const uint32_t positionStride,
+		const uint32_t maxLodCount = 8,
+		const uint32_t minTriangleCount = 64);
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "Meshlets.hpp"
+
+#include <algorithm>
+
+namespace RoseEngine {
+
+MeshletSet MeshletSet::Build(const std::span<const std::byte> indices, const uint32_t indexSize, const std::byte* positions, const uint32_t positionStride, const uint32_t maxVertices, const uint32_t maxTriangles) {
+	MeshletSet set = {};
+
+	const uint32_t triangleCount = (uint32_t)(indices.size() / (3*indexSize));
+	if (triangleCount == 0)
+		return set;
+
+	std::vector<uint32_t> triangleIndices(3*triangleCount);
+	for (size_t i = 0; i < triangleIndices.size(); i++) {
+		if (indexSize == sizeof(uint16_t))
+			triangleIndices[i] = reinterpret_cast<const uint16_t*>(indices.data())[i];
+		else
+			triangleIndices[i] = reinterpret_cast<const uint32_t*>(indices.data())[i];
+	}
+	const uint32_t vertexCount = *std::ranges::max_element(triangleIndices) + 1;
+
+	auto loadPosition = [&](const uint32_t v) -> float3 {
+		return *reinterpret_cast<const float3*>(positions + size_t(v) * positionStride);
+	};
+
+	// triangles adjacent to each vertex
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<uint32_t> adjacency(triangleIndices.size());
+	for (const uint32_t v : triangleIndices)
+		adjacencyOffsets[v + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t i = 0; i < triangleIndices.size(); i++)
+			adjacency[cursor[triangleIndices[i]]++] = i / 3;
+	}
+
+	std::vector<bool>     emitted(triangleCount, false);
+	std::vector<uint32_t> localIndices(vertexCount, ~0u); // index of each vertex in the current meshlet
+
+	auto newVertexCount = [&](const uint32_t t) {
+		uint32_t n = 0;
+		for (uint32_t j = 0; j < 3; j++)
+			if (localIndices[triangleIndices[3*t + j]] == ~0u) n++;
+		return n;
+	};
+
+	Meshlet current = {};
+
+	auto finishMeshlet = [&]() {
+		if (current.triangleCount == 0)
+			return;
+
+		// bounding sphere around the center of the meshlet's bounding box
+		float3 aabbMin = float3( std::numeric_limits<float>::infinity());
+		float3 aabbMax = float3(-std::numeric_limits<float>::infinity());
+		for (uint32_t i = 0; i < current.vertexCount; i++) {
+			const float3 p = loadPosition(set.vertices[current.vertexOffset + i]);
+			aabbMin = min(aabbMin, p);
+			aabbMax = max(aabbMax, p);
+		}
+		current.center = (aabbMin + aabbMax) * 0.5f;
+		current.radius = 0;
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			current.radius = std::max(current.radius, length(loadPosition(set.vertices[current.vertexOffset + i]) - current.center));
+
+		// normal cone, as in meshoptimizer's meshopt_computeMeshletBounds
+		std::vector<float3> normals;
+		normals.reserve(current.triangleCount);
+		float3 axis = float3(0);
+		for (uint32_t i = 0; i < current.triangleCount; i++) {
+			const uint32_t t = set.triangles[current.triangleOffset + i].y;
+			const float3 p0 = loadPosition(triangleIndices[3*t + 0]);
+			const float3 n = cross(loadPosition(triangleIndices[3*t + 1]) - p0, loadPosition(triangleIndices[3*t + 2]) - p0);
+			const float l = length(n);
+			if (l > 0) {
+				normals.emplace_back(n / l);
+				axis += n / l;
+			}
+		}
+		float minDot = 1;
+		if (length(axis) > 0) {
+			axis = normalize(axis);
+			for (const float3& n : normals)
+				minDot = std::min(minDot, dot(axis, n));
+		} else
+			minDot = -1;
+
+		if (minDot <= 0.1f) {
+			current.coneAxis = float3(0);
+			current.coneCutoff = 1;
+		} else {
+			current.coneAxis = axis;
+			current.coneCutoff = std::sqrt(1 - minDot*minDot);
+		}
+
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			localIndices[set.vertices[current.vertexOffset + i]] = ~0u;
+
+		set.meshlets.emplace_back(current);
+		current = Meshlet{
+			.vertexOffset   = (uint32_t)set.vertices.size(),
+			.triangleOffset = (uint32_t)set.triangles.size() };
+	};
+
+	uint32_t seed = 0; // first triangle which may not have been emitted yet
+	uint32_t last = ~0u; // triangle added last
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		// prefer unemitted triangles sharing vertices with the last triangle, then with any vertex of the meshlet,
+		// which need the fewest new vertices
+		uint32_t best = ~0u;
+		uint32_t bestNew = 4;
+		auto consider = [&](const uint32_t v) {
+			for (uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; i++) {
+				const uint32_t t = adjacency[i];
+				if (emitted[t]) continue;
+				const uint32_t n = newVertexCount(t);
+				if (n < bestNew || (n == bestNew && t < best)) {
+					best = t;
+					bestNew = n;
+				}
+			}
+		};
+		if (last != ~0u)
+			for (uint32_t j = 0; j < 3; j++)
+				consider(triangleIndices[3*last + j]);
+		if (best == ~0u)
+			for (uint32_t i = 0; i < current.vertexCount; i++)
+				consider(set.vertices[current.vertexOffset + i]);
+		if (best == ~0u) {
+			while (emitted[seed]) seed++;
+			best = seed;
+			bestNew = newVertexCount(best);
+		}
+
+		if (current.vertexCount + bestNew > maxVertices || current.triangleCount + 1 > maxTriangles)
+			finishMeshlet();
+
+		uint32_t packed = 0;
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t& local = localIndices[triangleIndices[3*best + j]];
+			if (local == ~0u) {
+				local = current.vertexCount++;
+				set.vertices.emplace_back(triangleIndices[3*best + j]);
+			}
+			packed |= local << (8*j);
+		}
+		set.triangles.emplace_back(uint2(packed, best));
+		current.triangleCount++;
+		emitted[best] = true;
+		last = best;
+	}
+	finishMeshlet();
+
+	return set;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Rose/Core/RoseEngine.h>
+
+// Limits of meshlets built by MeshletSet::Build, and of the mesh shader outputs in Visibility.3d.slang
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+namespace RoseEngine {
+
+struct Meshlet {
+	float3 center; // bounding sphere
+	float  radius;
+	// Normal cone. Every triangle is backfacing from a point p if
+	// dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius.
+	// Meshlets with too wide a cone have coneAxis = 0 and coneCutoff = 1, which never passes.
+	float3 coneAxis;
+	float  coneCutoff;
+	uint   vertexOffset; // into the meshlet vertices
+	uint   triangleOffset; // into the meshlet triangles
+	uint   vertexCount;
+	uint   triangleCount;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <Rose/Core/MathTypes.hpp>
+#include "Meshlets.h"
+
+namespace RoseEngine {
+
+// Clusters of up to MESHLET_MAX_TRIANGLES triangles referencing up to MESHLET_MAX_VERTICES vertices,
+// drawn by the mesh shader path in Visibility.3d.slang.
+struct MeshletSet {
+	std::vector<Meshlet>  meshlets = {};
+	std::vector<uint32_t> vertices = {}; // mesh vertex index of each meshlet vertex
+	std::vector<uint2>    triangles = {}; // x: three 8 bit meshlet vertex indices, y: index of the triangle in the mesh
+
+	inline bool empty() const { return meshlets.empty(); }
+
+	// Greedily grows meshlets along shared vertices of an indexed triangle list. indexSize is 2 or 4.
+	static MeshletSet Build(
+		const std::span<const std::byte> indices,
+		const uint32_t indexSize,
+		const std::byte* positions,
+		const uint32_t positionStride,
+		const uint32_t maxVertices = MESHLET_MAX_VERTICES,
+		const uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+};
+
+}
\ No newline at end of file
@@ -9,24 +9,41 @@ namespace RoseEngine {
 
 void Scene::Load(CommandContext& context, const std::filesystem::path& p) {
 	if (p.extension() == ".gltf" || p.extension() == ".glb") {
-		const ref<SceneNode> s = LoadGLTF(context, p);
-		if (!s) return;
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		uint32_t cacheOptions = quantizeVertices ? SceneCache::eQuantizeVertices : SceneCache::eNone;
+		if (textureCompression != TextureCompression::eNone)
+			cacheOptions |= textureCompression == TextureCompression::eHighQuality ? SceneCache::eCompressTexturesHighQuality : SceneCache::eCompressTextures;
+
+		// virtual textures keep their texels on the host, which the scene cache can't record
+		const bool cacheScene = useSceneCache && !useVirtualTextures;
+
+		ref<SceneNode> s = {};
+		if (cacheScene) {
+			try {
+				s = SceneCache::Load(context, p, cacheOptions);
+			} catch (const std::exception& e) {
+				std::cerr << "Failed to load scene cache for " << p << ": " << e.what() << std::endl;
+			}
+		}
+		const bool cached = s != nullptr;
+		// the virtual images of the current scene are dropped with it
+		virtualTextures.Clear(context);
+		if (!s) {
+			std::vector<std::filesystem::path> externalFiles;
+			s = LoadGLTF(context, p, quantizeVertices, importThreadCount, textureCompression, &mipGenerator, useVirtualTextures ? &virtualTextures : nullptr, &externalFiles);
+			if (!s) return;
+			if (cacheScene)
+				pendingSceneCaches.emplace_back(SceneCache::Record(context, s, p, cacheOptions, externalFiles));
+		}
+
+		const float seconds = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::high_resolution_clock::now() - t0).count();
+		std::cout << "Loaded " << p.filename() << " in " << seconds << "s (" << (cached ? "warm, from scene cache" : "cold, from glTF") << ")" << std::endl;
+
 		sceneRoot = s;
 		SetDirty();
 	} else {
-		const PixelData d = LoadImageFile(context, p);
-		if (!d.data) return;
-		const ImageView img = ImageView::Create(
-			Image::Create(context.GetDevice(), ImageInfo{
-				.format = d.format,
-				.extent = d.extent,
-				.queueFamilies = { context.QueueFamily() } }));
-		if (!img) return;
-		context.Copy(d.data, img);
-		context.GenerateMipMaps(img.mImage);
-		backgroundImage = img;
-		backgroundColor = float3(1);
-		SetDirty();
+		// the current background stays until the new one is uploaded in PreRender
+		pendingBackground = imageLoader.Load(context, p);
 	}
 }
 
@@ -41,15 +58,259 @@ void Scene::LoadDialog(CommandContext& context) {
 	}
 }
 
+void Scene::WriteSceneCaches(const Device& device) {
+	// hand ready caches to the writer thread, which owns them (and their host copies) until the file is written
+	for (auto it = pendingSceneCaches.begin(); it != pendingSceneCaches.end();) {
+		if (!it->IsReady(device)) {
+			it++;
+			continue;
+		}
+		const std::filesystem::path path = SceneCache::GetPath(it->Source());
+		sceneCacheWrites.emplace_back(path, sceneCacheWriter.Push([cache = std::move(*it)]() { return cache.Write(); }));
+		it = pendingSceneCaches.erase(it);
+	}
+
+	std::erase_if(sceneCacheWrites, [&](auto& write) {
+		auto&[path, size] = write;
+		if (size.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+		try {
+			std::cout << "Wrote " << path << " (" << (size.get() >> 20) << "MiB)" << std::endl;
+		} catch (const std::exception& e) {
+			std::cerr << "Failed to write scene cache " << path << ": " << e.what() << std::endl;
+		}
+		return true;
+	});
+}
+
+void Scene::RegisterResidency(Device& device) {
+	residency = device.Residency().Register({
+		.name = "Scene textures",
+		.priority = 0.75f,
+		.size  = [this]() {
+			vk::DeviceSize bytes = 0;
+			for (const ImageView& img : DroppableTextures())
+				bytes += img.mImage->MemorySize() * 3 / 4; // the top mip
+			return bytes;
+		},
+		.evict = [this](CommandContext& context, const vk::DeviceSize bytes) { return DropTopMips(context, bytes); } });
+}
+
+// Textures in materials, other than the tails of virtual textures, which are larger than minTextureSize
+std::vector<ImageView> Scene::DroppableTextures(const uint32_t minTextureSize) const {
+	std::vector<ImageView> textures;
+	if (!sceneRoot) return textures;
+	for (const auto&[img, idx] : imageMap) {
+		if (img == backgroundImage || virtualTextures.Find(*img.mImage)) continue;
+		const ImageInfo& info = img.mImage->Info();
+		if (info.mipLevels > 1 && (info.usage & vk::ImageUsageFlagBits::eTransferSrc) && std::max(info.extent.x, info.extent.y) > minTextureSize)
+			textures.emplace_back(img);
+	}
+	return textures;
+}
+
+vk::DeviceSize Scene::DropTopMips(CommandContext& context, const vk::DeviceSize bytes, const uint32_t minTextureSize) {
+	std::vector<ImageView> textures = DroppableTextures(minTextureSize);
+	std::ranges::sort(textures, std::greater{}, [](const ImageView& v) { return v.mImage->MemorySize(); });
+
+	std::unordered_map<vk::ImageView, ImageView> replaced;
+	vk::DeviceSize freed = 0;
+	for (const ImageView& src : textures) {
+		if (freed >= bytes) break;
+
+		ImageInfo info = src.mImage->Info();
+		info.extent = GetLevelExtent(info.extent, 1);
+		info.mipLevels--;
+		const ref<Image> image = Image::Create(context.GetDevice(), info, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+		if (!image) break;
+		context.GetDevice().SetDebugName(**image, "Downgraded texture");
+
+		std::vector<vk::ImageCopy> regions;
+		for (uint32_t level = 0; level < info.mipLevels; level++) {
+			const uint3 e = GetLevelExtent(info.extent, level);
+			regions.emplace_back(vk::ImageCopy{
+				.srcSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level + 1, 0, info.arrayLayers },
+				.dstSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level,     0, info.arrayLayers },
+				.extent = vk::Extent3D{ e.x, e.y, e.z } });
+		}
+		context.Copy(src.mImage, image, regions);
+
+		replaced.emplace(*src, ImageView::Create(image, vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, info.mipLevels, 0, info.arrayLayers }, src.mType, src.mComponentMapping));
+		retiredImages.push(src.mImage, context.GetDevice().NextTimelineSignal());
+		freed += src.mImage->MemorySize() - std::min(src.mImage->MemorySize(), image->MemorySize());
+	}
+	if (replaced.empty())
+		return 0;
+
+	// point materials at the new textures
+	std::unordered_set<Material<ImageView>*> visited;
+	std::stack<SceneNode*> todo;
+	todo.push(sceneRoot.get());
+	while (!todo.empty()) {
+		SceneNode* n = todo.top();
+		todo.pop();
+		if (n->material && visited.emplace(n->material.get()).second) {
+			for (ImageView* img : { &n->material->baseColorImage, &n->material->emissionImage, &n->material->metallicRoughness, &n->material->bumpMap })
+				if (const auto it = replaced.find(**img); *img && it != replaced.end())
+					*img = it->second;
+		}
+		for (const ref<SceneNode>& c : *n)
+			todo.push(c.get());
+	}
+	SetDirty();
+
+	return freed;
+}
+
+template<typename T>
+BufferRange<T> Scene::UploadPersistent(CommandContext& context, BufferRange<T>& buffer, const std::vector<T>& data, const vk::BufferUsageFlags usage) {
+	while (retiredBuffers.can_pop(context.GetDevice()))
+		retiredBuffers.pop();
+
+	if (!buffer || buffer.size() < data.size()) {
+		if (buffer)
+			retiredBuffers.push(buffer, context.GetDevice().NextTimelineSignal());
+		// leave room to grow
+		buffer = Buffer::Create(
+			context.GetDevice(),
+			sizeof(T) * (data.size() + data.size()/2),
+			usage | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
+			0.5f,
+			MemoryPool::eScene);
+	}
+
+	context.Copy(context.UploadData(data), buffer);
+	return buffer.slice(0, data.size());
+}
+
+bool Scene::UpdateDirtyNodes(CommandContext& context) {
+	const bool useAccelerationStructure = context.GetDevice().SupportsRayQuery();
+
+	std::vector<SceneNode*> visited;
+	std::vector<uint32_t>   dirtyInstances;
+	std::vector<uint32_t>   dirtyMaterials;
+
+	// only descend into dirty subtrees, or into every child below a node whose transform changed
+	std::stack<std::tuple<SceneNode*, Transform, bool/*transform changed*/>> todo;
+	todo.push({sceneRoot.get(), Transform::Identity(), false});
+	while (!todo.empty()) {
+		auto [n, t, transformChanged] = todo.top();
+		todo.pop();
+
+		if (n->IsDirty(SceneNodeDirtyFlags::eStructure))
+			return false;
+
+		visited.emplace_back(n);
+		transformChanged |= n->IsDirty(SceneNodeDirtyFlags::eTransform);
+
+		if (transformChanged) {
+			const uint32_t hierarchyIndex = hierarchy.Find(n);
+			if (hierarchyIndex == TransformHierarchy::kInvalidIndex)
+				return false;
+			if (n != sceneRoot.get())
+				hierarchy.localTransforms[hierarchyIndex] = n->transform.value_or(Transform::Identity());
+			hierarchy.worldTransforms[hierarchyIndex] = t;
+		}
+
+		if (n->mesh && n->material) {
+			if (transformChanged) {
+				const auto it = instanceSlots.find(n);
+				if (it == instanceSlots.end())
+					return false;
+				transforms[it->second] = t;
+				dirtyInstances.emplace_back(it->second);
+			}
+
+			if (n->IsDirty(SceneNodeDirtyFlags::eMaterial)) {
+				const auto it = materialMap.find(n->material.get());
+				if (it == materialMap.end())
+					return false;
+
+				// changes to flags, emission or textures affect pipelines, draw lists or light sampling
+				const Material<uint32_t>& prev = materials[it->second];
+				const size_t imageCount = imageMap.size();
+				const Material<uint32_t> packed = PackMaterial(*n->material, imageMap);
+				const bool wasEmissive = any(glm::greaterThan(prev.GetEmission(),   float3(0.f)));
+				const bool isEmissive  = any(glm::greaterThan(packed.GetEmission(), float3(0.f)));
+				if (imageMap.size() != imageCount || packed.GetFlags() != prev.GetFlags() || wasEmissive != isEmissive)
+					return false;
+
+				materials[it->second] = packed;
+				dirtyMaterials.emplace_back((uint32_t)it->second);
+			}
+		}
+
+		for (const ref<SceneNode>& c : *n) {
+			if (transformChanged || c->IsDirty())
+				todo.push({c.get(), c->transform.has_value() ? t * c->transform.value() : t, transformChanged});
+		}
+	}
+
+	// the software ray tracing instance BVH is rebuilt from scratch
+	if (!useAccelerationStructure && !dirtyInstances.empty())
+		return false;
+
+	for (SceneNode* n : visited)
+		n->ClearDirty();
+
+	if (!dirtyInstances.empty()) {
+		std::ranges::sort(dirtyInstances);
+
+		std::vector<Transform> dirtyTransforms(dirtyInstances.size());
+		std::vector<Transform> dirtyInverseTransforms(dirtyInstances.size());
+		for (size_t i = 0; i < dirtyInstances.size(); i++) {
+			const uint32_t slot = dirtyInstances[i];
+			inverseTransforms[slot] = inverse(transforms[slot]);
+			dirtyTransforms[i]        = transforms[slot];
+			dirtyInverseTransforms[i] = inverseTransforms[slot];
+			if (useAccelerationStructure)
+				instances[slot].transform = std::bit_cast<vk::TransformMatrixKHR>((float3x4)transpose(transforms[slot].transform));
+		}
+
+		context.Copy(context.UploadData(dirtyTransforms).cast<Transform>(),        transformsBuffer,        dirtyInstances);
+		context.Copy(context.UploadData(dirtyInverseTransforms).cast<Transform>(), inverseTransformsBuffer, dirtyInstances);
+
+		if (useAccelerationStructure) {
+			if (renderData.accelerationStructure->AllowsUpdate() && renderData.accelerationStructure->UpdateCount() < maxTlasUpdates)
+				renderData.accelerationStructure->Update(context, instances);
+			else {
+				renderData.accelerationStructure = AccelerationStructure::Create(context, instances, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+				renderData.sceneParameters["accelerationStructure"] = renderData.accelerationStructure;
+			}
+		}
+	}
+
+	if (!dirtyMaterials.empty()) {
+		std::ranges::sort(dirtyMaterials);
+		const auto [first, last] = std::ranges::unique(dirtyMaterials);
+		dirtyMaterials.erase(first, last);
+
+		std::vector<Material<uint32_t>> dirtyMaterialData(dirtyMaterials.size());
+		std::ranges::transform(dirtyMaterials, dirtyMaterialData.begin(), [&](const uint32_t i) { return materials[i]; });
+		context.Copy(context.UploadData(dirtyMaterialData).cast<Material<uint32_t>>(), materialsBuffer, dirtyMaterials);
+	}
+
+	if (!dirtyInstances.empty() || !dirtyMaterials.empty())
+		renderData.updateTime = std::chrono::high_resolution_clock::now();
+
+	return true;
+}
+
 void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSet& renderables) {
 	// create instances and draw calls from renderables
-	const bool useAccelerationStructure = context.GetDevice().EnabledExtensions().contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME);
+	const bool useAccelerationStructure = context.GetDevice().SupportsRayQuery();
+	std::vector<ref<BVH>> meshBvhs; // software ray tracing fallback, indexed like meshes
 
 	for (auto& d : renderData.drawLists) d.clear();
 	renderData.drawLists.resize(3);
+	renderData.drawListVersion++;
 	renderData.instanceNodes.clear();
+	instanceSlots.clear();
 
-	instances.clear();
+	// the instances the current TLAS was built with, to check that a refit is valid
+	const std::vector<vk::AccelerationStructureInstanceKHR> builtInstances = std::exchange(instances, {});
 	instanceHeaders.clear();
 	transforms.clear();
 
@@ -63,6 +324,70 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 
 	emissiveInstances.clear();
 
+	if (useAccelerationStructure) {
+		while (retiredAccelerationStructures.can_pop(context.GetDevice()))
+			retiredAccelerationStructures.pop();
+
+		// build all out of date BLASes in one batch, and compact the ones whose compacted size is known
+		std::vector<Mesh*> blasMeshes;
+		std::vector<AccelerationStructure::BuildGeometries> blasBuilds;
+		std::unordered_set<Mesh*> visited;
+		auto prevDeformableBlases = std::exchange(deformableBlases, {});
+		for (const auto&[pipeline, meshes__] : renderables) {
+			for (const auto&[mesh, materials_] : meshes__.second) {
+				if (!visited.emplace(mesh).second)
+					continue;
+
+				bool opaque = true;
+				for (const auto&[material, nt_] : materials_) {
+					if (material->HasFlag(MaterialFlags::eAlphaCutoff)) opaque = false;
+				}
+
+				if (mesh->deformable) {
+					// refits rather than rebuilds, which changes the instances' bounds but not their BLAS
+					// until the BLAS is rebuilt after maxBLASUpdates. Compared against the last TLAS build
+					// rather than NeedsBLASUpdate, since Mesh::SetPositions refits on its own.
+					if (mesh->NeedsBLASUpdate())
+						mesh->UpdateBLAS(context, opaque);
+					if (auto it = prevDeformableBlases.find(mesh); it == prevDeformableBlases.end() || std::get<1>(it->second) != mesh->blas)
+						instancesChanged = true;
+					else if (std::get<2>(it->second) != mesh->blasUpdateTime)
+						instancesMoved = true;
+					const ref<Mesh>& meshRef = materials_.begin()->second.front().first->mesh;
+					deformableBlases.emplace(mesh, std::tuple{ meshRef, mesh->blas, mesh->blasUpdateTime });
+					continue;
+				}
+
+				if (mesh->NeedsBLASUpdate()) {
+					blasMeshes.emplace_back(mesh);
+					blasBuilds.emplace_back(mesh->GetBLASGeometry(context.GetDevice(), opaque));
+				} else if (compactAccelerationStructures && mesh->blas->CanCompact(context.GetDevice())) {
+					if (auto compacted = mesh->blas->Compact(context)) {
+						retiredAccelerationStructures.push(mesh->blas, context.GetDevice().NextTimelineSignal());
+						mesh->blas = compacted;
+						instancesChanged = true;
+					}
+				}
+			}
+		}
+
+		if (!blasBuilds.empty()) {
+			auto blases = AccelerationStructure::Create(
+				context,
+				vk::AccelerationStructureTypeKHR::eBottomLevel,
+				blasBuilds,
+				vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
+				compactAccelerationStructures);
+			for (size_t i = 0; i < blasMeshes.size(); i++) {
+				blasMeshes[i]->blas = blases[i];
+				blasMeshes[i]->blasUpdateTime = context.GetDevice().NextTimelineSignal();
+			}
+			if (compactAccelerationStructures)
+				blasCompactionSignal = context.GetDevice().NextTimelineSignal();
+			instancesChanged = true;
+		}
+	}
+
 	for (const auto&[pipeline, meshes__] : renderables) {
 		const auto& [meshLayout, meshes_] = meshes__;
 		for (const auto&[mesh, materials_] : meshes_) {
@@ -72,15 +397,12 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 			else {
 				meshMap.emplace(mesh, meshId);
 				meshes.emplace_back(PackMesh(*mesh, meshBufferMap));
+				if (!useAccelerationStructure) {
+					mesh->UpdateBVH(context.GetDevice());
+					meshBvhs.emplace_back(mesh->bvh);
+				}
 			}
 
-			bool opaque = true;
-			for (const auto&[material, nt_] : materials_) {
-				if (material->HasFlag(MaterialFlags::eAlphaCutoff)) opaque = false;
-			}
-			if (useAccelerationStructure) mesh->UpdateBLAS(context, opaque);
-
-
 			for (const auto&[material, nt_] : materials_) {
 				size_t materialId = materials.size();
 				if (auto it = materialMap.find(material); it != materialMap.end())
@@ -99,9 +421,10 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 						.transformIndex = (uint32_t)transforms.size(),
 						.materialIndex  = (uint32_t)materialId,
 						.meshIndex = (uint32_t)meshId,
-						.triangleCount = uint32_t(mesh->indexBuffer.size_bytes()/mesh->indexSize)/3 });
+						.triangleCount = mesh->RayTracingTriangleCount() });
 					transforms.emplace_back(t);
 					renderData.instanceNodes.emplace_back(n->shared_from_this());
+					instanceSlots.emplace(n, (uint32_t)instanceId);
 
 					if (isEmissive) emissiveInstances.emplace_back((uint32_t)instanceId);
 
@@ -129,7 +452,77 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 		}
 	}
 
-	if (useAccelerationStructure) renderData.accelerationStructure = AccelerationStructure::Create(context, instances);
+	if (useAccelerationStructure) {
+		// the TLAS is refit if only instance transforms or BLAS contents changed. RenderableSet iteration order isn't
+		// stable across rebuilds, so a refit also requires every instance to reference the same BLAS as before.
+		const bool rebuild =
+			instancesChanged ||
+			!renderData.accelerationStructure ||
+			!renderData.accelerationStructure->AllowsUpdate() ||
+			renderData.accelerationStructure->UpdateCount() >= maxTlasUpdates ||
+			instances.empty() ||
+			!std::ranges::equal(instances, builtInstances, [](const vk::AccelerationStructureInstanceKHR& a, const vk::AccelerationStructureInstanceKHR& b) {
+				return a.accelerationStructureReference == b.accelerationStructureReference &&
+					a.instanceCustomIndex == b.instanceCustomIndex && a.mask == b.mask && a.flags == b.flags;
+			});
+		if (rebuild)
+			renderData.accelerationStructure = AccelerationStructure::Create(context, instances, vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+		else if (instancesMoved)
+			renderData.accelerationStructure->Update(context, instances);
+	} else {
+		// software ray tracing: build an instance BVH over the world space bounds of each instance's mesh BVH,
+		// and concatenate it with the mesh BVHs into a single node and primitive buffer
+		std::vector<std::pair<float3, float3>> instanceBounds(instanceHeaders.size());
+		for (size_t i = 0; i < instanceHeaders.size(); i++) {
+			const BVH& meshBvh = *meshBvhs[instanceHeaders[i].meshIndex];
+			const Transform& t = transforms[instanceHeaders[i].transformIndex];
+			if (meshBvh.empty()) {
+				instanceBounds[i] = { t.TransformPoint(float3(0)), t.TransformPoint(float3(0)) };
+				continue;
+			}
+			const BVHNode& root = meshBvh.nodes[0];
+			float3 mn = float3( std::numeric_limits<float>::infinity());
+			float3 mx = float3(-std::numeric_limits<float>::infinity());
+			for (uint32_t c = 0; c < 8; c++) {
+				const float3 p = t.TransformPoint(float3(
+					(c & 1) ? root.aabbMax.x : root.aabbMin.x,
+					(c & 2) ? root.aabbMax.y : root.aabbMin.y,
+					(c & 4) ? root.aabbMax.z : root.aabbMin.z));
+				mn = glm::min(mn, p);
+				mx = glm::max(mx, p);
+			}
+			instanceBounds[i] = { mn, mx };
+		}
+
+		BVH bvh = BVH::Build(instanceBounds, 2);
+		std::vector<uint32_t> meshBvhRoots(meshBvhs.size());
+		for (size_t i = 0; i < meshBvhs.size(); i++) {
+			const BVH& meshBvh = *meshBvhs[i];
+			if (meshBvh.empty()) {
+				meshBvhRoots[i] = UINT32_MAX;
+				continue;
+			}
+			const uint32_t nodeOffset      = (uint32_t)bvh.nodes.size();
+			const uint32_t primitiveOffset = (uint32_t)bvh.primitiveIndices.size();
+			meshBvhRoots[i] = nodeOffset;
+			for (BVHNode node : meshBvh.nodes) {
+				node.leftOrFirst += node.IsLeaf() ? primitiveOffset : nodeOffset;
+				bvh.nodes.emplace_back(node);
+			}
+			bvh.primitiveIndices.insert(bvh.primitiveIndices.end(), meshBvh.primitiveIndices.begin(), meshBvh.primitiveIndices.end());
+		}
+
+		// avoid creating empty buffers
+		if (bvh.nodes.empty())            bvh.nodes.push_back({});
+		if (bvh.primitiveIndices.empty()) bvh.primitiveIndices.push_back({});
+		if (meshBvhRoots.empty())         meshBvhRoots.push_back(UINT32_MAX);
+
+		renderData.sceneParameters["bvhNodes"]      = (BufferView)context.UploadData(bvh.nodes,            vk::BufferUsageFlagBits::eStorageBuffer);
+		renderData.sceneParameters["bvhPrimitives"] = (BufferView)context.UploadData(bvh.primitiveIndices, vk::BufferUsageFlagBits::eStorageBuffer);
+		renderData.sceneParameters["meshBvhRoots"]  = (BufferView)context.UploadData(meshBvhRoots,         vk::BufferUsageFlagBits::eStorageBuffer);
+	}
+	instancesChanged = false;
+	instancesMoved   = false;
 
 	renderData.sceneParameters["backgroundColor"] = backgroundColor;
 	uint32_t backgroundImageIndex = -1;
@@ -145,11 +538,12 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 		if (!backgroundImportanceMap || backgroundImportanceMap.Extent() != backgroundImage.Extent()) {
 			backgroundImportanceMap = ImageView::Create(
 				Image::Create(context.GetDevice(), ImageInfo{
-					.format = vk::Format::eR16Sfloat,
+					.format = vk::Format::eR32Sfloat, // sums of the whole image overflow half floats
 					.extent = backgroundImage.Extent(),
 					.mipLevels = GetMaxMipLevels(backgroundImage.Extent()),
-					.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
-					.queueFamilies = { context.QueueFamily() } }));
+					.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+					.queueFamilies = { context.QueueFamily() } },
+					vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene));
 		}
 
 		ShaderParameter params = {};
@@ -157,7 +551,8 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 		params["importanceMap"] = ImageParameter{ .image = backgroundImportanceMap, .imageLayout = vk::ImageLayout::eGeneral };
 		params["dim"] = (uint2)backgroundImage.Extent();
 		createImportanceMap(context, backgroundImage.Extent(), params);
-		context.GenerateMipMaps(backgroundImportanceMap.GetImage());
+		// each texel holds the total importance of the texels under it, which is what SampleTexel descends through
+		mipGenerator(context, backgroundImportanceMap.GetImage(), MipReduction::eSum);
 	} else {
 		backgroundImportanceMap = {};
 	}
@@ -170,6 +565,14 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 	renderData.sceneParameters["emissiveInstanceCount"]       = (uint32_t)emissiveInstances.size();
 	renderData.sceneParameters["backgroundSampleProbability"] = backgroundSampleProbability;
 
+	// headers of virtual images, at the index of their tails. Regular images get an empty header.
+	std::vector<VirtualImageHeader> virtualImages(std::max<size_t>(imageMap.size(), 1), VirtualImageHeader{});
+	if (virtualTextures.ImageCount() > 0) {
+		for (const auto& [img, idx] : imageMap)
+			if (const VirtualImageHeader* header = virtualTextures.Find(*img.mImage))
+				virtualImages[idx] = *header;
+	}
+
 	// avoid creating empty buffers
 	if (materials.empty())         materials.push_back({});
 	if (emissiveInstances.empty()) emissiveInstances.push_back({});
@@ -179,15 +582,16 @@ void Scene::PrepareRenderData(CommandContext& context, const Scene::RenderableSe
 	if (meshes.empty())            meshes.push_back({});
 	if (emissiveInstances.empty()) emissiveInstances.push_back({});
 
-	std::vector<Transform> invTransforms(transforms.size());
-	std::ranges::transform(transforms, invTransforms.begin(), [](const Transform& t) { return inverse(t); });
+	inverseTransforms.resize(transforms.size());
+	std::ranges::transform(transforms, inverseTransforms.begin(), [](const Transform& t) { return inverse(t); });
 
-	renderData.sceneParameters["instances"]         = (BufferView)context.UploadData(instanceHeaders,   vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eVertexBuffer);
-	renderData.sceneParameters["transforms"]        = (BufferView)context.UploadData(transforms,        vk::BufferUsageFlagBits::eStorageBuffer);
-	renderData.sceneParameters["inverseTransforms"] = (BufferView)context.UploadData(invTransforms,     vk::BufferUsageFlagBits::eStorageBuffer);
-	renderData.sceneParameters["materials"]         = (BufferView)context.UploadData(materials,         vk::BufferUsageFlagBits::eStorageBuffer);
+	renderData.sceneParameters["instances"]         = (BufferView)UploadPersistent(context, instancesBuffer,         instanceHeaders,   vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eVertexBuffer);
+	renderData.sceneParameters["transforms"]        = (BufferView)UploadPersistent(context, transformsBuffer,        transforms,        vk::BufferUsageFlagBits::eStorageBuffer);
+	renderData.sceneParameters["inverseTransforms"] = (BufferView)UploadPersistent(context, inverseTransformsBuffer, inverseTransforms, vk::BufferUsageFlagBits::eStorageBuffer);
+	renderData.sceneParameters["materials"]         = (BufferView)UploadPersistent(context, materialsBuffer,         materials,         vk::BufferUsageFlagBits::eStorageBuffer);
 	renderData.sceneParameters["meshes"]            = (BufferView)context.UploadData(meshes,            vk::BufferUsageFlagBits::eStorageBuffer);
 	renderData.sceneParameters["emissiveInstances"] = (BufferView)context.UploadData(emissiveInstances, vk::BufferUsageFlagBits::eStorageBuffer);
+	renderData.sceneParameters["virtualImages"]     = (BufferView)context.UploadData(virtualImages,     vk::BufferUsageFlagBits::eStorageBuffer);
 	renderData.sceneParameters["backgroundImportanceMap"] = ImageParameter{ .image = backgroundImportanceMap, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
 	if (useAccelerationStructure) renderData.sceneParameters["accelerationStructure"] = renderData.accelerationStructure;
 	for (const auto& [buf, idx] : meshBufferMap) renderData.sceneParameters["meshBuffers"][idx] = BufferView{buf, 0, buf->Size()};
@@ -3,8 +3,16 @@
 #include <stack>
 #include <chrono>
 
+#include <Rose/Algorithm/MipGenerator/MipGenerator.hpp>
+#include <Rose/Core/ImageLoader.hpp>
 #include <Rose/Core/PipelineCache.hpp>
+#include <Rose/Core/ThreadPool.hpp>
+#include <Rose/Core/TextureCompression.hpp>
+#include <Rose/Core/TransientResourceCache.hpp>
+#include "SceneCache.hpp"
 #include "SceneNode.hpp"
+#include "TransformHierarchy.hpp"
+#include "VirtualTexture.hpp"
 
 namespace RoseEngine {
 
@@ -18,6 +26,7 @@ struct SceneRenderData {
 
 	// 3 drawlists: alpha, cutout, opaque
 	std::vector<std::vector<DrawBatch>> drawLists = {};
+	uint64_t                            drawListVersion = 0; // incremented whenever drawLists are rebuilt
 
 	ref<AccelerationStructure>          accelerationStructure = {};
 
@@ -30,10 +39,20 @@ struct SceneRenderData {
 class Scene {
 private:
 	PipelineCache createImportanceMap = PipelineCache(FindShaderPath("CreateImportanceMap.cs.slang"));
+	MipGenerator  mipGenerator;
 
 	std::vector<vk::AccelerationStructureInstanceKHR> instances;
+	// Whether the TLAS must be rebuilt because instances were added, removed or changed more than their transform,
+	// and whether it must be refit because instance transforms or BLAS contents changed. Set from node dirty flags
+	// and BLAS builds as they happen. PrepareRenderData still checks that a refit's instances match the TLAS's.
+	bool instancesChanged = true;
+	bool instancesMoved   = false;
 	std::vector<InstanceHeader>                       instanceHeaders;
 	std::vector<Transform>                            transforms;
+	std::vector<Transform>                            inverseTransforms;
+	std::unordered_map<const SceneNode*, uint32_t>    instanceSlots; // index of each renderable node in instanceHeaders and transforms
+	TransformHierarchy                                hierarchy;
+	ThreadPool                                        hierarchyPool; // propagates large hierarchy levels
 
 	std::vector<Material<uint32_t>> materials;
 	std::unordered_map<const Material<ImageView>*, size_t> materialMap;
@@ -46,6 +65,38 @@ private:
 
 	bool dirty = false;
 
+	// BLASes replaced by compaction, kept alive until frames using them are done
+	TransientResourceCache<ref<AccelerationStructure>> retiredAccelerationStructures;
+	// timeline value after which compacted BLAS sizes are available
+	uint64_t blasCompactionSignal = 0;
+	// the BLAS and BLAS update time that the TLAS was last built or refit with, for each deformable mesh,
+	// so that refits done outside the scene (e.g. by Mesh::SetPositions) also refit the TLAS
+	std::unordered_map<const Mesh*, std::tuple<ref<Mesh>, ref<AccelerationStructure>, uint64_t>> deformableBlases;
+
+	// caches of imported scenes. Once their device data has been read back, they are written on sceneCacheWriter,
+	// which also frees their host copies.
+	std::vector<SceneCache> pendingSceneCaches;
+	std::vector<std::pair<std::filesystem::path, std::future<size_t>>> sceneCacheWrites;
+	ThreadPool sceneCacheWriter { 1 };
+	void WriteSceneCaches(const Device& device);
+
+	// environment map being decoded by imageLoader. backgroundImage is replaced once it is uploaded.
+	ref<AsyncImage> pendingBackground = {};
+
+	// Device copies of instanceHeaders, transforms, inverseTransforms and materials. Unlike UploadData's transient
+	// buffers, these are owned by the scene so that UpdateDirtyNodes can overwrite individual elements.
+	BufferRange<InstanceHeader>     instancesBuffer = {};
+	BufferRange<Transform>          transformsBuffer = {};
+	BufferRange<Transform>          inverseTransformsBuffer = {};
+	BufferRange<Material<uint32_t>> materialsBuffer = {};
+	TransientResourceCache<BufferView> retiredBuffers; // replaced by larger buffers, kept alive until frames using them are done
+
+	// Lets the residency manager drop the top mips of textures when over budget
+	ResidencyManager::Handle residency = {};
+	TransientResourceCache<ref<Image>> retiredImages; // textures replaced by DropTopMips
+	void RegisterResidency(Device& device);
+	std::vector<ImageView> DroppableTextures(const uint32_t minTextureSize = 256) const;
+
 	// Batch render calls by: pipeline/mesh/material
 	using RenderableSet =
 		std::unordered_map<const Pipeline*,
@@ -58,6 +109,13 @@ private:
 
 	void PrepareRenderData(CommandContext& context, const RenderableSet& renderables);
 
+	// Applies transform and material edits on dirty nodes to the existing render data, visiting only dirty subtrees
+	// and uploading only the instances and materials that changed. Returns false if a full rebuild is needed instead.
+	bool UpdateDirtyNodes(CommandContext& context);
+
+	template<typename T>
+	BufferRange<T> UploadPersistent(CommandContext& context, BufferRange<T>& buffer, const std::vector<T>& data, const vk::BufferUsageFlags usage);
+
 public:
 	ref<SceneNode>  sceneRoot = nullptr;
 	SceneRenderData renderData = {};
@@ -65,34 +123,94 @@ public:
 	ImageView backgroundImportanceMap = {};
 	float3    backgroundColor = float3(0);
 	float     backgroundSampleProbability = 0.5f;
+	bool      compactAccelerationStructures = true;
+	uint32_t  maxTlasUpdates = 64; // rebuild the TLAS after this many consecutive updates
+	bool      quantizeVertices = true; // for scenes loaded afterwards
+	bool      useSceneCache = true; // load glTF scenes from a binary cache next to the file, and write it after the first import
+	uint32_t  importThreadCount = 0; // threads decoding images and processing meshes at glTF import. 0 uses one per hardware thread
+	TextureCompression textureCompression = TextureCompression::eNone; // block compress glTF textures at import, for scenes loaded afterwards
+	bool      useVirtualTextures = false; // stream glTF textures larger than a tile through virtualTextures, for scenes loaded afterwards
+	VirtualTextureCache virtualTextures = {};
+	ImageLoader imageLoader = {};    // decodes environment maps in the background
+
+	// World transforms of every node as of the last PreRender
+	inline const TransformHierarchy& Hierarchy() const { return hierarchy; }
+	// Object to world transform of each instance, indexed like renderData's draws
+	inline const std::vector<Transform>& InstanceTransforms() const { return transforms; }
+
+	// Forces a full rebuild of the render data. Edits to individual nodes should use SceneNode::SetDirty instead.
+	inline void SetDirty() {
+		dirty = true;
+		instancesChanged = true;
+	}
 
-	inline void SetDirty() { dirty = true; }
+	// Replaces the largest textures in materials with copies without their top mip, until bytes are freed.
+	// Textures at most minTextureSize texels wide are kept. Returns the bytes freed once the replaced textures are released.
+	vk::DeviceSize DropTopMips(CommandContext& context, const vk::DeviceSize bytes, const uint32_t minTextureSize = 256);
 
 	void Load(CommandContext& context, const std::filesystem::path& p);
 	void LoadDialog(CommandContext& context);
 
 	inline void PreRender(CommandContext& context, auto getPipelineFn) {
-		if (!dirty || !sceneRoot) return;
+		// rebuild the TLAS once compacted BLASes can be swapped in
+		if (blasCompactionSignal > 0 && context.GetDevice().CurrentTimelineValue() >= blasCompactionSignal) {
+			blasCompactionSignal = 0;
+			dirty = true;
+		}
+
+		if (!pendingSceneCaches.empty() || !sceneCacheWrites.empty())
+			WriteSceneCaches(context.GetDevice());
+
+		while (retiredImages.can_pop(context.GetDevice()))
+			retiredImages.pop();
+		if (!residency)
+			RegisterResidency(context.GetDevice());
+		residency.Touch(context.GetDevice().NextTimelineSignal());
+
+		if (imageLoader.PendingCount() > 0)
+			imageLoader.Update(context);
+		if (pendingBackground && pendingBackground->IsDone()) {
+			if (pendingBackground->IsReady()) {
+				backgroundImage = pendingBackground->View();
+				backgroundColor = float3(1);
+				dirty = true;
+			}
+			pendingBackground.reset();
+		}
+
+		virtualTextures.Update(context, renderData.sceneParameters);
+
+		if (!sceneRoot) return;
+
+		if (!dirty && sceneRoot->IsDirty() && !UpdateDirtyNodes(context))
+			dirty = true;
+		if (!dirty && std::ranges::any_of(deformableBlases, [](const auto& p) { return std::get<0>(p.second)->blasUpdateTime != std::get<2>(p.second); }))
+			dirty = true;
+
+		if (!dirty) return;
 
 		// collect renderables and their transforms from the scene graph
 
+		hierarchy.Build(*sceneRoot);
+		hierarchy.PropagateParallel(hierarchyPool);
+
 		RenderableSet renderables;
 
-		std::stack<std::pair<SceneNode*, Transform>> todo;
-		todo.push({sceneRoot.get(), Transform::Identity()});
-		while (!todo.empty()) {
-			auto [n, t] = todo.top();
-			todo.pop();
+		for (uint32_t i = 0; i < hierarchy.size(); i++) {
+			SceneNode* n = hierarchy.nodes[i];
+			// material edits can change instance flags
+			if (n->IsDirty(SceneNodeDirtyFlags::eStructure) || n->IsDirty(SceneNodeDirtyFlags::eMaterial))
+				instancesChanged = true;
+			if (n->IsDirty(SceneNodeDirtyFlags::eTransform))
+				instancesMoved = true;
+			n->ClearDirty();
 
 			if (n->mesh && n->material) {
 				const auto& [key, cachedPipeline] = getPipelineFn(context.GetDevice(), *n->mesh, *n->material);
 				auto&[meshLayout_, meshes] = renderables[cachedPipeline.get()];
 				meshLayout_ = std::get<0>(key);
-				meshes[n->mesh.get()][n->material.get()].emplace_back(std::pair{n, t});
+				meshes[n->mesh.get()][n->material.get()].emplace_back(std::pair{n, hierarchy.worldTransforms[i]});
 			}
-
-			for (const ref<SceneNode>& c : *n)
-				todo.push({c.get(), c->transform.has_value() ? t * c->transform.value() : t});
 		}
 
 		PrepareRenderData(context, renderables);
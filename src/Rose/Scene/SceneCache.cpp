@@ -0,0 +1,551 @@
+#include <fstream>
+#include <iostream>
+#include <stack>
+#include <tuple>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "SceneCache.hpp"
+
+namespace RoseEngine {
+
+namespace {
+
+const std::array<char, 8> kMagic = { 'R', 'O', 'S', 'E', 'S', 'C', 'N', 0 };
+const uint32_t kVersion = 3;
+const size_t   kSectionAlignment = 256;
+
+// The file is the header, the table describing the scene, then the buffer and image level sections,
+// each aligned to kSectionAlignment. Section offsets are relative to the end of the table.
+// The table starts with the files the source refers to, with their size and last write time.
+struct FileHeader {
+	std::array<char, 8> magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t options = 0;
+	uint64_t sourceSize = 0;
+	int64_t  sourceTime = 0; // last write time of the source file
+	uint64_t tableSize = 0;
+};
+
+struct Section {
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+struct BufferRef {
+	uint64_t offset = 0; // in the buffer
+	uint64_t size = 0;
+	uint32_t index = ~0u;
+	uint32_t pad = 0;
+};
+
+inline size_t AlignUp(const size_t x, const size_t alignment) { return (x + alignment - 1) / alignment * alignment; }
+
+inline bool IsHostBuffer(const Buffer& buffer) {
+	return (buffer.MemoryFlags() & vk::MemoryPropertyFlagBits::eHostVisible) && buffer.data();
+}
+
+inline size_t GetLevelSize(const ImageInfo& info, const uint32_t level) {
+	return GetImageSize(info.format, GetLevelExtent(info.extent, level)) * info.arrayLayers;
+}
+
+std::pair<uint64_t, int64_t> GetSourceVersion(const std::filesystem::path& source) {
+	return { std::filesystem::file_size(source), std::filesystem::last_write_time(source).time_since_epoch().count() };
+}
+
+// Read-only mapping of a whole file. Empty if the file can't be opened.
+class MappedFile {
+private:
+	const std::byte* mData = nullptr;
+	size_t           mSize = 0;
+
+public:
+	inline MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size = {};
+		const HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		CloseHandle(file);
+		if (!mapping)
+			return;
+		mData = reinterpret_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+		if (mData) mSize = (size_t)size.QuadPart;
+#else
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st = {};
+		void* p = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (p == MAP_FAILED)
+			return;
+		madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+		mData = reinterpret_cast<const std::byte*>(p);
+		mSize = (size_t)st.st_size;
+#endif
+	}
+	inline ~MappedFile() {
+		if (!mData) return;
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+#else
+		munmap(const_cast<std::byte*>(mData), mSize);
+#endif
+	}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline std::span<const std::byte> data() const { return { mData, mSize }; }
+};
+
+class TableWriter {
+public:
+	std::vector<std::byte> data;
+
+	template<typename T> requires(std::is_trivially_copyable_v<T>)
+	inline void Write(const T& value) {
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(T));
+		std::memcpy(data.data() + offset, &value, sizeof(T));
+	}
+	template<typename T> requires(std::is_trivially_copyable_v<T>)
+	inline void Write(const std::vector<T>& values) {
+		Write((uint32_t)values.size());
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(T) * values.size());
+		std::memcpy(data.data() + offset, values.data(), sizeof(T) * values.size());
+	}
+	inline void Write(const std::string& value) {
+		Write(std::vector<char>(value.begin(), value.end()));
+	}
+};
+
+class TableReader {
+private:
+	std::span<const std::byte> mData;
+	size_t mOffset = 0;
+
+	inline const std::byte* Take(const size_t size) {
+		if (mOffset + size > mData.size())
+			throw std::runtime_error("Scene cache table is truncated");
+		const std::byte* p = mData.data() + mOffset;
+		mOffset += size;
+		return p;
+	}
+
+public:
+	inline TableReader(const std::span<const std::byte> data) : mData(data) {}
+
+	template<typename T> requires(std::is_trivially_copyable_v<T>)
+	inline T Read() {
+		T value;
+		std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+		return value;
+	}
+	template<typename T> requires(std::is_trivially_copyable_v<T>)
+	inline std::vector<T> ReadVector() {
+		const uint32_t count = Read<uint32_t>();
+		std::vector<T> values(count);
+		std::memcpy(values.data(), Take(sizeof(T) * count), sizeof(T) * count);
+		return values;
+	}
+	inline std::string ReadString() {
+		const std::vector<char> chars = ReadVector<char>();
+		return std::string(chars.begin(), chars.end());
+	}
+};
+
+// Everything below a root node which is written to the cache, in the order it is written
+struct SceneContents {
+	std::vector<std::pair<const SceneNode*, uint32_t/*parent index*/>> nodes;
+	std::vector<const Mesh*>                                meshes;
+	std::unordered_map<const Mesh*, uint32_t>               meshMap;
+	std::vector<Material<uint32_t>>                         materials;
+	std::unordered_map<const Material<ImageView>*, uint32_t> materialMap;
+	std::vector<ImageView>                                  images;
+	std::unordered_map<ImageView, uint32_t>                 imageMap;
+	std::vector<ref<Buffer>>                                buffers;
+	std::unordered_map<ref<Buffer>, uint32_t>               bufferMap;
+
+	inline SceneContents(const ref<SceneNode>& root) {
+		auto addBuffer = [&](const BufferView& b) {
+			if (b && !bufferMap.contains(b.mBuffer)) {
+				bufferMap.emplace(b.mBuffer, (uint32_t)buffers.size());
+				buffers.emplace_back(b.mBuffer);
+			}
+		};
+
+		std::stack<std::pair<const SceneNode*, uint32_t>> todo;
+		todo.push({ root.get(), ~0u });
+		while (!todo.empty()) {
+			const auto[n, parent] = todo.top();
+			todo.pop();
+			const uint32_t index = (uint32_t)nodes.size();
+			nodes.emplace_back(n, parent);
+			// pushed in reverse so that children keep their order
+			for (auto it = n->end(); it != n->begin();)
+				todo.push({ (--it)->get(), index });
+
+			if (n->mesh && !meshMap.contains(n->mesh.get())) {
+				const Mesh& mesh = *n->mesh;
+				meshMap.emplace(&mesh, (uint32_t)meshes.size());
+				meshes.emplace_back(&mesh);
+				addBuffer(mesh.indexBuffer);
+				addBuffer(mesh.indexBufferCpu);
+				addBuffer(mesh.meshletBuffer);
+				addBuffer(mesh.blasTransform);
+				for (const MeshVertexAttributes* attributes : { &mesh.vertexAttributes, &mesh.vertexAttributesCpu })
+					for (const auto&[type, streams] : *attributes)
+						for (const auto&[buffer, layout] : streams)
+							addBuffer(buffer);
+			}
+			if (n->material && !materialMap.contains(n->material.get())) {
+				materialMap.emplace(n->material.get(), (uint32_t)materials.size());
+				materials.emplace_back(PackMaterial(*n->material, imageMap));
+			}
+		}
+
+		images.resize(imageMap.size());
+		for (const auto&[image, index] : imageMap)
+			images[index] = image;
+	}
+
+	inline BufferRef GetRef(const BufferView& b) const {
+		if (!b) return {};
+		return BufferRef{ .offset = b.mOffset, .size = b.size_bytes(), .index = bufferMap.at(b.mBuffer) };
+	}
+};
+
+}
+
+std::filesystem::path SceneCache::GetPath(const std::filesystem::path& source) {
+	return source.parent_path() / (source.filename().string() + ".rosescene");
+}
+
+SceneCache SceneCache::Record(CommandContext& context, const ref<SceneNode>& root, const std::filesystem::path& source, const uint32_t options, const std::vector<std::filesystem::path>& dependencies) {
+	Device& device = context.GetDevice();
+
+	SceneCache cache = {};
+	cache.mSource  = source;
+	cache.mOptions = options;
+
+	const SceneContents contents(root);
+
+	size_t dataSize = 0;
+	auto addSection = [&](const BufferView& data) {
+		const Section s{ .offset = dataSize, .size = data.size_bytes() };
+		cache.mSections.emplace_back(data);
+		dataSize = AlignUp(dataSize + s.size, kSectionAlignment);
+		return s;
+	};
+	auto createReadback = [&](const size_t size) {
+		return Buffer::Create(
+			device,
+			size,
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent|vk::MemoryPropertyFlagBits::eHostCached,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT|VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+	};
+
+	TableWriter table;
+
+	table.Write((uint32_t)dependencies.size());
+	for (const std::filesystem::path& dependency : dependencies) {
+		const auto[size, time] = GetSourceVersion(source.parent_path() / dependency);
+		table.Write(dependency.generic_string());
+		table.Write(size);
+		table.Write(time);
+	}
+
+	table.Write((uint32_t)contents.buffers.size());
+	for (const ref<Buffer>& buffer : contents.buffers) {
+		const BufferView whole = BufferView{ buffer, 0, buffer->Size() };
+		const bool host = IsHostBuffer(*buffer);
+		if (host)
+			table.Write(addSection(whole));
+		else {
+			const BufferView readback = createReadback(buffer->Size());
+			context.Copy(whole, readback);
+			table.Write(addSection(readback));
+		}
+		table.Write((uint32_t)(VkBufferUsageFlags)buffer->Usage());
+		table.Write((uint32_t)host);
+	}
+
+	table.Write((uint32_t)contents.images.size());
+	for (const ImageView& image : contents.images) {
+		const ImageInfo& info = image.mImage->Info();
+		table.Write(info.format);
+		table.Write(info.extent);
+		table.Write(info.mipLevels);
+		table.Write(info.arrayLayers);
+		table.Write(image.mComponentMapping);
+		for (uint32_t level = 0; level < info.mipLevels; level++) {
+			const BufferView readback = createReadback(GetLevelSize(info, level));
+			context.Copy(image, readback, level);
+			table.Write(addSection(readback));
+		}
+	}
+
+	table.Write(contents.materials);
+
+	table.Write((uint32_t)contents.meshes.size());
+	for (const Mesh* mesh : contents.meshes) {
+		table.Write(contents.GetRef(mesh->indexBuffer));
+		table.Write(contents.GetRef(mesh->indexBufferCpu));
+		table.Write(mesh->indexSize);
+		table.Write(mesh->topology);
+		table.Write(mesh->aabb);
+		table.Write(mesh->lods);
+		table.Write(mesh->rayTracingLod);
+		table.Write(mesh->positionOffset);
+		table.Write(mesh->positionScale);
+		table.Write(contents.GetRef(mesh->blasTransform));
+		table.Write(contents.GetRef(mesh->meshletBuffer));
+		table.Write(mesh->meshletCount);
+		table.Write(mesh->meshletVertexCount);
+		for (const MeshVertexAttributes* attributes : { &mesh->vertexAttributes, &mesh->vertexAttributesCpu }) {
+			table.Write((uint32_t)attributes->size());
+			for (const auto&[type, streams] : *attributes) {
+				table.Write(type);
+				table.Write((uint32_t)streams.size());
+				for (const auto&[buffer, layout] : streams) {
+					table.Write(contents.GetRef(buffer));
+					table.Write(layout);
+				}
+			}
+		}
+	}
+
+	table.Write((uint32_t)contents.nodes.size());
+	for (const auto&[node, parent] : contents.nodes) {
+		table.Write(node->Name());
+		table.Write(parent);
+		table.Write(node->mesh     ? contents.meshMap.at(node->mesh.get())         : ~0u);
+		table.Write(node->material ? contents.materialMap.at(node->material.get()) : ~0u);
+		table.Write((uint32_t)node->transform.has_value());
+		table.Write(node->transform.value_or(Transform::Identity()));
+	}
+
+	cache.mTable = std::move(table.data);
+	cache.mReadySignal = device.NextTimelineSignal();
+	return cache;
+}
+
+size_t SceneCache::Write() const {
+	FileHeader header = {};
+	header.options = mOptions;
+	std::tie(header.sourceSize, header.sourceTime) = GetSourceVersion(mSource);
+	header.tableSize = mTable.size();
+
+	// write to a temporary file first, so that an interrupted write never leaves a broken cache behind
+	const std::filesystem::path path = GetPath(mSource);
+	const std::filesystem::path tmpPath = path.string() + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary);
+		if (!file)
+			throw std::runtime_error("Failed to open " + tmpPath.string() + " for writing");
+
+		const std::vector<char> padding(kSectionAlignment, 0);
+		auto pad = [&](const size_t alignment) {
+			const size_t p = (size_t)file.tellp();
+			file.write(padding.data(), AlignUp(p, alignment) - p);
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mTable.data()), mTable.size());
+		for (const BufferView& section : mSections) {
+			pad(kSectionAlignment);
+			file.write(reinterpret_cast<const char*>(section.data()), section.size_bytes());
+		}
+		if (!file)
+			throw std::runtime_error("Failed to write " + tmpPath.string());
+	}
+	std::filesystem::rename(tmpPath, path);
+
+	return std::filesystem::file_size(path);
+}
+
+ref<SceneNode> SceneCache::Load(CommandContext& context, const std::filesystem::path& source, const uint32_t options) {
+	const std::filesystem::path path = GetPath(source);
+	if (!std::filesystem::exists(path) || !std::filesystem::exists(source))
+		return nullptr;
+
+	const MappedFile file(path);
+	const std::span<const std::byte> fileData = file.data();
+	if (fileData.size() < sizeof(FileHeader))
+		return nullptr;
+
+	FileHeader header;
+	std::memcpy(&header, fileData.data(), sizeof(header));
+	if (header.magic != kMagic || header.version != kVersion || header.options != options)
+		return nullptr;
+	if (std::pair{ header.sourceSize, header.sourceTime } != GetSourceVersion(source)) {
+		std::cout << "Scene cache " << path << " is out of date" << std::endl;
+		return nullptr;
+	}
+	if (sizeof(header) + header.tableSize > fileData.size())
+		throw std::runtime_error("Scene cache table is truncated");
+
+	TableReader table(fileData.subspan(sizeof(header), header.tableSize));
+
+	for (uint32_t i = 0, n = table.Read<uint32_t>(); i < n; i++) {
+		const std::filesystem::path dependency = source.parent_path() / table.ReadString();
+		const uint64_t size = table.Read<uint64_t>();
+		const int64_t  time = table.Read<int64_t>();
+		if (!std::filesystem::exists(dependency) || std::pair{ size, time } != GetSourceVersion(dependency)) {
+			std::cout << "Scene cache " << path << " is out of date (" << dependency << " changed)" << std::endl;
+			return nullptr;
+		}
+	}
+
+	std::cout << "Loading " << path << std::endl;
+
+	Device& device = context.GetDevice();
+	const std::string name = source.stem().string();
+
+	const size_t dataStart = AlignUp(sizeof(header) + header.tableSize, kSectionAlignment);
+	auto getSection = [&](const Section s) {
+		if (dataStart + s.offset + s.size > fileData.size())
+			throw std::runtime_error("Scene cache section is truncated");
+		return fileData.subspan(dataStart + s.offset, s.size);
+	};
+
+	// acceleration structure inputs depend on the device the cache was written on
+	const vk::BufferUsageFlags accelerationStructureUsage = vk::BufferUsageFlagBits::eShaderDeviceAddress|vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR;
+	const bool hasAccelerationStructures = device.EnabledExtensions().contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME);
+	const bool hasMeshShaders            = device.EnabledExtensions().contains(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+	std::vector<ref<Buffer>> buffers(table.Read<uint32_t>());
+	for (uint32_t i = 0; i < buffers.size(); i++) {
+		const std::span<const std::byte> data = getSection(table.Read<Section>());
+		vk::BufferUsageFlags usage = (vk::BufferUsageFlags)table.Read<uint32_t>();
+		const bool host = table.Read<uint32_t>() != 0;
+		if (host) {
+			buffers[i] = Buffer::Create(device, data, usage).mBuffer;
+			device.SetDebugName(**buffers[i], name + "/hostbuffer" + std::to_string(i));
+		} else {
+			usage &= ~accelerationStructureUsage;
+			if (hasAccelerationStructures) usage |= accelerationStructureUsage;
+			const BufferView buffer = Buffer::Create(device, data.size(), usage|vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene);
+			context.Copy(context.UploadData(data), buffer);
+			buffers[i] = buffer.mBuffer;
+			device.SetDebugName(**buffers[i], name + "/buffer" + std::to_string(i));
+		}
+	}
+	auto getBuffer = [&](const BufferRef r) -> BufferView {
+		if (r.index == ~0u) return {};
+		return BufferView{ buffers.at(r.index), r.offset, r.size };
+	};
+
+	std::vector<ImageView> images(table.Read<uint32_t>());
+	for (uint32_t i = 0; i < images.size(); i++) {
+		ImageInfo info = {};
+		info.format      = table.Read<vk::Format>();
+		info.extent      = table.Read<uint3>();
+		info.mipLevels   = table.Read<uint32_t>();
+		info.arrayLayers = table.Read<uint32_t>();
+		info.queueFamilies = { context.QueueFamily() };
+		const vk::ComponentMapping components = table.Read<vk::ComponentMapping>();
+		images[i] = ImageView::Create(Image::Create(device, info, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, MemoryPool::eScene), vk::ImageSubresourceRange{
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = info.mipLevels,
+			.baseArrayLayer = 0,
+			.layerCount = info.arrayLayers },
+			vk::ImageViewType::e2D,
+			components);
+		device.SetDebugName(**images[i].mImage, name + "/image" + std::to_string(i));
+		for (uint32_t level = 0; level < info.mipLevels; level++)
+			context.Copy(context.UploadData(getSection(table.Read<Section>())), images[i], level);
+	}
+	auto getImage = [&](const uint32_t index) -> ImageView {
+		return index < images.size() ? images[index] : ImageView{};
+	};
+
+	std::vector<ref<Material<ImageView>>> materials;
+	for (const Material<uint32_t>& packed : table.ReadVector<Material<uint32_t>>()) {
+		Material<ImageView> m = {};
+		m.baseColorImage    = getImage(packed.baseColorImage);
+		m.emissionImage     = getImage(packed.emissionImage);
+		m.metallicRoughness = getImage(packed.metallicRoughness);
+		m.bumpMap           = getImage(packed.bumpMap);
+		m.packed            = packed.packed;
+		materials.emplace_back(make_ref<Material<ImageView>>(m));
+	}
+
+	std::vector<ref<Mesh>> meshes(table.Read<uint32_t>());
+	for (ref<Mesh>& meshRef : meshes) {
+		Mesh mesh = {};
+		mesh.indexBuffer        = getBuffer(table.Read<BufferRef>());
+		mesh.indexBufferCpu     = getBuffer(table.Read<BufferRef>());
+		mesh.indexSize          = table.Read<uint32_t>();
+		mesh.topology           = table.Read<vk::PrimitiveTopology>();
+		mesh.aabb               = table.Read<vk::AabbPositionsKHR>();
+		mesh.lods               = table.ReadVector<MeshLod>();
+		mesh.rayTracingLod      = table.Read<uint32_t>();
+		mesh.positionOffset     = table.Read<float3>();
+		mesh.positionScale      = table.Read<float3>();
+		mesh.blasTransform      = getBuffer(table.Read<BufferRef>());
+		mesh.meshletBuffer      = getBuffer(table.Read<BufferRef>());
+		mesh.meshletCount       = table.Read<uint32_t>();
+		mesh.meshletVertexCount = table.Read<uint32_t>();
+		for (MeshVertexAttributes* attributes : { &mesh.vertexAttributes, &mesh.vertexAttributesCpu }) {
+			const uint32_t typeCount = table.Read<uint32_t>();
+			for (uint32_t t = 0; t < typeCount; t++) {
+				std::vector<MeshVertexAttribute>& streams = (*attributes)[table.Read<MeshVertexAttributeType>()];
+				streams.resize(table.Read<uint32_t>());
+				for (auto&[buffer, layout] : streams) {
+					buffer = getBuffer(table.Read<BufferRef>());
+					layout = table.Read<MeshVertexAttributeLayout>();
+				}
+			}
+		}
+
+		// meshlets are only built on devices with mesh shaders
+		if (!hasMeshShaders) {
+			mesh.meshletBuffer = {};
+			mesh.meshletCount = 0;
+			mesh.meshletVertexCount = 0;
+		} else if (!mesh.meshletBuffer && mesh.topology == vk::PrimitiveTopology::eTriangleList && mesh.vertexAttributesCpu.contains(MeshVertexAttributeType::ePosition))
+			mesh.UpdateMeshlets(context);
+
+		meshRef = make_ref<Mesh>(std::move(mesh));
+	}
+
+	std::vector<ref<SceneNode>> nodes(table.Read<uint32_t>());
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		nodes[i] = SceneNode::Create(table.ReadString());
+		const uint32_t parent   = table.Read<uint32_t>();
+		const uint32_t mesh     = table.Read<uint32_t>();
+		const uint32_t material = table.Read<uint32_t>();
+		const bool hasTransform = table.Read<uint32_t>() != 0;
+		const Transform transform = table.Read<Transform>();
+		if (hasTransform)         nodes[i]->transform = transform;
+		if (mesh != ~0u)          nodes[i]->mesh      = meshes.at(mesh);
+		if (material != ~0u)      nodes[i]->material  = materials.at(material);
+		// parents are written before their children
+		if (parent < i)           nodes[i]->SetParent(nodes[parent]);
+		else if (parent != ~0u)   throw std::runtime_error("Scene cache node has an invalid parent");
+	}
+	if (nodes.empty())
+		return nullptr;
+
+	std::cout << "Loaded " << path << std::endl;
+
+	return nodes[0];
+}
+
+}
\ No newline at end of file
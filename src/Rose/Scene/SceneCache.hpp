@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Rose/Core/CommandContext.hpp>
+#include "SceneNode.hpp"
+
+namespace RoseEngine {
+
+// Binary snapshot of an imported scene, stored next to the source file: the mesh buffers as laid out after import,
+// packed materials, the node hierarchy and every mip level of the textures. Loading memory maps the file and copies
+// each section straight into upload buffers, skipping parsing, image decoding, mesh processing and mip generation.
+class SceneCache {
+public:
+	// Import settings that change the cached data. A cache written with different options is ignored.
+	enum Options : uint32_t {
+		eNone             = 0,
+		eQuantizeVertices = 1,
+		eCompressTextures = 2,
+		eCompressTexturesHighQuality = 4,
+	};
+
+private:
+	std::filesystem::path   mSource;
+	uint32_t                mOptions = 0;
+	std::vector<std::byte>  mTable;
+	std::vector<BufferView> mSections; // host copies of the mesh buffers and image levels
+	uint64_t                mReadySignal = 0;
+
+public:
+	static std::filesystem::path GetPath(const std::filesystem::path& source);
+
+	// Loads the cache of source if one was written from the current version of the file and of the files it refers to,
+	// with the same options. Returns nullptr otherwise.
+	static ref<SceneNode> Load(CommandContext& context, const std::filesystem::path& source, const uint32_t options);
+
+	// Describes the scene below root, and records copies of its device buffers and images to host buffers.
+	// Write may be called once the commands recorded in context are done.
+	// dependencies are the files source refers to, relative to its directory. The cache is out of date when any of them changes.
+	static SceneCache Record(CommandContext& context, const ref<SceneNode>& root, const std::filesystem::path& source, const uint32_t options, const std::vector<std::filesystem::path>& dependencies = {});
+
+	inline const std::filesystem::path& Source() const { return mSource; }
+	inline bool IsReady(const Device& device) const { return device.CurrentTimelineValue() >= mReadySignal; }
+
+	// Writes the cache file. Returns its size in bytes.
+	size_t Write() const;
+};
+
+}
\ No newline at end of file
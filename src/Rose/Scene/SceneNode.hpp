@@ -9,11 +9,20 @@
 
 namespace RoseEngine {
 
+enum class SceneNodeDirtyFlags : uint32_t {
+	eNone       = 0,
+	eTransform  = 1, // transform changed, so world transforms below this node are out of date
+	eMaterial   = 2, // contents of material changed
+	eStructure  = 4, // children, mesh or material were replaced. requires a full scene rebuild
+	eDescendant = 8, // set on every ancestor of a dirty node
+};
+
 class SceneNode : public std::enable_shared_from_this<SceneNode> {
 private:
 	std::string                 name = "";
 	weak_ref<SceneNode>         parent = {};
 	std::vector<ref<SceneNode>> children = {};
+	uint32_t                    dirtyFlags = 0;
 
 	inline SceneNode() {}
 
@@ -31,6 +40,17 @@ public:
 
 	inline const std::string& Name() const { return name; }
 
+	// Marks this node for Scene::PreRender, which only visits dirty subtrees.
+	// Must be called after modifying transform, mesh or material.
+	inline void SetDirty(const SceneNodeDirtyFlags flags) {
+		dirtyFlags |= (uint32_t)flags;
+		for (ref<SceneNode> p = GetParent(); p && !p->IsDirty(SceneNodeDirtyFlags::eDescendant); p = p->GetParent())
+			p->dirtyFlags |= (uint32_t)SceneNodeDirtyFlags::eDescendant;
+	}
+	inline bool IsDirty(const SceneNodeDirtyFlags flags) const { return (dirtyFlags & (uint32_t)flags) != 0; }
+	inline bool IsDirty() const { return dirtyFlags != 0; }
+	inline void ClearDirty() { dirtyFlags = 0; }
+
 	inline ref<SceneNode> GetParent() {
 		return parent.lock();
 	}
@@ -40,16 +60,22 @@ public:
 		if (newParent) newParent->children.emplace_back(shared_from_this());
 		if (oldParent) oldParent->children.erase(std::ranges::find(oldParent->children, this, &ref<SceneNode>::get));
 		parent = newParent;
+		if (newParent) newParent->SetDirty(SceneNodeDirtyFlags::eStructure);
+		if (oldParent) oldParent->SetDirty(SceneNodeDirtyFlags::eStructure);
 	}
 
 	inline void AddChild(const ref<SceneNode>& c) {
-		if (!std::ranges::contains(children, c))
+		if (!std::ranges::contains(children, c)) {
 			children.emplace_back(c);
+			SetDirty(SceneNodeDirtyFlags::eStructure);
+		}
 	}
 
 	inline void RemoveChild(const SceneNode* c) {
-		if (auto it = std::ranges::find(children, c, &ref<SceneNode>::get); it != children.end())
+		if (auto it = std::ranges::find(children, c, &ref<SceneNode>::get); it != children.end()) {
 			children.erase(it);
+			SetDirty(SceneNodeDirtyFlags::eStructure);
+		}
 	}
 
 	inline auto begin() { return children.begin(); }
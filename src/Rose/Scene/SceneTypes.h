@@ -9,12 +9,23 @@
 
 namespace RoseEngine {
 
+// Encoding of a vertex attribute stream. Quantized streams are written by Mesh::Quantize.
+enum VertexAttributeFormat {
+	eFloat        = 0, // 32-bit floats
+	eSnorm16      = 1, // positions as 16-bit SNORM xyz (8 byte stride), see MeshHeader::DequantizePosition
+	eUnorm16      = 2, // texcoords as 16-bit UNORM
+	eOctahedral16 = 3, // unit vectors as 16-bit octahedral coordinates, see PackOctahedral
+};
+
 struct VertexAttribute {
     uint bufferOffset;
     uint packed;
 
-    inline uint GetBufferIndex() { return BF_GET(packed, 0, 27); }
-    SLANG_MUTATING inline void SetBufferIndex(uint i) { BF_SET(packed, i, 0, 27); }
+    inline uint GetBufferIndex() { return BF_GET(packed, 0, 24); }
+    SLANG_MUTATING inline void SetBufferIndex(uint i) { BF_SET(packed, i, 0, 24); }
+
+    inline uint GetFormat() { return BF_GET(packed, 24, 3); }
+    SLANG_MUTATING inline void SetFormat(uint i) { BF_SET(packed, i, 24, 3); }
 
     inline uint GetStride() { return BF_GET(packed, 27, 5); }
     SLANG_MUTATING inline void SetStride(uint i) { BF_SET(packed, i, 27, 5); }
@@ -28,6 +39,10 @@ struct VertexAttribute {
         get { return GetStride(); }
         set { SetStride(newValue); }
     }
+    property VertexAttributeFormat format {
+        get { return (VertexAttributeFormat)GetFormat(); }
+        set { SetFormat((uint)newValue); }
+    }
 #endif
 };
 struct MeshHeader {
@@ -35,6 +50,18 @@ struct MeshHeader {
 	VertexAttribute positions;
 	VertexAttribute normals;
 	VertexAttribute texcoords;
+	// Mesh::meshletBuffer regions. Strides are unused.
+	VertexAttribute meshlets;
+	VertexAttribute meshletVertices;
+	VertexAttribute meshletTriangles;
+	uint            meshletCount;
+	// Quantized positions decode to positionOffset + positionScale * value. Identity for float positions.
+	float           positionOffset[3];
+	float           positionScale[3];
+
+	inline float3 DequantizePosition(const float3 v) CPP_CONST {
+		return float3(positionOffset[0], positionOffset[1], positionOffset[2]) + float3(positionScale[0], positionScale[1], positionScale[2]) * v;
+	}
 };
 struct InstanceHeader {
     uint transformIndex;
@@ -47,7 +74,8 @@ enum MaterialFlags {
 	eNone        = 0,
 	eAlphaCutoff = 1,
 	eAlphaBlend  = 2,
-	eDoubleSided = 4
+	eDoubleSided = 4,
+	eNormalMapXY = 8  // the bump map only stores xy (e.g. BC5), so z is reconstructed when sampling
 };
 
 #ifdef __cplusplus
@@ -195,16 +223,34 @@ inline MeshHeader PackMesh(const Mesh& mesh, std::unordered_map<ref<Buffer>, uin
 	m.positions.bufferOffset = positionsBuf.mOffset + positionsLayout.offset;
 	m.positions.SetBufferIndex(find_or_emplace(positionsBuf));
 	m.positions.SetStride(positionsLayout.stride);
+	m.positions.SetFormat(positionsLayout.format == vk::Format::eR16G16B16A16Snorm ? VertexAttributeFormat::eSnorm16 : VertexAttributeFormat::eFloat);
+	for (uint32_t i = 0; i < 3; i++) {
+		m.positionOffset[i] = mesh.positionOffset[i];
+		m.positionScale[i]  = mesh.positionScale[i];
+	}
 
 	const auto& [normalsBuf, normalsLayout] = mesh.vertexAttributes.at(MeshVertexAttributeType::eNormal)[0];
 	m.normals.bufferOffset = normalsBuf.mOffset + normalsLayout.offset;
 	m.normals.SetBufferIndex(find_or_emplace(normalsBuf));
 	m.normals.SetStride(normalsLayout.stride);
+	m.normals.SetFormat(normalsLayout.format == vk::Format::eR16G16Unorm ? VertexAttributeFormat::eOctahedral16 : VertexAttributeFormat::eFloat);
 
 	const auto& [texcoordsBuf, texcoordsLayout] = mesh.vertexAttributes.at(MeshVertexAttributeType::eTexcoord)[0];
 	m.texcoords.bufferOffset = texcoordsBuf.mOffset + texcoordsLayout.offset;
 	m.texcoords.SetBufferIndex(find_or_emplace(texcoordsBuf));
 	m.texcoords.SetStride(texcoordsLayout.stride);
+	m.texcoords.SetFormat(texcoordsLayout.format == vk::Format::eR16G16Unorm ? VertexAttributeFormat::eUnorm16 : VertexAttributeFormat::eFloat);
+
+	m.meshletCount = mesh.meshletCount;
+	if (mesh.meshletBuffer) {
+		const uint32_t meshletBufferIndex = find_or_emplace(mesh.meshletBuffer);
+		m.meshlets.bufferOffset         = mesh.meshletBuffer.mOffset;
+		m.meshletVertices.bufferOffset  = m.meshlets.bufferOffset + mesh.meshletCount * sizeof(Meshlet);
+		m.meshletTriangles.bufferOffset = m.meshletVertices.bufferOffset + mesh.meshletVertexCount * sizeof(uint32_t);
+		m.meshlets.SetBufferIndex(meshletBufferIndex);
+		m.meshletVertices.SetBufferIndex(meshletBufferIndex);
+		m.meshletTriangles.SetBufferIndex(meshletBufferIndex);
+	}
 
 	return m;
 }
@@ -0,0 +1,82 @@
+#include "TransformHierarchy.hpp"
+
+namespace RoseEngine {
+
+void TransformHierarchy::Build(SceneNode& root) {
+	nodes.clear();
+	parents.clear();
+	levelOffsets.clear();
+	nodeIndices.clear();
+
+	// breadth first, so that nodes end up sorted by depth
+	nodes.emplace_back(&root);
+	parents.emplace_back(kInvalidIndex);
+	levelOffsets.emplace_back(0);
+	for (uint32_t levelStart = 0; levelStart < nodes.size();) {
+		const uint32_t levelEnd = (uint32_t)nodes.size();
+		levelOffsets.emplace_back(levelEnd);
+		for (uint32_t i = levelStart; i < levelEnd; i++) {
+			for (const ref<SceneNode>& c : *nodes[i]) {
+				nodes.emplace_back(c.get());
+				parents.emplace_back(i);
+			}
+		}
+		levelStart = levelEnd;
+	}
+
+	nodeIndices.reserve(nodes.size());
+	for (uint32_t i = 0; i < nodes.size(); i++)
+		nodeIndices.emplace(nodes[i], i);
+
+	localTransforms.resize(nodes.size());
+	worldTransforms.resize(nodes.size());
+	SyncLocalTransforms();
+}
+
+void TransformHierarchy::SyncLocalTransforms() {
+	localTransforms[0] = Transform::Identity();
+	for (uint32_t i = 1; i < nodes.size(); i++)
+		localTransforms[i] = nodes[i]->transform.value_or(Transform::Identity());
+}
+
+void TransformHierarchy::Propagate() {
+	if (nodes.empty()) return;
+	worldTransforms[0] = localTransforms[0];
+	for (uint32_t i = 1; i < nodes.size(); i++)
+		worldTransforms[i] = worldTransforms[parents[i]] * localTransforms[i];
+}
+
+void TransformHierarchy::PropagateParallel(ThreadPool& pool, const uint32_t minParallelLevelSize) {
+	if (nodes.empty()) return;
+	// the calling thread takes a chunk too
+	const uint32_t threadCount = pool.ThreadCount() + 1;
+
+	auto propagateRange = [&](const uint32_t start, const uint32_t end) {
+		for (uint32_t i = start; i < end; i++)
+			worldTransforms[i] = worldTransforms[parents[i]] * localTransforms[i];
+	};
+
+	worldTransforms[0] = localTransforms[0];
+
+	std::vector<std::future<void>> chunks;
+	for (size_t level = 1; level < LevelCount(); level++) {
+		const uint32_t start = levelOffsets[level];
+		const uint32_t end   = levelOffsets[level + 1];
+		const uint32_t count = end - start;
+		if (count < minParallelLevelSize) {
+			propagateRange(start, end);
+			continue;
+		}
+
+		// every node in a level only reads from the previous level, so the level can be split freely
+		const uint32_t chunkSize = (count + threadCount - 1) / threadCount;
+		for (uint32_t chunkStart = start + chunkSize; chunkStart < end; chunkStart += chunkSize)
+			chunks.emplace_back(pool.Push([=]() { propagateRange(chunkStart, std::min(chunkStart + chunkSize, end)); }));
+		propagateRange(start, std::min(start + chunkSize, end));
+		for (std::future<void>& c : chunks)
+			c.get();
+		chunks.clear();
+	}
+}
+
+}
\ No newline at end of file
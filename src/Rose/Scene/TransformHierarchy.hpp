@@ -0,0 +1,53 @@
+#pragma once
+
+#include <unordered_map>
+
+#include <Rose/Core/ThreadPool.hpp>
+#include "SceneNode.hpp"
+
+namespace RoseEngine {
+
+// Flattened copy of a SceneNode tree, stored as arrays sorted by depth so that every parent comes before its children.
+// World transforms are propagated with one linear pass over the arrays, or in parallel within each depth level,
+// instead of chasing child pointers.
+class TransformHierarchy {
+public:
+	static constexpr uint32_t kInvalidIndex = ~0u;
+
+	std::vector<SceneNode*> nodes = {};
+	std::vector<uint32_t>   parents = {}; // kInvalidIndex for the root
+	std::vector<Transform>  localTransforms = {};
+	std::vector<Transform>  worldTransforms = {};
+	std::vector<uint32_t>   levelOffsets = {}; // nodes at depth d are in [levelOffsets[d], levelOffsets[d+1])
+
+	inline size_t size() const { return nodes.size(); }
+	inline bool empty() const { return nodes.empty(); }
+	inline size_t LevelCount() const { return levelOffsets.empty() ? 0 : levelOffsets.size() - 1; }
+
+	inline uint32_t Find(const SceneNode* n) const {
+		const auto it = nodeIndices.find(n);
+		return it == nodeIndices.end() ? kInvalidIndex : it->second;
+	}
+	inline const Transform* GetWorldTransform(const SceneNode* n) const {
+		const uint32_t i = Find(n);
+		return i == kInvalidIndex ? nullptr : &worldTransforms[i];
+	}
+
+	// Flattens the tree below root. The root's own transform is ignored, as in Scene::PreRender.
+	void Build(SceneNode& root);
+
+	// Copies transforms from the SceneNodes into localTransforms
+	void SyncLocalTransforms();
+
+	// Computes worldTransforms from localTransforms in one pass
+	void Propagate();
+
+	// Computes worldTransforms from localTransforms, splitting large levels across the pool's threads and the calling thread.
+	// Levels smaller than minParallelLevelSize are done on the calling thread.
+	void PropagateParallel(ThreadPool& pool, const uint32_t minParallelLevelSize = 4096);
+
+private:
+	std::unordered_map<const SceneNode*, uint32_t> nodeIndices = {};
+};
+
+}
\ No newline at end of file
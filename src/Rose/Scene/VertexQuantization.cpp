@@ -0,0 +1,67 @@
+#include "VertexQuantization.hpp"
+
+#include <Rose/Core/MathUtils.h>
+
+namespace RoseEngine {
+
+template<typename T>
+inline T LoadVertex(const std::byte* data, const uint32_t stride, const uint32_t i) {
+	return *reinterpret_cast<const T*>(data + size_t(i) * stride);
+}
+
+std::vector<uint2> QuantizePositions(const std::byte* positions, const uint32_t stride, const uint32_t count, float3& offset, float3& scale) {
+	float3 aabbMin = float3( std::numeric_limits<float>::infinity());
+	float3 aabbMax = float3(-std::numeric_limits<float>::infinity());
+	for (uint32_t i = 0; i < count; i++) {
+		const float3 p = LoadVertex<float3>(positions, stride, i);
+		aabbMin = min(aabbMin, p);
+		aabbMax = max(aabbMax, p);
+	}
+	if (count == 0)
+		aabbMin = aabbMax = float3(0);
+
+	offset = (aabbMin + aabbMax) / 2.f;
+	scale  = (aabbMax - aabbMin) / 2.f;
+
+	// flat axes decode to the offset
+	const float3 invScale = float3(
+		scale.x > 0 ? 1 / scale.x : 0,
+		scale.y > 0 ? 1 / scale.y : 0,
+		scale.z > 0 ? 1 / scale.z : 0);
+
+	std::vector<uint2> result(count);
+	for (uint32_t i = 0; i < count; i++)
+		result[i] = PackSnorm16x3((LoadVertex<float3>(positions, stride, i) - offset) * invScale);
+	return result;
+}
+
+std::vector<uint32_t> QuantizeNormals(const std::byte* normals, const uint32_t stride, const uint32_t count) {
+	std::vector<uint32_t> result(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const float3 n = LoadVertex<float3>(normals, stride, i);
+		result[i] = PackOctahedral(n != float3(0) ? n : float3(0, 0, 1));
+	}
+	return result;
+}
+
+std::vector<uint32_t> QuantizeTangents(const std::byte* tangents, const uint32_t stride, const uint32_t count) {
+	std::vector<uint32_t> result(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const float4 t = LoadVertex<float4>(tangents, stride, i);
+		result[i] = PackOctahedralTangent(float3(t) != float3(0) ? t : float4(1, 0, 0, t.w));
+	}
+	return result;
+}
+
+std::vector<uint32_t> QuantizeTexcoords(const std::byte* texcoords, const uint32_t stride, const uint32_t count) {
+	std::vector<uint32_t> result(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const float2 uv = LoadVertex<float2>(texcoords, stride, i);
+		if (!(uv.x >= 0 && uv.x <= 1 && uv.y >= 0 && uv.y <= 1))
+			return {};
+		result[i] = PackUnorm16x2(uv);
+	}
+	return result;
+}
+
+}
\ No newline at end of file
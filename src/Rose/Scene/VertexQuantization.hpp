@@ -0,0 +1,27 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <Rose/Core/MathTypes.hpp>
+
+namespace RoseEngine {
+
+// Quantized copies of vertex streams, in the encodings of VertexAttributeFormat (SceneTypes.h).
+// Inputs are strided arrays of 32-bit floats.
+
+// 16-bit SNORM xyz, 8 bytes per vertex, relative to the bounds of the positions.
+// Positions decode to offset + scale * value, where offset is the center of the bounds and scale is half their size.
+std::vector<uint2> QuantizePositions(const std::byte* positions, const uint32_t stride, const uint32_t count, float3& offset, float3& scale);
+
+// 16-bit octahedral coordinates, 4 bytes per vertex
+std::vector<uint32_t> QuantizeNormals(const std::byte* normals, const uint32_t stride, const uint32_t count);
+
+// 16-bit octahedral coordinates with the bitangent sign (w) in the top bit, 4 bytes per vertex
+std::vector<uint32_t> QuantizeTangents(const std::byte* tangents, const uint32_t stride, const uint32_t count);
+
+// 16-bit UNORM uv, 4 bytes per vertex. Returns an empty vector if any texcoord is outside of [0,1],
+// since wrapping texcoords would lose too much precision.
+std::vector<uint32_t> QuantizeTexcoords(const std::byte* texcoords, const uint32_t stride, const uint32_t count);
+
+}
\ No newline at end of file
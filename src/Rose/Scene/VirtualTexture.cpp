@@ -0,0 +1,371 @@
+#include "VirtualTexture.hpp"
+
+#include <Rose/Core/Gui.hpp>
+#include <Rose/Core/TextureCompression.hpp>
+
+#include <bit>
+#include <cinttypes>
+#include <cstring>
+
+namespace RoseEngine {
+
+namespace {
+
+// Copies a tile and its border out of a level. The border wraps around the level, like the scene's sampler.
+std::vector<uint8_t> CutTile(const std::vector<uint8_t>& level, const uint2 extent, const uint2 tile) {
+	std::vector<uint8_t> texels(kVirtualTileStride * kVirtualTileStride * 4);
+	for (uint32_t y = 0; y < kVirtualTileStride; y++) {
+		const uint32_t sy = (tile.y * kVirtualTileSize + y + extent.y - kVirtualTileBorder) % extent.y;
+		for (uint32_t x = 0; x < kVirtualTileStride; x++) {
+			const uint32_t sx = (tile.x * kVirtualTileSize + x + extent.x - kVirtualTileBorder) % extent.x;
+			std::memcpy(&texels[(size_t(y) * kVirtualTileStride + x) * 4], &level[(size_t(sy) * extent.x + sx) * 4], 4);
+		}
+	}
+	return texels;
+}
+
+uint2 TileCount(const uint2 levelExtent) {
+	return (levelExtent + kVirtualTileSize - 1) / kVirtualTileSize;
+}
+
+}
+
+VirtualTextureCache::VirtualTextureCache(const uint32_t loaderThreadCount) {
+	mLoader = std::make_unique<ThreadPool>(loaderThreadCount);
+}
+VirtualTextureCache::~VirtualTextureCache() {
+	// finish running loads before the images they read are destroyed
+	mLoader.reset();
+}
+
+ImageView VirtualTextureCache::Add(CommandContext& context, std::vector<uint8_t>&& rgba, const uint2 extent, const bool srgb, const std::string& name) {
+	if (rgba.size() != size_t(extent.x) * extent.y * 4)
+		throw std::runtime_error("Virtual texture " + name + " is not RGBA8");
+
+	// levels which fit in a tile form the tail
+	uint32_t tailLevel = 0;
+	while (std::max(extent.x >> tailLevel, extent.y >> tailLevel) > kVirtualTileSize)
+		tailLevel++;
+	if (tailLevel > kMaxVirtualLevels)
+		throw std::runtime_error("Virtual texture " + name + " is too large");
+
+	const uint32_t mipLevels = GetMaxMipLevels(uint3(extent, 1));
+	std::vector<std::vector<uint8_t>> levels(mipLevels);
+	levels[0] = std::move(rgba);
+	for (uint32_t level = 1; level < mipLevels; level++)
+		levels[level] = DownsampleRGBA8(levels[level - 1], uint2(GetLevelExtent(uint3(extent, 1), level - 1)), uint2(GetLevelExtent(uint3(extent, 1), level)), srgb);
+
+	// upload the tail
+	const uint3 tailExtent = GetLevelExtent(uint3(extent, 1), tailLevel);
+	std::vector<uint8_t> tailTexels;
+	std::vector<vk::BufferImageCopy> regions;
+	for (uint32_t level = tailLevel; level < mipLevels; level++) {
+		const uint3 e = GetLevelExtent(uint3(extent, 1), level);
+		regions.emplace_back(vk::BufferImageCopy{
+			.bufferOffset = tailTexels.size(),
+			.imageSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level - tailLevel, 0, 1 },
+			.imageExtent = vk::Extent3D{ e.x, e.y, 1 } });
+		tailTexels.insert(tailTexels.end(), levels[level].begin(), levels[level].end());
+	}
+	const ImageView tail = ImageView::Create(Image::Create(context.GetDevice(), ImageInfo{
+		.format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm,
+		.extent = tailExtent,
+		.mipLevels = mipLevels - tailLevel,
+		.queueFamilies = { context.QueueFamily() } }));
+	context.GetDevice().SetDebugName(**tail.mImage, name + " (virtual texture tail)");
+	context.Copy(context.UploadData(tailTexels), tail.mImage, regions);
+	mStats.tailBytes += tailTexels.size();
+
+	if (tailLevel == 0)
+		return tail;
+
+	const ref<VirtualImage> image = make_ref<VirtualImage>();
+	image->header.extent    = extent;
+	image->header.tailLevel = tailLevel;
+	image->header.flags     = srgb ? eVirtualImageSrgb : 0;
+	for (uint32_t level = 0; level < tailLevel; level++) {
+		image->header.pageTableOffsets[level] = (uint32_t)mPageTable.size();
+		const uint2 tiles = TileCount(uint2(GetLevelExtent(uint3(extent, 1), level)));
+		for (uint32_t y = 0; y < tiles.y; y++)
+			for (uint32_t x = 0; x < tiles.x; x++) {
+				mPages.emplace_back(Page{ (uint32_t)mImages.size(), level, uint2(x, y) });
+				mPageTable.emplace_back(0);
+			}
+		mStats.virtualBytes += levels[level].size();
+	}
+	levels.resize(tailLevel);
+	image->levels = std::move(levels);
+	image->tail   = tail.mImage;
+
+	mTailImages.emplace(tail.mImage.get(), (uint32_t)mImages.size());
+	mImages.emplace_back(image);
+	mPageTableDirty = true;
+
+	mStats.imageCount = (uint32_t)mImages.size();
+	mStats.pageCount  = (uint32_t)mPages.size();
+
+	return tail;
+}
+
+const VirtualImageHeader* VirtualTextureCache::Find(const Image& image) const {
+	const auto it = mTailImages.find(&image);
+	if (it == mTailImages.end()) return nullptr;
+	// the tail may have been destroyed, and image allocated at its address
+	const VirtualImage& v = *mImages[it->second];
+	return v.tail.expired() ? nullptr : &v.header;
+}
+
+void VirtualTextureCache::Clear(CommandContext& context) {
+	if (mImages.empty()) return;
+
+	// pending loads hold their image, so they can be dropped. CreateResources replaces the page table and request buffers
+	const uint64_t retireSignal = context.GetDevice().NextTimelineSignal();
+	if (mPageTableBuffer) {
+		mRetiredResources.push((BufferView)mPageTableBuffer, retireSignal);
+		mRetiredResources.push((BufferView)mRequestsBuffer, retireSignal);
+		mRetiredResources.push((BufferView)mRequestsReadback, retireSignal);
+	}
+	mPageTableBuffer  = {};
+	mRequestsBuffer   = {};
+	mRequestsReadback = {};
+	mRequestsSignal   = 0;
+
+	mImages.clear();
+	mTailImages.clear();
+	mPages.clear();
+	mPageTable.clear();
+	mHostRequests.clear();
+	mPendingLoads.clear();
+	std::ranges::fill(mTilePages, UINT32_MAX);
+	std::ranges::fill(mTileLastUsed, uint64_t(0));
+	mStats = {};
+}
+
+void VirtualTextureCache::SetTileCapacity(const uint32_t tileCount) {
+	// the cache image is at most 16384 texels wide
+	const uint32_t maxColumns = 16384 / kVirtualTileStride;
+	const uint32_t capacity = std::clamp(tileCount, 1u, maxColumns * maxColumns);
+	if (capacity == mTileCapacity) return;
+	mTileCapacity = capacity;
+	// evict everything. CreateResources replaces the cache image
+	std::ranges::fill(mPageTable, 0u);
+	mPageTableDirty = true;
+	mTilePages.clear();
+	mTileLastUsed.clear();
+	mStats.residentTiles = 0;
+}
+
+void VirtualTextureCache::RequestPages(const std::span<const uint32_t> pages) {
+	mHostRequests.resize((mPages.size() + 31) / 32);
+	for (const uint32_t page : pages)
+		if (page < mPages.size())
+			mHostRequests[page / 32] |= 1u << (page % 32);
+}
+
+void VirtualTextureCache::CreateResources(CommandContext& context) {
+	Device& device = context.GetDevice();
+	const uint64_t retireSignal = device.NextTimelineSignal();
+
+	if (!mResidency) {
+		mResidency = device.Residency().Register({
+			.name = "Virtual texture tile cache",
+			.priority = 0.5f,
+			.size = [this]() {
+				return !mImages.empty() && mTileCapacity > minTileCapacity ? vk::DeviceSize(mTileCapacity - std::max(mTileCapacity/2, minTileCapacity)) * kVirtualTileStride * kVirtualTileStride * 4 : 0;
+			},
+			.evict = [this](CommandContext&, const vk::DeviceSize) -> vk::DeviceSize {
+				// halve the cache. The current image is retired when CreateResources replaces it
+				const uint32_t capacity = mTileCapacity;
+				SetTileCapacity(std::max(mTileCapacity/2, minTileCapacity));
+				return vk::DeviceSize(capacity - mTileCapacity) * kVirtualTileStride * kVirtualTileStride * 4;
+			} });
+	}
+	mResidency.Touch(retireSignal);
+
+	// a single tile without virtual images, so that the scene's parameters are always bound
+	const uint32_t capacity = mImages.empty() ? 1 : mTileCapacity;
+	if (!mTileCache || mTilePages.size() != capacity) {
+		if (mTileCache)
+			mRetiredResources.push(mTileCache.mImage, retireSignal);
+		mTileColumns = (uint32_t)std::ceil(std::sqrt((double)capacity));
+		const uint32_t rows = (capacity + mTileColumns - 1) / mTileColumns;
+		const ref<Image> cache = Image::Create(device, ImageInfo{
+			.createFlags = vk::ImageCreateFlagBits::eMutableFormat,
+			.format = vk::Format::eR8G8B8A8Unorm,
+			.extent = uint3(mTileColumns * kVirtualTileStride, rows * kVirtualTileStride, 1),
+			.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+			.queueFamilies = { context.QueueFamily() } });
+		device.SetDebugName(**cache, "Virtual texture tile cache");
+		mTileCache     = ImageView::Create(cache);
+		mTileCacheSrgb = ImageView::Create(cache, vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }, vk::ImageViewType::e2D, {}, vk::Format::eR8G8B8A8Srgb);
+		context.ClearColor(mTileCache, vk::ClearColorValue(std::array<float,4>{ 0, 0, 0, 0 }));
+		mTilePages.assign(capacity, UINT32_MAX);
+		mTileLastUsed.assign(capacity, 0);
+	}
+
+	const size_t pageCount = std::max<size_t>(mPageTable.size(), 1);
+	if (!mPageTableBuffer || mPageTableBuffer.size() != pageCount) {
+		if (mPageTableBuffer) {
+			mRetiredResources.push((BufferView)mPageTableBuffer, retireSignal);
+			mRetiredResources.push((BufferView)mRequestsBuffer, retireSignal);
+			mRetiredResources.push((BufferView)mRequestsReadback, retireSignal);
+		}
+		const size_t wordCount = (pageCount + 31) / 32;
+		mPageTableBuffer  = Buffer::Create(device, pageCount * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferDst).cast<uint32_t>();
+		mRequestsBuffer   = Buffer::Create(device, wordCount * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferSrc|vk::BufferUsageFlagBits::eTransferDst).cast<uint32_t>();
+		mRequestsReadback = Buffer::Create(device, std::vector<uint32_t>(wordCount), vk::BufferUsageFlagBits::eTransferDst);
+		device.SetDebugName(**mPageTableBuffer.mBuffer, "Virtual texture page table");
+		device.SetDebugName(**mRequestsBuffer.mBuffer,  "Virtual texture requests");
+		context.Fill(mRequestsBuffer, 0u);
+		mRequestsSignal = 0;
+		mPageTableDirty = true;
+	}
+}
+
+void VirtualTextureCache::ProcessRequests() {
+	mGeneration++;
+	mStats.requestedTiles = 0;
+	mStats.pageFaults = 0;
+	const size_t wordCount = std::max<size_t>(mRequestsReadback.size(), mHostRequests.size());
+	for (uint32_t word = 0; word < wordCount; word++) {
+		uint32_t bits =
+			(word < mRequestsReadback.size() ? mRequestsReadback[word] : 0) |
+			(word < mHostRequests.size()     ? mHostRequests[word]     : 0);
+		while (bits != 0) {
+			const uint32_t page = word * 32 + std::countr_zero(bits);
+			bits &= bits - 1;
+			if (page >= mPages.size()) break;
+
+			mStats.requestedTiles++;
+			if (mPageTable[page] != 0) {
+				mTileLastUsed[mPageTable[page] - 1] = mGeneration;
+				continue;
+			}
+			mStats.pageFaults++;
+			if (mPendingLoads.contains(page) || mPendingLoads.size() >= maxPendingLoads)
+				continue;
+
+			const Page& p = mPages[page];
+			const ref<const VirtualImage> image = mImages[p.imageIndex];
+			mPendingLoads.emplace(page, mLoader->Push([=]() {
+				return CutTile(image->levels[p.level], uint2(GetLevelExtent(uint3(image->header.extent, 1), p.level)), p.tile);
+			}));
+		}
+	}
+	mHostRequests.clear();
+	mStats.totalRequests += mStats.requestedTiles;
+	mStats.totalFaults   += mStats.pageFaults;
+}
+
+uint32_t VirtualTextureCache::AllocateTile() {
+	// a free tile, or the least recently requested one. Tiles requested by the last readback, or uploaded since,
+	// are kept: readbacks arrive every few frames, so a frame counter would evict tiles which are still in use.
+	uint32_t best = UINT32_MAX;
+	for (uint32_t i = 0; i < mTilePages.size(); i++) {
+		if (mTilePages[i] == UINT32_MAX)
+			return i;
+		if (mTileLastUsed[i] < mGeneration && (best == UINT32_MAX || mTileLastUsed[i] < mTileLastUsed[best]))
+			best = i;
+	}
+	if (best != UINT32_MAX) {
+		mPageTable[mTilePages[best]] = 0;
+		mTilePages[best] = UINT32_MAX;
+		mStats.residentTiles--;
+		mStats.evictions++;
+	}
+	return best;
+}
+
+void VirtualTextureCache::UploadTiles(CommandContext& context) {
+	std::vector<uint8_t> texels;
+	std::vector<vk::BufferImageCopy> copies;
+	for (auto it = mPendingLoads.begin(); it != mPendingLoads.end() && copies.size() < maxUploadsPerFrame;) {
+		auto&[page, load] = *it;
+		if (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			it++;
+			continue;
+		}
+		const uint32_t tile = AllocateTile();
+		if (tile == UINT32_MAX)
+			break; // every tile was requested by the last readback. The cache is too small for the view
+
+		const std::vector<uint8_t> tileTexels = load.get();
+		copies.emplace_back(vk::BufferImageCopy{
+			.bufferOffset = texels.size(),
+			.imageSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+			.imageOffset = vk::Offset3D{ int32_t(tile % mTileColumns * kVirtualTileStride), int32_t(tile / mTileColumns * kVirtualTileStride), 0 },
+			.imageExtent = vk::Extent3D{ kVirtualTileStride, kVirtualTileStride, 1 } });
+		texels.insert(texels.end(), tileTexels.begin(), tileTexels.end());
+
+		mTilePages[tile]   = page;
+		mTileLastUsed[tile] = mGeneration;
+		mPageTable[page]   = tile + 1;
+		mPageTableDirty = true;
+		mStats.residentTiles++;
+		it = mPendingLoads.erase(it);
+	}
+	if (!copies.empty())
+		context.Copy(context.UploadData(texels), mTileCache.mImage, copies);
+}
+
+void VirtualTextureCache::Update(CommandContext& context, ShaderParameter& sceneParameters) {
+	Device& device = context.GetDevice();
+
+	while (mRetiredResources.can_pop(device))
+		mRetiredResources.pop();
+
+	CreateResources(context);
+
+	if (mRequestsSignal > 0 && device.CurrentTimelineValue() >= mRequestsSignal) {
+		ProcessRequests();
+		mRequestsSignal = 0;
+	}
+
+	UploadTiles(context);
+	mStats.pendingLoads = (uint32_t)mPendingLoads.size();
+
+	if (mPageTableDirty) {
+		if (!mPageTable.empty())
+			context.Copy(context.UploadData(mPageTable), mPageTableBuffer);
+		mPageTableDirty = false;
+	}
+
+	// read back the requests of the frame rendered last. Requests accumulate until the previous readback is done.
+	if (mRequestsSignal == 0 && !mPages.empty()) {
+		context.Copy(mRequestsBuffer, mRequestsReadback);
+		context.Fill(mRequestsBuffer, 0u);
+		mRequestsSignal = device.NextTimelineSignal();
+	}
+
+	sceneParameters["pageTable"]          = (BufferView)mPageTableBuffer;
+	sceneParameters["pageRequests"]       = (BufferView)mRequestsBuffer;
+	sceneParameters["tileCache"][0]       = ImageParameter{ .image = mTileCache,     .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+	sceneParameters["tileCache"][1]       = ImageParameter{ .image = mTileCacheSrgb, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+	sceneParameters["tileCacheColumns"]   = mTileColumns;
+	sceneParameters["tileCacheTexelSize"] = 1.f / float2(mTileCache.Extent());
+}
+
+void VirtualTextureCache::DrawGui() {
+	int capacity = (int)mTileCapacity;
+	if (ImGui::InputInt("Cache tiles", &capacity, 64, 1024) && capacity > 0)
+		SetTileCapacity((uint32_t)capacity);
+	ImGui::SliderInt("Max uploads per frame", (int*)&maxUploadsPerFrame, 1, 1024);
+
+	const size_t tileBytes = size_t(kVirtualTileStride) * kVirtualTileStride * 4;
+	{
+		const auto[bytes, unit] = FormatBytes(mStats.residentTiles * tileBytes);
+		const auto[capacityBytes, capacityUnit] = FormatBytes(mTileCapacity * tileBytes);
+		ImGui::Text("Resident: %u/%u tiles (%zu %s/%zu %s)", mStats.residentTiles, mTileCapacity, bytes, unit, capacityBytes, capacityUnit);
+	}
+	{
+		const auto[bytes, unit] = FormatBytes(mStats.virtualBytes);
+		const auto[tail, tailUnit] = FormatBytes(mStats.tailBytes);
+		ImGui::Text("%u virtual images: %u pages (%zu %s), tails %zu %s", mStats.imageCount, mStats.pageCount, bytes, unit, tail, tailUnit);
+	}
+	ImGui::Text("Requested %u tiles, %u page faults (%.1f%%)", mStats.requestedTiles, mStats.pageFaults,
+		mStats.requestedTiles > 0 ? 100.f * mStats.pageFaults / mStats.requestedTiles : 0.f);
+	ImGui::Text("Total page fault rate: %.2f%%", mStats.totalRequests > 0 ? 100.0 * mStats.totalFaults / mStats.totalRequests : 0.0);
+	ImGui::Text("%u loads pending, %" PRIu64 " evictions", mStats.pendingLoads, mStats.evictions);
+}
+
+}
\ No newline at end of file
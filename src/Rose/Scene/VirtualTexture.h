@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Rose/Core/RoseEngine.h>
+
+namespace RoseEngine {
+
+static const uint kVirtualTileSize   = 128; // texels of a tile along each axis, without its border
+static const uint kVirtualTileBorder = 1;   // texels of the neighbouring tiles around each tile in the cache, for bilinear filtering
+static const uint kVirtualTileStride = kVirtualTileSize + 2*kVirtualTileBorder;
+static const uint kMaxVirtualLevels  = 8;   // levels above the tail, for textures up to 32768 texels wide
+
+// Levels of a virtual image above tailLevel are split into tiles, which are loaded on demand into the tile cache
+// and found through the page table. The tail levels fit in a tile and are always resident in a regular image,
+// in Scene::images at the same index as the header.
+struct VirtualImageHeader {
+	uint2 extent;
+	uint  tailLevel; // 0 for regular images
+	uint  flags;     // VirtualImageFlags
+	uint  pageTableOffsets[kMaxVirtualLevels]; // first entry of each level in the page table. Tiles are in row major order
+};
+
+enum VirtualImageFlags {
+	eVirtualImageSrgb = 1,
+};
+
+}
\ No newline at end of file
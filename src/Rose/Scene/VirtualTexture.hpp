@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Rose/Core/CommandContext.hpp>
+#include <Rose/Core/ThreadPool.hpp>
+#include <Rose/Core/TransientResourceCache.hpp>
+#include "VirtualTexture.h"
+
+#include <variant>
+
+namespace RoseEngine {
+
+// Software virtual texturing, which needs no sparse binding support.
+// Textures larger than a tile keep their texels in host memory. Tiles of the levels above the tail are loaded
+// on demand into a fixed size tile cache, and shaders find them through a page table (see Scene::SampleImage).
+// Shaders set a bit in a request buffer for each tile they want. Fragment shaders only sample the tails, so raster
+// views request their tiles from a compute pass over the visibility buffer (see Scene::RequestMaterialTiles).
+// The buffer is read back a few frames later: missing tiles are cut from the texture on worker threads and uploaded,
+// replacing the tiles requested by the fewest recent readbacks once the cache is full. Until a tile is resident,
+// samples fall back to the closest resident coarser level.
+class VirtualTextureCache {
+public:
+	struct Stats {
+		uint32_t imageCount     = 0;
+		uint32_t pageCount      = 0; // tiles of the levels above the tail of every virtual image
+		uint32_t residentTiles  = 0;
+		size_t   virtualBytes   = 0; // of every virtual image's levels above the tail
+		size_t   tailBytes      = 0; // of the always resident tails
+		uint32_t requestedTiles = 0; // by the last frame read back
+		uint32_t pageFaults     = 0; // requested tiles which were not resident
+		uint32_t pendingLoads   = 0;
+		uint64_t totalRequests  = 0;
+		uint64_t totalFaults    = 0;
+		uint64_t evictions      = 0;
+	};
+
+private:
+	struct VirtualImage {
+		VirtualImageHeader                header = {};
+		std::vector<std::vector<uint8_t>> levels = {}; // RGBA8 texels of the levels above the tail
+		weak_ref<Image>                   tail = {};   // expires when the materials drop the tail
+	};
+	struct Page {
+		uint32_t imageIndex = 0;
+		uint32_t level = 0;
+		uint2    tile = {};
+	};
+
+	uint32_t mTileCapacity = 1024; // tiles in the cache. Changing it evicts every tile
+	uint32_t mTileColumns  = 0;
+
+	std::vector<ref<const VirtualImage>>        mImages = {};
+	std::unordered_map<const Image*, uint32_t>  mTailImages = {}; // index in mImages of each virtual image's tail
+	std::vector<Page>                           mPages = {};      // of each page table entry
+	std::vector<uint32_t>                       mPageTable = {};  // cache tile + 1 of each page, or 0 if it is not resident
+	std::vector<uint32_t>                       mHostRequests = {}; // a bit per page, set by RequestPages
+	bool                                        mPageTableDirty = false;
+
+	BufferRange<uint32_t> mPageTableBuffer = {};
+	BufferRange<uint32_t> mRequestsBuffer = {};   // a bit per page, set by shaders
+	BufferRange<uint32_t> mRequestsReadback = {};
+	uint64_t              mRequestsSignal = 0;    // timeline value after which mRequestsReadback holds a frame's requests
+	TransientResourceCache<std::variant<BufferView, ref<Image>>> mRetiredResources; // replaced, kept alive until frames using them are done
+
+	ImageView             mTileCache = {};       // UNORM view
+	ImageView             mTileCacheSrgb = {};   // sRGB view of the same image
+	std::vector<uint32_t> mTilePages = {};       // page in each cache tile, or UINT32_MAX if it is free
+	std::vector<uint64_t> mTileLastUsed = {};    // readback generation which last requested (or uploaded) each cache tile
+
+	// lets the residency manager shrink the tile cache when over budget
+	ResidencyManager::Handle mResidency = {};
+
+	std::unique_ptr<ThreadPool> mLoader;
+	std::unordered_map<uint32_t, std::future<std::vector<uint8_t>>> mPendingLoads = {}; // texels of a tile, with its border, for each page being loaded
+
+	uint64_t mGeneration = 0; // number of request readbacks processed
+	Stats    mStats = {};
+
+	void CreateResources(CommandContext& context);
+	void ProcessRequests();
+	void UploadTiles(CommandContext& context);
+	uint32_t AllocateTile();
+
+public:
+	uint32_t maxPendingLoads   = 256;
+	uint32_t maxUploadsPerFrame = 64;
+	uint32_t minTileCapacity    = 256; // the residency manager doesn't shrink the cache below this
+
+	VirtualTextureCache(const uint32_t loaderThreadCount = 2);
+	~VirtualTextureCache();
+
+	// Adds an RGBA8 texture larger than a tile, generating its mip chain in host memory. Levels above the tail
+	// are streamed, and the returned tail is uploaded right away. It stands in for the texture in materials.
+	ImageView Add(CommandContext& context, std::vector<uint8_t>&& rgba, const uint2 extent, const bool srgb, const std::string& name = "");
+
+	// The header of the virtual image whose tail is image, or nullptr if image is a regular image
+	const VirtualImageHeader* Find(const Image& image) const;
+
+	// Removes every virtual image, e.g. when the scene using them is replaced. Their tails become regular images.
+	void Clear(CommandContext& context);
+
+	inline uint32_t ImageCount() const { return (uint32_t)mImages.size(); }
+	inline uint32_t TileCapacity() const { return mTileCapacity; }
+	void SetTileCapacity(const uint32_t tileCount);
+
+	// Cache tile + 1 of each page, or 0 if it is not resident. A level's pages start at the header's pageTableOffsets.
+	inline const std::vector<uint32_t>& PageTable() const { return mPageTable; }
+	// Requests pages from the host, e.g. to prefetch them. They are processed with the next readback of shader requests.
+	void RequestPages(const std::span<const uint32_t> pages);
+
+	// Reads back the requests of an earlier frame, uploads loaded tiles and the page table, and sets the tile cache
+	// and page table parameters of the scene. Called once per frame, before rendering.
+	void Update(CommandContext& context, ShaderParameter& sceneParameters);
+
+	inline const Stats& GetStats() const { return mStats; }
+	void DrawGui();
+};
+
+}
\ No newline at end of file
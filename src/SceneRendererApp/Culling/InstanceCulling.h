@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Rose/Core/RoseEngine.h>
+
+namespace RoseEngine {
+
+// Object-space bounds of an instance, and where its draw command is written
+struct InstanceCullData {
+	float3 aabbMin;
+	uint   drawIndex; // draw batch the instance belongs to, which is also the index of its draw count
+	float3 aabbMax;
+	uint   commandOffset; // first draw command of the batch, or the instance's own command without drawIndirectCount
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <Rose/Core/PipelineCache.hpp>
+#include <Rose/Core/TransientResourceCache.hpp>
+#include <Rose/Scene/Scene.hpp>
+#include "InstanceCulling.h"
+
+namespace RoseEngine {
+
+// Culls scene instances against the view frustum and a hierarchical-z pyramid of the previous frame's depth,
+// and writes one compacted DrawIndexedIndirectCommand list per draw batch for drawIndexedIndirectCount.
+// Without drawIndirectCount, each instance writes a command at a fixed slot instead, with instanceCount 0 when culled,
+// and batches are drawn with drawIndexedIndirect.
+// On devices with VK_EXT_mesh_shader, it also writes the visible instances of each batch and DrawMeshTasksIndirectCommands
+// with a row of task groups per visible instance, for DrawMeshTasks.
+class InstanceCulling {
+private:
+	PipelineCache cull        = PipelineCache(FindShaderPath("InstanceCulling.cs.slang"), "Cull");
+	PipelineCache copyDepth   = PipelineCache(FindShaderPath("InstanceCulling.cs.slang"), "CopyDepth");
+	PipelineCache reduceDepth = PipelineCache(FindShaderPath("InstanceCulling.cs.slang"), "ReduceDepth");
+
+	// indexed by instance, rebuilt when the scene's draw lists change
+	BufferRange<InstanceCullData> mCullData;
+	uint64_t mDrawListVersion = 0;
+	bool     mFixedCount = false; // whether mCullData holds a command slot per instance
+	uint32_t mInstanceCount = 0;
+	std::vector<std::pair<uint32_t/*commandOffset*/, uint32_t/*maxDrawCount*/>> mBatches; // in drawLists order
+	BufferRange<uint4>   mBatchData; // first element in mLods, level count, first command and first mesh task command of each batch
+	BufferRange<MeshLod> mLods;
+	TransientResourceCache<BufferView> mRetiredBuffers; // replaced cull data, kept alive until frames using it are done
+
+	BufferRange<vk::DrawIndexedIndirectCommand> mDrawCommands;
+	BufferRange<uint32_t> mDrawCounts;
+
+	// mesh shading: a command per mMaxMeshTaskRows visible instances of each batch, whose rows of task groups
+	// read their instance from mVisibleInstances, compacted within the batch like the compacted draw commands
+	bool     mWriteMeshTasks = false;
+	uint32_t mMaxMeshTaskRows = 1;
+	std::vector<std::pair<uint32_t/*firstCommand*/, uint32_t/*commandCount*/>> mMeshTaskBatches; // in drawLists order
+	std::vector<vk::DrawMeshTasksIndirectCommandEXT> mMeshTaskCommandsCpu; // without rows, which Cull counts
+	BufferRange<vk::DrawMeshTasksIndirectCommandEXT> mMeshTaskCommands;
+	BufferRange<uint32_t> mVisibleInstances;
+
+	ImageView              mHiZ;
+	std::vector<ImageView> mHiZMips;
+	Transform mHiZWorldToClip;
+	std::chrono::high_resolution_clock::time_point mHiZSceneVersion;
+	bool      mHiZValid = false;
+
+	// full resolution and drawn triangle counts of the visible instances
+	BufferRange<uint32_t> mTriangleCounts;
+
+	// draw and triangle counts copied to the host, available once the device reaches mDrawCountsSignal
+	BufferRange<uint32_t> mDrawCountsCpu;
+	BufferRange<uint32_t> mTriangleCountsCpu;
+	uint64_t mDrawCountsSignal = 0;
+	uint32_t mVisibleCount = 0;
+	uint32_t mFullTriangleCount = 0;
+	uint32_t mDrawnTriangleCount = 0;
+
+	inline void UpdateCullData(CommandContext& context, const SceneRenderData& renderData, const bool fixedCount) {
+		if (mCullData && mDrawListVersion == renderData.drawListVersion && mFixedCount == fixedCount)
+			return;
+		mDrawListVersion = renderData.drawListVersion;
+		mFixedCount = fixedCount;
+
+		mWriteMeshTasks = context.GetDevice().EnabledExtensions().contains(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+		const auto& meshShaderLimits = context.GetDevice().MeshShaderProperties();
+		auto taskGroupCount = [](const Mesh& mesh) { return std::max((mesh.meshletCount + 31) / 32, 1u); }; // MESHLET_GROUP_SIZE in Visibility.3d.slang
+
+		mInstanceCount = 0;
+		mMaxMeshTaskRows = mWriteMeshTasks ? meshShaderLimits.maxTaskWorkGroupCount[1] : 1;
+		for (const auto& drawList : renderData.drawLists) {
+			for (const auto& batch : drawList) {
+				for (const auto&[firstInstance, instanceCount] : batch.draws)
+					mInstanceCount = std::max(mInstanceCount, firstInstance + instanceCount);
+				if (mWriteMeshTasks)
+					mMaxMeshTaskRows = std::min(mMaxMeshTaskRows, meshShaderLimits.maxTaskWorkGroupTotalCount / taskGroupCount(*batch.mesh));
+			}
+		}
+		mMaxMeshTaskRows = std::max(mMaxMeshTaskRows, 1u);
+
+		std::vector<InstanceCullData> data(std::max(mInstanceCount, 1u));
+		std::vector<uint4>   batchData;
+		std::vector<MeshLod> lods;
+		mBatches.clear();
+		mMeshTaskBatches.clear();
+		mMeshTaskCommandsCpu.clear();
+		uint32_t commandOffset = 0;
+		for (const auto& drawList : renderData.drawLists) {
+			for (const auto& batch : drawList) {
+				batchData.emplace_back((uint32_t)lods.size(), batch.mesh->LodCount(), commandOffset, (uint32_t)mMeshTaskCommandsCpu.size());
+				for (uint32_t i = 0; i < batch.mesh->LodCount(); i++)
+					lods.emplace_back(batch.mesh->GetLod(i));
+
+				const vk::AabbPositionsKHR& aabb = batch.mesh->aabb;
+				uint32_t batchSize = 0;
+				for (const auto&[firstInstance, instanceCount] : batch.draws) {
+					for (uint32_t i = firstInstance; i < firstInstance + instanceCount; i++)
+						data[i] = InstanceCullData{
+							.aabbMin = float3(aabb.minX, aabb.minY, aabb.minZ),
+							.drawIndex = (uint32_t)mBatches.size(),
+							.aabbMax = float3(aabb.maxX, aabb.maxY, aabb.maxZ),
+							.commandOffset = commandOffset + (fixedCount ? batchSize + (i - firstInstance) : 0) };
+					batchSize += instanceCount;
+				}
+				mBatches.emplace_back(commandOffset, batchSize);
+				commandOffset += batchSize;
+
+				if (mWriteMeshTasks) {
+					const uint32_t commandCount = (batchSize + mMaxMeshTaskRows - 1) / mMaxMeshTaskRows;
+					mMeshTaskBatches.emplace_back((uint32_t)mMeshTaskCommandsCpu.size(), commandCount);
+					for (uint32_t i = 0; i < commandCount; i++)
+						mMeshTaskCommandsCpu.emplace_back(vk::DrawMeshTasksIndirectCommandEXT{ .groupCountX = taskGroupCount(*batch.mesh), .groupCountY = 0, .groupCountZ = 1 });
+				}
+			}
+		}
+
+		if (batchData.empty()) {
+			batchData.emplace_back(0u, 1u, 0u, 0u);
+			lods.emplace_back(MeshLod{});
+		}
+		if (mMeshTaskCommandsCpu.empty())
+			mWriteMeshTasks = false;
+
+		while (mRetiredBuffers.can_pop(context.GetDevice()))
+			mRetiredBuffers.pop();
+
+		auto upload = [&]<typename T>(BufferRange<T>& dst, const std::vector<T>& src) {
+			if (!dst || dst.size() < src.size()) {
+				if (dst)
+					mRetiredBuffers.push(dst, context.GetDevice().NextTimelineSignal());
+				dst = Buffer::Create(
+					context.GetDevice(),
+					sizeof(T) * src.size(),
+					vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+					vk::MemoryPropertyFlagBits::eDeviceLocal);
+			}
+			context.Copy(context.UploadData(src), dst);
+		};
+		upload(mCullData, data);
+		upload(mBatchData, batchData);
+		upload(mLods, lods);
+	}
+
+	inline void ReadDrawCounts(CommandContext& context) {
+		if (mDrawCountsSignal == 0 || context.GetDevice().CurrentTimelineValue() < mDrawCountsSignal)
+			return;
+		mVisibleCount = 0;
+		for (size_t i = 0; i < mDrawCountsCpu.size(); i++)
+			mVisibleCount += mDrawCountsCpu[i];
+		mFullTriangleCount  = mTriangleCountsCpu[0];
+		mDrawnTriangleCount = mTriangleCountsCpu[1];
+		mDrawCountsSignal = 0;
+	}
+
+public:
+	bool enableOcclusionCulling = true;
+	bool useDrawIndirectCount = true; // fixed count draws are used regardless if the device doesn't support drawIndirectCount
+
+	inline uint32_t InstanceCount() const { return mInstanceCount; }
+	// Instances that passed culling, as of a recent frame
+	inline uint32_t VisibleCount() const { return mVisibleCount; }
+	// Triangles of the visible instances at full resolution, and at the levels of detail drawn, as of a recent frame
+	inline uint32_t FullTriangleCount()  const { return mFullTriangleCount; }
+	inline uint32_t DrawnTriangleCount() const { return mDrawnTriangleCount; }
+	// Whether Cull writes the commands and instances for DrawMeshTasks
+	inline bool WritesMeshTasks() const { return mWriteMeshTasks; }
+	// Visible instances, compacted within each batch, which DrawMeshTasks' task shaders read. Written by the last Cull.
+	inline const BufferRange<uint32_t>& VisibleInstances() const { return mVisibleInstances; }
+	// Whether the last Cull wrote fixed count commands
+	inline bool UsesFixedCount() const { return mFixedCount; }
+	// Written by the last Cull, in batch order. Each batch's commands start at its first instance's slot.
+	inline const BufferRange<vk::DrawIndexedIndirectCommand>& DrawCommands() const { return mDrawCommands; }
+
+	// Writes the draw commands and counts for every batch in scene.renderData.drawLists.
+	// Each visible instance draws the coarsest level of detail of its mesh whose error, scaled by lodErrorScale
+	// (pixels per object space unit at unit distance) over the distance to the camera, is at most maxLodError pixels.
+	// The first triangle of the level is written to instanceFirstTriangles, which fragment shaders add to SV_PrimitiveID.
+	// Must be called outside of rendering, before Draw.
+	inline void Cull(CommandContext& context, const Scene& scene, const Transform& worldToClip, const float3 cameraPosition, const float lodErrorScale, const float maxLodError, const BufferRange<uint32_t>& instanceFirstTriangles) {
+		context.PushDebugLabel("InstanceCulling::Cull");
+
+		const SceneRenderData& renderData = scene.renderData;
+		UpdateCullData(context, renderData, !useDrawIndirectCount || !context.GetDevice().SupportsDrawIndirectCount());
+		ReadDrawCounts(context);
+
+		mDrawCommands = context.GetTransientBuffer<vk::DrawIndexedIndirectCommand>(std::max(mInstanceCount, 1u), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc);
+		mDrawCounts   = context.GetTransientBuffer<uint32_t>(std::max<size_t>(mBatches.size(), 1), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst);
+		context.Fill(mDrawCounts, 0u);
+		mTriangleCounts = context.GetTransientBuffer<uint32_t>(2, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst);
+		context.Fill(mTriangleCounts, 0u);
+		if (mWriteMeshTasks) {
+			mVisibleInstances  = context.GetTransientBuffer<uint32_t>(std::max(mInstanceCount, 1u), vk::BufferUsageFlagBits::eStorageBuffer);
+			mMeshTaskCommands = context.UploadData(mMeshTaskCommandsCpu, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer).cast<vk::DrawMeshTasksIndirectCommandEXT>();
+		}
+
+		// the pyramid is stale if anything in the scene moved since it was rendered
+		const bool useOcclusion = enableOcclusionCulling && mHiZValid && mHiZSceneVersion >= renderData.updateTime;
+
+		ShaderParameter params = {};
+		params["instances"]     = renderData.sceneParameters.at("instances");
+		params["transforms"]    = renderData.sceneParameters.at("transforms");
+		params["cullData"]      = (BufferParameter)mCullData;
+		params["drawCommands"]  = (BufferParameter)mDrawCommands;
+		params["drawCounts"]    = (BufferParameter)mDrawCounts;
+		params["batches"]       = (BufferParameter)mBatchData;
+		params["lods"]          = (BufferParameter)mLods;
+		params["instanceFirstTriangles"] = (BufferParameter)instanceFirstTriangles;
+		params["triangleCounts"] = (BufferParameter)mTriangleCounts;
+		params["worldToClip"]   = worldToClip;
+		params["instanceCount"] = mInstanceCount;
+		params["cameraPosition"] = cameraPosition;
+		params["lodErrorScale"] = lodErrorScale;
+		params["maxLodError"]   = maxLodError;
+		if (mWriteMeshTasks) {
+			params["visibleInstances"] = (BufferParameter)mVisibleInstances;
+			params["meshTaskCommands"] = (BufferParameter)mMeshTaskCommands.cast<uint32_t>();
+			params["maxMeshTaskRows"]  = mMaxMeshTaskRows;
+		}
+		if (useOcclusion) {
+			params["hiz"]            = ImageParameter{ .image = mHiZ, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+			params["hizWorldToClip"] = mHiZWorldToClip;
+			params["hizSize"]        = uint2(mHiZ.Extent());
+			params["hizMipCount"]    = mHiZ.GetImage()->Info().mipLevels;
+		}
+		cull(context, uint3(mInstanceCount, 1, 1), params, ShaderDefines{
+			{ "USE_OCCLUSION_CULLING",   useOcclusion ? "1" : "0" },
+			{ "USE_DRAW_INDIRECT_COUNT", mFixedCount  ? "0" : "1" },
+			{ "WRITE_MESH_TASKS",        mWriteMeshTasks ? "1" : "0" } });
+
+		context.AddBarrier(mDrawCommands, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eDrawIndirect,
+			.access = vk::AccessFlagBits2::eIndirectCommandRead,
+			.queueFamily = context.QueueFamily() });
+		context.AddBarrier(mDrawCounts, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eDrawIndirect,
+			.access = vk::AccessFlagBits2::eIndirectCommandRead,
+			.queueFamily = context.QueueFamily() });
+		if (mWriteMeshTasks) {
+			context.AddBarrier(mMeshTaskCommands, Buffer::ResourceState{
+				.stage  = vk::PipelineStageFlagBits2::eDrawIndirect,
+				.access = vk::AccessFlagBits2::eIndirectCommandRead,
+				.queueFamily = context.QueueFamily() });
+			context.AddBarrier(mVisibleInstances, Buffer::ResourceState{
+				.stage  = vk::PipelineStageFlagBits2::eTaskShaderEXT,
+				.access = vk::AccessFlagBits2::eShaderStorageRead,
+				.queueFamily = context.QueueFamily() });
+		}
+		context.AddBarrier(instanceFirstTriangles, Buffer::ResourceState{
+			.stage  = vk::PipelineStageFlagBits2::eFragmentShader,
+			.access = vk::AccessFlagBits2::eShaderRead,
+			.queueFamily = context.QueueFamily() });
+		context.ExecuteBarriers();
+
+		// read back a frame's counts at a time for statistics
+		if (mDrawCountsSignal == 0) {
+			if (!mDrawCountsCpu || mDrawCountsCpu.size() != mDrawCounts.size())
+				mDrawCountsCpu = Buffer::Create(context.GetDevice(), std::vector<uint32_t>(mDrawCounts.size()), vk::BufferUsageFlagBits::eTransferDst);
+			context.Copy(mDrawCounts, mDrawCountsCpu);
+			if (!mTriangleCountsCpu)
+				mTriangleCountsCpu = Buffer::Create(context.GetDevice(), std::vector<uint32_t>(2), vk::BufferUsageFlagBits::eTransferDst);
+			context.Copy(mTriangleCounts, mTriangleCountsCpu);
+			mDrawCountsSignal = context.GetDevice().NextTimelineSignal();
+		}
+
+		context.PopDebugLabel();
+	}
+
+	// Draws the visible instances of a batch, with the batch's pipeline, descriptors and mesh already bound.
+	// batchIndex counts batches across all of the scene's draw lists, in order.
+	inline void Draw(CommandContext& context, const uint32_t batchIndex) const {
+		const auto&[commandOffset, maxDrawCount] = mBatches[batchIndex];
+		if (maxDrawCount == 0) return;
+		if (mFixedCount) {
+			const vk::DeviceSize offset = mDrawCommands.mOffset + commandOffset * sizeof(vk::DrawIndexedIndirectCommand);
+			if (context.GetDevice().Features().multiDrawIndirect)
+				context->drawIndexedIndirect(**mDrawCommands.mBuffer, offset, maxDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+			else {
+				for (uint32_t i = 0; i < maxDrawCount; i++)
+					context->drawIndexedIndirect(**mDrawCommands.mBuffer, offset + i * sizeof(vk::DrawIndexedIndirectCommand), 1, sizeof(vk::DrawIndexedIndirectCommand));
+			}
+			return;
+		}
+		context->drawIndexedIndirectCount(
+			**mDrawCommands.mBuffer, mDrawCommands.mOffset + commandOffset * sizeof(vk::DrawIndexedIndirectCommand),
+			**mDrawCounts.mBuffer,   mDrawCounts.mOffset + batchIndex * sizeof(uint32_t),
+			maxDrawCount,
+			sizeof(vk::DrawIndexedIndirectCommand));
+	}
+
+	// Draws the visible instances of a batch with task and mesh shaders, with the batch's mesh shading pipeline and descriptors
+	// already bound. Each row of task groups reads its instance from VisibleInstances(), at the firstVisibleInstance push
+	// constant plus the row index. Requires WritesMeshTasks().
+	inline void DrawMeshTasks(CommandContext& context, const uint32_t batchIndex, const PipelineLayout& layout) const {
+		const auto&[firstCommand, commandCount] = mMeshTaskBatches[batchIndex];
+		for (uint32_t i = 0; i < commandCount; i++) {
+			ShaderParameter params = {};
+			params["firstVisibleInstance"] = mBatches[batchIndex].first + i * mMaxMeshTaskRows;
+			context.PushConstants(layout, params);
+			context->drawMeshTasksIndirectEXT(
+				**mMeshTaskCommands.mBuffer, mMeshTaskCommands.mOffset + (firstCommand + i) * sizeof(vk::DrawMeshTasksIndirectCommandEXT),
+				1,
+				sizeof(vk::DrawMeshTasksIndirectCommandEXT));
+		}
+	}
+
+	// Builds the hi-z pyramid from depth rendered with worldToClip, for occlusion culling in the next frame.
+	// Newly disoccluded instances can therefore show up a frame late.
+	inline void BuildHiZ(CommandContext& context, const Scene& scene, const ImageView& depth, const Transform& worldToClip) {
+		if (!enableOcclusionCulling) {
+			mHiZValid = false;
+			return;
+		}
+
+		context.PushDebugLabel("InstanceCulling::BuildHiZ");
+
+		if (!mHiZ || mHiZ.Extent() != depth.Extent()) {
+			mHiZ = ImageView::Create(
+				Image::Create(context.GetDevice(), ImageInfo{
+					.format = vk::Format::eR32Sfloat,
+					.extent = depth.Extent(),
+					.mipLevels = GetMaxMipLevels(depth.Extent()),
+					.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+					.queueFamilies = { context.QueueFamily() } }));
+			mHiZMips.resize(mHiZ.GetImage()->Info().mipLevels);
+			for (uint32_t i = 0; i < mHiZMips.size(); i++)
+				mHiZMips[i] = ImageView::Create(mHiZ.GetImage(), vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, i, 1, 0, 1 });
+		}
+
+		{
+			ShaderParameter params = {};
+			params["srcDepth"] = ImageParameter{ .image = depth,      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+			params["dstDepth"] = ImageParameter{ .image = mHiZMips[0], .imageLayout = vk::ImageLayout::eGeneral };
+			params["srcSize"]  = uint2(depth.Extent());
+			params["dstSize"]  = uint2(mHiZMips[0].Extent());
+			copyDepth(context, mHiZMips[0].Extent(), params);
+		}
+		for (uint32_t i = 1; i < mHiZMips.size(); i++) {
+			ShaderParameter params = {};
+			params["srcDepth"] = ImageParameter{ .image = mHiZMips[i-1], .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+			params["dstDepth"] = ImageParameter{ .image = mHiZMips[i],   .imageLayout = vk::ImageLayout::eGeneral };
+			params["srcSize"]  = uint2(mHiZMips[i-1].Extent());
+			params["dstSize"]  = uint2(mHiZMips[i].Extent());
+			reduceDepth(context, mHiZMips[i].Extent(), params);
+		}
+
+		mHiZWorldToClip  = worldToClip;
+		mHiZSceneVersion = scene.renderData.updateTime;
+		mHiZValid = true;
+
+		context.PopDebugLabel();
+	}
+};
+
+}
\ No newline at end of file
@@ -21,8 +21,7 @@ private:
 	bool opOriginWorld = false;
 
 	struct ViewportPickerData {
-		BufferRange<uint4> visibility = {};
-		uint64_t timelineCounterValue = 0;
+		ReadbackFuture<uint4> visibility = {};
 		std::vector<weak_ref<SceneNode>> nodes = {};
 	};
 	std::queue<ViewportPickerData> viewportPickerQueue = {};
@@ -45,7 +44,6 @@ private:
 				if (n->GetParent()) {
 					n->GetParent()->RemoveChild(n);
 					deleted = true;
-					scene->SetDirty();
 				}
 			}
 			ImGui::EndPopup();
@@ -96,6 +94,16 @@ public:
 
 		changed |= ImGui::ColorEdit3("Background color", &scene->backgroundColor.x, ImGuiColorEditFlags_Float|ImGuiColorEditFlags_HDR);
 		changed |= ImGui::SliderFloat("Background sample probability", &scene->backgroundSampleProbability, 0.f, 1.f);
+		if (changed)
+			scene->SetDirty();
+
+		if (ImGui::CollapsingHeader("Image loading"))
+			scene->imageLoader.DrawGui();
+
+		if (ImGui::CollapsingHeader("Virtual textures")) {
+			ImGui::Checkbox("Stream large glTF textures", &scene->useVirtualTextures);
+			scene->virtualTextures.DrawGui();
+		}
 
 		auto n = selected.lock();
 		if (!n) return;
@@ -104,31 +112,28 @@ public:
 			ImGui::Text("Transform: %s", n->transform ? "true" : "false");
 			if (n->transform.has_value()) {
 				if (InspectorGui(n->transform.value()))
-					changed = true;
+					n->SetDirty(SceneNodeDirtyFlags::eTransform);
 			} else {
 				Transform t = Transform::Identity();
 				if (InspectorGui(t)) {
 					n->transform = t;
-					changed = true;
+					n->SetDirty(SceneNodeDirtyFlags::eTransform);
 				}
 			}
 			if (n->material) {
 				if (InspectorGui(*n->material))
-					changed = true;
+					n->SetDirty(SceneNodeDirtyFlags::eMaterial);
 			}
 		}
-
-		if (changed)
-			scene->SetDirty();
 	}
 
 	inline void PreRender(CommandContext& context, const Transform& worldToCamera, const Transform& projection) {
 		// update selected node based on vbuffer pixel that was clicked on
 		if (!viewportPickerQueue.empty()) {
-			auto&[buf, value, nodes] = viewportPickerQueue.front();
-			if (context.GetDevice().CurrentTimelineValue() >= value) {
-				if (buf[0].x < nodes.size())
-					selected = std::move(nodes[buf[0].x]);
+			auto&[visibility, nodes] = viewportPickerQueue.front();
+			if (visibility.ready()) {
+				if (visibility[0].x < nodes.size())
+					selected = std::move(nodes[visibility[0].x]);
 				else
 					selected.reset();
 				viewportPickerQueue.pop();
@@ -138,11 +143,16 @@ public:
 		// draw gizmos for selected node
 		if (auto n = selected.lock(); n) {
 			Transform parentTransform = Transform::Identity();
-			SceneNode* parent = n->GetParent().get();
-			while (parent) {
-				if (parent->transform.has_value())
-					parentTransform = parent->transform.value() * parentTransform;
-				parent = parent->GetParent().get();
+			if (const Transform* t = scene->Hierarchy().GetWorldTransform(n->GetParent().get()))
+				parentTransform = *t;
+			else {
+				// not rendered yet
+				SceneNode* parent = n->GetParent().get();
+				while (parent) {
+					if (parent->transform.has_value())
+						parentTransform = parent->transform.value() * parentTransform;
+					parent = parent->GetParent().get();
+				}
 			}
 
 			if (!opOriginWorld && n->mesh) {
@@ -162,7 +172,7 @@ public:
 				NULL,
 				NULL)) {
 				n->transform = inverse(parentTransform) * t;
-				scene->SetDirty();
+				n->SetDirty(SceneNodeDirtyFlags::eTransform);
 			}
 		}
 	}
@@ -202,32 +212,9 @@ public:
 		int2 cursor = int2(cursorScreen - float2(rect));
 
 		if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && ImGui::IsWindowFocused() && ImGui::IsWindowHovered() && !ImGuizmo::IsUsing()) {
-			// copy selected pixel from visibility buffer into host-visible buffer
-			if (cursor.x >= 0 && cursor.y >= 0 && cursor.x < int(rect.z) && cursor.y < int(rect.w)) {
-				context.AddBarrier(vbuffer, Image::ResourceState{
-					.layout = vk::ImageLayout::eTransferSrcOptimal,
-					.stage  = vk::PipelineStageFlagBits2::eTransfer,
-					.access = vk::AccessFlagBits2::eTransferRead,
-					.queueFamily = context.QueueFamily() });
-				context.ExecuteBarriers();
-
-				BufferRange<uint4> buf = Buffer::Create(
-					context.GetDevice(),
-					sizeof(uint4),
-					vk::BufferUsageFlagBits::eTransferDst,
-					vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-					VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
-
-				context->copyImageToBuffer(**vbuffer.GetImage(), vk::ImageLayout::eTransferSrcOptimal, **buf.mBuffer, vk::BufferImageCopy{
-					.bufferOffset = 0,
-					.bufferRowLength = 0,
-					.bufferImageHeight = 0,
-					.imageSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
-					.imageOffset = vk::Offset3D{ cursor.x, cursor.y, 0 },
-					.imageExtent = vk::Extent3D{ 1, 1, 1 } });
-
-				viewportPickerQueue.push({ buf, context.GetDevice().NextTimelineSignal(), instanceNodes });
-			}
+			// read back the selected pixel of the visibility buffer
+			if (cursor.x >= 0 && cursor.y >= 0 && cursor.x < int(rect.z) && cursor.y < int(rect.w))
+				viewportPickerQueue.push({ context.Readback<uint4>(vbuffer, int3(cursor, 0), uint3(1)), instanceNodes });
 		}
 
 		if (ImGui::IsKeyDown(ImGuiKey_Z)) {
@@ -5,10 +5,11 @@
 #include <Rose/Core/PipelineCache.hpp>
 #include <Rose/Scene/Scene.hpp>
 #include "Tonemapper/Tonemapper.hpp"
+#include "Culling/InstanceCulling.hpp"
 
 namespace RoseEngine {
 
-ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename);
+ref<SceneNode> LoadGLTF(CommandContext& context, const std::filesystem::path& filename, const bool quantizeVertices, const uint32_t threadCount, const TextureCompression textureCompression, MipGenerator* mipGenerator, VirtualTextureCache* virtualTextures, std::vector<std::filesystem::path>* externalFiles);
 
 class SceneRenderer {
 public:
@@ -24,6 +25,20 @@ private:
 	ref<vk::raii::Sampler> cachedSampler = nullptr;
 	ref<const ShaderModule> vertexShader, vertexShaderTextured, fragmentShader, fragmentShaderTextured, fragmentShaderTexturedAlphaCutoff;
 
+	// Mesh shading variants of the cached pipelines, for meshes with meshlets, on devices with VK_EXT_mesh_shader.
+	// Keyed by the vertex pipeline they replace.
+	std::unordered_map<const Pipeline*, ref<Pipeline>> meshShadingPipelines = {};
+	ref<const ShaderModule> taskShader, meshShader, meshShaderTextured, meshFragmentShader, meshFragmentShaderTextured, meshFragmentShaderTexturedAlphaCutoff;
+	ref<DescriptorSets> meshDescriptorSets = {};
+	ShaderParameter     meshParameters = {}; // written to meshDescriptorSets once culling has written the visible instances
+	bool enableMeshShading = true;
+
+	// meshlets tested, meshlets drawn and triangles drawn by the task shader. Read back once the device reaches meshletStatsSignal.
+	BufferRange<uint32_t> meshletStats;
+	BufferRange<uint32_t> meshletStatsCpu;
+	uint64_t meshletStatsSignal = 0;
+	std::array<uint32_t, 3> meshletStatsValues = {};
+
 	std::vector<ImageView> attachments;
 	ref<DescriptorSets> descriptorSets = {};
 	struct ViewportParams {
@@ -51,6 +66,18 @@ private:
 	bool useFixedSeed = false;
 	uint32_t fixedSeed = 1u;
 
+	// requests the virtual texture tiles seen in the visibility buffer, which fragment shaders can't request
+	PipelineCache virtualTextureRequests = PipelineCache(FindShaderPath("VirtualTextureRequests.cs.slang"), "main", PipelineLayoutInfo{
+		.descriptorBindingFlags = {
+			{ "scene.meshBuffers", vk::DescriptorBindingFlagBits::ePartiallyBound },
+			{ "scene.images",      vk::DescriptorBindingFlagBits::ePartiallyBound } },
+		.immutableSamplers = { { "scene.sampler", { vk::SamplerCreateInfo{
+			.magFilter  = vk::Filter::eLinear,
+			.minFilter  = vk::Filter::eLinear,
+			.mipmapMode = vk::SamplerMipmapMode::eLinear,
+			.minLod = 0,
+			.maxLod = 12 } } } } });
+
 	PipelineCache accumulation = PipelineCache(FindShaderPath("Accumulation.cs.slang"));
 	bool enableAccumulation = true;
 	bool resetAccumulation = false;
@@ -65,14 +92,63 @@ private:
 
 	Tonemapper tonemapper;
 
+	InstanceCulling culling;
+	bool enableGpuCulling = true;
+
+	// Level of detail selection. Each instance draws the coarsest level of its mesh whose error projects to at most maxLodError pixels.
+	// Fragment shaders add instanceFirstTriangles to SV_PrimitiveID, which starts at 0 for each draw.
+	bool  enableLod = true;
+	float maxLodError = 1;
+	BufferRange<uint32_t> instanceFirstTriangles;
+	std::vector<uint32_t> instanceLods; // selected on the CPU when GPU culling is disabled
+	uint32_t fullTriangleCount = 0;
+	uint32_t drawnTriangleCount = 0;
+
+	// visibility pass timings. Timestamps are read once the device reaches visibilityQuerySignal.
+	ref<vk::raii::QueryPool> visibilityQueryPool = nullptr;
+	uint64_t visibilityQuerySignal = 0;
+	float visibilityCpuTime = 0; // ms
+	float cullingGpuTime = 0; // ms, culling and LOD selection
+	float drawGpuTime    = 0; // ms, drawing the visibility buffer
+	float hiZGpuTime     = 0; // ms, building the HiZ pyramid and copying stats after drawing
+
+	// Pixels covered by an object space unit at unit distance from the camera
+	inline float LodErrorScale() const {
+		return attachments[0].Extent().y * std::abs(viewData.projection.transform[1][1]) / 2;
+	}
+
+	// Same as the selection in InstanceCulling's Cull shader: the error is projected at the nearest point of the mesh's bounding sphere
+	inline uint32_t SelectLod(const Mesh& mesh, const Transform& objectToWorld) const {
+		if (!enableLod || mesh.LodCount() < 2)
+			return 0;
+		const float3 aabbMin = float3(mesh.aabb.minX, mesh.aabb.minY, mesh.aabb.minZ);
+		const float3 aabbMax = float3(mesh.aabb.maxX, mesh.aabb.maxY, mesh.aabb.maxZ);
+		const float scale = std::max({
+			length(objectToWorld.TransformVector(float3(1, 0, 0))),
+			length(objectToWorld.TransformVector(float3(0, 1, 0))),
+			length(objectToWorld.TransformVector(float3(0, 0, 1))) });
+		const float3 center = objectToWorld.TransformPoint((aabbMin + aabbMax) / 2.f);
+		const float distance = std::max(length(center - viewData.cameraToWorld.TransformPoint(float3(0))) - scale * length(aabbMax - aabbMin) / 2, 1e-4f);
+		return mesh.SelectLod(scale * LodErrorScale() / distance, maxLodError);
+	}
+
 	inline const auto& GetPipeline(Device& device, const Mesh& mesh, const Material<ImageView>& material) {
 		if (!vertexShader || (ImGui::IsKeyPressed(ImGuiKey_F5, false) && vertexShader->IsStale())) {
 			if (vertexShader) device.Wait();
-			vertexShader                      = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "vertexMain");
-			vertexShaderTextured              = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "vertexMain", "sm_6_7", ShaderDefines{ { "HAS_TEXCOORD", "1" } });
-			fragmentShader                    = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain");
-			fragmentShaderTextured            = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "HAS_TEXCOORD", "1" } });
-			fragmentShaderTexturedAlphaCutoff = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "HAS_TEXCOORD", "1" }, { "USE_ALPHA_CUTOFF", "1" } });
+			const std::string softwareRT = device.SupportsRayQuery() ? "0" : "1";
+			vertexShader                      = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "vertexMain",   "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT } });
+			vertexShaderTextured              = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "vertexMain",   "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "HAS_TEXCOORD", "1" } });
+			fragmentShader                    = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT } });
+			fragmentShaderTextured            = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "HAS_TEXCOORD", "1" } });
+			fragmentShaderTexturedAlphaCutoff = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "HAS_TEXCOORD", "1" }, { "USE_ALPHA_CUTOFF", "1" } });
+			if (device.EnabledExtensions().contains(VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+				taskShader                            = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "taskMain",     "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" } });
+				meshShader                            = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "meshMain",     "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" } });
+				meshShaderTextured                    = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "meshMain",     "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" }, { "HAS_TEXCOORD", "1" } });
+				meshFragmentShader                    = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" } });
+				meshFragmentShaderTextured            = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" }, { "HAS_TEXCOORD", "1" } });
+				meshFragmentShaderTexturedAlphaCutoff = ShaderModule::Create(device, FindShaderPath("Visibility.3d.slang"), "fragmentMain", "sm_6_7", ShaderDefines{ { "USE_SOFTWARE_RAYTRACING", softwareRT }, { "USE_MESH_SHADER", "1" }, { "HAS_TEXCOORD", "1" }, { "USE_ALPHA_CUTOFF", "1" } });
+			}
 		}
 
 		bool textured = mesh.vertexAttributes.contains(MeshVertexAttributeType::eTexcoord) && mesh.vertexAttributes.at(MeshVertexAttributeType::eTexcoord).size() > 0;
@@ -84,8 +160,10 @@ private:
 
 		if (auto it = cachedPipelines.find(key); it != cachedPipelines.end()) {
 			const auto& pipeline = it->second;
-			if (pipeline->GetShader(vk::ShaderStageFlagBits::eVertex) != vs || pipeline->GetShader(vk::ShaderStageFlagBits::eFragment) != fs)
+			if (pipeline->GetShader(vk::ShaderStageFlagBits::eVertex) != vs || pipeline->GetShader(vk::ShaderStageFlagBits::eFragment) != fs) {
+				meshShadingPipelines.erase(pipeline.get());
 				cachedPipelines.erase(it);
+			}
 			else
 				return *it;
 		}
@@ -150,6 +228,17 @@ private:
 				{ "scene.images",      vk::DescriptorBindingFlagBits::ePartiallyBound } },
 			.immutableSamplers      = { { "scene.sampler", { cachedSampler } } } };
 		auto pipeline = Pipeline::CreateGraphics(device, { vs, fs }, pipelineInfo, layoutInfo);
+
+		if (taskShader && std::get<0>(key).topology == vk::PrimitiveTopology::eTriangleList) {
+			// same state, with vertices fetched by the mesh shader
+			GraphicsPipelineInfo meshPipelineInfo = pipelineInfo;
+			meshPipelineInfo.vertexInputState   = std::nullopt;
+			meshPipelineInfo.inputAssemblyState = std::nullopt;
+			auto ms  = textured ? meshShaderTextured : meshShader;
+			auto mfs = textured ? (material.HasFlag(MaterialFlags::eAlphaCutoff) ? meshFragmentShaderTexturedAlphaCutoff : meshFragmentShaderTextured) : meshFragmentShader;
+			meshShadingPipelines[pipeline.get()] = Pipeline::CreateGraphics(device, { taskShader, ms, mfs }, meshPipelineInfo, layoutInfo);
+		}
+
 		return *cachedPipelines.emplace(key, pipeline).first;
 	}
 
@@ -190,6 +279,33 @@ public:
 
 		ImGui::Separator();
 
+		ImGui::Checkbox("GPU culling", &enableGpuCulling);
+		if (enableGpuCulling) {
+			ImGui::Checkbox("Occlusion culling", &culling.enableOcclusionCulling);
+			ImGui::Text("%u / %u instances visible", culling.VisibleCount(), culling.InstanceCount());
+		}
+		if (!meshShadingPipelines.empty()) {
+			ImGui::BeginDisabled(!enableGpuCulling);
+			ImGui::Checkbox("Mesh shading", &enableMeshShading);
+			ImGui::EndDisabled();
+			if (enableMeshShading && enableGpuCulling) {
+				const auto&[tested, drawn, triangles] = meshletStatsValues;
+				ImGui::Text("%u / %u meshlets visible (%.1f%% culled)", drawn, tested, tested > 0 ? 100.f * (tested - drawn) / tested : 0.f);
+				ImGui::Text("%u triangles, %.1f Mtri/s", triangles, drawGpuTime > 0 ? triangles / (drawGpuTime * 1e3f) : 0.f);
+			}
+		}
+		ImGui::Checkbox("LOD", &enableLod);
+		if (enableLod) {
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+			ImGui::SliderFloat("Max error (px)", &maxLodError, 0.1f, 16.f, "%.1f", ImGuiSliderFlags_Logarithmic);
+		}
+		ImGui::Text("%u / %u triangles drawn (%.1f%% saved)", drawnTriangleCount, fullTriangleCount, fullTriangleCount > 0 ? 100.f * (fullTriangleCount - drawnTriangleCount) / fullTriangleCount : 0.f);
+		ImGui::Text("Visibility pass: %.3fms CPU, %.3fms GPU", visibilityCpuTime, cullingGpuTime + drawGpuTime + hiZGpuTime);
+		ImGui::Text("GPU culling %.3fms, draw %.3fms, HiZ %.3fms", cullingGpuTime, drawGpuTime, hiZGpuTime);
+
+		ImGui::Separator();
+
 		tonemapper.DrawGui(context);
 
 		if (dirty) resetAccumulation = true;
@@ -211,8 +327,9 @@ public:
 						Image::Create(context.GetDevice(), ImageInfo{
 							.format = format,
 							.extent = uint3(extent, 1),
-							.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eDepthStencilAttachment,
-							.queueFamilies = { context.QueueFamily() } }),
+							.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eDepthStencilAttachment,
+							.queueFamilies = { context.QueueFamily() } },
+							vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 1.f, MemoryPool::eRenderTarget), // render targets stay resident
 						vk::ImageSubresourceRange{
 							.aspectMask = vk::ImageAspectFlagBits::eDepth,
 							.baseMipLevel = 0,
@@ -225,7 +342,8 @@ public:
 							.format = format,
 							.extent = uint3(extent, 1),
 							.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eColorAttachment,
-							.queueFamilies = { context.QueueFamily() } }));
+							.queueFamilies = { context.QueueFamily() } },
+							vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 1.f, MemoryPool::eRenderTarget));
 				}
 				attachments.emplace_back(attachment);
 			}
@@ -235,7 +353,8 @@ public:
 					.format = attachments[0].GetImage()->Info().format,
 					.extent = uint3(extent, 1),
 					.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
-					.queueFamilies = { context.QueueFamily() } }));
+					.queueFamilies = { context.QueueFamily() } },
+					vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 1.f, MemoryPool::eRenderTarget));
 		}
 
 		viewData.cameraToWorld = cameraToWorld;
@@ -250,15 +369,108 @@ public:
 			params["worldToCamera"] = viewData.worldToCamera;
 			params["projection"]    = viewData.projection;
 
+			// the mesh shading pipelines draw meshlets of the ray tracing level, with absolute primitive ids
+			instanceFirstTriangles = context.GetTransientBuffer<uint32_t>(std::max<size_t>(scene->InstanceTransforms().size(), 1), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+			ShaderParameter vertexParams = params;
+			vertexParams["instanceFirstTriangles"] = (BufferParameter)instanceFirstTriangles;
+
 			// all pipelines should have the same descriptor set layouts
 			descriptorSets = context.GetDescriptorSets(*cachedPipelines.begin()->second->Layout());
-			context.UpdateDescriptorSets(*descriptorSets, params, *cachedPipelines.begin()->second->Layout());
+			context.UpdateDescriptorSets(*descriptorSets, vertexParams, *cachedPipelines.begin()->second->Layout());
+
+			if (!meshShadingPipelines.empty()) {
+				if (!meshletStats)
+					meshletStats = Buffer::Create(context.GetDevice(), 3*sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst);
+				params["cameraPosition"] = viewData.cameraToWorld.TransformPoint(float3(0));
+				params["meshletStats"]   = (BufferParameter)meshletStats;
+				meshDescriptorSets = context.GetDescriptorSets(*meshShadingPipelines.begin()->second->Layout());
+				meshParameters = params;
+			} else
+				meshDescriptorSets = {};
 		} else {
 			descriptorSets = {};
+			meshDescriptorSets = {};
 		}
 	}
 
 	inline void Render(CommandContext& context) {
+		const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+		// time a frame at a time, once the previous frame's timestamps are available
+		const bool measureGpuTime = visibilityQuerySignal == 0 || context.GetDevice().CurrentTimelineValue() >= visibilityQuerySignal;
+		if (measureGpuTime) {
+			if (!visibilityQueryPool) {
+				visibilityQueryPool = make_ref<vk::raii::QueryPool>(*context.GetDevice(), vk::QueryPoolCreateInfo{
+					.queryType = vk::QueryType::eTimestamp,
+					.queryCount = 4 });
+			} else if (visibilityQuerySignal > 0) {
+				auto [result, timestamps] = visibilityQueryPool->getResults<uint64_t>(0, 4, sizeof(uint64_t)*4, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+				if (result == vk::Result::eSuccess) {
+					const float period = context.GetDevice().Limits().timestampPeriod / 1e6f;
+					cullingGpuTime = (timestamps[1] - timestamps[0]) * period;
+					drawGpuTime    = (timestamps[2] - timestamps[1]) * period;
+					hiZGpuTime     = (timestamps[3] - timestamps[2]) * period;
+				}
+			}
+			context->resetQueryPool(**visibilityQueryPool, 0, 4);
+			context->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, **visibilityQueryPool, 0);
+		}
+
+		const bool gpuCulling = descriptorSets && enableGpuCulling;
+		const Transform worldToClip = viewData.projection * viewData.worldToCamera;
+		if (gpuCulling) {
+			culling.Cull(context, *scene, worldToClip, viewData.cameraToWorld.TransformPoint(float3(0)), LodErrorScale(), enableLod ? maxLodError : -1.f, instanceFirstTriangles);
+			fullTriangleCount  = culling.FullTriangleCount();
+			drawnTriangleCount = culling.DrawnTriangleCount();
+		} else if (descriptorSets) {
+			// select levels of detail on the CPU, for every instance since none are culled
+			const std::vector<Transform>& transforms = scene->InstanceTransforms();
+			instanceLods.assign(transforms.size(), 0);
+			std::vector<uint32_t> firstTriangles(std::max<size_t>(transforms.size(), 1), 0);
+			fullTriangleCount  = 0;
+			drawnTriangleCount = 0;
+			for (const auto& drawList : scene->renderData.drawLists) {
+				for (const auto& batch : drawList) {
+					for (const auto&[firstInstance, instanceCount] : batch.draws) {
+						for (uint32_t i = firstInstance; i < firstInstance + instanceCount; i++) {
+							instanceLods[i] = SelectLod(*batch.mesh, transforms[i]);
+							const MeshLod lod = batch.mesh->GetLod(instanceLods[i]);
+							firstTriangles[i] = lod.firstTriangle;
+							fullTriangleCount  += batch.mesh->GetLod(0).triangleCount;
+							drawnTriangleCount += lod.triangleCount;
+						}
+					}
+				}
+			}
+			context.Copy(context.UploadData(firstTriangles), instanceFirstTriangles);
+			context.AddBarrier(instanceFirstTriangles, Buffer::ResourceState{
+				.stage  = vk::PipelineStageFlagBits2::eFragmentShader,
+				.access = vk::AccessFlagBits2::eShaderRead,
+				.queueFamily = context.QueueFamily() });
+			context.ExecuteBarriers();
+		}
+
+		// mesh shading draws the instances that passed culling
+		const bool meshShading = meshDescriptorSets && enableMeshShading && gpuCulling && culling.WritesMeshTasks();
+		if (meshShading) {
+			meshParameters["visibleInstances"] = (BufferParameter)culling.VisibleInstances();
+			context.UpdateDescriptorSets(*meshDescriptorSets, meshParameters, *meshShadingPipelines.begin()->second->Layout());
+			if (meshletStatsSignal > 0 && context.GetDevice().CurrentTimelineValue() >= meshletStatsSignal) {
+				for (uint32_t i = 0; i < meshletStatsValues.size(); i++)
+					meshletStatsValues[i] = meshletStatsCpu[i];
+				meshletStatsSignal = 0;
+			}
+			context.Fill(meshletStats, 0u);
+			context.AddBarrier(meshletStats, Buffer::ResourceState{
+				.stage  = vk::PipelineStageFlagBits2::eTaskShaderEXT,
+				.access = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+				.queueFamily = context.QueueFamily() });
+			context.ExecuteBarriers();
+		}
+
+		if (measureGpuTime)
+			context->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, **visibilityQueryPool, 1);
+
 		context.BeginRendering({
 			{ attachments[0], std::get<vk::ClearValue>(kRenderAttachments[0]) },
 			{ attachments[1], std::get<vk::ClearValue>(kRenderAttachments[1]) },
@@ -267,8 +479,24 @@ public:
 
 		if (descriptorSets) {
 			const Pipeline* p = nullptr;
+			uint32_t batchIndex = 0;
 			for (const auto& drawList : scene->renderData.drawLists) {
 				for (const auto&[pipeline, mesh, meshLayout, draws] : drawList) {
+					if (meshShading && mesh->meshletBuffer) {
+						if (auto it = meshShadingPipelines.find(pipeline); it != meshShadingPipelines.end()) {
+							const Pipeline* meshPipeline = it->second.get();
+							if (p != meshPipeline) {
+								context->bindPipeline(vk::PipelineBindPoint::eGraphics, ***meshPipeline);
+								context.BindDescriptors(*meshPipeline->Layout(), *meshDescriptorSets);
+								p = meshPipeline;
+							}
+
+							culling.DrawMeshTasks(context, batchIndex, *meshPipeline->Layout());
+							batchIndex++;
+							continue;
+						}
+					}
+
 					if (p != pipeline) {
 						context->bindPipeline(vk::PipelineBindPoint::eGraphics, ***pipeline);
 						context.BindDescriptors(*pipeline->Layout(), *descriptorSets);
@@ -277,15 +505,47 @@ public:
 
 					mesh->Bind(context, meshLayout);
 
-					const uint32_t indexCount = mesh->indexBuffer.size_bytes() / mesh->indexSize;
-					for (const auto&[firstInstance, instanceCount] : draws) {
-						context->drawIndexed(indexCount, instanceCount, 0, 0, firstInstance);
+					if (gpuCulling) {
+						culling.Draw(context, batchIndex);
+					} else {
+						// one draw per run of consecutive instances at the same level
+						for (const auto&[firstInstance, instanceCount] : draws) {
+							const uint32_t end = firstInstance + instanceCount;
+							for (uint32_t i = firstInstance; i < end;) {
+								uint32_t runEnd = i + 1;
+								while (runEnd < end && instanceLods[runEnd] == instanceLods[i]) runEnd++;
+								const MeshLod lod = mesh->GetLod(instanceLods[i]);
+								context->drawIndexed(3*lod.triangleCount, runEnd - i, 3*lod.firstTriangle, 0, i);
+								i = runEnd;
+							}
+						}
 					}
+					batchIndex++;
 				}
 			}
 		}
 
 		context.EndRendering();
+
+		if (measureGpuTime)
+			context->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, **visibilityQueryPool, 2);
+
+		if (gpuCulling)
+			culling.BuildHiZ(context, *scene, attachments[2], worldToClip);
+
+		if (meshShading && meshletStatsSignal == 0) {
+			if (!meshletStatsCpu)
+				meshletStatsCpu = Buffer::Create(context.GetDevice(), std::vector<uint32_t>(3), vk::BufferUsageFlagBits::eTransferDst);
+			context.Copy(meshletStats, meshletStatsCpu);
+			meshletStatsSignal = context.GetDevice().NextTimelineSignal();
+		}
+
+		if (measureGpuTime) {
+			context->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, **visibilityQueryPool, 3);
+			visibilityQuerySignal = context.GetDevice().NextTimelineSignal();
+		}
+
+		visibilityCpuTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
 	}
 
 	inline void PostRender(CommandContext& context) {
@@ -294,6 +554,15 @@ public:
 		const ImageView& renderTarget = attachments[0];
 		const ImageView& visibility   = attachments[1];
 
+		if (scene->virtualTextures.ImageCount() > 0) {
+			ShaderParameter params = {};
+			params["scene"]      = scene->renderData.sceneParameters;
+			params["visibility"] = ImageParameter{ .image = visibility, .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal };
+			params["imageSize"]  = uint2(visibility.Extent());
+			virtualTextureRequests(context, visibility.Extent(), params, ShaderDefines{
+				{ "USE_SOFTWARE_RAYTRACING", context.GetDevice().SupportsRayQuery() ? "0" : "1" } });
+		}
+
 		// main path tracing
 		{
 			ShaderParameter params = {};
@@ -308,7 +577,9 @@ public:
 			params["seed"] = useFixedSeed ? fixedSeed : (uint32_t)context.GetDevice().NextTimelineSignal();
 			params["maxBounces"] = maxBounces;
 			params["maxDiffuseBounces"] = maxDiffuseBounces;
-			pathTracer(context, renderTarget.Extent(), params, ShaderDefines{ { "USE_NEE", enableNEE ? "1" : "0" } });
+			pathTracer(context, renderTarget.Extent(), params, ShaderDefines{
+				{ "USE_NEE", enableNEE ? "1" : "0" },
+				{ "USE_SOFTWARE_RAYTRACING", context.GetDevice().SupportsRayQuery() ? "0" : "1" } });
 		}
 
 		if (enableAccumulation && !resetAccumulation && prevCameraToWorld.transform == viewData.cameraToWorld.transform && prevSceneVersion >= scene->renderData.updateTime)
@@ -10,11 +10,18 @@ using namespace RoseEngine;
 int main(int argc, const char** argv) {
 	WindowedApp app("GLTF Viewer", {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+		VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME,
+	}, {
+		// ray queries fall back to software ray tracing, and mesh shading to the vertex pipeline
+		VK_KHR_PRESENT_ID_EXTENSION_NAME,
+		VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
 		VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
 		VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
 		VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,
 		VK_KHR_RAY_QUERY_EXTENSION_NAME,
-		VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME,
+		VK_EXT_MESH_SHADER_EXTENSION_NAME,
+		VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+		VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME,
 	});
 
 	auto sceneRenderer = make_ref<SceneRenderer>();
@@ -10,8 +10,6 @@ private:
 	PipelineCache maxReduce = PipelineCache(FindShaderPath("Tonemapper.cs.slang"), "MaxReduce");
 	PipelineCache tonemap   = PipelineCache(FindShaderPath("Tonemapper.cs.slang"), "Tonemap");
 
-	BufferRange<uint4> mMaxBuf;
-
 	float mExposure = 0;
 	bool mGammaCorrect = true;
 	TonemapperMode mMode = TonemapperMode::eACES;
@@ -33,16 +31,17 @@ public:
 			{ "GAMMA_CORRECT", mGammaCorrect ? "1" : "0" }
 		};
 
-		if (!mMaxBuf) mMaxBuf = Buffer::Create(context.GetDevice(), sizeof(uint4), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+		// only used during the pass, so its memory is reused by transient resources requested after it
+		const BufferRange<uint4> maxBuf = context.GetTransientBuffer<uint4>(1, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
 
 		// get maximum value in image
 
-		context.Fill(mMaxBuf.cast<uint32_t>(), 0u);
+		context.Fill(maxBuf.cast<uint32_t>(), 0u);
 
 		ShaderParameter params;
 		params["gImage"] = ImageParameter{ .image = input, .imageLayout = vk::ImageLayout::eGeneral };
 		params["gExposure"] = std::pow(2.f, mExposure);
-		params["gMax"] = (BufferParameter)mMaxBuf;
+		params["gMax"] = (BufferParameter)maxBuf;
 
 		maxReduce(context, input.Extent(), params, defines);
 
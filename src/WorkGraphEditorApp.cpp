@@ -154,8 +154,8 @@ int main(int argc, const char** argv) {
 
 	NodeWidget nodeEditor(*app.contexts[0]);
 
-	app.AddWidget("Properties", [&]() { nodeEditor.RenderProperties(*app.contexts[app.swapchain->ImageIndex()]); }, true);
-	app.AddWidget("Nodes",      [&]() { nodeEditor.RenderNodes(     *app.contexts[app.swapchain->ImageIndex()]); }, true);
+	app.AddWidget("Properties", [&]() { nodeEditor.RenderProperties(app.CurrentContext()); }, true);
+	app.AddWidget("Nodes",      [&]() { nodeEditor.RenderNodes(     app.CurrentContext()); }, true);
 
 	app.Run();
 
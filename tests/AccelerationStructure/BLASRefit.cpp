@@ -0,0 +1,172 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/Pipeline.hpp>
+#include <Rose/Core/ShaderModule.hpp>
+#include <Rose/Scene/Mesh.hpp>
+
+#include <bit>
+#include <iostream>
+
+// Animates a large grid mesh and compares the GPU time of full BLAS rebuilds against refits.
+// On devices with ray queries, also traces rays against the refit BLAS and a BLAS rebuilt from the same positions,
+// and checks that the hit distances match.
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	if (!device->EnabledExtensions().contains(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME)) {
+		std::cout << "Acceleration structures not supported, skipping" << std::endl;
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	vk::raii::QueryPool queryPool(**device, vk::QueryPoolCreateInfo{
+		.queryType = vk::QueryType::eTimestamp,
+		.queryCount = 2 });
+
+	const uint32_t gridDim = 512;
+	const uint32_t frameCount = 64;
+
+	std::vector<uint32_t> indices;
+	indices.reserve((gridDim-1)*(gridDim-1)*6);
+	for (uint32_t y = 0; y + 1 < gridDim; y++) {
+		for (uint32_t x = 0; x + 1 < gridDim; x++) {
+			const uint32_t i = y*gridDim + x;
+			indices.insert(indices.end(), { i, i + 1, i + gridDim, i + 1, i + gridDim + 1, i + gridDim });
+		}
+	}
+
+	std::vector<float3> positions(gridDim*gridDim);
+	auto animate = [&](const float t) {
+		for (uint32_t y = 0; y < gridDim; y++)
+			for (uint32_t x = 0; x < gridDim; x++) {
+				const float2 uv = float2(x, y) / float(gridDim - 1);
+				positions[y*gridDim + x] = float3(uv.x, 0.1f * std::sin(20*uv.x + t) * std::cos(20*uv.y + t), uv.y);
+			}
+	};
+
+	const vk::BufferUsageFlags meshUsage =
+		vk::BufferUsageFlagBits::eStorageBuffer |
+		vk::BufferUsageFlagBits::eShaderDeviceAddress |
+		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+		vk::BufferUsageFlagBits::eTransferDst;
+
+	// rays straight down onto the grid, away from the grid's vertices and edges
+	const uint32_t rayGridDim = 64;
+	std::vector<float4> rayOrigins;
+	for (uint32_t y = 0; y < rayGridDim; y++)
+		for (uint32_t x = 0; x < rayGridDim; x++)
+			rayOrigins.emplace_back(float4((x + 0.37f) / rayGridDim, 1, (y + 0.61f) / rayGridDim, 0));
+	const uint32_t rayCount = (uint32_t)rayOrigins.size();
+
+	// traces the rays against a TLAS with a single instance of blas
+	ref<Pipeline> tracePipeline = device->SupportsRayQuery() ? Pipeline::CreateCompute(*device, ShaderModule::Create(*device, FindShaderPath("BLASRefit.cs.slang"), "testMain")) : nullptr;
+	auto trace = [&](const AccelerationStructure& blas, const BufferRange<float>& hitsCpu) {
+		vk::AccelerationStructureInstanceKHR instance{
+			.transform = std::bit_cast<vk::TransformMatrixKHR>((float3x4)transpose(float4x4(1))),
+			.mask = 0xFF,
+			.accelerationStructureReference = blas.GetDeviceAddress(*device) };
+		const ref<AccelerationStructure> tlas = AccelerationStructure::Create(*context, instance);
+
+		auto hits = context->GetTransientBuffer<float>(rayCount, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+
+		ShaderParameter params;
+		params["accelerationStructure"] = tlas;
+		params["rayOrigins"] = (BufferView)context->UploadData(rayOrigins, vk::BufferUsageFlagBits::eStorageBuffer);
+		params["hits"]       = (BufferView)hits;
+		params["rayCount"]   = rayCount;
+		context->Dispatch(*tracePipeline, rayCount, params);
+
+		context->Copy(hits, hitsCpu);
+	};
+
+	bool allPassed = true;
+
+	for (const bool deformable : { false, true }) {
+		context->Begin();
+
+		Mesh mesh = Mesh {
+			.indexBuffer = context->UploadData(indices, meshUsage | vk::BufferUsageFlagBits::eIndexBuffer),
+			.indexSize = sizeof(uint32_t),
+			.topology = vk::PrimitiveTopology::eTriangleList };
+		mesh.vertexAttributes[MeshVertexAttributeType::ePosition].emplace_back(
+			Buffer::Create(*device, positions.size() * sizeof(float3), meshUsage | vk::BufferUsageFlagBits::eVertexBuffer),
+			MeshVertexAttributeLayout{
+				.stride = sizeof(float3),
+				.format = vk::Format::eR32G32B32Sfloat,
+				.offset = 0,
+				.inputRate = vk::VertexInputRate::eVertex });
+		mesh.deformable = deformable;
+
+		context->Submit();
+
+		double totalTime = 0;
+		for (uint32_t frame = 0; frame < frameCount; frame++) {
+			animate(frame * 0.1f);
+
+			context->Begin();
+
+			context->Copy(context->UploadData(positions), mesh.vertexAttributes.at(MeshVertexAttributeType::ePosition)[0].first);
+			mesh.lastUpdateTime = device->NextTimelineSignal();
+
+			(*context)->resetQueryPool(*queryPool, 0, 2);
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 0);
+
+			mesh.UpdateBLAS(*context, true);
+
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 1);
+
+			context->Submit();
+			device->Wait();
+
+			auto [result, timestamps] = queryPool.getResults<uint64_t>(0, 2, sizeof(uint64_t)*2, sizeof(uint64_t), vk::QueryResultFlagBits::e64|vk::QueryResultFlagBits::eWait);
+			totalTime += (timestamps[1] - timestamps[0]) * device->Limits().timestampPeriod / 1e6;
+		}
+
+		const bool passed = mesh.blas && (!deformable || mesh.blas->AllowsUpdate());
+		if (!passed) allPassed = false;
+
+		std::cout << (deformable ? "Refit" : "Rebuild") << " (" << indices.size()/3 << " triangles): " << (passed ? "PASSED" : "FAILED")
+			<< " (" << totalTime / frameCount << "ms per frame)" << std::endl;
+
+		if (deformable && tracePipeline) {
+			auto refitHits   = Buffer::Create(*device, std::vector<float>(rayCount), vk::BufferUsageFlagBits::eTransferDst);
+			auto rebuiltHits = Buffer::Create(*device, std::vector<float>(rayCount), vk::BufferUsageFlagBits::eTransferDst);
+
+			context->Begin();
+			Mesh rebuilt = mesh;
+			rebuilt.blas = {};
+			rebuilt.deformable = false;
+			rebuilt.UpdateBLAS(*context, true);
+			trace(*mesh.blas, refitHits);
+			trace(*rebuilt.blas, rebuiltHits);
+			context->Submit();
+			device->Wait();
+
+			// the last frame must have been refit, and every ray must hit the moved surface where the rebuilt BLAS does
+			bool tracePassed = mesh.blas->UpdateCount() > 0;
+			for (uint32_t i = 0; i < rayCount && tracePassed; i++) {
+				if (rebuiltHits[i] < 0 || std::abs(refitHits[i] - rebuiltHits[i]) > 1e-4f) {
+					tracePassed = false;
+					std::cout << "Mismatch at ray " << i << ": " << refitHits[i] << " != " << rebuiltHits[i] << std::endl;
+				}
+			}
+			if (!tracePassed) allPassed = false;
+
+			std::cout << "Refit hit distances: " << (tracePassed ? "PASSED" : "FAILED") << " (" << rayCount << " rays, " << mesh.blas->UpdateCount() << " refits)" << std::endl;
+		}
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
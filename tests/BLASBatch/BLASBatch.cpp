@@ -0,0 +1,173 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/Pipeline.hpp>
+#include <Rose/Core/ShaderModule.hpp>
+#include <Rose/Scene/Mesh.hpp>
+
+#include <bit>
+#include <iostream>
+
+// Builds many small BLASes in one batch whose scratch arena only fits one build at a time, then compacts them.
+// Traces a ray at every BLAS before and after compaction and checks that it hits the right one at the right distance,
+// and that compaction shrinks the structures and the bottom-level memory total.
+int main(int argc, const char** argv) {
+	using namespace RoseEngine;
+
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	if (!device->SupportsRayQuery()) {
+		std::cout << "Ray queries not supported, skipping" << std::endl;
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	auto pipeline = Pipeline::CreateCompute(*device, ShaderModule::Create(*device, FindShaderPath("BLASBatch.cs.slang"), "testMain"));
+
+	const uint32_t meshCount = 256;
+	const uint32_t gridDim = 16;
+
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y + 1 < gridDim; y++) {
+		for (uint32_t x = 0; x + 1 < gridDim; x++) {
+			const uint32_t i = y*gridDim + x;
+			indices.insert(indices.end(), { i, i + 1, i + gridDim, i + 1, i + gridDim + 1, i + gridDim });
+		}
+	}
+
+	// mesh i is a flat grid over [0,1]^2 at height heights[i]
+	std::vector<float> heights(meshCount);
+	for (uint32_t i = 0; i < meshCount; i++)
+		heights[i] = 0.5f * i / meshCount;
+
+	const vk::BufferUsageFlags meshUsage =
+		vk::BufferUsageFlagBits::eStorageBuffer |
+		vk::BufferUsageFlagBits::eShaderDeviceAddress |
+		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+		vk::BufferUsageFlagBits::eTransferDst;
+
+	context->Begin();
+
+	const BufferView indexBuffer = context->UploadData(indices, meshUsage | vk::BufferUsageFlagBits::eIndexBuffer);
+	std::vector<Mesh> meshes(meshCount);
+	std::vector<AccelerationStructure::BuildGeometries> builds;
+	for (uint32_t m = 0; m < meshCount; m++) {
+		std::vector<float3> positions(gridDim*gridDim);
+		for (uint32_t y = 0; y < gridDim; y++)
+			for (uint32_t x = 0; x < gridDim; x++)
+				positions[y*gridDim + x] = float3(float(x) / (gridDim - 1), heights[m], float(y) / (gridDim - 1));
+
+		Mesh& mesh = meshes[m];
+		mesh.indexBuffer = indexBuffer;
+		mesh.indexSize = sizeof(uint32_t);
+		mesh.topology = vk::PrimitiveTopology::eTriangleList;
+		mesh.vertexAttributes[MeshVertexAttributeType::ePosition].emplace_back(
+			context->UploadData(positions, meshUsage | vk::BufferUsageFlagBits::eVertexBuffer),
+			MeshVertexAttributeLayout{
+				.stride = sizeof(float3),
+				.format = vk::Format::eR32G32B32Sfloat,
+				.offset = 0,
+				.inputRate = vk::VertexInputRate::eVertex });
+		builds.emplace_back(mesh.GetBLASGeometry(*device, true));
+	}
+
+	const vk::DeviceSize memory0 = AccelerationStructure::BottomLevelMemory();
+
+	// a maxScratchSize smaller than any build makes every build reuse the arena
+	std::vector<ref<AccelerationStructure>> blases = AccelerationStructure::Create(
+		*context,
+		vk::AccelerationStructureTypeKHR::eBottomLevel,
+		builds,
+		vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
+		true,
+		1);
+
+	context->Submit();
+	device->Wait();
+
+	const vk::DeviceSize uncompactedMemory = AccelerationStructure::BottomLevelMemory() - memory0;
+
+	// one ray per BLAS, with instance i moved to x = i
+	std::vector<float4> rayOrigins(meshCount);
+	for (uint32_t i = 0; i < meshCount; i++)
+		rayOrigins[i] = float4(i + 0.37f, 1, 0.61f, 0);
+
+	auto trace = [&](const std::vector<ref<AccelerationStructure>>& structures) {
+		std::vector<vk::AccelerationStructureInstanceKHR> instances(structures.size());
+		for (uint32_t i = 0; i < structures.size(); i++) {
+			float4x4 transform = float4x4(1);
+			transform[3] = float4(i, 0, 0, 1);
+			instances[i] = vk::AccelerationStructureInstanceKHR{
+				.transform = std::bit_cast<vk::TransformMatrixKHR>((float3x4)transpose(transform)),
+				.instanceCustomIndex = i,
+				.mask = 0xFF,
+				.accelerationStructureReference = structures[i]->GetDeviceAddress(*device) };
+		}
+
+		auto hitsCpu = Buffer::Create(*device, std::vector<float2>(meshCount), vk::BufferUsageFlagBits::eTransferDst);
+
+		context->Begin();
+		const ref<AccelerationStructure> tlas = AccelerationStructure::Create(*context, instances);
+		auto hits = context->GetTransientBuffer<float2>(meshCount, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+
+		ShaderParameter params;
+		params["accelerationStructure"] = tlas;
+		params["rayOrigins"] = (BufferView)context->UploadData(rayOrigins, vk::BufferUsageFlagBits::eStorageBuffer);
+		params["hits"]       = (BufferView)hits;
+		params["rayCount"]   = meshCount;
+		context->Dispatch(*pipeline, meshCount, params);
+
+		context->Copy(hits, hitsCpu);
+		context->Submit();
+		device->Wait();
+
+		for (uint32_t i = 0; i < meshCount; i++) {
+			const float t = hitsCpu[i].x;
+			const uint32_t hitInstance = std::bit_cast<uint32_t>(hitsCpu[i].y);
+			if (hitInstance != i || std::abs(t - (1 - heights[i])) > 1e-4f) {
+				std::cout << "Mismatch at ray " << i << ": instance " << hitInstance << ", t = " << t << std::endl;
+				return false;
+			}
+		}
+		return true;
+	};
+
+	const bool buildPassed = blases.size() == meshCount && trace(blases);
+
+	context->Begin();
+	bool compactPassed = true;
+	std::vector<ref<AccelerationStructure>> compacted(meshCount);
+	for (uint32_t i = 0; i < meshCount; i++) {
+		if (!blases[i]->CanCompact(*device)) {
+			compactPassed = false;
+			break;
+		}
+		// Compact returns nullptr when the compacted size is no smaller
+		compacted[i] = blases[i]->Compact(*context);
+		if (!compacted[i])
+			compacted[i] = blases[i];
+		else if (compacted[i]->Size() >= blases[i]->Size())
+			compactPassed = false;
+	}
+	context->Submit();
+	device->Wait();
+
+	compactPassed = compactPassed && trace(compacted);
+
+	blases.clear();
+	const vk::DeviceSize compactedMemory = AccelerationStructure::BottomLevelMemory() - memory0;
+	compactPassed = compactPassed && compactedMemory <= uncompactedMemory;
+
+	std::cout << "Batched build (" << meshCount << " BLASes): " << (buildPassed ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Compaction: " << (compactPassed ? "PASSED" : "FAILED")
+		<< " (" << (uncompactedMemory >> 10) << "KiB -> " << (compactedMemory >> 10) << "KiB)" << std::endl;
+
+	if (buildPassed && compactPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
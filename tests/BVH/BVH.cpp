@@ -0,0 +1,146 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/Pipeline.hpp>
+#include <Rose/Core/ShaderModule.hpp>
+#include <Rose/Scene/BVH.hpp>
+
+#include <iostream>
+#include <random>
+#include <chrono>
+
+// Traces random rays against a BVH over random triangles on the GPU, checks a subset against brute force on the CPU,
+// and reports rays per second. Runs on any Vulkan device, including ones without ray queries (e.g. lavapipe).
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	vk::raii::QueryPool queryPool(**device, vk::QueryPoolCreateInfo{
+		.queryType = vk::QueryType::eTimestamp,
+		.queryCount = 2 });
+
+	auto pipeline = Pipeline::CreateCompute(*device, ShaderModule::Create(*device, FindShaderPath("BVH.cs.slang"), "testMain"));
+
+	const uint32_t rayCount = 1 << 20;
+	const uint32_t checkCount = 1024;
+
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<float> dist(0, 1);
+	auto randomDirection = [&]() {
+		const float z = 1 - 2*dist(rng);
+		const float r = std::sqrt(std::max(0.f, 1 - z*z));
+		const float phi = 2 * float(M_PI) * dist(rng);
+		return float3(r * std::cos(phi), r * std::sin(phi), z);
+	};
+
+	// float3 structured buffers have a 16 byte stride
+	auto toFloat4 = [](const std::vector<float3>& v) {
+		std::vector<float4> r(v.size());
+		std::ranges::transform(v, r.begin(), [](const float3 x) { return float4(x, 0); });
+		return r;
+	};
+
+	bool allPassed = true;
+
+	for (uint32_t triangleCount : { 1000, 100000 }) {
+		// small random triangles in the unit cube
+		std::vector<float3> vertices(triangleCount*3);
+		std::vector<std::pair<float3, float3>> bounds(triangleCount);
+		const float size = 2 / std::cbrt(float(triangleCount));
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			const float3 c = float3(dist(rng), dist(rng), dist(rng));
+			float3 mn = c, mx = c;
+			for (uint32_t j = 0; j < 3; j++) {
+				vertices[3*i + j] = c + randomDirection() * size * dist(rng);
+				mn = glm::min(mn, vertices[3*i + j]);
+				mx = glm::max(mx, vertices[3*i + j]);
+			}
+			bounds[i] = { mn, mx };
+		}
+
+		std::vector<float3> origins(rayCount);
+		std::vector<float3> directions(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++) {
+			origins[i] = float3(dist(rng), dist(rng), dist(rng));
+			directions[i] = randomDirection();
+		}
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		const BVH bvh = BVH::Build(bounds);
+		const double buildTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+		auto hitsCpu = Buffer::Create(*device, std::vector<float2>(rayCount), vk::BufferUsageFlagBits::eTransferDst);
+
+		context->Begin();
+
+		auto hits = context->GetTransientBuffer<float2>(rayCount, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+
+		ShaderParameter params;
+		params["nodes"]         = (BufferView)context->UploadData(bvh.nodes,            vk::BufferUsageFlagBits::eStorageBuffer);
+		params["primitives"]    = (BufferView)context->UploadData(bvh.primitiveIndices, vk::BufferUsageFlagBits::eStorageBuffer);
+		params["vertices"]      = (BufferView)context->UploadData(toFloat4(vertices),   vk::BufferUsageFlagBits::eStorageBuffer);
+		params["rayOrigins"]    = (BufferView)context->UploadData(toFloat4(origins),    vk::BufferUsageFlagBits::eStorageBuffer);
+		params["rayDirections"] = (BufferView)context->UploadData(toFloat4(directions), vk::BufferUsageFlagBits::eStorageBuffer);
+		params["hits"]          = (BufferView)hits;
+		params["rayCount"]      = rayCount;
+
+		(*context)->resetQueryPool(*queryPool, 0, 2);
+		(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 0);
+
+		context->Dispatch(*pipeline, rayCount, params);
+
+		(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 1);
+
+		context->Copy(hits, hitsCpu);
+
+		context->Submit();
+		device->Wait();
+
+		auto [result, timestamps] = queryPool.getResults<uint64_t>(0, 2, sizeof(uint64_t)*2, sizeof(uint64_t), vk::QueryResultFlagBits::e64|vk::QueryResultFlagBits::eWait);
+		const double gpuTime = (timestamps[1] - timestamps[0]) * device->Limits().timestampPeriod / 1e6;
+
+		// brute force reference
+		bool passed = true;
+		for (uint32_t i = 0; i < checkCount && passed; i++) {
+			const uint32_t r = i * (rayCount / checkCount);
+			float tmax = std::numeric_limits<float>::max();
+			for (uint32_t tri = 0; tri < triangleCount; tri++) {
+				const float3 e1 = vertices[3*tri + 1] - vertices[3*tri];
+				const float3 e2 = vertices[3*tri + 2] - vertices[3*tri];
+				const float3 p = cross(directions[r], e2);
+				const float det = dot(e1, p);
+				if (det == 0) continue;
+				const float3 s = origins[r] - vertices[3*tri];
+				const float u = dot(s, p) / det;
+				const float3 q = cross(s, e1);
+				const float v = dot(directions[r], q) / det;
+				const float t = dot(e2, q) / det;
+				if (u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t < tmax)
+					tmax = t;
+			}
+
+			const float t = hitsCpu[r].x;
+			if (std::abs(t - tmax) > 1e-4f * std::max(1.f, tmax)) {
+				passed = false;
+				allPassed = false;
+				std::cout << "Mismatch at ray " << r << ": " << t << " != " << tmax << std::endl;
+			}
+		}
+
+		std::cout << triangleCount << " triangles: " << (passed ? "PASSED" : "FAILED")
+			<< " (" << bvh.nodes.size() << " nodes, " << buildTime << "ms build, "
+			<< gpuTime << "ms trace, " << (rayCount / (gpuTime / 1000)) / 1e6 << " Mrays/s)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Rose/Scene/Mesh.hpp>
+
+namespace RoseEngine {
+
+// A unit quad in the XZ plane, with device copies for rendering and ray tracing, and host copies for the
+// software ray tracing BVH. The device copies are valid once context's commands are done.
+inline ref<Mesh> CreateQuad(CommandContext& context) {
+	const std::vector<float3>   positions = { float3(0, 0, 0), float3(1, 0, 0), float3(0, 0, 1), float3(1, 0, 1) };
+	const std::vector<uint32_t> indices   = { 0, 2, 1, 1, 2, 3 };
+	const vk::BufferUsageFlags usage =
+		vk::BufferUsageFlagBits::eStorageBuffer |
+		vk::BufferUsageFlagBits::eShaderDeviceAddress |
+		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+		vk::BufferUsageFlagBits::eTransferDst;
+	const MeshVertexAttributeLayout layout {
+		.stride = sizeof(float3),
+		.format = vk::Format::eR32G32B32Sfloat,
+		.offset = 0,
+		.inputRate = vk::VertexInputRate::eVertex };
+
+	ref<Mesh> mesh = make_ref<Mesh>();
+	mesh->indexBuffer    = (BufferView)Buffer::Create(context.GetDevice(), indices.size() * sizeof(uint32_t), usage | vk::BufferUsageFlagBits::eIndexBuffer);
+	mesh->indexBufferCpu = (BufferView)Buffer::Create(context.GetDevice(), indices, vk::BufferUsageFlagBits::eTransferSrc);
+	mesh->indexSize = sizeof(uint32_t);
+	mesh->topology = vk::PrimitiveTopology::eTriangleList;
+	mesh->vertexAttributes[MeshVertexAttributeType::ePosition].emplace_back(Buffer::Create(context.GetDevice(), positions.size() * sizeof(float3), usage | vk::BufferUsageFlagBits::eVertexBuffer), layout);
+	mesh->vertexAttributesCpu[MeshVertexAttributeType::ePosition].emplace_back(Buffer::Create(context.GetDevice(), positions, vk::BufferUsageFlagBits::eTransferSrc), layout);
+	mesh->aabb = vk::AabbPositionsKHR(0, 0, 0, 1, 0, 1);
+	context.Copy(mesh->indexBufferCpu, mesh->indexBuffer);
+	context.Copy(mesh->vertexAttributesCpu.at(MeshVertexAttributeType::ePosition)[0].first, mesh->vertexAttributes.at(MeshVertexAttributeType::ePosition)[0].first);
+	return mesh;
+}
+
+}
\ No newline at end of file
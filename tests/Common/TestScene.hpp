@@ -0,0 +1,201 @@
+#pragma once
+
+#include <Rose/Scene/LoadGLTF.hpp>
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+// Helpers shared by the tests that import glTF files and compare the resulting scenes
+
+namespace RoseEngine {
+
+// Writes scene.gltf to dir, with imageCount textures (image<i>.png) used in pairs by imageCount/2 materials,
+// and meshCount grid meshes stored in scene.bin
+inline void WriteTestScene(const std::filesystem::path& dir, const uint32_t imageCount, const uint32_t imageSize, const uint32_t meshCount, const uint32_t gridDim) {
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<uint32_t> noise(0, 63);
+	std::vector<uint8_t> pixels(imageSize*imageSize*4);
+	for (uint32_t i = 0; i < imageCount; i++) {
+		for (uint32_t y = 0; y < imageSize; y++)
+			for (uint32_t x = 0; x < imageSize; x++) {
+				uint8_t* p = &pixels[4*(y*imageSize + x)];
+				p[0] = uint8_t((x + 17*i) % 192 + noise(rng));
+				p[1] = uint8_t((y + 31*i) % 192 + noise(rng));
+				p[2] = uint8_t(((x ^ y) + 7*i) % 192 + noise(rng));
+				p[3] = 255;
+			}
+		stbi_write_png((dir / ("image" + std::to_string(i) + ".png")).string().c_str(), imageSize, imageSize, 4, pixels.data(), imageSize*4);
+	}
+
+	// each mesh is a grid of positions, normals and texcoords followed by its indices
+	const uint32_t vertexCount = gridDim*gridDim;
+	const uint32_t indexCount  = (gridDim-1)*(gridDim-1)*6;
+	const size_t   meshBytes   = vertexCount*(sizeof(float3) + sizeof(float3) + sizeof(float2)) + indexCount*sizeof(uint32_t);
+	std::vector<std::byte> data(meshBytes * meshCount);
+	for (uint32_t m = 0; m < meshCount; m++) {
+		std::byte* dst = data.data() + m*meshBytes;
+		float3* positions = reinterpret_cast<float3*>(dst);
+		float3* normals   = reinterpret_cast<float3*>(dst + vertexCount*sizeof(float3));
+		float2* texcoords = reinterpret_cast<float2*>(dst + vertexCount*2*sizeof(float3));
+		uint32_t* indices = reinterpret_cast<uint32_t*>(dst + vertexCount*(2*sizeof(float3) + sizeof(float2)));
+		for (uint32_t y = 0; y < gridDim; y++)
+			for (uint32_t x = 0; x < gridDim; x++) {
+				const float2 uv = float2(x, y) / float(gridDim - 1);
+				positions[y*gridDim + x] = float3(uv.x, 0.1f * std::sin(20*uv.x + m) * std::cos(20*uv.y), uv.y);
+				normals  [y*gridDim + x] = float3(0, 1, 0);
+				texcoords[y*gridDim + x] = uv;
+			}
+		for (uint32_t y = 0; y + 1 < gridDim; y++)
+			for (uint32_t x = 0; x + 1 < gridDim; x++) {
+				const uint32_t i = y*gridDim + x;
+				for (const uint32_t v : { i, i + gridDim, i + 1, i + 1, i + gridDim, i + gridDim + 1 })
+					*indices++ = v;
+			}
+	}
+	std::ofstream(dir / "scene.bin", std::ios::binary).write((const char*)data.data(), data.size());
+
+	std::string bufferViews, accessors, meshes, nodes, children;
+	for (uint32_t m = 0; m < meshCount; m++) {
+		const size_t o = m*meshBytes;
+		bufferViews += std::string(m ? "," : "") +
+			"{\"buffer\":0,\"byteOffset\":" + std::to_string(o) + ",\"byteLength\":" + std::to_string(vertexCount*sizeof(float3)) + "}," +
+			"{\"buffer\":0,\"byteOffset\":" + std::to_string(o + vertexCount*sizeof(float3)) + ",\"byteLength\":" + std::to_string(vertexCount*sizeof(float3)) + "}," +
+			"{\"buffer\":0,\"byteOffset\":" + std::to_string(o + vertexCount*2*sizeof(float3)) + ",\"byteLength\":" + std::to_string(vertexCount*sizeof(float2)) + "}," +
+			"{\"buffer\":0,\"byteOffset\":" + std::to_string(o + vertexCount*(2*sizeof(float3) + sizeof(float2))) + ",\"byteLength\":" + std::to_string(indexCount*sizeof(uint32_t)) + "}";
+		accessors += std::string(m ? "," : "") +
+			"{\"bufferView\":" + std::to_string(4*m+0) + ",\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC3\",\"min\":[0,-0.1,0],\"max\":[1,0.1,1]}," +
+			"{\"bufferView\":" + std::to_string(4*m+1) + ",\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC3\"}," +
+			"{\"bufferView\":" + std::to_string(4*m+2) + ",\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC2\"}," +
+			"{\"bufferView\":" + std::to_string(4*m+3) + ",\"componentType\":5125,\"count\":" + std::to_string(indexCount) + ",\"type\":\"SCALAR\"}";
+		meshes += std::string(m ? "," : "") +
+			"{\"name\":\"mesh" + std::to_string(m) + "\",\"primitives\":[{\"attributes\":{\"POSITION\":" + std::to_string(4*m+0) + ",\"NORMAL\":" + std::to_string(4*m+1) + ",\"TEXCOORD_0\":" + std::to_string(4*m+2) + "}," +
+			"\"indices\":" + std::to_string(4*m+3) + ",\"material\":" + std::to_string(m % (imageCount/2)) + "}]}";
+		nodes += std::string(m ? "," : "") +
+			"{\"name\":\"node" + std::to_string(m) + "\",\"mesh\":" + std::to_string(m) + ",\"translation\":[" + std::to_string(m) + ",0,0]}";
+		children += std::string(m ? "," : "") + std::to_string(m);
+	}
+
+	std::string images, textures, materials;
+	for (uint32_t i = 0; i < imageCount; i++) {
+		images   += std::string(i ? "," : "") + "{\"name\":\"image" + std::to_string(i) + "\",\"uri\":\"image" + std::to_string(i) + ".png\"}";
+		textures += std::string(i ? "," : "") + "{\"source\":" + std::to_string(i) + "}";
+	}
+	for (uint32_t i = 0; i < imageCount/2; i++) {
+		materials += std::string(i ? "," : "") +
+			"{\"name\":\"material" + std::to_string(i) + "\",\"pbrMetallicRoughness\":{" +
+			"\"baseColorTexture\":{\"index\":" + std::to_string(2*i) + "},\"metallicRoughnessTexture\":{\"index\":" + std::to_string(2*i+1) + "}," +
+			"\"roughnessFactor\":" + std::to_string(0.1f*i) + "}}";
+	}
+
+	std::ofstream(dir / "scene.gltf") <<
+		"{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" << meshCount << "]}]," <<
+		"\"nodes\":[" << nodes << ",{\"name\":\"root\",\"children\":[" << children << "]}]," <<
+		"\"meshes\":[" << meshes << "],\"materials\":[" << materials << "]," <<
+		"\"images\":[" << images << "],\"textures\":[" << textures << "]," <<
+		"\"accessors\":[" << accessors << "],\"bufferViews\":[" << bufferViews << "]," <<
+		"\"buffers\":[{\"uri\":\"scene.bin\",\"byteLength\":" << data.size() << "}]}";
+}
+
+inline bool SameBytes(const BufferView& a, const BufferView& b) {
+	if (!a || !b) return !a && !b;
+	return a.size_bytes() == b.size_bytes() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+}
+
+// Compares the texel layout and subresource of a and b, and appends them to images for their texels to be compared.
+// Usage and other creation flags aren't compared, since they can differ between images with the same contents.
+inline bool SameImage(const ImageView& a, const ImageView& b, std::vector<std::pair<ImageView, ImageView>>& images) {
+	if (!a || !b) return !a && !b;
+	const ImageInfo& ia = a.mImage->Info();
+	const ImageInfo& ib = b.mImage->Info();
+	if (ia.format != ib.format || ia.extent != ib.extent || ia.mipLevels != ib.mipLevels || ia.arrayLayers != ib.arrayLayers) return false;
+	if (!(a.mSubresource == b.mSubresource && a.mComponentMapping == b.mComponentMapping)) return false;
+	if (std::ranges::none_of(images, [&](const auto& p) { return p.first.mImage == a.mImage && p.second.mImage == b.mImage; }))
+		images.emplace_back(a, b);
+	return true;
+}
+
+inline bool SameMesh(const Mesh& a, const Mesh& b) {
+	if (!SameBytes(a.indexBufferCpu, b.indexBufferCpu) || a.indexSize != b.indexSize || a.topology != b.topology) return false;
+	if (a.lods.size() != b.lods.size() || a.rayTracingLod != b.rayTracingLod) return false;
+	for (size_t i = 0; i < a.lods.size(); i++)
+		if (a.lods[i].firstTriangle != b.lods[i].firstTriangle || a.lods[i].triangleCount != b.lods[i].triangleCount || a.lods[i].error != b.lods[i].error)
+			return false;
+	if (a.meshletCount != b.meshletCount || a.meshletVertexCount != b.meshletVertexCount) return false;
+	if (a.positionOffset != b.positionOffset || a.positionScale != b.positionScale) return false;
+	if (std::memcmp(&a.aabb, &b.aabb, sizeof(a.aabb)) != 0) return false;
+	if (a.vertexAttributesCpu.size() != b.vertexAttributesCpu.size()) return false;
+	for (const auto&[type, attribs] : a.vertexAttributesCpu) {
+		const auto it = b.vertexAttributesCpu.find(type);
+		if (it == b.vertexAttributesCpu.end() || it->second.size() != attribs.size()) return false;
+		for (size_t i = 0; i < attribs.size(); i++)
+			if (!SameBytes(attribs[i].first, it->second[i].first) || attribs[i].second != it->second[i].second)
+				return false;
+	}
+	return true;
+}
+
+// Compares the node trees, meshes and materials of a and b, and appends the pairs of material images to images
+inline bool SameScene(const SceneNode& a, const SceneNode& b, std::vector<std::pair<ImageView, ImageView>>& images) {
+	if (a.Name() != b.Name() || a.transform.has_value() != b.transform.has_value()) return false;
+	if (a.transform && std::memcmp(&*a.transform, &*b.transform, sizeof(Transform)) != 0) return false;
+	if (bool(a.mesh) != bool(b.mesh) || (a.mesh && !SameMesh(*a.mesh, *b.mesh))) return false;
+	if (bool(a.material) != bool(b.material)) return false;
+	if (a.material) {
+		const Material<ImageView>& ma = *a.material;
+		const Material<ImageView>& mb = *b.material;
+		if (ma.packed != mb.packed ||
+			!SameImage(ma.baseColorImage, mb.baseColorImage, images) ||
+			!SameImage(ma.emissionImage, mb.emissionImage, images) ||
+			!SameImage(ma.metallicRoughness, mb.metallicRoughness, images) ||
+			!SameImage(ma.bumpMap, mb.bumpMap, images))
+			return false;
+	}
+	const auto ca = std::ranges::distance(a.begin(), a.end());
+	const auto cb = std::ranges::distance(b.begin(), b.end());
+	if (ca != cb) return false;
+	for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ++ia, ++ib)
+		if (!SameScene(**ia, **ib, images))
+			return false;
+	return true;
+}
+
+// Copies every mip level of image to a host buffer. The copies are valid once context's commands are done.
+inline std::vector<BufferView> ReadLevels(CommandContext& context, const ImageView& image) {
+	std::vector<BufferView> levels;
+	const ImageInfo& info = image.mImage->Info();
+	for (uint32_t level = 0; level < info.mipLevels; level++) {
+		const uint3 extent = image.Extent(level);
+		const BufferView buffer = Buffer::Create(
+			context.GetDevice(),
+			GetImageSize(info.format, extent) * info.arrayLayers,
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent|vk::MemoryPropertyFlagBits::eHostCached,
+			VMA_ALLOCATION_CREATE_MAPPED_BIT|VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+		context.Copy(image, buffer, level);
+		levels.emplace_back(buffer);
+	}
+	return levels;
+}
+
+// Reads back every level of each pair of images and compares their texels. Submits and waits on context.
+inline bool SameTexels(CommandContext& context, const std::vector<std::pair<ImageView, ImageView>>& images) {
+	context.Begin();
+	std::vector<std::pair<std::vector<BufferView>, std::vector<BufferView>>> texels;
+	for (const auto&[a, b] : images)
+		texels.emplace_back(ReadLevels(context, a), ReadLevels(context, b));
+	context.Submit();
+	context.GetDevice().Wait();
+
+	for (const auto&[a, b] : texels) {
+		if (a.size() != b.size()) return false;
+		for (size_t level = 0; level < a.size(); level++)
+			if (!SameBytes(a[level], b[level])) return false;
+	}
+	return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Algorithm/ConcurrentBinaryTree/ConcurrentBinaryTree.hpp>
+#include <Rose/Algorithm/ConcurrentBinaryTree/cbt.h>
+
+#include <algorithm>
+#include <iostream>
+
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	vk::raii::QueryPool queryPool(**device, vk::QueryPoolCreateInfo{
+		.queryType = vk::QueryType::eTimestamp,
+		.queryCount = 2 });
+
+	const uint32_t maxDepth = 16;
+
+	bool allPassed = true;
+
+	for (uint32_t N : { 1, 4, 16, 64 }) {
+		// each tree is subdivided to a different depth, so that mixing up trees shows up as a wrong node count
+		std::vector<uint32_t> expected(N);
+		std::vector<cbt_Tree*> cpuTrees(N);
+		for (uint32_t i = 0; i < N; i++) {
+			cpuTrees[i] = cbt_CreateAtDepth(maxDepth, i % maxDepth);
+			expected[i] = (uint32_t)cbt_NodeCount(cpuTrees[i]);
+		}
+
+		auto drawArgsCpu     = Buffer::Create(*device, std::vector<vk::DrawIndirectCommand>(N), vk::BufferUsageFlagBits::eTransferDst);
+		auto dispatchArgsCpu = Buffer::Create(*device, std::vector<uint4>(N), vk::BufferUsageFlagBits::eTransferDst);
+
+		context->Begin();
+
+		// cbt_CreateAtDepth already sum-reduces the heap, so only the leaf bitfield and the max depth marker are uploaded.
+		// The internal nodes are zeroed for Build to fill in.
+		auto cbt = ConcurrentBinaryTree::Create(*context, maxDepth, N);
+		for (uint32_t i = 0; i < N; i++) {
+			const uint64_t* heap = (const uint64_t*)cbt_GetHeap(cpuTrees[i]);
+			std::vector<uint64_t> leaves(heap, heap + cbt_HeapByteSize(cpuTrees[i]) / sizeof(uint64_t));
+			std::fill(leaves.begin(), leaves.begin() + (1 << (maxDepth - 5)), 0);
+			leaves[0] = 1ull << maxDepth;
+			context->Copy(context->UploadData(leaves), cbt->GetBuffer(i));
+		}
+
+		auto drawArgs     = context->GetTransientBuffer<vk::DrawIndirectCommand>(N, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+		auto dispatchArgs = context->GetTransientBuffer<uint4>(N, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+
+		(*context)->resetQueryPool(*queryPool, 0, 2);
+		(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 0);
+
+		cbt->Build(*context);
+		cbt->WriteIndirectArgs(*context, dispatchArgs, drawArgs, 256);
+
+		(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 1);
+
+		context->Copy(drawArgs, drawArgsCpu);
+		context->Copy(dispatchArgs, dispatchArgsCpu);
+
+		context->Submit();
+		device->Wait();
+
+		auto [result, timestamps] = queryPool.getResults<uint64_t>(0, 2, sizeof(uint64_t)*2, sizeof(uint64_t), vk::QueryResultFlagBits::e64|vk::QueryResultFlagBits::eWait);
+		const double gpuTime = (timestamps[1] - timestamps[0]) * device->Limits().timestampPeriod / 1e6;
+
+		bool passed = true;
+		for (uint32_t i = 0; i < N; i++) {
+			const uint32_t expectedGroups = std::max((expected[i] + 255) / 256, 1u);
+			if (drawArgsCpu[i].instanceCount != expected[i] || dispatchArgsCpu[i].x != expectedGroups) {
+				passed = false;
+				allPassed = false;
+				std::cout << "Mismatch at tree " << i << ": " << drawArgsCpu[i].instanceCount << " != " << expected[i] << std::endl;
+				break;
+			}
+		}
+
+		for (cbt_Tree* tree : cpuTrees)
+			cbt_Release(tree);
+
+		std::cout << "N = " << N << ": " << (passed ? "PASSED" : "FAILED")
+			<< " (" << cbt->BuildDispatchCount() + 1 << " dispatches, " << gpuTime << "ms)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
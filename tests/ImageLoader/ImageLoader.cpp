@@ -0,0 +1,220 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/ImageLoader.hpp>
+
+#include <stb_image_write.h>
+#include <miniz.h>
+
+#include <fstream>
+#include <iostream>
+#include <random>
+
+using namespace RoseEngine;
+
+// Writes an RGBA8 2D array DDS with a full mip chain. Every texel of a level and layer is set to level*16 + layer.
+void WriteTestDDS(const std::filesystem::path& filename, const uint32_t size, const uint32_t mipLevels, const uint32_t arrayLayers) {
+	std::vector<uint32_t> header(1 + 31 + 5, 0);
+	header[0] = 0x20534444; // "DDS "
+	header[1] = 124;
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; // caps, height, width, pixel format, mip count
+	header[3] = size;
+	header[4] = size;
+	header[7] = mipLevels;
+	header[19] = 32;
+	header[20] = 0x4; // four cc
+	header[21] = 0x30315844; // "DX10"
+	header[27] = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+	header[32] = 28; // DXGI_FORMAT_R8G8B8A8_UNORM
+	header[33] = 3;  // 2D
+	header[35] = arrayLayers;
+
+	std::ofstream f(filename, std::ios::binary);
+	f.write((const char*)header.data(), header.size() * sizeof(uint32_t));
+	for (uint32_t layer = 0; layer < arrayLayers; layer++)
+		for (uint32_t level = 0; level < mipLevels; level++) {
+			const uint32_t s = std::max(size >> level, 1u);
+			const std::vector<uint8_t> texels(s*s*4, uint8_t(level*16 + layer));
+			f.write((const char*)texels.data(), texels.size());
+		}
+}
+
+// Writes an RGBA8 2D array KTX2 like WriteTestDDS, optionally with zlib supercompression
+void WriteTestKTX2(const std::filesystem::path& filename, const uint32_t size, const uint32_t mipLevels, const uint32_t arrayLayers, const bool zlib) {
+	std::vector<std::vector<uint8_t>> levels(mipLevels);
+	for (uint32_t level = 0; level < mipLevels; level++) {
+		const uint32_t s = std::max(size >> level, 1u);
+		for (uint32_t layer = 0; layer < arrayLayers; layer++)
+			levels[level].insert(levels[level].end(), s*s*4, uint8_t(level*16 + layer));
+	}
+
+	const uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	std::vector<uint32_t> header = {
+		(uint32_t)VK_FORMAT_R8G8B8A8_UNORM, 1, size, size, 0, arrayLayers, 1, mipLevels, zlib ? 3u : 0u,
+		0, 0, 0, 0, 0, 0, 0, 0 };
+	std::vector<uint64_t> levelIndex(mipLevels * 3);
+	std::vector<std::vector<uint8_t>> stored(mipLevels);
+
+	uint64_t offset = sizeof(identifier) + header.size() * sizeof(uint32_t) + levelIndex.size() * sizeof(uint64_t);
+	for (int32_t level = mipLevels - 1; level >= 0; level--) { // smallest level first, as in the specification
+		if (zlib) {
+			mz_ulong length = mz_compressBound((mz_ulong)levels[level].size());
+			stored[level].resize(length);
+			mz_compress(stored[level].data(), &length, levels[level].data(), (mz_ulong)levels[level].size());
+			stored[level].resize(length);
+		} else
+			stored[level] = levels[level];
+		offset = (offset + 3) & ~uint64_t(3);
+		levelIndex[3*level + 0] = offset;
+		levelIndex[3*level + 1] = stored[level].size();
+		levelIndex[3*level + 2] = levels[level].size();
+		offset += stored[level].size();
+	}
+
+	std::ofstream f(filename, std::ios::binary);
+	f.write((const char*)identifier, sizeof(identifier));
+	f.write((const char*)header.data(), header.size() * sizeof(uint32_t));
+	f.write((const char*)levelIndex.data(), levelIndex.size() * sizeof(uint64_t));
+	for (int32_t level = mipLevels - 1; level >= 0; level--) {
+		while ((uint64_t)f.tellp() < levelIndex[3*level])
+			f.put(0);
+		f.write((const char*)stored[level].data(), stored[level].size());
+	}
+}
+
+// Loads a folder of PNG and HDR images through ImageLoader with one and with all hardware threads
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eTransfer);
+
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "RoseTestImageLoader";
+	std::filesystem::create_directories(dir);
+
+	const uint32_t imageCount = 8;
+	const uint32_t imageSize = 1024;
+
+	std::vector<std::filesystem::path> files;
+	{
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> noise(0, 1);
+		std::vector<uint8_t> ldr(imageSize*imageSize*4);
+		std::vector<float>   hdr(imageSize*imageSize*3);
+		for (uint32_t i = 0; i < imageCount; i++) {
+			for (auto& p : ldr) p = uint8_t(255 * noise(rng));
+			for (auto& p : hdr) p = 16 * noise(rng);
+			files.emplace_back(dir / ("image" + std::to_string(i) + ".png"));
+			stbi_write_png(files.back().string().c_str(), imageSize, imageSize, 4, ldr.data(), imageSize*4);
+			files.emplace_back(dir / ("image" + std::to_string(i) + ".hdr"));
+			stbi_write_hdr(files.back().string().c_str(), imageSize, imageSize, 3, hdr.data());
+		}
+	}
+	const std::filesystem::path missingFile = dir / "missing.png";
+
+	bool allPassed = true;
+
+	const uint32_t threadCounts[] = { 1, std::max(std::thread::hardware_concurrency(), 1u) };
+	double seconds[2];
+	for (uint32_t t = 0; t < 2; t++) {
+		ImageLoader loader(threadCounts[t]);
+
+		context->Begin();
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+
+		std::vector<ref<AsyncImage>> images;
+		for (const auto& f : files)
+			images.emplace_back(loader.Load(*context, f));
+		const ref<AsyncImage> missing = loader.Load(*context, missingFile);
+
+		// the placeholder is usable right away
+		bool placeholderPassed = true;
+		for (const auto& img : images)
+			if (!img->View() || img->View().Extent() != uint3(1, 1, 1))
+				placeholderPassed = false;
+
+		// upload images as they finish decoding, like a frame loop would
+		while (loader.PendingCount() > 0) {
+			loader.Update(*context);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		seconds[t] = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t0).count();
+
+		context->Submit();
+		device->Wait();
+
+		bool uploadPassed = true;
+		for (const auto& img : images) {
+			const bool hdr = img->Filename().extension() == ".hdr";
+			if (!img->IsReady() || img->View().Extent() != uint3(imageSize, imageSize, 1) ||
+				img->View().mImage->Info().format != (hdr ? vk::Format::eR32G32B32A32Sfloat : vk::Format::eR8G8B8A8Srgb))
+				uploadPassed = false;
+		}
+		const bool errorPassed = missing->IsDone() && !missing->IsReady() && !missing->Error().empty();
+
+		const auto stats = loader.Stats();
+		const bool statsPassed =
+			stats.contains(".png") && stats.at(".png").count == imageCount && stats.at(".png").failures == 1 &&
+			stats.contains(".hdr") && stats.at(".hdr").count == imageCount && stats.at(".hdr").decodedBytes == size_t(imageCount) * imageSize * imageSize * 16;
+
+		const bool passed = placeholderPassed && uploadPassed && errorPassed && statsPassed;
+		if (!passed) allPassed = false;
+
+		std::cout << threadCounts[t] << " decode threads: " << (passed ? "PASSED" : "FAILED") << " (" << seconds[t] << "s)" << std::endl;
+		for (const auto&[extension, s] : stats)
+			std::cout << "\t" << extension << ": " << s.count << " images, " << 1000 * s.decodeSeconds / std::max(s.count, 1u) << "ms average, " << 1000 * s.maxDecodeSeconds << "ms max" << std::endl;
+	}
+	std::cout << "Speedup: " << seconds[0] / seconds[1] << "x" << std::endl;
+
+	// every level and layer of DDS and KTX2 files is uploaded
+	const uint32_t size = 64;
+	const uint32_t mipLevels = 7;
+	const uint32_t arrayLayers = 3;
+	WriteTestDDS(dir / "array.dds", size, mipLevels, arrayLayers);
+	WriteTestKTX2(dir / "array.ktx2", size, mipLevels, arrayLayers, false);
+	WriteTestKTX2(dir / "array_zlib.ktx2", size, mipLevels, arrayLayers, true);
+	for (const char* file : { "array.dds", "array.ktx2", "array_zlib.ktx2" }) {
+		ImageLoader loader;
+		context->Begin();
+		const ref<AsyncImage> image = loader.Load(*context, dir / file);
+		loader.Flush(*context);
+
+		bool passed = image->IsReady() &&
+			image->View().mImage->Info().mipLevels == mipLevels &&
+			image->View().mImage->Info().arrayLayers == arrayLayers &&
+			image->View().mType == vk::ImageViewType::e2DArray;
+
+		std::vector<BufferView> levels;
+		if (passed) {
+			for (uint32_t level = 0; level < mipLevels; level++) {
+				const uint32_t s = std::max(size >> level, 1u);
+				levels.emplace_back(Buffer::Create(*device, s*s*4*arrayLayers, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent, VMA_ALLOCATION_CREATE_MAPPED_BIT|VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+				context->Copy(image->View(), levels.back(), level);
+			}
+		}
+		context->Submit();
+		device->Wait();
+
+		for (uint32_t level = 0; level < levels.size(); level++) {
+			const size_t layerBytes = levels[level].size_bytes() / arrayLayers;
+			for (uint32_t layer = 0; layer < arrayLayers; layer++)
+				for (size_t i = 0; i < layerBytes; i++)
+					if (uint8_t(levels[level].data()[layer*layerBytes + i]) != uint8_t(level*16 + layer)) {
+						passed = false;
+						break;
+					}
+		}
+		if (!passed) allPassed = false;
+
+		std::cout << file << " mip chain and array layers: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	std::filesystem::remove_all(dir);
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
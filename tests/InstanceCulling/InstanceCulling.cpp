@@ -0,0 +1,85 @@
+#include <Rose/Core/Instance.hpp>
+#include <SceneRendererApp/Culling/InstanceCulling.hpp>
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Culls a batch of instances alternating between inside and outside of the view, with and without drawIndirectCount.
+// Compacted commands must list only the visible instances, and fixed count commands must keep every instance
+// at its own slot with instanceCount 0 when culled.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	const uint32_t instanceCount = 8;
+	const uint32_t triangleCount = 12;
+
+	Mesh mesh = {};
+	mesh.aabb = vk::AabbPositionsKHR(-1, -1, -1, 1, 1, 1);
+	mesh.lods = { MeshLod{ .firstTriangle = 0, .triangleCount = triangleCount, .error = 0 } };
+
+	// odd instances are far outside of the identity view
+	std::vector<InstanceHeader> headers(instanceCount);
+	std::vector<Transform>      transforms(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++) {
+		headers[i] = InstanceHeader{ .transformIndex = i, .materialIndex = 0, .meshIndex = 0, .triangleCount = triangleCount };
+		transforms[i] = Transform::Translate(float3(i % 2 == 0 ? 0 : 100, 0, 0)) * Transform::Scale(float3(0.5f));
+	}
+
+	Scene scene;
+	scene.renderData.drawLists = { { SceneRenderData::DrawBatch{ .mesh = &mesh, .draws = { { 0u, instanceCount } } } } };
+	scene.renderData.drawListVersion = 1;
+	scene.renderData.updateTime = std::chrono::high_resolution_clock::now();
+
+	auto cull = [&](InstanceCulling& culling) {
+		context->Begin();
+		scene.renderData.sceneParameters["instances"]  = (BufferView)context->UploadData(headers,    vk::BufferUsageFlagBits::eStorageBuffer);
+		scene.renderData.sceneParameters["transforms"] = (BufferView)context->UploadData(transforms, vk::BufferUsageFlagBits::eStorageBuffer);
+		const BufferRange<uint32_t> firstTriangles = context->GetTransientBuffer<uint32_t>(instanceCount, vk::BufferUsageFlagBits::eStorageBuffer);
+		culling.Cull(*context, scene, Transform::Identity(), float3(0), 1, 1, firstTriangles);
+		ReadbackFuture<vk::DrawIndexedIndirectCommand> commands = context->Readback(culling.DrawCommands());
+		context->Submit();
+		return std::vector<vk::DrawIndexedIndirectCommand>(commands.get().begin(), commands.get().end());
+	};
+
+	bool allPassed = true;
+
+	if (device->SupportsDrawIndirectCount()) {
+		InstanceCulling culling;
+		const auto commands = cull(culling);
+		bool passed = !culling.UsesFixedCount();
+		for (uint32_t i = 0; i < instanceCount / 2; i++) {
+			const vk::DrawIndexedIndirectCommand& c = commands[i];
+			passed = passed && c.instanceCount == 1 && c.indexCount == triangleCount * 3 && c.firstInstance % 2 == 0;
+		}
+		if (!passed) allPassed = false;
+		std::cout << "Compacted commands: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	} else
+		std::cout << "Compacted commands: skipped, drawIndirectCount is not supported" << std::endl;
+
+	{
+		InstanceCulling culling;
+		culling.useDrawIndirectCount = false;
+		const auto commands = cull(culling);
+		bool passed = culling.UsesFixedCount();
+		for (uint32_t i = 0; i < instanceCount; i++) {
+			const vk::DrawIndexedIndirectCommand& c = commands[i];
+			if (i % 2 == 0)
+				passed = passed && c.instanceCount == 1 && c.indexCount == triangleCount * 3 && c.firstInstance == i;
+			else
+				passed = passed && c.instanceCount == 0;
+		}
+		if (!passed) allPassed = false;
+		std::cout << "Fixed count commands: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <Rose/Core/Instance.hpp>
+#include "../Common/TestScene.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace RoseEngine;
+
+// Imports the same glTF with one and with all hardware threads, and checks that both produce the same scene and texels
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eTransfer);
+
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "RoseTestLoadGLTF";
+	std::filesystem::create_directories(dir);
+	WriteTestScene(dir, 16, 1024, 8, 128);
+
+	const uint32_t threadCounts[] = { 1, std::max(std::thread::hardware_concurrency(), 1u) };
+
+	ref<SceneNode> scenes[2];
+	double seconds[2];
+	for (uint32_t i = 0; i < 2; i++) {
+		context->Begin();
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		scenes[i] = LoadGLTF(*context, dir / "scene.gltf", true, threadCounts[i]);
+		seconds[i] = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t0).count();
+		context->Submit();
+		device->Wait();
+	}
+
+	std::filesystem::remove_all(dir);
+
+	std::vector<std::pair<ImageView, ImageView>> images;
+	const bool passed = scenes[0] && scenes[1] && SameScene(*scenes[0], *scenes[1], images) && !images.empty() && SameTexels(*context, images);
+
+	std::cout << "Import with " << threadCounts[0] << " thread: " << seconds[0] << "s" << std::endl;
+	std::cout << "Import with " << threadCounts[1] << " threads: " << seconds[1] << "s (" << seconds[0] / seconds[1] << "x)" << std::endl;
+	std::cout << "Identical scenes: " << (passed ? "PASSED" : "FAILED") << std::endl;
+
+	if (passed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
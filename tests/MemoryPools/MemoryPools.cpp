@@ -0,0 +1,104 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/Image.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Sums the statistics of every memory type of a pool
+Device::MemoryPoolStats GetStats(const Device& device, const MemoryPool pool) {
+	Device::MemoryPoolStats sum = { .pool = pool };
+	uint32_t count = 0;
+	for (const Device::MemoryPoolStats& s : device.MemoryPoolStatistics()) {
+		if (s.pool != pool) continue;
+		sum.memoryType       = s.memoryType;
+		sum.allocationCount += s.allocationCount;
+		sum.allocationBytes += s.allocationBytes;
+		sum.blockCount      += s.blockCount;
+		sum.blockBytes      += s.blockBytes;
+		sum.freeRanges      += s.freeRanges;
+		sum.fragmentation    = s.fragmentation;
+		count++;
+	}
+	if (count > 1) sum.fragmentation = -1; // only meaningful for a single memory type
+	return sum;
+}
+
+// Creates buffers and images in each class of memory pool, and checks that they are allocated from the right pools,
+// that the statistics shown by the memory pool widget match them, and that transient pools reuse freed memory.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	const vk::DeviceSize size = 4 << 20;
+	const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	auto createBuffer = [&](const MemoryPool pool) {
+		return Buffer::Create(*device, size, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 0.5f, pool);
+	};
+
+	const BufferView defaultBuffer = createBuffer(MemoryPool::eDefault);
+	std::vector<BufferView> sceneBuffers = { createBuffer(MemoryPool::eScene), createBuffer(MemoryPool::eScene) };
+	std::vector<BufferView> transientBuffers = { createBuffer(MemoryPool::eTransient), createBuffer(MemoryPool::eTransient), createBuffer(MemoryPool::eTransient) };
+	const ref<Image> renderTarget = Image::Create(*device, ImageInfo{
+		.format = vk::Format::eR8G8B8A8Unorm,
+		.extent = uint3(256, 256, 1),
+		.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc },
+		vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT, 1.f, MemoryPool::eRenderTarget);
+
+	auto allocatedBytes = [](const std::vector<BufferView>& buffers) {
+		vk::DeviceSize bytes = 0;
+		for (const BufferView& b : buffers)
+			if (b) bytes += b.mBuffer->AllocationInfo().size;
+		return bytes;
+	};
+
+	const Device::MemoryPoolStats scene0     = GetStats(*device, MemoryPool::eScene);
+	const Device::MemoryPoolStats transient0 = GetStats(*device, MemoryPool::eTransient);
+	const Device::MemoryPoolStats target0    = GetStats(*device, MemoryPool::eRenderTarget);
+	const bool hasDefaultPool = std::ranges::any_of(device->MemoryPoolStatistics(), [](const auto& s) { return s.pool == MemoryPool::eDefault; });
+
+	const bool selectPassed = !hasDefaultPool &&
+		scene0.allocationCount == 2 && transient0.allocationCount == 3 &&
+		target0.allocationCount == 1 && target0.blockCount == 1; // render targets get dedicated memory
+
+	const bool statsPassed =
+		scene0.allocationBytes == allocatedBytes(sceneBuffers) &&
+		transient0.allocationBytes == allocatedBytes(transientBuffers) &&
+		transient0.blockBytes >= transient0.allocationBytes &&
+		target0.allocationBytes == renderTarget->MemorySize() &&
+		transient0.freeRanges <= transient0.blockCount && transient0.fragmentation == 0;
+
+	// freeing the middle buffer leaves a hole before the free end of the block
+	const vk::DeviceSize holeBytes = transientBuffers[1].mBuffer->AllocationInfo().size;
+	transientBuffers[1] = {};
+	const Device::MemoryPoolStats transient1 = GetStats(*device, MemoryPool::eTransient);
+	const vk::DeviceSize unusedBytes = transient1.blockBytes - transient1.allocationBytes;
+	const bool holePassed =
+		transient1.allocationCount == 2 &&
+		transient1.allocationBytes == allocatedBytes(transientBuffers) &&
+		transient1.freeRanges == transient0.freeRanges + 1 &&
+		std::abs(transient1.fragmentation - holeBytes / (float)unusedBytes) < 1e-4f;
+
+	// an allocation of the same size fills the hole instead of growing the pool
+	transientBuffers[1] = createBuffer(MemoryPool::eTransient);
+	const Device::MemoryPoolStats transient2 = GetStats(*device, MemoryPool::eTransient);
+	const bool reusePassed =
+		transient2.allocationCount == 3 &&
+		transient2.blockBytes == transient0.blockBytes &&
+		transient2.freeRanges == transient0.freeRanges &&
+		transient2.fragmentation == 0;
+
+	std::cout << "Pool selection: "      << (selectPassed ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Pool statistics: "     << (statsPassed  ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Freed range: "         << (holePassed   ? "PASSED" : "FAILED") << " (" << transient1.freeRanges << " free ranges, " << transient1.fragmentation * 100 << "% fragmentation)" << std::endl;
+	std::cout << "Reuse of freed range: " << (reusePassed  ? "PASSED" : "FAILED") << " (" << transient2.freeRanges << " free ranges)" << std::endl;
+
+	if (selectPassed && statsPassed && holePassed && reusePassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <Rose/Scene/MeshOptimize.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+// Shuffles the triangles and vertices of a tessellated sphere, optimizes them, and checks that the same triangles
+// with the same winding remain, that vertices are numbered in order of first use, and that the ACMR improves.
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	bool allPassed = true;
+
+	const uint32_t n = 256;
+	std::vector<float3>   positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y <= n; y++)
+		for (uint32_t x = 0; x <= n; x++) {
+			const float theta = float(M_PI) * y / n;
+			const float phi   = 2 * float(M_PI) * x / n;
+			positions.emplace_back(std::sin(theta)*std::cos(phi), std::cos(theta), std::sin(theta)*std::sin(phi));
+		}
+	for (uint32_t y = 0; y < n; y++)
+		for (uint32_t x = 0; x < n; x++) {
+			const uint32_t i = y*(n+1) + x;
+			indices.insert(indices.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+		}
+	const uint32_t triangleCount = (uint32_t)indices.size()/3;
+
+	// shuffle triangles and vertices, as an exporter without any optimization might
+	{
+		std::mt19937 rng(0);
+		std::vector<uint32_t> triangleOrder(triangleCount);
+		std::iota(triangleOrder.begin(), triangleOrder.end(), 0);
+		std::ranges::shuffle(triangleOrder, rng);
+		std::vector<uint32_t> vertexOrder(positions.size());
+		std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+		std::ranges::shuffle(vertexOrder, rng);
+
+		std::vector<uint32_t> shuffled(indices.size());
+		for (uint32_t i = 0; i < triangleCount; i++)
+			for (uint32_t j = 0; j < 3; j++)
+				shuffled[3*i + j] = vertexOrder[indices[3*triangleOrder[i] + j]];
+		indices = std::move(shuffled);
+
+		std::vector<float3> shuffledPositions(positions.size());
+		for (uint32_t v = 0; v < positions.size(); v++)
+			shuffledPositions[vertexOrder[v]] = positions[v];
+		positions = std::move(shuffledPositions);
+	}
+
+	// triangles as position triples rotated to start at the smallest vertex, which survive renumbering
+	auto canonicalTriangles = [](const std::vector<uint32_t>& idx, const std::vector<float3>& pos) {
+		std::vector<std::array<float, 9>> triangles(idx.size()/3);
+		for (size_t i = 0; i < triangles.size(); i++) {
+			std::array<float3, 3> p = { pos[idx[3*i]], pos[idx[3*i + 1]], pos[idx[3*i + 2]] };
+			auto less = [](const float3 a, const float3 b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+			while (less(p[1], p[0]) || less(p[2], p[0]))
+				std::rotate(p.begin(), p.begin() + 1, p.end());
+			for (uint32_t j = 0; j < 3; j++)
+				for (uint32_t k = 0; k < 3; k++)
+					triangles[i][3*j + k] = p[j][k];
+		}
+		std::ranges::sort(triangles);
+		return triangles;
+	};
+	const auto referenceTriangles = canonicalTriangles(indices, positions);
+
+	for (const float overdrawThreshold : { 0.f, 1.05f }) {
+		std::vector<uint32_t> optimized = indices;
+		const float acmrBefore = ComputeACMR(optimized);
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		OptimizeTriangleOrder(optimized, reinterpret_cast<const std::byte*>(positions.data()), sizeof(float3), 16, overdrawThreshold);
+		const std::vector<uint32_t> oldIndices = OptimizeVertexFetch(optimized);
+		const double time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - start).count();
+
+		const float acmrAfter = ComputeACMR(optimized);
+
+		std::vector<float3> remapped(oldIndices.size());
+		for (uint32_t v = 0; v < oldIndices.size(); v++)
+			remapped[v] = positions[oldIndices[v]];
+
+		bool passed = oldIndices.size() == positions.size() && canonicalTriangles(optimized, remapped) == referenceTriangles;
+
+		// vertices are first used in order
+		uint32_t nextVertex = 0;
+		for (const uint32_t v : optimized) {
+			if (v > nextVertex) passed = false;
+			if (v == nextVertex) nextVertex++;
+		}
+
+		passed = passed && acmrAfter < 0.8f && acmrAfter < acmrBefore;
+		if (!passed) allPassed = false;
+
+		std::cout << "Sphere (" << triangleCount << " triangles, overdraw threshold " << overdrawThreshold << "): " << (passed ? "PASSED" : "FAILED")
+			<< " (ACMR " << acmrBefore << " -> " << acmrAfter << ", " << time << "ms)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <Rose/Scene/MeshSimplify.hpp>
+
+#include <iostream>
+#include <chrono>
+
+// Builds LOD chains for a tessellated sphere, with and without a split seam, and checks that every level
+// is a valid, consistently oriented triangle list close to the sphere, with a seam that stays closed.
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	bool allPassed = true;
+
+	for (const bool splitSeam : { false, true }) {
+		const uint32_t n = 512;
+
+		// latitude/longitude sphere. With splitSeam, the vertices at phi = 0 and phi = 2pi are duplicated, like at a texture seam.
+		const uint32_t columns = splitSeam ? n + 1 : n;
+		std::vector<float3>   positions;
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y <= n; y++)
+			for (uint32_t x = 0; x < columns; x++) {
+				const float theta = float(M_PI) * y / n;
+				const float phi   = 2 * float(M_PI) * x / n;
+				positions.emplace_back(std::sin(theta)*std::cos(phi), std::cos(theta), std::sin(theta)*std::sin(phi));
+			}
+		for (uint32_t y = 0; y < n; y++)
+			for (uint32_t x = 0; x < n; x++) {
+				const uint32_t x1 = splitSeam ? x + 1 : (x + 1) % n;
+				const uint32_t i00 = y*columns + x, i01 = y*columns + x1;
+				const uint32_t i10 = (y+1)*columns + x, i11 = (y+1)*columns + x1;
+				// skip the degenerate triangles at the poles
+				if (y > 0)     indices.insert(indices.end(), { i00, i01, i10 });
+				if (y < n - 1) indices.insert(indices.end(), { i01, i11, i10 });
+			}
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		const MeshLodChain chain = MeshLodChain::Build(std::as_bytes(std::span{ indices }), sizeof(uint32_t), reinterpret_cast<const std::byte*>(positions.data()), sizeof(float3));
+		const double buildTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+		bool passed = chain.lods.size() > 1;
+		for (uint32_t i = 0; i < chain.lods.size(); i++) {
+			const MeshLod& lod = chain.lods[i];
+			if (i > 0 && (lod.triangleCount >= chain.lods[i-1].triangleCount || lod.error < chain.lods[i-1].error))
+				passed = false;
+
+			float maxDistance = 0;
+			for (uint32_t t = lod.firstTriangle; t < lod.firstTriangle + lod.triangleCount; t++) {
+				const float3 p0 = positions[chain.indices[3*t + 0]];
+				const float3 p1 = positions[chain.indices[3*t + 1]];
+				const float3 p2 = positions[chain.indices[3*t + 2]];
+				const float3 centroid = (p0 + p1 + p2) / 3.f;
+
+				// outward facing, like the input
+				if (dot(cross(p1 - p0, p2 - p0), centroid) <= 0)
+					passed = false;
+				maxDistance = std::max(maxDistance, 1 - length(centroid));
+			}
+
+			// the quadric error bounds the distance to the input surface, which is within the tessellation error of the sphere
+			const float tessellationError = 1 - std::cos(float(M_PI) / n);
+			if (maxDistance > lod.error + tessellationError + 1e-4f)
+				passed = false;
+
+			// the seam must not open: both copies of a seam vertex are moved or kept together
+			if (splitSeam) {
+				std::vector<bool> used(positions.size(), false);
+				for (uint32_t t = lod.firstTriangle; t < lod.firstTriangle + lod.triangleCount; t++)
+					for (uint32_t j = 0; j < 3; j++)
+						used[chain.indices[3*t + j]] = true;
+				for (uint32_t y = 1; y < n; y++)
+					if (used[y*columns] != used[y*columns + n])
+						passed = false;
+			}
+		}
+
+		if (!passed) allPassed = false;
+
+		std::cout << (splitSeam ? "Sphere with seam" : "Sphere") << " (" << chain.lods[0].triangleCount << " triangles): " << (passed ? "PASSED" : "FAILED")
+			<< " (" << buildTime << "ms)" << std::endl;
+		for (const MeshLod& lod : chain.lods)
+			std::cout << "\t" << lod.triangleCount << " triangles, error " << lod.error << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
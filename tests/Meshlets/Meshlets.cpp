@@ -0,0 +1,98 @@
+#include <Rose/Scene/Meshlets.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+// Builds meshlets for a tessellated sphere, checks that they cover every triangle once within the size limits,
+// that the bounds are conservative, and reports the fraction of meshlets rejected by the normal cone test.
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	bool allPassed = true;
+
+	for (const uint32_t n : { 16, 512 }) {
+		std::vector<float3>   positions;
+		std::vector<uint32_t> indices;
+		positions.reserve((n+1)*(n+1));
+		indices.reserve(n*n*6);
+		for (uint32_t y = 0; y <= n; y++)
+			for (uint32_t x = 0; x <= n; x++) {
+				const float theta = float(M_PI) * y / n;
+				const float phi   = 2 * float(M_PI) * x / n;
+				positions.emplace_back(std::sin(theta)*std::cos(phi), std::cos(theta), std::sin(theta)*std::sin(phi));
+			}
+		for (uint32_t y = 0; y < n; y++)
+			for (uint32_t x = 0; x < n; x++) {
+				const uint32_t i = y*(n+1) + x;
+				indices.insert(indices.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+			}
+		const uint32_t triangleCount = (uint32_t)indices.size()/3;
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		const MeshletSet set = MeshletSet::Build(std::as_bytes(std::span{ indices }), sizeof(uint32_t), reinterpret_cast<const std::byte*>(positions.data()), sizeof(float3));
+		const double buildTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+		const float3 camera = float3(0, 0, 5);
+
+		bool passed = !set.empty();
+		std::vector<uint32_t> triangleMeshletCounts(triangleCount, 0);
+		uint32_t culledCount = 0;
+		for (const Meshlet& m : set.meshlets) {
+			if (m.vertexCount > MESHLET_MAX_VERTICES || m.triangleCount > MESHLET_MAX_TRIANGLES || m.triangleCount == 0) {
+				passed = false;
+				continue;
+			}
+
+			for (uint32_t i = 0; i < m.vertexCount; i++)
+				if (length(positions[set.vertices[m.vertexOffset + i]] - m.center) > m.radius * 1.0001f)
+					passed = false;
+
+			const float3 v = m.center - camera;
+			const bool culled = dot(v, m.coneAxis) >= m.coneCutoff * length(v) + m.radius;
+			if (culled) culledCount++;
+
+			for (uint32_t i = 0; i < m.triangleCount; i++) {
+				const uint2 tri = set.triangles[m.triangleOffset + i];
+				if (tri.y >= triangleCount) {
+					passed = false;
+					continue;
+				}
+				triangleMeshletCounts[tri.y]++;
+
+				// local indices must refer to the mesh's triangle
+				for (uint32_t j = 0; j < 3; j++) {
+					const uint32_t local = (tri.x >> (8*j)) & 0xFF;
+					if (local >= m.vertexCount || set.vertices[m.vertexOffset + local] != indices[3*tri.y + j])
+						passed = false;
+				}
+
+				// culled meshlets must only contain backfacing triangles
+				if (culled) {
+					const float3 p0 = positions[indices[3*tri.y + 0]];
+					const float3 normal = cross(positions[indices[3*tri.y + 1]] - p0, positions[indices[3*tri.y + 2]] - p0);
+					if (dot(normal, camera - p0) > 1e-6f)
+						passed = false;
+				}
+			}
+		}
+		if (std::ranges::any_of(triangleMeshletCounts, [](const uint32_t c) { return c != 1; }))
+			passed = false;
+
+		if (!passed) allPassed = false;
+
+		std::cout << "Sphere (" << triangleCount << " triangles): " << (passed ? "PASSED" : "FAILED")
+			<< " (" << set.meshlets.size() << " meshlets, " << float(triangleCount) / set.meshlets.size() << " triangles per meshlet, "
+			<< 100.f * culledCount / set.meshlets.size() << "% cone culled, " << buildTime << "ms)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Algorithm/MipGenerator/MipGenerator.hpp>
+
+#include <cfloat>
+#include <iostream>
+#include <random>
+
+using namespace RoseEngine;
+
+// Reduces level 0 of texels on the CPU, for one channel of floats. Children past the edge of odd sized levels are skipped.
+std::vector<std::vector<float>> ReferenceMips(const std::vector<float>& texels, const uint2 extent, const uint32_t mipLevels, const MipReduction reduction) {
+	std::vector<std::vector<float>> levels = { texels };
+	for (uint32_t level = 1; level < mipLevels; level++) {
+		const uint2 src = uint2(GetLevelExtent(uint3(extent, 1), level - 1));
+		const uint2 dst = uint2(GetLevelExtent(uint3(extent, 1), level));
+		std::vector<float> result(size_t(dst.x) * dst.y);
+		for (uint32_t y = 0; y < dst.y; y++)
+			for (uint32_t x = 0; x < dst.x; x++) {
+				float r = reduction == MipReduction::eMax ? -FLT_MAX : reduction == MipReduction::eMin ? FLT_MAX : 0;
+				uint32_t count = 0;
+				for (uint32_t j = 0; j < 4; j++) {
+					const uint2 c = uint2(2*x + (j & 1), 2*y + (j >> 1));
+					if (c.x >= src.x || c.y >= src.y) continue;
+					const float v = levels.back()[size_t(c.y) * src.x + c.x];
+					switch (reduction) {
+					case MipReduction::eMax: r = std::max(r, v); break;
+					case MipReduction::eMin: r = std::min(r, v); break;
+					default:                 r += v; break;
+					}
+					count++;
+				}
+				if (reduction == MipReduction::eAverage) r /= count;
+				result[size_t(y) * dst.x + x] = r;
+			}
+		levels.emplace_back(std::move(result));
+	}
+	return levels;
+}
+
+float SrgbToLinear(const float c) {
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+ref<Image> CreateImage(Device& device, const vk::Format format, const uint2 extent) {
+	ImageInfo info = {
+		.format = format,
+		.extent = uint3(extent, 1),
+		.mipLevels = GetMaxMipLevels(uint3(extent, 1)) };
+	MipGenerator::Configure(device, info);
+	return Image::Create(device, info);
+}
+
+template<typename T>
+std::vector<BufferRange<T>> ReadLevels(CommandContext& context, const ref<Image>& image, const uint32_t channels) {
+	std::vector<BufferRange<T>> levels;
+	for (uint32_t level = 0; level < image->Info().mipLevels; level++) {
+		const uint3 e = GetLevelExtent(image->Info().extent, level);
+		levels.emplace_back(Buffer::Create(context.GetDevice(), std::vector<T>(size_t(e.x) * e.y * channels), vk::BufferUsageFlagBits::eTransferDst));
+		context.Copy(ImageView::Create(image), levels.back(), level);
+	}
+	return levels;
+}
+
+// Checks every reduction against the CPU on odd sized float images, including one that takes more than one dispatch,
+// checks sRGB filtering against blits, and times both on a 4096x4096 RGBA8 image.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+
+	MipGenerator mipGenerator;
+	std::mt19937 rng(0);
+	bool allPassed = true;
+
+	// reductions of R32 images
+	for (const uint2 extent : { uint2(300, 77), uint2(1000, 1), uint2(5000, 40) }) {
+		std::uniform_real_distribution<float> dist(0, 1);
+		std::vector<float> texels(size_t(extent.x) * extent.y);
+		for (float& t : texels) t = dist(rng);
+
+		for (const MipReduction reduction : { MipReduction::eAverage, MipReduction::eMax, MipReduction::eMin, MipReduction::eSum }) {
+			const ref<Image> image = CreateImage(*device, vk::Format::eR32Sfloat, extent);
+
+			context->Begin();
+			context->Copy(context->UploadData(texels), ImageView::Create(image));
+			mipGenerator(*context, image, reduction);
+			const auto levels = ReadLevels<float>(*context, image, 1);
+			context->Submit();
+			device->Wait();
+
+			const auto expected = ReferenceMips(texels, extent, image->Info().mipLevels, reduction);
+			float maxError = 0;
+			for (uint32_t level = 0; level < levels.size(); level++)
+				for (size_t i = 0; i < expected[level].size(); i++)
+					maxError = std::max(maxError, std::abs(levels[level][i] - expected[level][i]) / std::max(1.f, std::abs(expected[level][i])));
+
+			const bool passed = maxError < 1e-4f;
+			if (!passed) allPassed = false;
+			const char* names[] = { "average", "max", "min", "sum" };
+			std::cout << extent.x << "x" << extent.y << " " << names[(uint32_t)reduction] << ": " << (passed ? "PASSED" : "FAILED") << " (max relative error " << maxError << ")" << std::endl;
+		}
+	}
+
+	// sRGB averages are taken in linear space, like blits of sRGB images
+	{
+		const uint2 extent = uint2(512, 512);
+		std::vector<uint8_t> texels(size_t(extent.x) * extent.y * 4);
+		for (uint8_t& t : texels) t = uint8_t(rng() & 0xFF);
+
+		const ref<Image> computeImage = CreateImage(*device, vk::Format::eR8G8B8A8Srgb, extent);
+		const ref<Image> blitImage    = CreateImage(*device, vk::Format::eR8G8B8A8Srgb, extent);
+
+		context->Begin();
+		context->Copy(context->UploadData(texels), ImageView::Create(computeImage));
+		context->Copy(context->UploadData(texels), ImageView::Create(blitImage));
+		mipGenerator(*context, computeImage);
+		context->GenerateMipMaps(blitImage);
+		const auto computeLevels = ReadLevels<uint8_t>(*context, computeImage, 4);
+		const auto blitLevels    = ReadLevels<uint8_t>(*context, blitImage, 4);
+		context->Submit();
+		device->Wait();
+
+		// level 1 of the red channel, from the linear average of level 0
+		float maxError = 0;
+		for (uint32_t y = 0; y < extent.y/2; y++)
+			for (uint32_t x = 0; x < extent.x/2; x++) {
+				float sum = 0;
+				for (uint32_t j = 0; j < 4; j++)
+					sum += SrgbToLinear(texels[(size_t(2*y + (j >> 1)) * extent.x + 2*x + (j & 1)) * 4] / 255.f);
+				maxError = std::max(maxError, std::abs(SrgbToLinear(computeLevels[1][(size_t(y) * extent.x/2 + x) * 4] / 255.f) - sum / 4));
+			}
+
+		int maxBlitDifference = 0;
+		for (uint32_t level = 1; level < computeLevels.size(); level++)
+			for (size_t i = 0; i < computeLevels[level].size(); i++)
+				maxBlitDifference = std::max(maxBlitDifference, std::abs(int(computeLevels[level][i]) - int(blitLevels[level][i])));
+
+		const bool passed = maxError < 0.01f && maxBlitDifference <= 2;
+		if (!passed) allPassed = false;
+		std::cout << "sRGB average: " << (passed ? "PASSED" : "FAILED") << " (max linear error " << maxError << ", max difference from blits " << maxBlitDifference << ")" << std::endl;
+	}
+
+	// benchmark against blits
+	{
+		const uint2 extent = uint2(4096, 4096);
+		const ref<Image> computeImage = CreateImage(*device, vk::Format::eR8G8B8A8Unorm, extent);
+		const ref<Image> blitImage    = CreateImage(*device, vk::Format::eR8G8B8A8Unorm, extent);
+		std::vector<uint8_t> texels(size_t(extent.x) * extent.y * 4);
+		for (uint8_t& t : texels) t = uint8_t(rng() & 0xFF);
+
+		vk::raii::QueryPool queryPool(**device, vk::QueryPoolCreateInfo{
+			.queryType = vk::QueryType::eTimestamp,
+			.queryCount = 4 });
+
+		double times[2] = { 0, 0 };
+		const uint32_t iterations = 8;
+		for (uint32_t i = 0; i <= iterations; i++) {
+			context->Begin();
+			if (i == 0) {
+				context->Copy(context->UploadData(texels), ImageView::Create(computeImage));
+				context->Copy(context->UploadData(texels), ImageView::Create(blitImage));
+			}
+			(*context)->resetQueryPool(*queryPool, 0, 4);
+			context->ExecuteBarriers();
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 0);
+			context->GenerateMipMaps(blitImage);
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 1);
+			mipGenerator(*context, computeImage);
+			context->ExecuteBarriers();
+			(*context)->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *queryPool, 2);
+			context->Submit();
+			device->Wait();
+
+			auto [result, timestamps] = queryPool.getResults<uint64_t>(0, 3, sizeof(uint64_t)*3, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+			if (i == 0) continue; // warm up
+			times[0] += (timestamps[1] - timestamps[0]) * device->Limits().timestampPeriod / 1e6 / iterations;
+			times[1] += (timestamps[2] - timestamps[1]) * device->Limits().timestampPeriod / 1e6 / iterations;
+		}
+
+		std::cout << extent.x << "x" << extent.y << " RGBA8: blits " << times[0] << "ms, compute " << times[1] << "ms (" << times[0] / times[1] << "x)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -44,12 +44,11 @@ int main(int argc, const char** argv) {
 
 			prefixSum(*context, dataGpu);
 
-			context->Copy(dataGpu, dataCpu);
+			const ReadbackFuture<uint32_t> result = context->Readback(dataGpu);
 
 			context->Submit();
-			device->Wait();
 
-			std::ranges::copy(dataCpu, inputData.begin());
+			std::ranges::copy(result.get(), inputData.begin());
 		}
 
 		bool passed = true;
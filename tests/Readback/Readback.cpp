@@ -0,0 +1,68 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/CommandContext.hpp>
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Reads back more than the ring holds over many submits, releasing each readback once read, and checks that the ring
+// wraps around without growing. Then holds on to the readbacks, checking that the ring grows without overwriting them.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	const size_t count = 1 << 14; // 64KiB
+	const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+
+	bool allPassed = true;
+
+	{
+		bool passed = true;
+		bool readyBeforeSubmit = false;
+		vk::DeviceSize ringSize = 0;
+		for (uint32_t i = 0; i < 100; i++) {
+			context->Begin();
+			const BufferRange<uint32_t> buffer = context->GetTransientBuffer<uint32_t>(count, usage);
+			context->Fill(buffer, i);
+			const ReadbackFuture<uint32_t> result = context->Readback(buffer);
+			readyBeforeSubmit |= result.ready();
+			context->Submit();
+			if (!std::ranges::all_of(result.get(), [&](const uint32_t v) { return v == i; }))
+				passed = false;
+			if (i == 0)
+				ringSize = context->GetReadbackRing().Size();
+		}
+		passed = passed && !readyBeforeSubmit && context->GetReadbackRing().Size() == ringSize;
+		if (!passed) allPassed = false;
+		std::cout << "Released readbacks reuse the ring: " << (passed ? "PASSED" : "FAILED")
+			<< " (" << (context->GetReadbackRing().Size() >> 10) << "KiB)" << std::endl;
+	}
+
+	{
+		const vk::DeviceSize ringSize = context->GetReadbackRing().Size();
+		std::vector<ReadbackFuture<uint32_t>> results;
+		for (uint32_t i = 0; i < 64; i++) {
+			context->Begin();
+			const BufferRange<uint32_t> buffer = context->GetTransientBuffer<uint32_t>(count, usage);
+			context->Fill(buffer, i);
+			results.emplace_back(context->Readback(buffer));
+			context->Submit();
+		}
+		bool passed = context->GetReadbackRing().Size() > ringSize;
+		for (uint32_t i = 0; i < results.size(); i++)
+			if (!std::ranges::all_of(results[i].get(), [&](const uint32_t v) { return v == i; }))
+				passed = false;
+		if (!passed) allPassed = false;
+		std::cout << "Held readbacks grow the ring: " << (passed ? "PASSED" : "FAILED")
+			<< " (" << (context->GetReadbackRing().Size() >> 10) << "KiB)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
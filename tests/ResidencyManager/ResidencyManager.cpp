@@ -0,0 +1,133 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/CommandContext.hpp>
+#include <Rose/Core/TransientResourceCache.hpp>
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+struct Asset {
+	uint32_t   index;
+	float      priority;
+	ref<Image> image;
+	ResidencyManager::Handle residency;
+};
+
+// Loads textures past an artificial budget, and checks that the residency manager keeps usage under it by evicting
+// low priority and least recently used textures first, then that failed allocations make the next Enforce release
+// the command context's cached buffers.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0], { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME });
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+
+	ResidencyManager& residency = device->Residency();
+	const uint32_t assetCount = 32;
+	const uint32_t budgetAssets = 8;
+	const vk::DeviceSize assetBytes = 2048 * 2048 * 4;
+	residency.budgetOverride = residency.Usage() + budgetAssets * assetBytes + assetBytes/2;
+
+	bool allPassed = true;
+	std::vector<std::unique_ptr<Asset>> assets;
+	std::vector<uint32_t> evicted;
+	TransientResourceCache<ref<Image>> retired;
+	vk::DeviceSize maxUsage = 0;
+	bool priorityOrder = true;
+
+	for (uint32_t i = 0; i < assetCount; i++) {
+		Asset* asset = assets.emplace_back(std::make_unique<Asset>()).get();
+		asset->index    = i;
+		asset->priority = (i % 2) ? 0.75f : 0.25f;
+		// dedicated, so that evicting an asset returns its memory to the heap
+		asset->image = Image::Create(*device, ImageInfo{
+				.format = vk::Format::eR8G8B8A8Unorm,
+				.extent = uint3(2048, 2048, 1),
+				.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled },
+			vk::MemoryPropertyFlagBits::eDeviceLocal, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT, asset->priority);
+		asset->residency = residency.Register({
+			.name = "Asset " + std::to_string(i),
+			.priority = asset->priority,
+			.size = [=]() { return asset->image ? asset->image->MemorySize() : 0; },
+			// the image may be cleared by the commands being recorded, so it is kept alive until they are done
+			.evict = [&, asset](CommandContext&, const vk::DeviceSize) -> vk::DeviceSize {
+				if (!asset->image) return 0;
+				if (asset->priority > 0.5f)
+					for (const auto& a : assets)
+						if (a->image && a->priority < 0.5f) priorityOrder = false;
+				const vk::DeviceSize size = asset->image->MemorySize();
+				retired.push(asset->image, device->NextTimelineSignal());
+				asset->image.reset();
+				evicted.emplace_back(asset->index);
+				return size;
+			} });
+
+		context->Begin();
+		context->ClearColor(ImageView::Create(asset->image), vk::ClearColorValue(std::array<float,4>{ 1, 0, 1, 1 }));
+		asset->residency.Touch(device->NextTimelineSignal());
+		residency.Enforce(*context);
+		context->Submit();
+		device->Wait();
+
+		while (retired.can_pop(*device))
+			retired.pop();
+		maxUsage = std::max(maxUsage, residency.Usage());
+	}
+
+	{
+		const bool passed = maxUsage <= residency.Budget();
+		if (!passed) allPassed = false;
+		std::cout << "Usage under budget: " << (passed ? "PASSED" : "FAILED") << " (max " << (maxUsage >> 20) << "MiB, budget " << (residency.Budget() >> 20) << "MiB)" << std::endl;
+	}
+	{
+		const bool passed = priorityOrder && !evicted.empty();
+		if (!passed) allPassed = false;
+		std::cout << "Low priority evicted first: " << (passed ? "PASSED" : "FAILED") << " (" << evicted.size() << " evictions)" << std::endl;
+	}
+	{
+		// assets of the same priority are evicted least recently used first, which is creation order here
+		bool passed = true;
+		for (const float priority : { 0.25f, 0.75f }) {
+			uint32_t last = 0;
+			bool first = true;
+			for (const uint32_t i : evicted) {
+				if (assets[i]->priority != priority) continue;
+				if (!first && i < last) passed = false;
+				last = i;
+				first = false;
+			}
+		}
+		if (!passed) allPassed = false;
+		std::cout << "Least recently used evicted first: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	assets.clear();
+
+	// transient buffers return to the context's cache once the context begins again
+	{
+		const vk::DeviceSize bufferBytes = 64 << 20;
+		context->Begin();
+		context->Fill(context->GetTransientBuffer<uint32_t>(bufferBytes / sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferDst), 0u);
+		context->Submit();
+		context->Begin();
+		// failed allocations don't evict anything themselves, the next Enforce does
+		const vk::DeviceSize evictedBefore = residency.GetStats().evictedBytes;
+		residency.AllocationFailed(1);
+		const bool deferred = residency.GetStats().evictedBytes == evictedBefore;
+		residency.Enforce(*context);
+		const vk::DeviceSize freed = residency.GetStats().evictedBytes - evictedBefore;
+		context->Submit();
+		device->Wait();
+
+		const bool passed = deferred && freed >= bufferBytes;
+		if (!passed) allPassed = false;
+		std::cout << "Release cached transient buffers: " << (passed ? "PASSED" : "FAILED") << " (" << (freed >> 20) << "MiB freed)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
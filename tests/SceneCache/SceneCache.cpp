@@ -0,0 +1,77 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Scene/SceneCache.hpp>
+#include "../Common/TestScene.hpp"
+
+#include <chrono>
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Imports a glTF, writes its scene cache, loads the cache back and checks that it reproduces the imported scene,
+// including every texel of every mip level. Also checks that caches written with other options or from an older
+// version of the source or of the buffer and image files it refers to are ignored.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eTransfer);
+
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() / "RoseTestSceneCache";
+	std::filesystem::create_directories(dir);
+	WriteTestScene(dir, 2, 256, 4, 32);
+	const std::filesystem::path source = dir / "scene.gltf";
+	const uint32_t options = SceneCache::eQuantizeVertices;
+
+	context->Begin();
+	std::vector<std::filesystem::path> externalFiles;
+	ref<SceneNode> imported = LoadGLTF(*context, source, true, 0, TextureCompression::eNone, nullptr, nullptr, &externalFiles);
+	SceneCache cache = SceneCache::Record(*context, imported, source, options, externalFiles);
+	context->Submit();
+	device->Wait();
+
+	bool writePassed = false;
+	if (cache.IsReady(*device)) {
+		try {
+			writePassed = cache.Write() > 0 && std::filesystem::exists(SceneCache::GetPath(source));
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+		}
+	}
+
+	context->Begin();
+	ref<SceneNode> loaded = SceneCache::Load(*context, source, options);
+	ref<SceneNode> otherOptions = SceneCache::Load(*context, source, SceneCache::eNone);
+	context->Submit();
+	device->Wait();
+	std::vector<std::pair<ImageView, ImageView>> images;
+	const bool scenePassed  = imported && loaded && SameScene(*imported, *loaded, images) && !images.empty();
+	const bool texelsPassed = scenePassed && SameTexels(*context, images);
+
+	// touching the source or a file it refers to makes the cache out of date
+	auto outdatedBy = [&](const std::filesystem::path& file) {
+		const auto time = std::filesystem::last_write_time(file);
+		std::filesystem::last_write_time(file, time + std::chrono::seconds(1));
+		context->Begin();
+		ref<SceneNode> outdated = SceneCache::Load(*context, source, options);
+		context->Submit();
+		device->Wait();
+		std::filesystem::last_write_time(file, time);
+		return outdated == nullptr;
+	};
+	const bool rejectPassed = !otherOptions && externalFiles.size() == 3 &&
+		outdatedBy(dir / "scene.bin") && outdatedBy(dir / "image1.png") && outdatedBy(source);
+
+	std::filesystem::remove_all(dir);
+
+	std::cout << "Write: "                 << (writePassed  ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Identical scenes: "      << (scenePassed  ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Identical texels: "      << (texelsPassed ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Rejects stale caches: "  << (rejectPassed ? "PASSED" : "FAILED") << std::endl;
+
+	if (writePassed && scenePassed && texelsPassed && rejectPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
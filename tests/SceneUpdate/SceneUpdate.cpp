@@ -0,0 +1,135 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Scene/Scene.hpp>
+#include "../Common/TestMesh.hpp"
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Object to world transform of a node, from its ancestors' transforms
+Transform WorldTransform(SceneNode& node) {
+	Transform t = node.transform.value_or(Transform::Identity());
+	for (ref<SceneNode> p = node.GetParent(); p; p = p->GetParent())
+		t = p->transform.value_or(Transform::Identity()) * t;
+	return t;
+}
+
+bool SameTransform(const Transform& a, const Transform& b) {
+	for (uint32_t c = 0; c < 4; c++)
+		if (any(glm::greaterThan(glm::abs(a.transform[c] - b.transform[c]), float4(1e-5f))))
+			return false;
+	return true;
+}
+
+// Builds a scene of two groups of instances with a material each, then edits a group's transform and a material
+// through SceneNode::SetDirty. Checks that the edits are applied without rebuilding the draw lists, that the
+// instance transforms and materials on the device match the scene graph, and that structure edits still rebuild.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	// no pipelines are created, as nothing is drawn
+	const std::pair<std::tuple<MeshLayout>, ref<Pipeline>> pipeline = {};
+	auto getPipeline = [&](Device&, const Mesh&, const Material<ImageView>&) -> const auto& { return pipeline; };
+
+	const uint32_t groupSize = 16;
+
+	context->Begin();
+	const ref<Mesh> quad = CreateQuad(*context);
+	ref<SceneNode> root = SceneNode::Create("root");
+	ref<SceneNode> groups[2];
+	ref<Material<ImageView>> materials[2];
+	for (uint32_t g = 0; g < 2; g++) {
+		groups[g] = SceneNode::Create("group" + std::to_string(g));
+		groups[g]->transform = Transform::Translate(float3(0, 0, 2*g));
+		groups[g]->SetParent(root);
+		materials[g] = make_ref<Material<ImageView>>();
+		materials[g]->SetBaseColor(float3(1));
+		materials[g]->SetRoughness(0.25f);
+		for (uint32_t i = 0; i < groupSize; i++) {
+			ref<SceneNode> n = SceneNode::Create("instance" + std::to_string(i));
+			n->transform = Transform::Translate(float3(i, 0, 0));
+			n->mesh = quad;
+			n->material = materials[g];
+			n->SetParent(groups[g]);
+		}
+	}
+
+	Scene scene;
+	scene.sceneRoot = root;
+	scene.SetDirty();
+	scene.PreRender(*context, getPipeline);
+	context->Submit();
+	device->Wait();
+
+	const uint64_t version0 = scene.renderData.drawListVersion;
+
+	// Reads back the device instance data and compares it with the scene graph
+	auto checkDeviceData = [&]() {
+		context->Begin();
+		auto headers    = context->Readback(scene.renderData.sceneParameters["instances"].get<BufferParameter>().cast<InstanceHeader>());
+		auto transforms = context->Readback(scene.renderData.sceneParameters["transforms"].get<BufferParameter>().cast<Transform>());
+		auto packed     = context->Readback(scene.renderData.sceneParameters["materials"].get<BufferParameter>().cast<Material<uint32_t>>());
+		context->Submit();
+		device->Wait();
+
+		const auto& nodes = scene.renderData.instanceNodes;
+		if (nodes.size() != scene.InstanceTransforms().size()) return false;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			const ref<SceneNode> n = nodes[i].lock();
+			if (!n) return false;
+			const InstanceHeader& header = headers.get()[i];
+			const Transform expected = WorldTransform(*n);
+			if (!SameTransform(scene.InstanceTransforms()[i], expected) ||
+				!SameTransform(transforms.get()[header.transformIndex], expected) ||
+				packed.get()[header.materialIndex].packed != n->material->packed)
+				return false;
+		}
+		return true;
+	};
+
+	const bool buildPassed = scene.renderData.instanceNodes.size() == 2*groupSize && checkDeviceData();
+
+	// move a group and change the other group's roughness
+	groups[0]->transform = Transform::Translate(float3(0, 1, 0));
+	groups[0]->SetDirty(SceneNodeDirtyFlags::eTransform);
+	materials[1]->SetRoughness(0.75f);
+	(*groups[1]->begin())->SetDirty(SceneNodeDirtyFlags::eMaterial);
+
+	context->Begin();
+	scene.PreRender(*context, getPipeline);
+	context->Submit();
+	device->Wait();
+
+	// software ray tracing rebuilds the instance BVH, and the rest of the scene with it, when transforms change
+	const bool incremental = scene.renderData.drawListVersion == version0 || !device->SupportsRayQuery();
+	const bool editPassed = incremental && !root->IsDirty() && checkDeviceData();
+
+	// adding a node changes the structure, which rebuilds the draw lists
+	ref<SceneNode> added = SceneNode::Create("added");
+	added->transform = Transform::Translate(float3(0, 0, 4));
+	added->mesh = quad;
+	added->material = materials[0];
+	added->SetParent(groups[1]);
+
+	const uint64_t version1 = scene.renderData.drawListVersion;
+	context->Begin();
+	scene.PreRender(*context, getPipeline);
+	context->Submit();
+	device->Wait();
+
+	const bool structurePassed = scene.renderData.drawListVersion == version1 + 1 && scene.renderData.instanceNodes.size() == 2*groupSize + 1 && checkDeviceData();
+
+	std::cout << "Initial build: "             << (buildPassed     ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Transform and material edits: " << (editPassed   ? "PASSED" : "FAILED") << (incremental && device->SupportsRayQuery() ? " (incremental)" : "") << std::endl;
+	std::cout << "Structure edit: "            << (structurePassed ? "PASSED" : "FAILED") << std::endl;
+
+	if (buildPassed && editPassed && structurePassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
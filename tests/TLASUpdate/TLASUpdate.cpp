@@ -0,0 +1,142 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/Pipeline.hpp>
+#include <Rose/Core/ShaderModule.hpp>
+#include <Rose/Scene/Scene.hpp>
+#include "../Common/TestMesh.hpp"
+
+#include <bit>
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Moves instances of a scene one at a time through SceneNode::SetDirty, and checks that the TLAS is refit in place
+// until maxTlasUpdates, then rebuilt. After every edit, traces a ray onto the center of each instance and checks
+// that it hits that instance.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+
+	if (!device->SupportsRayQuery()) {
+		std::cout << "Ray queries not supported, skipping" << std::endl;
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	auto tracePipeline = Pipeline::CreateCompute(*device, ShaderModule::Create(*device, FindShaderPath("TLASUpdate.cs.slang"), "testMain"));
+
+	// no graphics pipelines are created, as nothing is drawn
+	const std::pair<std::tuple<MeshLayout>, ref<Pipeline>> pipeline = {};
+	auto getPipeline = [&](Device&, const Mesh&, const Material<ImageView>&) -> const auto& { return pipeline; };
+
+	const uint32_t nodeCount = 16;
+	const uint32_t maxTlasUpdates = 3;
+
+	context->Begin();
+	const ref<Mesh> quad = CreateQuad(*context);
+	const ref<Material<ImageView>> material = make_ref<Material<ImageView>>();
+	ref<SceneNode> root = SceneNode::Create("root");
+	std::vector<ref<SceneNode>> nodes(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		nodes[i] = SceneNode::Create("instance" + std::to_string(i));
+		nodes[i]->transform = Transform::Translate(float3(2*i, 0, 0));
+		nodes[i]->mesh = quad;
+		nodes[i]->material = material;
+		nodes[i]->SetParent(root);
+	}
+
+	Scene scene;
+	scene.maxTlasUpdates = maxTlasUpdates;
+	scene.compactAccelerationStructures = false;
+	scene.sceneRoot = root;
+	scene.SetDirty();
+	scene.PreRender(*context, getPipeline);
+	context->Submit();
+	device->Wait();
+
+	// traces a ray down onto the center of each node's quad
+	auto trace = [&]() {
+		std::vector<float4> rayOrigins(nodeCount);
+		for (uint32_t i = 0; i < nodeCount; i++)
+			rayOrigins[i] = float4(nodes[i]->transform->TransformPoint(float3(0.5f, 0, 0.5f)) + float3(0, 1, 0), 0);
+
+		auto hitsCpu = Buffer::Create(*device, std::vector<float2>(nodeCount), vk::BufferUsageFlagBits::eTransferDst);
+
+		context->Begin();
+		auto hits = context->GetTransientBuffer<float2>(nodeCount, vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferSrc);
+		ShaderParameter params;
+		params["accelerationStructure"] = scene.renderData.accelerationStructure;
+		params["rayOrigins"] = (BufferView)context->UploadData(rayOrigins, vk::BufferUsageFlagBits::eStorageBuffer);
+		params["hits"]       = (BufferView)hits;
+		params["rayCount"]   = nodeCount;
+		context->Dispatch(*tracePipeline, nodeCount, params);
+		context->Copy(hits, hitsCpu);
+		context->Submit();
+		device->Wait();
+
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			const uint32_t hitInstance = std::bit_cast<uint32_t>(hitsCpu[i].y);
+			if (hitInstance >= scene.renderData.instanceNodes.size() ||
+				scene.renderData.instanceNodes[hitInstance].lock() != nodes[i] ||
+				std::abs(hitsCpu[i].x - 1) > 1e-4f) {
+				std::cout << "Mismatch at ray " << i << ": instance " << hitInstance << ", t = " << hitsCpu[i].x << std::endl;
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// kept alive so that a rebuilt TLAS can't reuse its address
+	ref<AccelerationStructure> tlas = scene.renderData.accelerationStructure;
+	bool allPassed = true;
+	{
+		const bool passed = tlas && tlas->UpdateCount() == 0 && trace();
+		if (!passed) allPassed = false;
+		std::cout << "Initial build: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	// the first maxTlasUpdates edits refit the TLAS, and the next one rebuilds it
+	for (uint32_t edit = 1; edit <= maxTlasUpdates + 1; edit++) {
+		ref<SceneNode>& n = nodes[edit];
+		n->transform = Transform::Translate(float3(2*edit, 0.25f*edit, 3));
+		n->SetDirty(SceneNodeDirtyFlags::eTransform);
+
+		const uint64_t drawListVersion = scene.renderData.drawListVersion;
+		context->Begin();
+		scene.PreRender(*context, getPipeline);
+		context->Submit();
+		device->Wait();
+
+		const ref<AccelerationStructure> current = scene.renderData.accelerationStructure;
+		const bool refit = edit <= maxTlasUpdates;
+		const bool passed =
+			scene.renderData.drawListVersion == drawListVersion &&
+			(refit ? current == tlas && current->UpdateCount() == edit : current != tlas && current->UpdateCount() == 0) &&
+			trace();
+		if (!passed) allPassed = false;
+		tlas = current;
+		std::cout << "Edit " << edit << (refit ? " refit: " : " rebuild: ") << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	// forcing a full rebuild without any changes rebuilds the TLAS
+	{
+		scene.SetDirty();
+		context->Begin();
+		scene.PreRender(*context, getPipeline);
+		context->Submit();
+		device->Wait();
+		const ref<AccelerationStructure> current = scene.renderData.accelerationStructure;
+		const bool passed = current != tlas && current->UpdateCount() == 0 && trace();
+		if (!passed) allPassed = false;
+		std::cout << "Forced rebuild: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include <Rose/Core/TextureCompression.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+using namespace RoseEngine;
+
+// Reference decoders, written from the format specifications independently of the encoder
+
+void DecodeBC1(const uint8_t* block, std::array<std::array<float, 4>, 16>& texels) {
+	uint16_t c[2];
+	uint32_t indices;
+	std::memcpy(c, block, 4);
+	std::memcpy(&indices, block + 4, 4);
+	std::array<std::array<float, 3>, 4> palette = {};
+	for (uint32_t j = 0; j < 2; j++) {
+		const uint32_t r = c[j] >> 11, g = (c[j] >> 5) & 63, b = c[j] & 31;
+		palette[j] = { float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)) };
+	}
+	for (uint32_t i = 0; i < 3; i++) {
+		if (c[0] > c[1]) {
+			palette[2][i] = (2*palette[0][i] + palette[1][i]) / 3;
+			palette[3][i] = (palette[0][i] + 2*palette[1][i]) / 3;
+		} else {
+			palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+			palette[3][i] = 0;
+		}
+	}
+	for (uint32_t t = 0; t < 16; t++)
+		for (uint32_t i = 0; i < 3; i++)
+			texels[t][i] = palette[(indices >> (2*t)) & 3][i];
+}
+
+void DecodeBC4(const uint8_t* block, const uint32_t channel, std::array<std::array<float, 4>, 16>& texels) {
+	const float a0 = block[0], a1 = block[1];
+	float palette[8] = { a0, a1 };
+	for (uint32_t i = 2; i < 8; i++) {
+		if (a0 > a1)
+			palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		else
+			palette[i] = i < 6 ? ((7 - i) * a0 + (i - 1) * a1) / 5 : (i == 6 ? 0 : 255);
+	}
+	uint64_t indices = 0;
+	std::memcpy(&indices, block + 2, 6);
+	for (uint32_t t = 0; t < 16; t++)
+		texels[t][channel] = palette[(indices >> (3*t)) & 7];
+}
+
+// Mode 6 only
+bool DecodeBC7(const uint8_t* block, std::array<std::array<float, 4>, 16>& texels) {
+	uint32_t position = 0;
+	auto read = [&](const uint32_t count) {
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < count; i++, position++)
+			value |= ((block[position / 8] >> (position % 8)) & 1) << i;
+		return value;
+	};
+	if (read(7) != (1 << 6))
+		return false;
+	uint32_t e[2][4];
+	for (uint32_t c = 0; c < 4; c++) {
+		e[0][c] = read(7);
+		e[1][c] = read(7);
+	}
+	const uint32_t p0 = read(1), p1 = read(1);
+	for (uint32_t c = 0; c < 4; c++) {
+		e[0][c] = (e[0][c] << 1) | p0;
+		e[1][c] = (e[1][c] << 1) | p1;
+	}
+	static const uint32_t kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	for (uint32_t t = 0; t < 16; t++) {
+		const uint32_t index = read(t == 0 ? 3 : 4);
+		for (uint32_t c = 0; c < 4; c++)
+			texels[t][c] = float(((64 - kWeights[index]) * e[0][c] + kWeights[index] * e[1][c] + 32) >> 6);
+	}
+	return true;
+}
+
+// Compresses smooth images with noise for each usage, decodes the top level with the reference decoders,
+// and checks the format, the mip chain and the reported PSNR against the decoded texels.
+int main(int argc, const char** argv) {
+	const uint2 extent = uint2(200, 120); // not a multiple of 4 below the top level
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<float> noise(-4, 4);
+
+	// color with an alpha gradient, and a tangent space normal map of bumps
+	std::vector<uint8_t> color(size_t(extent.x) * extent.y * 4), normal(color.size());
+	for (uint32_t y = 0; y < extent.y; y++)
+		for (uint32_t x = 0; x < extent.x; x++) {
+			uint8_t* c = &color[(size_t(y) * extent.x + x) * 4];
+			const float u = x / float(extent.x), v = y / float(extent.y);
+			c[0] = (uint8_t)std::clamp(255 * u + noise(rng), 0.f, 255.f);
+			c[1] = (uint8_t)std::clamp(255 * v + noise(rng), 0.f, 255.f);
+			c[2] = (uint8_t)std::clamp(128 + 100 * std::sin(8 * u) * std::cos(5 * v) + noise(rng), 0.f, 255.f);
+			c[3] = (uint8_t)(255 * (u + v) / 2);
+
+			float3 n = normalize(float3(0.3f * std::sin(20 * u), 0.3f * std::cos(14 * v), 1));
+			uint8_t* p = &normal[(size_t(y) * extent.x + x) * 4];
+			for (uint32_t i = 0; i < 3; i++)
+				p[i] = (uint8_t)std::lround((n[i] * 0.5f + 0.5f) * 255);
+			p[3] = 255;
+		}
+	std::vector<uint8_t> opaque = color;
+	for (size_t i = 3; i < opaque.size(); i += 4)
+		opaque[i] = 255;
+	std::vector<uint8_t> gray = color;
+	for (size_t i = 0; i < gray.size(); i += 4)
+		gray[i + 1] = gray[i + 2] = gray[i];
+
+	struct Case {
+		const char*                 name;
+		const std::vector<uint8_t>& texels;
+		TextureUsage                usage;
+		bool                        highQuality;
+		vk::Format                  format;
+		std::vector<uint32_t>       channels; // source channel of each channel usage reads, in the order they are stored
+		double                      minPsnr;
+	};
+	const Case cases[] = {
+		{ "BC1 color",               opaque, TextureUsage::eColor,             false, vk::Format::eBc1RgbSrgbBlock, { 0, 1, 2 },    36 },
+		{ "BC3 color and alpha",     color,  TextureUsage::eColor,             false, vk::Format::eBc3SrgbBlock,    { 0, 1, 2, 3 }, 36 },
+		{ "BC7 color and alpha",     color,  TextureUsage::eColor,             true,  vk::Format::eBc7SrgbBlock,    { 0, 1, 2, 3 }, 38 },
+		{ "BC5 normal",              normal, TextureUsage::eNormal,            false, vk::Format::eBc5UnormBlock,   { 0, 1 },       50 },
+		{ "BC5 metallic/roughness",  color,  TextureUsage::eMetallicRoughness, false, vk::Format::eBc5UnormBlock,   { 1, 2 },       45 },
+		{ "BC4 mask",                gray,   TextureUsage::eMask,              false, vk::Format::eBc4UnormBlock,   { 0 },          45 },
+	};
+
+	bool allPassed = true;
+	double bc1Psnr = 0;
+	for (const Case& test : cases) {
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		const CompressedTexture result = CompressTexture(test.texels, extent, test.usage, test.highQuality);
+		const double ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - t0).count();
+
+		const DecodedImage& image = result.image;
+		const uint32_t mipLevels = GetMaxMipLevels(uint3(extent, 1));
+		bool passed =
+			image.format == test.format &&
+			image.extent == uint3(extent, 1) &&
+			image.mipLevels == mipLevels &&
+			image.regions.size() == mipLevels;
+		for (uint32_t level = 0; passed && level < mipLevels; level++) {
+			const vk::BufferImageCopy& r = image.regions[level];
+			const uint3 e = GetLevelExtent(image.extent, level);
+			passed = r.imageSubresource.mipLevel == level && r.imageExtent == vk::Extent3D{ e.x, e.y, 1 } && r.bufferOffset % 16 == 0 &&
+				r.bufferOffset + GetImageSize(image.format, e) <= image.pixels.size();
+		}
+
+		// decode the top level
+		double squaredError = 0;
+		if (passed) {
+			const uint32_t blocksX = (extent.x + 3) / 4;
+			const uint32_t blockSize = GetBlockSize(image.format);
+			for (uint32_t by = 0; by < (extent.y + 3) / 4; by++)
+				for (uint32_t bx = 0; bx < blocksX; bx++) {
+					const uint8_t* block = reinterpret_cast<const uint8_t*>(image.pixels.data()) + (size_t(by) * blocksX + bx) * blockSize;
+					std::array<std::array<float, 4>, 16> decoded = {};
+					switch (image.format) {
+					case vk::Format::eBc1RgbSrgbBlock: DecodeBC1(block, decoded); break;
+					case vk::Format::eBc3SrgbBlock:    DecodeBC4(block, 3, decoded); DecodeBC1(block + 8, decoded); break;
+					case vk::Format::eBc4UnormBlock:   DecodeBC4(block, 0, decoded); break;
+					case vk::Format::eBc5UnormBlock:   DecodeBC4(block, 0, decoded); DecodeBC4(block + 8, 1, decoded); break;
+					default: if (!DecodeBC7(block, decoded)) passed = false; break;
+					}
+					for (uint32_t t = 0; t < 16; t++) {
+						const uint32_t x = bx*4 + t%4, y = by*4 + t/4;
+						if (x >= extent.x || y >= extent.y) continue;
+						for (uint32_t c = 0; c < test.channels.size(); c++) {
+							const double d = decoded[t][c] - test.texels[(size_t(y) * extent.x + x) * 4 + test.channels[c]];
+							squaredError += d*d;
+						}
+					}
+				}
+		}
+		const double psnr = 10 * std::log10(255.0 * 255.0 / (squaredError / (double(extent.x) * extent.y * test.channels.size())));
+
+		passed = passed && std::abs(psnr - result.psnr) < 0.01 && psnr >= test.minPsnr;
+		if (test.format == vk::Format::eBc1RgbSrgbBlock) bc1Psnr = psnr;
+		// BC7 spends the same 16 bytes as BC3 on higher precision endpoints and indices
+		if (test.format == vk::Format::eBc7SrgbBlock) passed = passed && psnr > bc1Psnr;
+
+		if (!passed) allPassed = false;
+		std::cout << test.name << ": " << (passed ? "PASSED" : "FAILED")
+			<< " (PSNR " << psnr << " dB, reported " << result.psnr << " dB, "
+			<< (result.uncompressedBytes >> 10) << "KiB -> " << (image.pixels.size() >> 10) << "KiB, " << ms << "ms)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <Rose/Scene/TransformHierarchy.hpp>
+
+#include <iostream>
+#include <random>
+#include <stack>
+#include <chrono>
+
+// Compares world transform propagation in the flattened hierarchy against pointer-chasing traversal of the SceneNode tree
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	auto timeMs = [](auto fn) {
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		fn();
+		return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(std::chrono::high_resolution_clock::now() - t0).count();
+	};
+
+	std::mt19937 rng(0);
+	ThreadPool pool;
+	std::uniform_real_distribution<float> dist(-1, 1);
+
+	// nodeCount nodes, each child attached to parent (i - 1) / branching
+	auto createTree = [&](const uint32_t nodeCount, const uint32_t branching) {
+		std::vector<ref<SceneNode>> nodes(nodeCount);
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			nodes[i] = SceneNode::Create("node");
+			nodes[i]->transform = Transform::Translate(float3(dist(rng), dist(rng), dist(rng))) * Transform::Scale(float3(1 + 0.001f*dist(rng)));
+			if (i > 0)
+				nodes[i]->SetParent(nodes[(i - 1) / branching]);
+		}
+		return nodes;
+	};
+
+	bool allPassed = true;
+
+	for (const auto&[name, nodeCount, branching] : {
+			std::tuple{ "Deep", 10000u, 1u },
+			std::tuple{ "Wide", 200000u, 200000u },
+			std::tuple{ "Bushy", 200000u, 4u } }) {
+		const auto nodes = createTree(nodeCount, branching);
+
+		// reference: stack-based traversal, as Scene::PreRender used to do
+		std::unordered_map<const SceneNode*, Transform> reference;
+		const double traverseTime = timeMs([&]() {
+			std::stack<std::pair<SceneNode*, Transform>> todo;
+			todo.push({nodes[0].get(), Transform::Identity()});
+			while (!todo.empty()) {
+				auto [n, t] = todo.top();
+				todo.pop();
+				reference[n] = t;
+				for (const ref<SceneNode>& c : *n)
+					todo.push({c.get(), c->transform.has_value() ? t * c->transform.value() : t});
+			}
+		});
+
+		TransformHierarchy hierarchy;
+		const double buildTime = timeMs([&]() { hierarchy.Build(*nodes[0]); });
+		const double propagateTime = timeMs([&]() { hierarchy.Propagate(); });
+
+		bool passed = hierarchy.size() == nodeCount;
+		for (uint32_t i = 0; i < hierarchy.size() && passed; i++) {
+			const float4x4 d = hierarchy.worldTransforms[i].transform - reference.at(hierarchy.nodes[i]).transform;
+			for (uint32_t c = 0; c < 4; c++)
+				if (any(glm::greaterThan(glm::abs(d[c]), float4(1e-3f))))
+					passed = false;
+		}
+
+		const std::vector<Transform> serial = hierarchy.worldTransforms;
+		const double parallelTime = timeMs([&]() { hierarchy.PropagateParallel(pool); });
+		for (uint32_t i = 0; i < hierarchy.size() && passed; i++)
+			if (hierarchy.worldTransforms[i].transform != serial[i].transform)
+				passed = false;
+
+		if (!passed) allPassed = false;
+
+		std::cout << name << " (" << nodeCount << " nodes, " << hierarchy.LevelCount() << " levels): " << (passed ? "PASSED" : "FAILED")
+			<< " (traverse " << traverseTime << "ms, build " << buildTime << "ms, propagate " << propagateTime << "ms, parallel " << parallelTime << "ms)" << std::endl;
+	}
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Core/CommandContext.hpp>
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Requests transient buffers whose lifetimes don't overlap, and checks that they share memory while the commands using
+// them stay ordered. Then checks that buffers which are still referenced don't share memory.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer);
+
+	const size_t count = 1 << 20;
+	const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+	const std::vector<uint32_t> values = { 1, 2, 3, 4 };
+	std::vector<BufferRange<uint32_t>> readbacks;
+	for (size_t i = 0; i < values.size(); i++)
+		readbacks.emplace_back(Buffer::Create(*device, std::vector<uint32_t>(count), vk::BufferUsageFlagBits::eTransferDst));
+
+	bool allPassed = true;
+
+	context->Begin();
+	for (size_t i = 0; i < values.size(); i++) {
+		// dropped at the end of the iteration, before the next one is requested
+		const BufferRange<uint32_t> buffer = context->GetTransientBuffer<uint32_t>(count, usage);
+		context->Fill(buffer, values[i]);
+		context->Copy(buffer, readbacks[i]);
+	}
+	context->Submit();
+	context->Begin();
+	{
+		const TransientHeap::Stats stats = context->GetTransientHeap().GetStats();
+		const bool passed = stats.aliasedCount == values.size() - 1 && stats.peakBytes < stats.requestedBytes;
+		if (!passed) allPassed = false;
+		std::cout << "Disjoint lifetimes aliased: " << (passed ? "PASSED" : "FAILED")
+			<< " (" << stats.aliasedCount << " aliased, peak " << (stats.peakBytes >> 10) << "KiB of " << (stats.requestedBytes >> 10) << "KiB)" << std::endl;
+	}
+	{
+		bool passed = true;
+		for (size_t i = 0; i < values.size(); i++)
+			if (!std::ranges::all_of(readbacks[i], [&](const uint32_t v) { return v == values[i]; }))
+				passed = false;
+		if (!passed) allPassed = false;
+		std::cout << "Aliased contents ordered: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+
+	{
+		std::vector<BufferRange<uint32_t>> buffers;
+		for (size_t i = 0; i < values.size(); i++) {
+			buffers.emplace_back(context->GetTransientBuffer<uint32_t>(count, usage));
+			context->Fill(buffers.back(), values[i]);
+		}
+		// blocks holding live resources can't be released
+		const bool passed = context->GetTransientHeap().UnusedSize() == 0;
+		if (!passed) allPassed = false;
+		std::cout << "Live blocks not releasable: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+	context->Submit();
+	context->Begin();
+	{
+		const TransientHeap::Stats stats = context->GetTransientHeap().GetStats();
+		const bool passed = stats.aliasedCount == 0 && stats.peakBytes >= stats.requestedBytes;
+		if (!passed) allPassed = false;
+		std::cout << "Overlapping lifetimes not aliased: " << (passed ? "PASSED" : "FAILED")
+			<< " (peak " << (stats.peakBytes >> 10) << "KiB of " << (stats.requestedBytes >> 10) << "KiB)" << std::endl;
+	}
+	{
+		const TransientHeap& heap = context->GetTransientHeap();
+		const bool passed = heap.Size() > 0 && heap.UnusedSize() == heap.Size() && context->CachedResourceBytes() >= heap.Size();
+		if (!passed) allPassed = false;
+		std::cout << "Unused blocks releasable: " << (passed ? "PASSED" : "FAILED") << std::endl;
+	}
+	context->Submit();
+	device->Wait();
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <Rose/Scene/VertexQuantization.hpp>
+#include <Rose/Core/MathUtils.h>
+
+#include <iostream>
+#include <random>
+
+// Quantizes random vertex streams and checks the decoded values against the precision of each encoding.
+// Also reports the memory of a position/normal/tangent/texcoord vertex before and after quantization.
+int main(int argc, const char** argv) {
+	std::span args = { argv, (size_t)argc };
+
+	using namespace RoseEngine;
+
+	bool allPassed = true;
+	auto report = [&](const char* name, const bool passed, const std::string& details) {
+		if (!passed) allPassed = false;
+		std::cout << name << ": " << (passed ? "PASSED" : "FAILED") << " (" << details << ")" << std::endl;
+	};
+
+	const uint32_t count = 100000;
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<float> u(0, 1);
+	std::normal_distribution<float> n(0, 1);
+	auto randomDirection = [&]() {
+		float3 d;
+		do { d = float3(n(rng), n(rng), n(rng)); } while (length(d) < 1e-4f);
+		return normalize(d);
+	};
+	// between unit vectors, accurate for small angles unlike acos(dot(a, b))
+	auto angle = [](const float3 a, const float3 b) {
+		return 2 * std::asin(std::min(length(a - b) / 2, 1.f));
+	};
+
+	// positions in an off-center box, with one flat axis
+	{
+		std::vector<float3> positions(count);
+		for (float3& p : positions)
+			p = float3(-3 + 8*u(rng), 10 + 0.5f*u(rng), -42);
+
+		float3 offset, scale;
+		const std::vector<uint2> quantized = QuantizePositions(reinterpret_cast<const std::byte*>(positions.data()), sizeof(float3), count, offset, scale);
+
+		bool passed = quantized.size() == count;
+		float3 maxError = float3(0);
+		for (uint32_t i = 0; i < quantized.size(); i++) {
+			const float3 p = offset + scale * UnpackSnorm16x3(quantized[i]);
+			maxError = max(maxError, abs(p - positions[i]));
+		}
+		// half a quantization step, plus float rounding of the decode
+		const float3 bound = scale / 32767.f * 0.5f + abs(offset) * 1e-6f + 1e-6f;
+		passed = passed && maxError.x <= bound.x && maxError.y <= bound.y && maxError.z <= bound.z;
+		report("Positions", passed, "max error " + std::to_string(maxError.x) + ", " + std::to_string(maxError.y) + ", " + std::to_string(maxError.z));
+	}
+
+	// unit normals
+	{
+		std::vector<float3> normals(count);
+		for (float3& d : normals)
+			d = randomDirection();
+		normals[0] = float3(0, 0, -1); // octahedron folds
+		normals[1] = float3(1, 0, 0);
+
+		const std::vector<uint32_t> quantized = QuantizeNormals(reinterpret_cast<const std::byte*>(normals.data()), sizeof(float3), count);
+		float maxAngle = 0;
+		for (uint32_t i = 0; i < quantized.size(); i++)
+			maxAngle = std::max(maxAngle, angle(UnpackOctahedral(quantized[i]), normals[i]));
+		report("Normals", quantized.size() == count && maxAngle < 1e-4f, "max error " + std::to_string(maxAngle * 180 / float(M_PI)) + " degrees");
+	}
+
+	// tangents with random handedness
+	{
+		std::vector<float4> tangents(count);
+		for (float4& t : tangents)
+			t = float4(randomDirection(), u(rng) < 0.5f ? -1 : 1);
+
+		const std::vector<uint32_t> quantized = QuantizeTangents(reinterpret_cast<const std::byte*>(tangents.data()), sizeof(float4), count);
+		bool passed = quantized.size() == count;
+		float maxAngle = 0;
+		for (uint32_t i = 0; i < quantized.size(); i++) {
+			const float4 t = UnpackOctahedralTangent(quantized[i]);
+			if (t.w != tangents[i].w)
+				passed = false;
+			maxAngle = std::max(maxAngle, angle(float3(t), float3(tangents[i])));
+		}
+		passed = passed && maxAngle < 2e-4f;
+		report("Tangents", passed, "max error " + std::to_string(maxAngle * 180 / float(M_PI)) + " degrees");
+	}
+
+	// texcoords in [0,1], and a set which wraps
+	{
+		std::vector<float2> texcoords(count);
+		for (float2& t : texcoords)
+			t = float2(u(rng), u(rng));
+		texcoords[0] = float2(0, 1);
+
+		const std::vector<uint32_t> quantized = QuantizeTexcoords(reinterpret_cast<const std::byte*>(texcoords.data()), sizeof(float2), count);
+		bool passed = quantized.size() == count;
+		float maxError = 0;
+		for (uint32_t i = 0; i < quantized.size(); i++) {
+			const float2 d = abs(UnpackUnorm16x2(quantized[i]) - texcoords[i]);
+			maxError = std::max(maxError, std::max(d.x, d.y));
+		}
+		passed = passed && maxError <= 0.5f / 65535.f + 1e-7f;
+
+		texcoords[count/2] = float2(1.5f, 0.5f);
+		passed = passed && QuantizeTexcoords(reinterpret_cast<const std::byte*>(texcoords.data()), sizeof(float2), count).empty();
+
+		report("Texcoords", passed, "max error " + std::to_string(maxError));
+	}
+
+	const size_t floatVertexSize     = sizeof(float3) + sizeof(float3) + sizeof(float4) + sizeof(float2);
+	const size_t quantizedVertexSize = sizeof(uint2) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint32_t);
+	std::cout << "Vertex size: " << floatVertexSize << " bytes -> " << quantizedVertexSize << " bytes ("
+		<< 100.f * (floatVertexSize - quantizedVertexSize) / floatVertexSize << "% smaller)" << std::endl;
+
+	if (allPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include <Rose/Core/Instance.hpp>
+#include <Rose/Scene/VirtualTexture.hpp>
+
+#include <iostream>
+
+using namespace RoseEngine;
+
+// Streams the tiles of a virtual image through a two tile cache, with pages requested from the host.
+// Checks the page table, residency and fault counts, that the least recently requested tile is evicted first,
+// and that tiles requested by the last readback are not evicted by uploads in the frames before the next one.
+// Also checks that clearing the cache removes the virtual image.
+int main(int argc, const char** argv) {
+	ref<Instance> instance = Instance::Create({}, { "VK_LAYER_KHRONOS_validation" });
+	ref<Device>   device   = Device::Create(*instance, (*instance)->enumeratePhysicalDevices()[0]);
+	ref<CommandContext> context = CommandContext::Create(device, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eTransfer);
+
+	VirtualTextureCache cache(1);
+	ShaderParameter sceneParameters = {};
+
+	// 4x1 tiles in level 0 and 2x1 tiles in level 1. Level 2 fits in a tile and is the tail.
+	const uint2 extent = uint2(4*kVirtualTileSize, kVirtualTileSize);
+	std::vector<uint8_t> rgba(size_t(extent.x) * extent.y * 4);
+	for (size_t i = 0; i < rgba.size(); i++)
+		rgba[i] = uint8_t(i * 7);
+	context->Begin();
+	const ImageView tail = cache.Add(*context, std::move(rgba), extent, false, "test");
+	context->Submit();
+	device->Wait();
+
+	const VirtualImageHeader* header = cache.Find(*tail.mImage);
+	if (!header) {
+		std::cout << "Page table: FAILED" << std::endl;
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+	cache.SetTileCapacity(2);
+
+	// Each submit records framesInFlight frames, of which only the first reads back requests, like frames rendered
+	// ahead of the device. Runs until no loads are pending and one more submit after that, or maxSubmits.
+	auto update = [&](const std::vector<uint32_t>& pages, const uint32_t framesInFlight, const uint32_t maxSubmits) {
+		bool settled = false;
+		for (uint32_t i = 0; i < maxSubmits; i++) {
+			context->Begin();
+			for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+				cache.RequestPages(pages);
+				cache.Update(*context, sceneParameters);
+			}
+			context->Submit();
+			device->Wait();
+			if (settled) break;
+			settled = i > 0 && cache.GetStats().pendingLoads == 0;
+		}
+	};
+	auto resident = [&](const uint32_t page) { return cache.PageTable()[page] != 0; };
+
+	const uint32_t a = header->pageTableOffsets[0] + 0;
+	const uint32_t b = header->pageTableOffsets[0] + 1;
+	const uint32_t c = header->pageTableOffsets[1] + 0;
+	const uint32_t d = header->pageTableOffsets[1] + 1;
+
+	const bool pagesPassed = header->tailLevel == 2 && cache.PageTable().size() == 6 && tail.Extent() == uint3(kVirtualTileSize, kVirtualTileSize/4, 1);
+
+	update({ a, b }, 2, 64);
+	const VirtualTextureCache::Stats stats0 = cache.GetStats();
+	const bool loadPassed = resident(a) && resident(b) && !resident(c) && !resident(d) &&
+		stats0.residentTiles == 2 && stats0.requestedTiles == 2 && stats0.pageFaults == 0 && stats0.totalFaults >= 2 && stats0.evictions == 0;
+
+	// a was requested more recently than b, so c replaces b
+	update({ a, c }, 2, 64);
+	const VirtualTextureCache::Stats stats1 = cache.GetStats();
+	const bool evictPassed = resident(a) && !resident(b) && resident(c) &&
+		stats1.residentTiles == 2 && stats1.requestedTiles == 2 && stats1.pageFaults == 0 && stats1.totalFaults >= 3 && stats1.evictions == 1;
+
+	// three tiles don't fit. a and c are requested by every readback, so d waits instead of evicting them in the
+	// frames between readbacks
+	update({ a, c, d }, 4, 8);
+	const VirtualTextureCache::Stats stats2 = cache.GetStats();
+	const bool thrashPassed = resident(a) && resident(c) && !resident(d) && stats2.evictions == 1 && stats2.requestedTiles == 3 && stats2.pageFaults == 1;
+
+	context->Begin();
+	cache.Clear(*context);
+	cache.Update(*context, sceneParameters);
+	context->Submit();
+	device->Wait();
+	const bool clearPassed = cache.Find(*tail.mImage) == nullptr && cache.ImageCount() == 0 && cache.PageTable().empty() && cache.GetStats().residentTiles == 0;
+
+	std::cout << "Page table: "              << (pagesPassed  ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Load requested tiles: "    << (loadPassed   ? "PASSED" : "FAILED") << std::endl;
+	std::cout << "Evict least recent tile: " << (evictPassed  ? "PASSED" : "FAILED") << " (" << stats1.evictions << " evictions)" << std::endl;
+	std::cout << "Keep requested tiles: "    << (thrashPassed ? "PASSED" : "FAILED") << " (" << stats2.evictions << " evictions, " << stats2.pageFaults << "/" << stats2.requestedTiles << " faults)" << std::endl;
+	std::cout << "Clear: "                   << (clearPassed  ? "PASSED" : "FAILED") << std::endl;
+
+	if (pagesPassed && loadPassed && evictPassed && thrashPassed && clearPassed) {
+		std::cout << "SUCCESS" << std::endl;
+		return EXIT_SUCCESS;
+	} else {
+		std::cout << "FAILURE" << std::endl;
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file